@@ -3,16 +3,76 @@
 
 #include "precomp.h"
 #include "AttrRow.hpp"
+#include "HyperlinkRegistry.hpp"
 
 // Routine Description:
 // - constructor
 // Arguments:
 // - cchRowWidth - the length of the default text attribute
 // - attr - the default text attribute
+// - hyperlinks - the registry to hold references to the hyperlinks of this row in, if any
+// - allocator - allocates the runs once the row has more than one
 // Return Value:
 // - constructed object
-ATTR_ROW::ATTR_ROW(const uint16_t width, const TextAttribute attr) :
-    _data(width, attr) {}
+ATTR_ROW::ATTR_ROW(const uint16_t width, const TextAttribute attr, HyperlinkRegistry* hyperlinks, const allocator_type& allocator) :
+    _data(width, attr, allocator),
+    _hyperlinks{ hyperlinks },
+    _hyperlinkCells{ 0 }
+{
+    _AddHyperlinkRefs(attr, width);
+}
+
+ATTR_ROW::~ATTR_ROW()
+{
+    _ReleaseHyperlinkRefs(0, _data.size());
+}
+
+// A copy may outlive the text buffer of the other row, so it doesn't allocate from its resource.
+ATTR_ROW::ATTR_ROW(const ATTR_ROW& other) :
+    ATTR_ROW{ other, other._hyperlinks, allocator_type{ til::pmr::get_default_resource() } }
+{
+}
+
+// Copies the cells of another row, but holds the references to its hyperlinks in the given registry.
+ATTR_ROW::ATTR_ROW(const ATTR_ROW& other, HyperlinkRegistry* hyperlinks, const allocator_type& allocator) :
+    _data(other._data, allocator),
+    _hyperlinks{ hyperlinks },
+    _hyperlinkCells{ 0 }
+{
+    _AddAllHyperlinkRefs();
+}
+
+ATTR_ROW& ATTR_ROW::operator=(const ATTR_ROW& other)
+{
+    if (this != &other)
+    {
+        // The row stays in the registry and the allocator of the buffer it belongs to,
+        // wherever the other one is from. Take the new references before releasing ours,
+        // so that hyperlinks used by both rows don't get removed in between.
+        *this = ATTR_ROW{ other, _hyperlinks, _data.get_allocator() };
+    }
+    return *this;
+}
+
+// The references held by a row move along with it.
+ATTR_ROW::ATTR_ROW(ATTR_ROW&& other) noexcept :
+    _data(std::move(other._data)),
+    _hyperlinks{ std::exchange(other._hyperlinks, nullptr) },
+    _hyperlinkCells{ std::exchange(other._hyperlinkCells, 0) }
+{
+}
+
+ATTR_ROW& ATTR_ROW::operator=(ATTR_ROW&& other) noexcept
+{
+    if (this != &other)
+    {
+        _ReleaseHyperlinkRefs(0, _data.size());
+        _data = std::move(other._data);
+        _hyperlinks = std::exchange(other._hyperlinks, nullptr);
+        _hyperlinkCells = std::exchange(other._hyperlinkCells, 0);
+    }
+    return *this;
+}
 
 // Routine Description:
 // - Sets all properties of the ATTR_ROW to default values
@@ -20,6 +80,8 @@ ATTR_ROW::ATTR_ROW(const uint16_t width, const TextAttribute attr) :
 // - attr - The default text attributes to use on text in this row.
 void ATTR_ROW::Reset(const TextAttribute attr)
 {
+    _AddHyperlinkRefs(attr, _data.size());
+    _ReleaseHyperlinkRefs(0, _data.size());
     _data.replace(0, _data.size(), attr);
 }
 
@@ -34,7 +96,19 @@ void ATTR_ROW::Reset(const TextAttribute attr)
 // - <none>, throws exceptions on failures.
 void ATTR_ROW::Resize(const uint16_t newWidth)
 {
-    _data.resize_trailing_extent(newWidth);
+    const size_t oldWidth = _data.size();
+    if (newWidth < oldWidth)
+    {
+        _ReleaseHyperlinkRefs(newWidth, oldWidth);
+        _data.resize_trailing_extent(newWidth);
+    }
+    else if (newWidth > oldWidth)
+    {
+        // The last run is extended to fill the new cells.
+        const auto lastAttr = _data.runs().back().value;
+        _data.resize_trailing_extent(newWidth);
+        _AddHyperlinkRefs(lastAttr, newWidth - oldWidth);
+    }
 }
 
 // Routine Description:
@@ -76,7 +150,7 @@ std::vector<uint16_t> ATTR_ROW::GetHyperlinks() const
 // - <none>
 bool ATTR_ROW::SetAttrToEnd(const uint16_t beginIndex, const TextAttribute attr)
 {
-    _data.replace(gsl::narrow<uint16_t>(beginIndex), _data.size(), attr);
+    Replace(beginIndex, _data.size(), attr);
     return true;
 }
 
@@ -90,6 +164,25 @@ bool ATTR_ROW::SetAttrToEnd(const uint16_t beginIndex, const TextAttribute attr)
 // - <none>
 void ATTR_ROW::ReplaceAttrs(const TextAttribute& toBeReplacedAttr, const TextAttribute& replaceWith)
 {
+    if (_hyperlinks && toBeReplacedAttr.GetHyperlinkId() != replaceWith.GetHyperlinkId())
+    {
+        size_t cells = 0;
+        for (const auto& run : _data.runs())
+        {
+            if (run.value == toBeReplacedAttr)
+            {
+                cells += run.length;
+            }
+        }
+
+        _AddHyperlinkRefs(replaceWith, cells);
+        if (toBeReplacedAttr.IsHyperlink())
+        {
+            _hyperlinks->Release(toBeReplacedAttr.GetHyperlinkId(), cells);
+            _hyperlinkCells -= cells;
+        }
+    }
+
     _data.replace_values(toBeReplacedAttr, replaceWith);
 }
 
@@ -105,7 +198,154 @@ void ATTR_ROW::ReplaceAttrs(const TextAttribute& toBeReplacedAttr, const TextAtt
 // - <none>
 void ATTR_ROW::Replace(const uint16_t beginIndex, const uint16_t endIndex, const TextAttribute& newAttr)
 {
+    // The references are only updated once the runs have been replaced, which throws
+    // for an invalid range. Until then, hold on to the runs that are being overwritten.
+    const auto overwritten = _hyperlinkCells != 0 ? _data.slice(beginIndex, endIndex) : rle_vector{};
+
     _data.replace(beginIndex, endIndex, newAttr);
+
+    // Take the new references before releasing the old ones, so that
+    // a hyperlink that's in both doesn't get removed in between.
+    _AddHyperlinkRefs(newAttr, std::min<size_t>(endIndex, _data.size()) - beginIndex);
+    _ReleaseHyperlinkRefs(overwritten);
+}
+
+// Routine Description:
+// - Copies the attributes of a range of columns of another row into this row.
+//   Like a sequence of SetAttrToEnd() calls, one for each copied column, the
+//   attribute of the last copied column is extended to the end of this row.
+// - The runs are copied as a whole, instead of being looked up column by column.
+// Arguments:
+// - beginIndex - The column of this row to copy the first attribute to.
+// - source - The row to copy the attributes from.
+// - sourceBegin, sourceEnd - The [sourceBegin, sourceEnd) range of columns of the source row to copy.
+// Return Value:
+// - <none>
+void ATTR_ROW::CopyToEnd(const uint16_t beginIndex, const ATTR_ROW& source, const uint16_t sourceBegin, const uint16_t sourceEnd)
+{
+    THROW_HR_IF(E_INVALIDARG, sourceBegin >= sourceEnd || sourceEnd > source._data.size());
+    const uint16_t length = sourceEnd - sourceBegin;
+    THROW_HR_IF(E_INVALIDARG, beginIndex >= _data.size() || length > _data.size() - beginIndex);
+
+    auto runs = source._data.slice(sourceBegin, sourceEnd).runs();
+    runs.back().length += gsl::narrow_cast<uint16_t>(_data.size() - beginIndex - length);
+
+    for (const auto& run : runs)
+    {
+        _AddHyperlinkRefs(run.value, run.length);
+    }
+    _ReleaseHyperlinkRefs(beginIndex, _data.size());
+
+    _data.replace(beginIndex, _data.size(), gsl::span<const rle_vector::rle_type>{ runs.data(), runs.size() });
+}
+
+// Routine Description:
+// - Copies the attributes of a range of columns of another row into the same
+//   number of columns of this row. The rest of this row is left as it is.
+// - The runs are spliced in as a whole. The source may be this row, even if
+//   the two ranges overlap, since the runs are sliced out before they're replaced.
+// Arguments:
+// - beginIndex - The column of this row to copy the first attribute to.
+// - source - The row to copy the attributes from.
+// - sourceBegin, sourceEnd - The [sourceBegin, sourceEnd) range of columns of the source row to copy.
+// Return Value:
+// - <none>
+void ATTR_ROW::CopyRange(const uint16_t beginIndex, const ATTR_ROW& source, const uint16_t sourceBegin, const uint16_t sourceEnd)
+{
+    THROW_HR_IF(E_INVALIDARG, sourceBegin >= sourceEnd || sourceEnd > source._data.size());
+    const uint16_t length = sourceEnd - sourceBegin;
+    THROW_HR_IF(E_INVALIDARG, beginIndex >= _data.size() || length > _data.size() - beginIndex);
+
+    const auto runs = source._data.slice(sourceBegin, sourceEnd).runs();
+
+    for (const auto& run : runs)
+    {
+        _AddHyperlinkRefs(run.value, run.length);
+    }
+    _ReleaseHyperlinkRefs(beginIndex, beginIndex + length);
+
+    _data.replace(beginIndex, gsl::narrow_cast<uint16_t>(beginIndex + length), gsl::span<const rle_vector::rle_type>{ runs.data(), runs.size() });
+}
+
+// Routine Description:
+// - Adds references to the hyperlink of the given attribute, if it has one.
+// Arguments:
+// - attr - The attribute that's being written into this row.
+// - cells - The number of cells it's being written to.
+void ATTR_ROW::_AddHyperlinkRefs(const TextAttribute& attr, const size_t cells)
+{
+    if (_hyperlinks && attr.IsHyperlink() && cells != 0)
+    {
+        _hyperlinks->AddRef(attr.GetHyperlinkId(), cells);
+        _hyperlinkCells += cells;
+    }
+}
+
+// Routine Description:
+// - Adds references to the hyperlinks of all runs in this row, for a copy of another row.
+void ATTR_ROW::_AddAllHyperlinkRefs()
+{
+    if (_hyperlinks)
+    {
+        for (const auto& run : _data.runs())
+        {
+            _AddHyperlinkRefs(run.value, run.length);
+        }
+    }
+}
+
+// Routine Description:
+// - Releases the references held by the hyperlinks in the given range of this
+//   row, because they're about to be overwritten or cut off.
+// - This is free for the vast majority of rows, which don't contain any hyperlinks.
+// Arguments:
+// - beginIndex, endIndex: The [beginIndex, endIndex) range that's being removed.
+void ATTR_ROW::_ReleaseHyperlinkRefs(const size_t beginIndex, const size_t endIndex) noexcept
+{
+    if (!_hyperlinks || _hyperlinkCells == 0)
+    {
+        return;
+    }
+
+    size_t runBegin = 0;
+    for (const auto& run : _data.runs())
+    {
+        if (runBegin >= endIndex)
+        {
+            break;
+        }
+
+        const size_t runEnd = runBegin + run.length;
+        if (runEnd > beginIndex && run.value.IsHyperlink())
+        {
+            const auto cells = std::min(runEnd, endIndex) - std::max(runBegin, beginIndex);
+            _hyperlinks->Release(run.value.GetHyperlinkId(), cells);
+            _hyperlinkCells -= cells;
+        }
+        runBegin = runEnd;
+    }
+}
+
+// Routine Description:
+// - Releases the references held by the hyperlinks in the given runs,
+//   which have been removed from this row already.
+// Arguments:
+// - removed: The runs that were removed.
+void ATTR_ROW::_ReleaseHyperlinkRefs(const rle_vector& removed) noexcept
+{
+    if (!_hyperlinks)
+    {
+        return;
+    }
+
+    for (const auto& run : removed.runs())
+    {
+        if (run.value.IsHyperlink())
+        {
+            _hyperlinks->Release(run.value.GetHyperlinkId(), run.length);
+            _hyperlinkCells -= run.length;
+        }
+    }
 }
 
 ATTR_ROW::const_iterator ATTR_ROW::begin() const noexcept
@@ -23,22 +23,24 @@ Revision History:
 #include "til/rle.h"
 #include "TextAttribute.hpp"
 
+class HyperlinkRegistry;
+
 class ATTR_ROW final
 {
-    using rle_vector = til::small_rle<TextAttribute, uint16_t, 1>;
+    using rle_vector = til::pmr::small_rle<TextAttribute, uint16_t, 1>;
 
 public:
     using const_iterator = rle_vector::const_iterator;
+    using allocator_type = rle_vector::allocator_type;
 
-    ATTR_ROW(uint16_t width, TextAttribute attr);
+    ATTR_ROW(uint16_t width, TextAttribute attr, HyperlinkRegistry* hyperlinks = nullptr, const allocator_type& allocator = allocator_type{ til::pmr::get_default_resource() });
 
-    ~ATTR_ROW() = default;
+    ~ATTR_ROW();
 
-    ATTR_ROW(const ATTR_ROW&) = default;
-    ATTR_ROW& operator=(const ATTR_ROW&) = default;
-    ATTR_ROW(ATTR_ROW&&)
-    noexcept = default;
-    ATTR_ROW& operator=(ATTR_ROW&&) noexcept = default;
+    ATTR_ROW(const ATTR_ROW& other);
+    ATTR_ROW& operator=(const ATTR_ROW& other);
+    ATTR_ROW(ATTR_ROW&& other) noexcept;
+    ATTR_ROW& operator=(ATTR_ROW&& other) noexcept;
 
     TextAttribute GetAttrByColumn(uint16_t column) const;
     std::vector<uint16_t> GetHyperlinks() const;
@@ -47,6 +49,8 @@ public:
     void ReplaceAttrs(const TextAttribute& toBeReplacedAttr, const TextAttribute& replaceWith);
     void Resize(uint16_t newWidth);
     void Replace(uint16_t beginIndex, uint16_t endIndex, const TextAttribute& newAttr);
+    void CopyToEnd(uint16_t beginIndex, const ATTR_ROW& source, uint16_t sourceBegin, uint16_t sourceEnd);
+    void CopyRange(uint16_t beginIndex, const ATTR_ROW& source, uint16_t sourceBegin, uint16_t sourceEnd);
 
     const_iterator begin() const noexcept;
     const_iterator end() const noexcept;
@@ -58,10 +62,22 @@ public:
     friend class ROW;
 
 private:
+    ATTR_ROW(const ATTR_ROW& other, HyperlinkRegistry* hyperlinks, const allocator_type& allocator);
+
     void Reset(const TextAttribute attr);
 
+    void _AddHyperlinkRefs(const TextAttribute& attr, const size_t cells);
+    void _AddAllHyperlinkRefs();
+    void _ReleaseHyperlinkRefs(const size_t beginIndex, const size_t endIndex) noexcept;
+    void _ReleaseHyperlinkRefs(const rle_vector& removed) noexcept;
+
     rle_vector _data;
 
+    // The registry that the hyperlinks used by this row are reference counted in, if any.
+    HyperlinkRegistry* _hyperlinks;
+    // The number of cells in this row that are part of a hyperlink.
+    size_t _hyperlinkCells;
+
 #ifdef UNIT_TESTING
     friend class CommonState;
 #endif
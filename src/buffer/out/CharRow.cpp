@@ -7,22 +7,23 @@
 #include "unicode.hpp"
 #include "Row.hpp"
 
+#pragma warning(push)
+#pragma warning(disable : 26481) // Don't use pointer arithmetic. Use span instead (bounds.1).
+
 // Routine Description:
 // - constructor
 // Arguments:
+// - data - the cells of this row. They're owned by the text buffer and have to be initialized already.
 // - rowWidth - the size (in wchar_t) of the char and attribute rows
 // - pParent - the parent ROW
 // Return Value:
 // - instantiated object
-// Note: will through if unable to allocate char/attribute buffers
-#pragma warning(push)
-#pragma warning(disable : 26447) // small_vector's constructor says it can throw but it should not given how we use it.  This suppresses this error for the AuditMode build.
-CharRow::CharRow(size_t rowWidth, ROW* const pParent) noexcept :
-    _data(rowWidth, value_type()),
+CharRow::CharRow(value_type* const data, size_t rowWidth, ROW* const pParent) noexcept :
+    _data{ data },
+    _size{ rowWidth },
     _pParent{ FAIL_FAST_IF_NULL(pParent) }
 {
 }
-#pragma warning(pop)
 
 // Routine Description:
 // - gets the size of the row, in glyph cells
@@ -32,7 +33,7 @@ CharRow::CharRow(size_t rowWidth, ROW* const pParent) noexcept :
 // - the size of the row
 size_t CharRow::size() const noexcept
 {
-    return _data.size();
+    return _size;
 }
 
 // Routine Description:
@@ -43,48 +44,44 @@ size_t CharRow::size() const noexcept
 // - <none>
 void CharRow::Reset() noexcept
 {
-    for (auto& cell : _data)
-    {
-        cell.Reset();
-    }
+    std::fill_n(_data, _size, value_type{});
 }
 
 // Routine Description:
-// - resizes the width of the CharRowBase
+// - moves the row into new cells with a different width. The columns that
+//   fit are copied over and any new columns are reset to default values.
 // Arguments:
+// - data - the new cells of this row, owned by the text buffer
 // - newSize - the new width of the character and attributes rows
 // Return Value:
-// - S_OK on success, otherwise relevant error code
-[[nodiscard]] HRESULT CharRow::Resize(const size_t newSize) noexcept
+// - <none>
+void CharRow::Resize(value_type* const data, const size_t newSize) noexcept
 {
-    try
-    {
-        const value_type insertVals;
-        _data.resize(newSize, insertVals);
-    }
-    CATCH_RETURN();
-
-    return S_OK;
+    const auto copyable = std::min(_size, newSize);
+    std::copy_n(_data, copyable, data);
+    std::fill_n(data + copyable, newSize - copyable, value_type{});
+    _data = data;
+    _size = newSize;
 }
 
 typename CharRow::iterator CharRow::begin() noexcept
 {
-    return _data.begin();
+    return _data;
 }
 
 typename CharRow::const_iterator CharRow::cbegin() const noexcept
 {
-    return _data.cbegin();
+    return _data;
 }
 
 typename CharRow::iterator CharRow::end() noexcept
 {
-    return _data.end();
+    return _data + _size;
 }
 
 typename CharRow::const_iterator CharRow::cend() const noexcept
 {
-    return _data.cend();
+    return _data + _size;
 }
 
 // Routine Description:
@@ -95,12 +92,12 @@ typename CharRow::const_iterator CharRow::cend() const noexcept
 // - The calculated left boundary of the internal string.
 size_t CharRow::MeasureLeft() const noexcept
 {
-    const_iterator it = _data.cbegin();
-    while (it != _data.cend() && it->IsSpace())
+    const_iterator it = cbegin();
+    while (it != cend() && it->IsSpace())
     {
         ++it;
     }
-    return it - _data.cbegin();
+    return it - cbegin();
 }
 
 // Routine Description:
@@ -111,17 +108,31 @@ size_t CharRow::MeasureLeft() const noexcept
 // - The calculated right boundary of the internal string.
 size_t CharRow::MeasureRight() const
 {
-    const_reverse_iterator it = _data.crbegin();
-    while (it != _data.crend() && it->IsSpace())
+    const_reverse_iterator it{ cend() };
+    const const_reverse_iterator rend{ cbegin() };
+    while (it != rend && it->IsSpace())
     {
         ++it;
     }
-    return _data.crend() - it;
+    return rend - it;
 }
 
 void CharRow::ClearCell(const size_t column)
 {
-    _data.at(column).Reset();
+    CellAt(column).Reset();
+}
+
+// Routine Description:
+// - gets the cell at the specified column
+// Arguments:
+// - column - the column to get the cell for
+// Return Value:
+// - the cell
+// Note: will throw exception if column is out of bounds
+CharRow::value_type& CharRow::CellAt(const size_t column) const
+{
+    THROW_HR_IF(E_INVALIDARG, column >= _size);
+    return _data[column];
 }
 
 // Routine Description:
@@ -132,7 +143,7 @@ void CharRow::ClearCell(const size_t column)
 // - True if there is valid text in this row. False otherwise.
 bool CharRow::ContainsText() const noexcept
 {
-    for (const value_type& cell : _data)
+    for (const value_type& cell : *this)
     {
         if (!cell.IsSpace())
         {
@@ -151,7 +162,7 @@ bool CharRow::ContainsText() const noexcept
 // Note: will throw exception if column is out of bounds
 const DbcsAttribute& CharRow::DbcsAttrAt(const size_t column) const
 {
-    return _data.at(column).DbcsAttr();
+    return CellAt(column).DbcsAttr();
 }
 
 // Routine Description:
@@ -163,7 +174,7 @@ const DbcsAttribute& CharRow::DbcsAttrAt(const size_t column) const
 // Note: will throw exception if column is out of bounds
 DbcsAttribute& CharRow::DbcsAttrAt(const size_t column)
 {
-    return _data.at(column).DbcsAttr();
+    return CellAt(column).DbcsAttr();
 }
 
 // Routine Description:
@@ -175,7 +186,43 @@ DbcsAttribute& CharRow::DbcsAttrAt(const size_t column)
 // Note: will throw exception if column is out of bounds
 void CharRow::ClearGlyph(const size_t column)
 {
-    _data.at(column).EraseChars();
+    CellAt(column).EraseChars();
+}
+
+// Routine Description:
+// - overwrites a run of cells with single width, single code unit glyphs.
+// - this is the bulk equivalent of assigning each glyph through GlyphAt() and
+//   resetting its DbcsAttrAt() to single, without the per-cell bounds checks.
+// Arguments:
+// - column - the first column to overwrite
+// - chars - the glyphs to store, one cell per code unit. Must not contain
+//   surrogates or glyphs that are wide.
+// Return Value:
+// - <none>
+// - Note: will throw exception if the run doesn't fit into the row
+void CharRow::ReplaceNarrowCharacters(const size_t column, const std::wstring_view chars)
+{
+    THROW_HR_IF(E_INVALIDARG, column > _size || chars.size() > _size - column);
+
+    // Glyphs we're about to overwrite mustn't linger in the row's storage.
+    auto& storage = GetUnicodeStorage();
+    if (!storage.empty())
+    {
+        for (auto i = column; i < column + chars.size(); ++i)
+        {
+            if (_data[i].DbcsAttr().IsGlyphStored())
+            {
+                storage.Erase(i);
+            }
+        }
+    }
+
+    std::transform(chars.cbegin(),
+                   chars.cend(),
+                   _data + column,
+                   [](const wchar_t wch) {
+                       return value_type{ wch, DbcsAttribute{} };
+                   });
 }
 
 // Routine Description:
@@ -187,7 +234,7 @@ void CharRow::ClearGlyph(const size_t column)
 // - Note: will throw exception if column is out of bounds
 const CharRow::reference CharRow::GlyphAt(const size_t column) const
 {
-    THROW_HR_IF(E_INVALIDARG, column >= _data.size());
+    THROW_HR_IF(E_INVALIDARG, column >= _size);
     return { const_cast<CharRow&>(*this), column };
 }
 
@@ -200,16 +247,16 @@ const CharRow::reference CharRow::GlyphAt(const size_t column) const
 // - Note: will throw exception if column is out of bounds
 CharRow::reference CharRow::GlyphAt(const size_t column)
 {
-    THROW_HR_IF(E_INVALIDARG, column >= _data.size());
+    THROW_HR_IF(E_INVALIDARG, column >= _size);
     return { *this, column };
 }
 
 std::wstring CharRow::GetText() const
 {
     std::wstring wstr;
-    wstr.reserve(_data.size());
+    wstr.reserve(_size);
 
-    for (size_t i = 0; i < _data.size(); ++i)
+    for (size_t i = 0; i < _size; ++i)
     {
         const auto glyph = GlyphAt(i);
         if (!DbcsAttrAt(i).IsTrailing())
@@ -233,7 +280,7 @@ std::wstring CharRow::GetText() const
 // - the delimiter class for the given char
 const DelimiterClass CharRow::DelimiterClassAt(const size_t column, const std::wstring_view wordDelimiters) const
 {
-    THROW_HR_IF(E_INVALIDARG, column >= _data.size());
+    THROW_HR_IF(E_INVALIDARG, column >= _size);
 
     const auto glyph = *GlyphAt(column).begin();
     if (glyph <= UNICODE_SPACE)
@@ -260,17 +307,6 @@ const UnicodeStorage& CharRow::GetUnicodeStorage() const noexcept
     return _pParent->GetUnicodeStorage();
 }
 
-// Routine Description:
-// - calculates the key used by the given column of the char row to store glyph data in UnicodeStorage
-// Arguments:
-// - column - the column to generate the key for
-// Return Value:
-// - the COORD key for data access from UnicodeStorage for the column
-COORD CharRow::GetStorageKey(const size_t column) const noexcept
-{
-    return { gsl::narrow<SHORT>(column), _pParent->GetId() };
-}
-
 // Routine Description:
 // - Updates the pointer to the parent row (which might change if we shuffle the rows around)
 // Arguments:
@@ -279,3 +315,5 @@ void CharRow::UpdateParent(ROW* const pParent)
 {
     _pParent = FAIL_FAST_IF_NULL(pParent);
 }
+
+#pragma warning(pop)
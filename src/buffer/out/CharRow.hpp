@@ -7,6 +7,8 @@ Module Name:
 
 Abstract:
 - contains data structure for UCS2 encoded character data of a row
+- the cells themselves are owned by the TextBuffer, which keeps the cells of
+  all of its rows in one contiguous allocation. A CharRow is a view into it.
 
 Author(s):
 - Michael Niksa (miniksa) 10-Apr-2014
@@ -49,21 +51,27 @@ class CharRow final
 public:
     using glyph_type = typename wchar_t;
     using value_type = typename CharRowCell;
-    using iterator = typename boost::container::small_vector_base<value_type>::iterator;
-    using const_iterator = typename boost::container::small_vector_base<value_type>::const_iterator;
-    using const_reverse_iterator = typename boost::container::small_vector_base<value_type>::const_reverse_iterator;
+    using iterator = value_type*;
+    using const_iterator = const value_type*;
+    using const_reverse_iterator = std::reverse_iterator<const_iterator>;
     using reference = typename CharRowCellReference;
 
-    CharRow(size_t rowWidth, ROW* const pParent) noexcept;
+    CharRow(value_type* const data, size_t rowWidth, ROW* const pParent) noexcept;
+
+    CharRow(const CharRow&) = delete;
+    CharRow& operator=(const CharRow&) = delete;
+    CharRow(CharRow&&) noexcept = default;
+    CharRow& operator=(CharRow&&) noexcept = default;
 
     size_t size() const noexcept;
-    [[nodiscard]] HRESULT Resize(const size_t newSize) noexcept;
+    void Resize(value_type* const data, const size_t newSize) noexcept;
     size_t MeasureLeft() const noexcept;
     size_t MeasureRight() const;
     bool ContainsText() const noexcept;
     const DbcsAttribute& DbcsAttrAt(const size_t column) const;
     DbcsAttribute& DbcsAttrAt(const size_t column);
     void ClearGlyph(const size_t column);
+    void ReplaceNarrowCharacters(const size_t column, const std::wstring_view chars);
 
     const DelimiterClass DelimiterClassAt(const size_t column, const std::wstring_view wordDelimiters) const;
 
@@ -82,7 +90,6 @@ public:
 
     UnicodeStorage& GetUnicodeStorage() noexcept;
     const UnicodeStorage& GetUnicodeStorage() const noexcept;
-    COORD GetStorageKey(const size_t column) const noexcept;
 
     void UpdateParent(ROW* const pParent);
 
@@ -93,10 +100,14 @@ private:
     void Reset() noexcept;
     void ClearCell(const size_t column);
     std::wstring GetText() const;
+    value_type& CellAt(const size_t column) const;
 
 protected:
-    // storage for glyph data and dbcs attributes
-    boost::container::small_vector<value_type, 120> _data;
+    // storage for glyph data and dbcs attributes, owned by the TextBuffer.
+    // Null while the row is frozen. Thawing it doesn't change its contents,
+    // which is why this can be set for a const row. See ROW::Thaw.
+    mutable value_type* _data;
+    size_t _size;
 
     // ROW that this CharRow belongs to
     ROW* _pParent;
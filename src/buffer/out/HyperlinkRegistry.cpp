@@ -0,0 +1,216 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+
+#include "precomp.h"
+#include "HyperlinkRegistry.hpp"
+
+HyperlinkRegistry::HyperlinkRegistry() noexcept :
+    _entries{},
+    _customIds{},
+    _nextId{ 1 },
+    _activeId{ 0 }
+{
+}
+
+// Method description:
+// - Provides the hyperlink ID to be assigned as a text attribute, based on the optional custom id provided
+// Arguments:
+// - uri - The hyperlink URI
+// - customId - The user-defined id
+// Return value:
+// - The internal hyperlink ID
+uint16_t HyperlinkRegistry::GetId(std::wstring_view uri, std::wstring_view customId)
+{
+    uint16_t numericId = 0;
+    if (customId.empty())
+    {
+        // no custom id specified, return our internal count
+        numericId = _nextId;
+        ++_nextId;
+        _entries[numericId].uri = uri;
+    }
+    else
+    {
+        // assign _nextId if the custom id does not already exist
+        std::wstring newId{ customId };
+        // hash the URL and add it to the custom ID - GH#7698
+        newId += L"%" + std::to_wstring(til::hash(uri));
+        const auto result = _customIds.emplace(newId, _nextId);
+        if (result.second)
+        {
+            // the custom id did not already exist
+            ++_nextId;
+            auto& entry = _entries[result.first->second];
+            entry.uri = uri;
+            entry.customId = std::move(newId);
+        }
+        numericId = result.first->second;
+    }
+    // _nextId could overflow, make sure its not 0
+    if (_nextId == 0)
+    {
+        ++_nextId;
+    }
+    return numericId;
+}
+
+// Method Description:
+// - Adds or updates the URI of a hyperlink
+// Arguments:
+// - id - The hyperlink ID (could be new or old)
+// - uri - The hyperlink URI
+void HyperlinkRegistry::SetUri(const uint16_t id, std::wstring_view uri)
+{
+    _entries[id].uri = uri;
+}
+
+// Method Description:
+// - Retrieves the URI associated with a particular hyperlink ID
+// Arguments:
+// - id - The hyperlink ID
+// Return Value:
+// - The URI
+// Note: will throw exception if the hyperlink doesn't exist
+std::wstring HyperlinkRegistry::GetUri(const uint16_t id) const
+{
+    return _entries.at(id).uri;
+}
+
+// Method Description:
+// - Obtains the custom ID, if there was one, associated with a hyperlink ID
+// Arguments:
+// - id - The hyperlink ID
+// Return Value:
+// - The custom ID if there was one, empty string otherwise
+std::wstring HyperlinkRegistry::GetCustomId(const uint16_t id) const
+{
+    const auto it = _entries.find(id);
+    return it != _entries.end() ? it->second.customId : std::wstring{};
+}
+
+// Method Description:
+// - Removes a hyperlink and its user defined id (if there is one)
+// Arguments:
+// - id - The ID of the hyperlink to be removed
+void HyperlinkRegistry::Remove(const uint16_t id) noexcept
+{
+    const auto it = _entries.find(id);
+    if (it != _entries.end())
+    {
+        if (!it->second.customId.empty())
+        {
+            _customIds.erase(it->second.customId);
+        }
+        _entries.erase(it);
+    }
+}
+
+// Method Description:
+// - Records that the given number of cells started using a hyperlink.
+// Arguments:
+// - id - The hyperlink ID
+// - cells - The number of cells
+void HyperlinkRegistry::AddRef(const uint16_t id, const size_t cells)
+{
+    // The hyperlink may not have been registered yet, for instance while a
+    // buffer is being reflowed. Its URI is filled in once it is.
+    _entries[id].refCount += cells;
+}
+
+// Method Description:
+// - Records that the given number of cells stopped using a hyperlink,
+//   and removes it once the last one did, unless it's the active hyperlink.
+// Arguments:
+// - id - The hyperlink ID
+// - cells - The number of cells
+void HyperlinkRegistry::Release(const uint16_t id, const size_t cells) noexcept
+{
+    const auto it = _entries.find(id);
+    if (it == _entries.end())
+    {
+        return;
+    }
+
+    auto& refCount = it->second.refCount;
+    refCount -= std::min(refCount, cells);
+    if (refCount == 0 && id != _activeId)
+    {
+        Remove(id);
+    }
+}
+
+// Method Description:
+// - Sets the hyperlink ID of the buffer's current attributes, or 0 if there is none.
+//   The active hyperlink is kept, even while no cell uses it. The previously
+//   active one is removed, if no cell ended up using it.
+// Arguments:
+// - id - The hyperlink ID
+void HyperlinkRegistry::SetActiveId(const uint16_t id) noexcept
+{
+    const auto previousId = std::exchange(_activeId, id);
+    if (previousId != id)
+    {
+        const auto it = _entries.find(previousId);
+        if (it != _entries.end() && it->second.refCount == 0)
+        {
+            Remove(previousId);
+        }
+    }
+}
+
+// Method Description:
+// - Copies the URIs and custom IDs of another registry into this one, without
+//   changing the reference counts of the hyperlinks this one already has.
+// - Hyperlinks that were used by cells of the other buffer, but aren't used by
+//   any of this one (because they didn't survive a reflow), aren't copied.
+// Arguments:
+// - other - The registry to copy from
+void HyperlinkRegistry::CopyFrom(const HyperlinkRegistry& other)
+{
+    for (const auto& [id, otherEntry] : other._entries)
+    {
+        auto it = _entries.find(id);
+        if (it == _entries.end())
+        {
+            if (otherEntry.refCount != 0 && id != other._activeId)
+            {
+                continue;
+            }
+            it = _entries.emplace(id, Entry{}).first;
+        }
+
+        auto& entry = it->second;
+        entry.uri = otherEntry.uri;
+        entry.customId = otherEntry.customId;
+        if (!entry.customId.empty())
+        {
+            _customIds.insert_or_assign(entry.customId, id);
+        }
+    }
+    _nextId = other._nextId;
+    _activeId = other._activeId;
+}
+
+// Method Description:
+// - Gets the IDs of the hyperlinks that are used by at least one cell.
+// Return Value:
+// - The IDs, in no particular order
+std::vector<uint16_t> HyperlinkRegistry::GetReferencedIds() const
+{
+    std::vector<uint16_t> ids;
+    for (const auto& [id, entry] : _entries)
+    {
+        if (entry.refCount != 0)
+        {
+            ids.emplace_back(id);
+        }
+    }
+    return ids;
+}
+
+// Method Description:
+// - The number of hyperlinks in the registry
+size_t HyperlinkRegistry::size() const noexcept
+{
+    return _entries.size();
+}
@@ -0,0 +1,53 @@
+/*++
+Copyright (c) Microsoft Corporation
+Licensed under the MIT license.
+
+Module Name:
+- HyperlinkRegistry.hpp
+
+Abstract:
+- Maps the hyperlink IDs stored in text attributes to their URIs and custom IDs.
+- Every ATTR_ROW of a TextBuffer holds a reference on each hyperlink ID for
+  every cell that uses it. When the last cell is overwritten, reset or
+  scrolled out of the buffer, the hyperlink is removed in O(1).
+--*/
+
+#pragma once
+
+class HyperlinkRegistry final
+{
+public:
+    HyperlinkRegistry() noexcept;
+
+    uint16_t GetId(std::wstring_view uri, std::wstring_view customId);
+    void SetUri(const uint16_t id, std::wstring_view uri);
+    std::wstring GetUri(const uint16_t id) const;
+    std::wstring GetCustomId(const uint16_t id) const;
+    void Remove(const uint16_t id) noexcept;
+
+    void AddRef(const uint16_t id, const size_t cells);
+    void Release(const uint16_t id, const size_t cells) noexcept;
+    void SetActiveId(const uint16_t id) noexcept;
+
+    void CopyFrom(const HyperlinkRegistry& other);
+    std::vector<uint16_t> GetReferencedIds() const;
+
+    size_t size() const noexcept;
+
+private:
+    struct Entry
+    {
+        std::wstring uri;
+        // the key of this entry in _customIds, if it has one
+        std::wstring customId;
+        // the number of buffer cells using this hyperlink
+        size_t refCount = 0;
+    };
+
+    std::unordered_map<uint16_t, Entry> _entries;
+    std::unordered_map<std::wstring, uint16_t> _customIds;
+    uint16_t _nextId;
+    // the hyperlink of the buffer's current attributes, which mustn't be
+    // removed even if none of the cells use it at the moment
+    uint16_t _activeId;
+};
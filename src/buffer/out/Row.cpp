@@ -7,20 +7,45 @@
 #include "textBuffer.hpp"
 #include "../types/inc/convert.hpp"
 
+namespace
+{
+    // Returns the end of the cells that a frozen row keeps, which are
+    // all of them up to the last one that isn't blank.
+    const CharRowCell* FrozenEnd(const CharRow& charRow) noexcept
+    {
+        const CharRow::const_reverse_iterator rbegin{ charRow.cend() };
+        const CharRow::const_reverse_iterator rend{ charRow.cbegin() };
+        return std::find_if(rbegin, rend, [](const CharRowCell& cell) {
+                   return !(cell == CharRowCell{});
+               }).base();
+    }
+
+    // Returns whether the cells can be frozen with a single byte each, which is
+    // the case if they're all narrow and their text fits into a byte.
+    bool IsNarrowRun(const CharRowCell* const begin, const CharRowCell* const end) noexcept
+    {
+        return std::all_of(begin, end, [](const CharRowCell& cell) {
+            return cell.Char() <= 0xff && cell.DbcsAttr() == DbcsAttribute{};
+        });
+    }
+}
+
 // Routine Description:
 // - constructor
 // Arguments:
 // - rowId - the row index in the text buffer
+// - cells - the rowWidth cells of this row, owned by the text buffer
 // - rowWidth - the width of the row, cell elements
 // - fillAttribute - the default text attribute
 // - pParent - the text buffer that this row belongs to
 // Return Value:
 // - constructed object
-ROW::ROW(const SHORT rowId, const unsigned short rowWidth, const TextAttribute fillAttribute, TextBuffer* const pParent) :
+ROW::ROW(const SHORT rowId, CharRowCell* const cells, const unsigned short rowWidth, const TextAttribute fillAttribute, TextBuffer* const pParent) :
     _id{ rowId },
     _rowWidth{ rowWidth },
-    _charRow{ rowWidth, this },
-    _attrRow{ rowWidth, fillAttribute },
+    _charRow{ cells, rowWidth, this },
+    _attrRow{ rowWidth, fillAttribute, pParent ? &pParent->GetHyperlinkRegistry() : nullptr, ATTR_ROW::allocator_type{ pParent ? &pParent->GetAttrRunResource() : til::pmr::get_default_resource() } },
+    _unicodeStorage{},
     _lineRendition{ LineRendition::SingleWidth },
     _wrapForced{ false },
     _doubleBytePadded{ false },
@@ -39,7 +64,18 @@ bool ROW::Reset(const TextAttribute Attr)
     _lineRendition = LineRendition::SingleWidth;
     _wrapForced = false;
     _doubleBytePadded = false;
-    _charRow.Reset();
+    if (IsFrozen())
+    {
+        // A blank frozen row doesn't need any cells at all.
+        _frozenCells.reset();
+        _frozenCount = 0;
+        _frozenNarrow = false;
+    }
+    else
+    {
+        _charRow.Reset();
+    }
+    _unicodeStorage.Clear();
     try
     {
         _attrRow.Reset(Attr);
@@ -55,23 +91,131 @@ bool ROW::Reset(const TextAttribute Attr)
 // Routine Description:
 // - resizes ROW to new width
 // Arguments:
+// - cells - the width cells the row is moved into, owned by the text buffer
 // - width - the new width, in cells
 // Return Value:
 // - S_OK if successful, otherwise relevant error
-[[nodiscard]] HRESULT ROW::Resize(const unsigned short width)
+[[nodiscard]] HRESULT ROW::Resize(CharRowCell* const cells, const unsigned short width)
 {
-    RETURN_IF_FAILED(_charRow.Resize(width));
+    if (IsFrozen())
+    {
+        // A frozen row only forgets the cells that were cut off, unless it's given cells of its own.
+        _frozenCount = std::min<size_t>(_frozenCount, width);
+        _charRow._size = width;
+        if (cells)
+        {
+            Thaw(cells);
+        }
+    }
+    else
+    {
+        _charRow.Resize(cells, width);
+    }
+
     try
     {
         _attrRow.Resize(width);
     }
     CATCH_RETURN();
 
+    // Drop the glyphs of any columns that were cut off.
+    _unicodeStorage.Truncate(width);
+
     _rowWidth = width;
 
     return S_OK;
 }
 
+// Routine Description:
+// - Measures how many bytes Freeze() needs for this row. It keeps all of its
+//   cells up to the last one that isn't blank, in one byte each if they're
+//   narrow and their text fits into a byte, or as they are otherwise.
+// Arguments:
+// - <none>
+// Return Value:
+// - The number of bytes, or 0 if the row is already frozen.
+size_t ROW::MeasureFrozenSize() const noexcept
+{
+    if (IsFrozen())
+    {
+        return 0;
+    }
+
+    const auto end = FrozenEnd(_charRow);
+    const auto count = gsl::narrow_cast<size_t>(end - _charRow.cbegin());
+    return IsNarrowRun(_charRow.cbegin(), end) ? count : count * sizeof(CharRowCell);
+}
+
+// Routine Description:
+// - Moves the cells of this row out of the text buffer into the given block,
+//   so that the text buffer can hand them to another row.
+// - Trailing blank cells aren't kept. If the rest of them are narrow and their text
+//   fits into a byte, which is the case for most output, only that byte is kept.
+//   Attributes are run-length encoded in the ATTR_ROW anyway, so they stay as they are.
+// - The row gets its cells back when it's thawed.
+// Arguments:
+// - block - the bytes that this row and the rows frozen along with it are moved into
+// - offset - the index of this row's first byte within the block
+// Return Value:
+// - The number of bytes this row takes up in the block. See MeasureFrozenSize().
+size_t ROW::Freeze(const std::shared_ptr<std::byte[]>& block, const size_t offset) noexcept
+{
+    static_assert(std::is_trivially_copyable_v<CharRowCell>);
+
+    const auto end = FrozenEnd(_charRow);
+    const auto count = gsl::narrow_cast<size_t>(end - _charRow.cbegin());
+    const auto narrow = IsNarrowRun(_charRow.cbegin(), end);
+    const auto size = narrow ? count : count * sizeof(CharRowCell);
+    if (count != 0)
+    {
+        const auto frozen = block.get() + offset;
+        if (narrow)
+        {
+            std::transform(_charRow.cbegin(), _charRow.cbegin() + count, frozen, [](const CharRowCell& cell) noexcept {
+                return static_cast<std::byte>(cell.Char());
+            });
+        }
+        else
+        {
+            std::memcpy(frozen, _charRow.cbegin(), size);
+        }
+        _frozenCells = std::shared_ptr<const std::byte>{ block, frozen };
+    }
+    _frozenCount = count;
+    _frozenNarrow = narrow;
+    _charRow._data = nullptr;
+    return size;
+}
+
+// Routine Description:
+// - Moves the cells of a frozen row back into the given cells of the text buffer.
+// - The contents of the row stay the same, which is why the text buffer
+//   can do this when a row is accessed through a const reference.
+// Arguments:
+// - cells - the cells the row is moved into, owned by the text buffer
+// Return Value:
+// - <none>
+void ROW::Thaw(CharRowCell* const cells) const noexcept
+{
+    const auto frozen = std::min(_frozenCount, _charRow._size);
+    if (_frozenNarrow)
+    {
+        std::transform(_frozenCells.get(), _frozenCells.get() + frozen, cells, [](const std::byte ch) noexcept {
+            return CharRowCell{ static_cast<wchar_t>(ch), DbcsAttribute{} };
+        });
+    }
+    else
+    {
+        std::memcpy(cells, _frozenCells.get(), frozen * sizeof(CharRowCell));
+    }
+    std::fill_n(cells + frozen, _charRow._size - frozen, CharRowCell{});
+    _charRow._data = cells;
+
+    _frozenCells.reset();
+    _frozenCount = 0;
+    _frozenNarrow = false;
+}
+
 // Routine Description:
 // - clears char data in column in row
 // Arguments:
@@ -86,12 +230,12 @@ void ROW::ClearColumn(const size_t column)
 
 UnicodeStorage& ROW::GetUnicodeStorage() noexcept
 {
-    return _pParent->GetUnicodeStorage();
+    return _unicodeStorage;
 }
 
 const UnicodeStorage& ROW::GetUnicodeStorage() const noexcept
 {
-    return _pParent->GetUnicodeStorage();
+    return _unicodeStorage;
 }
 
 // Routine Description:
@@ -196,3 +340,176 @@ OutputCellIterator ROW::WriteCells(OutputCellIterator it, const size_t index, co
 
     return it;
 }
+
+// Routine Description:
+// - writes a run of narrow glyphs to the row in a single pass.
+// - this is a fast path for WriteCells() for the very common case of
+//   printable text where every code unit occupies exactly one cell. The
+//   attribute run is only updated once for the whole run.
+// Arguments:
+// - chars - the text to write. Every code unit must be a narrow, non-surrogate glyph.
+// - index - column in row to start writing at
+// - attr - the attribute to apply to every cell that was written
+// - wrap - change the wrap flag if we hit the end of the row while writing.
+// Return Value:
+// - the number of code units (and thus cells) that were written to this row.
+size_t ROW::WriteNarrowRun(const std::wstring_view chars, const size_t index, const TextAttribute& attr, const std::optional<bool> wrap)
+{
+    THROW_HR_IF(E_INVALIDARG, index >= _charRow.size());
+
+    const auto count = std::min(chars.size(), _charRow.size() - index);
+    if (count == 0)
+    {
+        return 0;
+    }
+
+    _charRow.ReplaceNarrowCharacters(index, chars.substr(0, count));
+    _attrRow.Replace(gsl::narrow_cast<uint16_t>(index), gsl::narrow_cast<uint16_t>(index + count), attr);
+
+    // Just like WriteCells(), only touch the wrap flag when we filled the last column.
+    if (wrap.has_value() && index + count == _charRow.size())
+    {
+        SetWrapForced(*wrap);
+    }
+
+    return count;
+}
+
+// Routine Description:
+// - copies a run of cells of another row into this row, as is. This includes
+//   their double byte attributes and any glyphs kept in the unicode storage.
+// - the result is the same as inserting each of the cells one after another:
+//   the attribute of the last cell is extended to the end of this row.
+// Arguments:
+// - source - the row to copy the cells from
+// - sourceBegin, sourceEnd - the [sourceBegin, sourceEnd) range of columns of the source row to copy
+// - index - column in this row to copy the first cell to
+// Return Value:
+// - <none>
+// - Note: will throw exception if the run doesn't fit into either row
+void ROW::CopyCells(const ROW& source, const size_t sourceBegin, const size_t sourceEnd, const size_t index)
+{
+    THROW_HR_IF(E_INVALIDARG, sourceBegin >= sourceEnd || sourceEnd > source._charRow.size());
+    const auto count = sourceEnd - sourceBegin;
+    THROW_HR_IF(E_INVALIDARG, index >= _charRow.size() || count > _charRow.size() - index);
+
+    const gsl::span<const CharRowCell> sourceCells{ source._charRow.cbegin(), source._charRow.size() };
+    const gsl::span<CharRowCell> cells{ _charRow.begin(), _charRow.size() };
+
+    // Glyphs we're about to overwrite mustn't linger in our storage.
+    if (!_unicodeStorage.empty())
+    {
+        for (auto column = index; column < index + count; ++column)
+        {
+            if (til::at(cells, column).DbcsAttr().IsGlyphStored())
+            {
+                _unicodeStorage.Erase(column);
+            }
+        }
+    }
+
+    const auto sourceRun = sourceCells.subspan(sourceBegin, count);
+    std::copy(sourceRun.begin(), sourceRun.end(), cells.subspan(index, count).begin());
+
+    if (!source._unicodeStorage.empty())
+    {
+        for (size_t i = 0; i < count; ++i)
+        {
+            if (til::at(sourceRun, i).DbcsAttr().IsGlyphStored())
+            {
+                _unicodeStorage.StoreGlyph(index + i, source._unicodeStorage.GetText(sourceBegin + i));
+            }
+        }
+    }
+
+    _attrRow.CopyToEnd(gsl::narrow_cast<uint16_t>(index),
+                       source._attrRow,
+                       gsl::narrow_cast<uint16_t>(sourceBegin),
+                       gsl::narrow_cast<uint16_t>(sourceEnd));
+}
+
+// Routine Description:
+// - copies a run of cells of another row into the same number of cells of this row.
+//   Unlike CopyCells(), the attributes of the rest of this row are left alone.
+// - the source may be this row, even if the two runs overlap.
+// - just like writing the cells with WriteCells(), a trailing half of a wide glyph
+//   copied into the first column, or a leading half copied into the last column,
+//   is cleared instead.
+// Arguments:
+// - source - the row to copy the cells from
+// - sourceBegin, sourceEnd - the [sourceBegin, sourceEnd) range of columns of the source row to copy
+// - index - column in this row to copy the first cell to
+// Return Value:
+// - <none>
+// - Note: will throw exception if the run doesn't fit into either row
+void ROW::CopyCellRange(const ROW& source, const size_t sourceBegin, const size_t sourceEnd, const size_t index)
+{
+    THROW_HR_IF(E_INVALIDARG, sourceBegin >= sourceEnd || sourceEnd > source._charRow.size());
+    const auto count = sourceEnd - sourceBegin;
+    THROW_HR_IF(E_INVALIDARG, index >= _charRow.size() || count > _charRow.size() - index);
+
+    const gsl::span<const CharRowCell> sourceCells{ source._charRow.cbegin(), source._charRow.size() };
+    const gsl::span<CharRowCell> cells{ _charRow.begin(), _charRow.size() };
+    const auto sourceRun = sourceCells.subspan(sourceBegin, count);
+    const auto targetRun = cells.subspan(index, count);
+
+    // The stored glyphs of the source have to be picked up before
+    // they might get overwritten, in case the source is this row.
+    std::vector<std::pair<size_t, std::wstring>> glyphs;
+    if (!source._unicodeStorage.empty())
+    {
+        for (size_t i = 0; i < count; ++i)
+        {
+            if (til::at(sourceRun, i).DbcsAttr().IsGlyphStored())
+            {
+                glyphs.emplace_back(index + i, source._unicodeStorage.GetText(sourceBegin + i));
+            }
+        }
+    }
+
+    // Glyphs we're about to overwrite mustn't linger in our storage.
+    if (!_unicodeStorage.empty())
+    {
+        for (const auto& cell : targetRun)
+        {
+            if (cell.DbcsAttr().IsGlyphStored())
+            {
+                _unicodeStorage.Erase(gsl::narrow_cast<size_t>(&cell - cells.data()));
+            }
+        }
+    }
+
+    // Within a row, the cells have to be moved starting from the end the run moves towards.
+    if (&source == this && index > sourceBegin)
+    {
+        std::copy_backward(sourceRun.begin(), sourceRun.end(), targetRun.end());
+    }
+    else
+    {
+        std::copy(sourceRun.begin(), sourceRun.end(), targetRun.begin());
+    }
+
+    for (const auto& [column, glyph] : glyphs)
+    {
+        _unicodeStorage.StoreGlyph(column, glyph);
+    }
+
+    _attrRow.CopyRange(gsl::narrow_cast<uint16_t>(index),
+                       source._attrRow,
+                       gsl::narrow_cast<uint16_t>(sourceBegin),
+                       gsl::narrow_cast<uint16_t>(sourceEnd));
+
+    // Halves of wide glyphs that were cut off by the edges of the row are cleared.
+    if (index == 0 && til::at(cells, 0).DbcsAttr().IsTrailing())
+    {
+        _unicodeStorage.Erase(0);
+        ClearColumn(0);
+    }
+    const auto lastColumn = cells.size() - 1;
+    if (index + count - 1 == lastColumn && til::at(cells, lastColumn).DbcsAttr().IsLeading())
+    {
+        _unicodeStorage.Erase(lastColumn);
+        ClearColumn(lastColumn);
+        SetDoubleBytePadded(true);
+    }
+}
@@ -32,7 +32,7 @@ class TextBuffer;
 class ROW final
 {
 public:
-    ROW(const SHORT rowId, const unsigned short rowWidth, const TextAttribute fillAttribute, TextBuffer* const pParent);
+    ROW(const SHORT rowId, CharRowCell* const cells, const unsigned short rowWidth, const TextAttribute fillAttribute, TextBuffer* const pParent);
 
     size_t size() const noexcept { return _rowWidth; }
 
@@ -55,7 +55,12 @@ public:
     void SetId(const SHORT id) noexcept { _id = id; }
 
     bool Reset(const TextAttribute Attr);
-    [[nodiscard]] HRESULT Resize(const unsigned short width);
+    [[nodiscard]] HRESULT Resize(CharRowCell* const cells, const unsigned short width);
+
+    bool IsFrozen() const noexcept { return _charRow._data == nullptr; }
+    size_t MeasureFrozenSize() const noexcept;
+    size_t Freeze(const std::shared_ptr<std::byte[]>& block, const size_t offset) noexcept;
+    void Thaw(CharRowCell* const cells) const noexcept;
 
     void ClearColumn(const size_t column);
     std::wstring GetText() const { return _charRow.GetText(); }
@@ -64,15 +69,25 @@ public:
     const UnicodeStorage& GetUnicodeStorage() const noexcept;
 
     OutputCellIterator WriteCells(OutputCellIterator it, const size_t index, const std::optional<bool> wrap = std::nullopt, std::optional<size_t> limitRight = std::nullopt);
+    size_t WriteNarrowRun(const std::wstring_view chars, const size_t index, const TextAttribute& attr, const std::optional<bool> wrap = std::nullopt);
+    void CopyCells(const ROW& source, const size_t sourceBegin, const size_t sourceEnd, const size_t index);
+    void CopyCellRange(const ROW& source, const size_t sourceBegin, const size_t sourceEnd, const size_t index);
 
 #ifdef UNIT_TESTING
     friend constexpr bool operator==(const ROW& a, const ROW& b) noexcept;
     friend class RowTests;
+    friend class TextBufferTests;
 #endif
 
 private:
     CharRow _charRow;
     ATTR_ROW _attrRow;
+    UnicodeStorage _unicodeStorage;
+    // The cells of a frozen row, up to the last one that isn't blank. They live in a block
+    // that's shared with the rows that were frozen along with this one. See Freeze().
+    // Thawing doesn't change the contents of the row, so a const row can be thawed.
+    mutable std::shared_ptr<const std::byte> _frozenCells;
+    mutable size_t _frozenCount{ 0 };
     LineRendition _lineRendition;
     SHORT _id;
     unsigned short _rowWidth;
@@ -80,6 +95,8 @@ private:
     bool _wrapForced;
     // Occurs when the user runs out of text to support a double byte character and we're forced to the next line
     bool _doubleBytePadded;
+    // Whether the frozen cells are stored as a single byte each. See Freeze().
+    mutable bool _frozenNarrow{ false };
     TextBuffer* _pParent; // non ownership pointer
 };
 
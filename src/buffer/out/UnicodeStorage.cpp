@@ -4,95 +4,156 @@
 #include "precomp.h"
 #include "UnicodeStorage.hpp"
 
+// Replaced and erased glyphs leave gaps in the arena. Once the gaps outgrow
+// both the live glyphs and this many characters, the arena is rebuilt.
+static constexpr size_t CompactionThreshold = 64;
+
 UnicodeStorage::UnicodeStorage() noexcept :
-    _map{}
+    _entries{},
+    _arena{},
+    _liveSize{ 0 }
 {
 }
 
 // Routine Description:
-// - fetches the text associated with key
+// - fetches the text associated with column
 // Arguments:
-// - key - the key into the storage
+// - column - the column of the glyph in the row
 // Return Value:
-// - the glyph data associated with key
-// Note: will throw exception if key is not stored yet
-const UnicodeStorage::mapped_type& UnicodeStorage::GetText(const key_type key) const
+// - the glyph data associated with column. Only valid until the storage is next modified.
+// Note: will throw exception if column is not stored yet
+UnicodeStorage::mapped_type UnicodeStorage::GetText(const key_type column) const
 {
-    return _map.at(key);
+    const auto it = _LowerBound(column);
+    THROW_HR_IF(E_INVALIDARG, it == _entries.end() || it->column != column);
+    return { _arena.data() + it->offset, it->length };
 }
 
 // Routine Description:
-// - stores glyph data associated with key.
+// - stores glyph data associated with column.
 // Arguments:
-// - key - the key into the storage
+// - column - the column of the glyph in the row
 // - glyph - the glyph data to store
-void UnicodeStorage::StoreGlyph(const key_type key, const mapped_type& glyph)
+void UnicodeStorage::StoreGlyph(const key_type column, const mapped_type glyph)
 {
-    _map.insert_or_assign(key, glyph);
+    const auto length = gsl::narrow<uint16_t>(glyph.size());
+    const auto it = _LowerBound(column);
+
+    if (it != _entries.end() && it->column == column)
+    {
+        // A glyph that fits into the space of the one it replaces is written in place.
+        if (length <= it->length)
+        {
+            _arena.replace(it->offset, length, glyph.data(), length);
+            _liveSize -= it->length - length;
+            it->length = length;
+            return;
+        }
+
+        _liveSize -= it->length;
+        it->offset = gsl::narrow<uint32_t>(_arena.size());
+        it->length = length;
+    }
+    else
+    {
+        _entries.insert(it, Entry{ gsl::narrow<uint16_t>(column), length, gsl::narrow<uint32_t>(_arena.size()) });
+    }
+
+    _arena.append(glyph);
+    _liveSize += length;
+    _CompactIfWasteful();
 }
 
 // Routine Description:
-// - erases key and its associated data from the storage
+// - erases column and its associated data from the storage
 // Arguments:
-// - key - the key to remove
-void UnicodeStorage::Erase(const key_type key) noexcept
+// - column - the column to remove
+void UnicodeStorage::Erase(const key_type column) noexcept
 {
-    _map.erase(key);
+    const auto it = _LowerBound(column);
+    if (it != _entries.end() && it->column == column)
+    {
+        _liveSize -= it->length;
+        _entries.erase(it);
+
+        if (_entries.empty())
+        {
+            Clear();
+        }
+    }
 }
 
 // Routine Description:
-// - Remaps all of the stored items to new coordinate positions
-//   based on a bulk rearrangement of row IDs and potential row width resize.
+// - erases all glyphs at or beyond the given width, for when the row shrinks.
 // Arguments:
-// - rowMap - A map of the old row IDs to the new row IDs.
-// - width - The width of the new row. Remove any items that are beyond the row width.
-//         - Use nullopt if we're not resizing the width of the row, just renumbering the rows.
-void UnicodeStorage::Remap(const std::unordered_map<SHORT, SHORT>& rowMap, const std::optional<SHORT> width)
+// - width - the new width of the row
+void UnicodeStorage::Truncate(const key_type width) noexcept
 {
-    // Make a temporary map to hold all the new row positioning
-    std::unordered_map<key_type, mapped_type> newMap;
-
-    // Walk through every stored item.
-    for (const auto& pair : _map)
+    const auto first = _LowerBound(width);
+    for (auto it = first; it != _entries.end(); ++it)
     {
-        // Extract the old coordinate position
-        const auto oldCoord = pair.first;
+        _liveSize -= it->length;
+    }
+    _entries.erase(first, _entries.end());
 
-        // Only try to short-circuit based on width if we were told it changed
-        // by being given a new width value.
-        if (width.has_value())
-        {
-            // Get the column ID
-            const auto oldColId = oldCoord.X;
-
-            // If the column index is at/beyond the row width, don't bother copying it to the new map.
-            if (oldColId >= width.value())
-            {
-                continue;
-            }
-        }
+    if (_entries.empty())
+    {
+        Clear();
+    }
+}
 
-        // Get the row ID from the position as that's what we need to remap
-        const auto oldRowId = oldCoord.Y;
+// Routine Description:
+// - erases all glyphs from the storage, without releasing its memory.
+void UnicodeStorage::Clear() noexcept
+{
+    _entries.clear();
+    _arena.clear();
+    _liveSize = 0;
+}
 
-        // Use the mapping given to convert the old row ID to the new row ID
-        const auto mapIter = rowMap.find(oldRowId);
+// Routine Description:
+// - the number of glyphs in the storage
+size_t UnicodeStorage::size() const noexcept
+{
+    return _entries.size();
+}
 
-        // If there's no mapping to a new row, don't bother copying it to the new map. The row is gone.
-        if (mapIter == rowMap.end())
-        {
-            continue;
-        }
+bool UnicodeStorage::empty() const noexcept
+{
+    return _entries.empty();
+}
 
-        const auto newRowId = mapIter->second;
+UnicodeStorage::entries_type::iterator UnicodeStorage::_LowerBound(const key_type column) noexcept
+{
+    return std::lower_bound(_entries.begin(), _entries.end(), column, [](const Entry& entry, const key_type value) noexcept {
+        return entry.column < value;
+    });
+}
 
-        // Generate a new coordinate with the same X as the old one, but a new Y value.
-        const auto newCoord = COORD{ oldCoord.X, newRowId };
+UnicodeStorage::entries_type::const_iterator UnicodeStorage::_LowerBound(const key_type column) const noexcept
+{
+    return std::lower_bound(_entries.begin(), _entries.end(), column, [](const Entry& entry, const key_type value) noexcept {
+        return entry.column < value;
+    });
+}
 
-        // Put the adjusted coordinate into the map with the original value.
-        newMap.emplace(newCoord, pair.second);
+// Routine Description:
+// - rebuilds the arena without the gaps left by replaced glyphs, once they make up most of it.
+void UnicodeStorage::_CompactIfWasteful()
+{
+    const auto waste = _arena.size() - _liveSize;
+    if (waste <= _liveSize || waste <= CompactionThreshold)
+    {
+        return;
     }
 
-    // Swap into the stored map, free the temporary when we exit.
-    _map.swap(newMap);
+    std::wstring arena;
+    arena.reserve(_liveSize);
+    for (auto& entry : _entries)
+    {
+        const auto offset = arena.size();
+        arena.append(_arena, entry.offset, entry.length);
+        entry.offset = gsl::narrow_cast<uint32_t>(offset);
+    }
+    _arena.swap(arena);
 }
@@ -7,6 +7,9 @@ Module Name:
 
 Abstract:
 - dynamic storage location for glyphs that can't normally fit in the output buffer
+- each ROW owns one of these. Glyphs are kept in a single character arena per
+  row and indexed by a small vector of entries sorted by column, so that
+  clearing or moving a row takes its glyphs along without any rekeying.
 
 Author(s):
 - Austin Diviness (AustDi) 02-May-2018
@@ -14,50 +17,50 @@ Author(s):
 
 #pragma once
 
-#include <unordered_map>
-#include <vector>
-
-#include <til/bit.h>
-#include <til/hash.h>
-
-// std::unordered_map needs help to know how to hash a COORD
-namespace std
-{
-    template<>
-    struct hash<COORD>
-    {
-        // Routine Description:
-        // - hashes a coord. coord will be hashed by storing the x and y values consecutively in the lower
-        // bits of a size_t.
-        // Arguments:
-        // - coord - the coord to hash
-        // Return Value:
-        // - the hashed coord
-        constexpr size_t operator()(const COORD& coord) const noexcept
-        {
-            return til::hash(til::bit_cast<uint32_t>(coord));
-        }
-    };
-}
+#include <string>
+#include <string_view>
 
 class UnicodeStorage final
 {
 public:
-    using key_type = typename COORD;
-    using mapped_type = typename std::vector<wchar_t>;
+    using key_type = size_t;
+    using mapped_type = std::wstring_view;
 
     UnicodeStorage() noexcept;
 
-    const mapped_type& GetText(const key_type key) const;
+    mapped_type GetText(const key_type column) const;
+
+    void StoreGlyph(const key_type column, const mapped_type glyph);
 
-    void StoreGlyph(const key_type key, const mapped_type& glyph);
+    void Erase(const key_type column) noexcept;
 
-    void Erase(const key_type key) noexcept;
+    void Truncate(const key_type width) noexcept;
 
-    void Remap(const std::unordered_map<SHORT, SHORT>& rowMap, const std::optional<SHORT> width);
+    void Clear() noexcept;
+
+    size_t size() const noexcept;
+    bool empty() const noexcept;
 
 private:
-    std::unordered_map<key_type, mapped_type> _map;
+    struct Entry
+    {
+        uint16_t column;
+        uint16_t length;
+        uint32_t offset;
+    };
+
+    using entries_type = boost::container::small_vector<Entry, 1>;
+
+    entries_type::iterator _LowerBound(const key_type column) noexcept;
+    entries_type::const_iterator _LowerBound(const key_type column) const noexcept;
+    void _CompactIfWasteful();
+
+    // sorted by column, at most one entry per column
+    entries_type _entries;
+    // the characters of all stored glyphs, possibly with gaps left by erased or replaced ones
+    std::wstring _arena;
+    // the number of characters in _arena that are still referenced by an entry
+    size_t _liveSize;
 
 #ifdef UNIT_TESTING
     friend class UnicodeStorageTests;
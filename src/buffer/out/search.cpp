@@ -28,10 +28,11 @@ Search::Search(IUiaData& uiaData,
                const Sensitivity sensitivity) :
     _direction(direction),
     _sensitivity(sensitivity),
-    _needle(s_CreateNeedleFromString(str)),
     _uiaData(uiaData),
     _coordAnchor(s_GetInitialAnchor(uiaData, direction))
 {
+    _uiaData.ReflowScrollback();
+    _PrepareNeedle(s_CreateNeedleFromString(str));
     _coordNext = _coordAnchor;
 }
 
@@ -53,10 +54,11 @@ Search::Search(IUiaData& uiaData,
                const COORD anchor) :
     _direction(direction),
     _sensitivity(sensitivity),
-    _needle(s_CreateNeedleFromString(str)),
     _coordAnchor(anchor),
     _uiaData(uiaData)
 {
+    _uiaData.ReflowScrollback();
+    _PrepareNeedle(s_CreateNeedleFromString(str));
     _coordNext = _coordAnchor;
 }
 
@@ -75,22 +77,131 @@ bool Search::FindNext()
         return false;
     }
 
-    do
+    const auto& matches = FindAll();
+
+    // The positions are visited in the order the search direction dictates, starting at _coordNext
+    // and wrapping around at the end of the text, until we're back at the anchor.
+    // Pick the match that would be visited first.
+    const size_t width = _uiaData.GetTextBuffer().GetSize().Width();
+    const auto toIndex = [width](const COORD pos) noexcept {
+        return gsl::narrow_cast<size_t>(pos.Y) * width + gsl::narrow_cast<size_t>(pos.X);
+    };
+    const auto count = toIndex(_uiaData.GetTextBufferEndPosition()) + 1;
+    const auto from = toIndex(_coordNext);
+    const auto anchor = toIndex(_coordAnchor);
+    const auto limit = anchor == from || anchor >= count ? SIZE_MAX : _GetScanOrder(from, anchor, count);
+
+    // The matches are sorted, so the first one to be visited is either the
+    // closest one in the search direction or the one we wrap around to.
+    const auto startsBefore = [&](const std::pair<COORD, COORD>& match, const size_t index) noexcept {
+        return toIndex(match.first) < index;
+    };
+    auto best = matches.end();
+    if (!matches.empty())
     {
-        if (_FindNeedleInHaystackAt(_coordNext, _coordSelStart, _coordSelEnd))
+        if (_direction == Direction::Forward)
         {
-            _UpdateNextPosition();
-            _reachedEnd = _coordNext == _coordAnchor;
-            return true;
+            best = from < count ? std::lower_bound(matches.begin(), matches.end(), from, startsBefore) : matches.begin();
+            if (best == matches.end())
+            {
+                best = matches.begin();
+            }
         }
         else
         {
-            _UpdateNextPosition();
+            best = from < count ? std::lower_bound(matches.begin(), matches.end(), from + 1, startsBefore) : matches.end();
+            best = best == matches.begin() ? matches.end() - 1 : best - 1;
+        }
+    }
+
+    if (best == matches.end() || _GetScanOrder(from, toIndex(best->first), count) >= limit)
+    {
+        _coordNext = _coordAnchor;
+        return false;
+    }
+
+    _coordSelStart = best->first;
+    _coordSelEnd = best->second;
+    _coordNext = best->first;
+    _UpdateNextPosition();
+    _reachedEnd = _coordNext == _coordAnchor;
+    return true;
+}
+
+// Routine Description
+// - Locates all instances of the search term within the screen buffer, up to
+//   the end of the text. The text is searched one logical line at a time,
+//   so a match may span rows only if they were wrapped.
+// - The buffer is only searched once. Later calls return the same matches.
+// Arguments:
+// - <none> - Uses internal state from constructor
+// Return Value:
+// - The start and end of every match, in forward order. Matches may overlap.
+const std::vector<std::pair<COORD, COORD>>& Search::FindAll()
+{
+    if (_matches)
+    {
+        return *_matches;
+    }
+
+    _matches.emplace();
+    if (_needle.empty())
+    {
+        return *_matches;
+    }
+
+    const auto& textBuffer = _uiaData.GetTextBuffer();
+    const auto endPosition = _uiaData.GetTextBufferEndPosition();
+    const size_t width = textBuffer.GetSize().Width();
+    const size_t lastRow = std::min<size_t>(endPosition.Y, textBuffer.TotalRowCount() - 1);
+
+    std::wstring text;
+    std::vector<size_t> cells;
+    size_t firstRow = 0;
+
+    for (size_t y = 0; y <= lastRow; ++y)
+    {
+        const auto& row = textBuffer.GetRowByOffset(y);
+        const auto& charRow = row.GetCharRow();
+        const auto& unicodeStorage = row.GetUnicodeStorage();
+        const auto cellOffset = (y - firstRow) * width;
+
+        size_t x = 0;
+        for (const auto& cell : charRow)
+        {
+            if (cell.DbcsAttr().IsGlyphStored())
+            {
+                for (const auto wch : unicodeStorage.GetText(x))
+                {
+                    text.push_back(_ApplySensitivity(wch));
+                    cells.push_back(cellOffset + x);
+                }
+            }
+            else
+            {
+                text.push_back(_ApplySensitivity(cell.Char()));
+                cells.push_back(cellOffset + x);
+            }
+            ++x;
         }
 
-    } while (_coordNext != _coordAnchor);
+        // A wrapped row continues on the next one. Otherwise the logical line ends here.
+        if (!row.WasWrapForced() || y == lastRow)
+        {
+            _FindAllInLine(text, cells, firstRow, width);
+            text.clear();
+            cells.clear();
+            firstRow = y + 1;
+        }
+    }
+
+    // Drop the matches that start past the end of the text.
+    const auto isPastEnd = [&](const std::pair<COORD, COORD>& match) noexcept {
+        return match.first.Y > endPosition.Y || (match.first.Y == endPosition.Y && match.first.X > endPosition.X);
+    };
+    _matches->erase(std::remove_if(_matches->begin(), _matches->end(), isPastEnd), _matches->end());
 
-    return false;
+    return *_matches;
 }
 
 // Routine Description:
@@ -178,72 +289,79 @@ COORD Search::s_GetInitialAnchor(IUiaData& uiaData, const Direction direction)
 }
 
 // Routine Description:
-// - Attempts to compare the search term (the needle) to the screen buffer (the haystack)
-//   at the given coordinate position of the screen buffer.
-// - Performs one comparison. Call again with new positions to check other spots.
+// - Finds all instances of the search term in the text of one logical line (the haystack)
+//   and appends them to _matches.
 // Arguments:
-// - pos - The position in the haystack (screen buffer) to compare
-// - start - If we found it, this is filled with the coordinate of the first character of the needle.
-// - end - If we found it, this is filled with the coordinate of the last character of the needle.
-// Return Value:
-// - True if we found it. False if not.
-bool Search::_FindNeedleInHaystackAt(const COORD pos, COORD& start, COORD& end) const
+// - text - The text of the line, with the case sensitivity applied
+// - cells - The index of the cell each code unit of text belongs to, counted from the start of the line
+// - firstRow - The row the line starts at
+// - width - The width of the rows
+void Search::_FindAllInLine(const std::wstring_view text, const std::vector<size_t>& cells, const size_t firstRow, const size_t width)
 {
-    start = { 0 };
-    end = { 0 };
+    const auto needleSize = _needle.size();
+    if (text.size() < needleSize)
+    {
+        return;
+    }
 
-    COORD bufferPos = pos;
+    // A code unit is the first of its cell if the cell differs from the one of the previous code unit.
+    const auto startsCell = [](const std::vector<size_t>& offsets, const size_t offset) noexcept {
+        return offset == 0 || offset == offsets.size() || til::at(offsets, offset) != til::at(offsets, offset - 1);
+    };
+    const auto toCoord = [&](const size_t cell) {
+        return COORD{ gsl::narrow<SHORT>(cell % width), gsl::narrow<SHORT>(firstRow + cell / width) };
+    };
 
-    for (const auto& needleCell : _needle)
+    const auto lastNeedleChar = _needle.back();
+    for (size_t pos = 0; pos + needleSize <= text.size();)
     {
-        // Haystack is the buffer. Needle is the string we were given.
-        const auto hayIter = _uiaData.GetTextBuffer().GetTextDataAt(bufferPos);
-        const auto hayChars = *hayIter;
-        const auto needleChars = std::wstring_view(needleCell.data(), needleCell.size());
-
-        // If we didn't match at any point of the needle, return false.
-        if (!_CompareChars(hayChars, needleChars))
+        const auto last = til::at(text, pos + needleSize - 1);
+        if (last == lastNeedleChar && text.compare(pos, needleSize - 1, _needle, 0, needleSize - 1) == 0)
         {
-            return false;
+            // The text matches, but it also has to cover the same cells. A multi code unit
+            // glyph in the buffer must not match only partially, for instance.
+            auto cellsMatch = startsCell(cells, pos) && startsCell(cells, pos + needleSize);
+            for (size_t i = 1; cellsMatch && i < needleSize; ++i)
+            {
+                cellsMatch = startsCell(cells, pos + i) == startsCell(_needleCells, i);
+            }
+
+            if (cellsMatch)
+            {
+                _matches->emplace_back(toCoord(til::at(cells, pos)), toCoord(til::at(cells, pos + needleSize - 1)));
+            }
         }
 
-        _IncrementCoord(bufferPos);
+        pos += til::at(_shifts, last & 0xff);
     }
-
-    _DecrementCoord(bufferPos);
-
-    // If we made it the whole way through the needle, then it was in the haystack.
-    // Fill out the span that we found the result at and return true.
-    start = pos;
-    end = bufferPos;
-
-    return true;
 }
 
 // Routine Description:
-// - Provides an abstraction for comparing two spans of text.
-// - Internally handles case sensitivity based on object construction.
+// - Determines when a position is visited if the text is scanned in the search
+//   direction starting at the given position. See _UpdateNextPosition.
 // Arguments:
-// - one - String view representing the first string of text
-// - two - String view representing the second string of text
+// - from - The index of the position the scan starts at (row * width + column)
+// - pos - The index of the position to check
+// - count - The number of positions up to the end of the text
 // Return Value:
-// - True if they are the same. False otherwise.
-bool Search::_CompareChars(const std::wstring_view one, const std::wstring_view two) const noexcept
+// - The number of steps it takes to reach pos.
+size_t Search::_GetScanOrder(const size_t from, const size_t pos, const size_t count) const noexcept
 {
-    if (one.size() != two.size())
+    if (pos == from)
     {
-        return false;
+        return 0;
     }
 
-    for (size_t i = 0; i < one.size(); i++)
+    if (_direction == Direction::Forward)
     {
-        if (_ApplySensitivity(one.at(i)) != _ApplySensitivity(two.at(i)))
-        {
-            return false;
-        }
+        // Going past the end of the text continues at the start of the buffer.
+        return from < count ? (pos + count - from) % count : pos + 1;
+    }
+    else
+    {
+        // Going past the start of the buffer continues at the end of the text.
+        return from < count ? (from + count - pos) % count : count - pos;
     }
-
-    return true;
 }
 
 // Routine Description:
@@ -257,6 +375,11 @@ wchar_t Search::_ApplySensitivity(const wchar_t wch) const noexcept
 {
     if (_sensitivity == Sensitivity::CaseInsensitive)
     {
+        // Most of the buffer is usually ASCII. Spare us the call for it.
+        if (wch < 0x80)
+        {
+            return wch >= L'A' && wch <= L'Z' ? static_cast<wchar_t>(wch + (L'a' - L'A')) : wch;
+        }
         return ::towlower(wch);
     }
     else
@@ -344,3 +467,30 @@ std::vector<std::vector<wchar_t>> Search::s_CreateNeedleFromString(const std::ws
     }
     return cells;
 }
+
+// Routine Description:
+// - Flattens the cells of the search term into _needle, applying the case
+//   sensitivity, and prepares the Boyer-Moore-Horspool shift table.
+// Arguments:
+// - cells - The search term, split into cells as created by s_CreateNeedleFromString
+void Search::_PrepareNeedle(const std::vector<std::vector<wchar_t>>& cells)
+{
+    for (size_t cell = 0; cell < cells.size(); ++cell)
+    {
+        for (const auto wch : til::at(cells, cell))
+        {
+            _needle.push_back(_ApplySensitivity(wch));
+            _needleCells.push_back(cell);
+        }
+    }
+
+    // Each code unit shifts the window so that its last occurrence in the needle
+    // (not counting the last position) lines up with it. Code units are bucketed
+    // by their low byte, so the shift is the smallest one of each bucket.
+    const auto needleSize = _needle.size();
+    _shifts.fill(std::max<size_t>(needleSize, 1));
+    for (size_t i = 0; i + 1 < needleSize; ++i)
+    {
+        til::at(_shifts, til::at(_needle, i) & 0xff) = needleSize - 1 - i;
+    }
+}
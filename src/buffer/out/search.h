@@ -7,6 +7,9 @@ Module Name:
 
 Abstract:
 - This module is used for searching through the screen for a substring
+- All matches are found in a single pass over the text of the buffer, one
+  logical line (a run of wrapped rows) at a time, with a Boyer-Moore-Horspool
+  matcher. FindNext() then steps through them.
 
 Author(s):
 - Michael Niksa (MiNiksa) 20-Apr-2018
@@ -52,6 +55,7 @@ public:
            const COORD anchor);
 
     bool FindNext();
+    const std::vector<std::pair<COORD, COORD>>& FindAll();
     void Select() const;
     void Color(const TextAttribute attr) const;
 
@@ -59,8 +63,9 @@ public:
 
 private:
     wchar_t _ApplySensitivity(const wchar_t wch) const noexcept;
-    bool _FindNeedleInHaystackAt(const COORD pos, COORD& start, COORD& end) const;
-    bool _CompareChars(const std::wstring_view one, const std::wstring_view two) const noexcept;
+    void _PrepareNeedle(const std::vector<std::vector<wchar_t>>& cells);
+    void _FindAllInLine(const std::wstring_view text, const std::vector<size_t>& cells, const size_t firstRow, const size_t width);
+    size_t _GetScanOrder(const size_t from, const size_t pos, const size_t count) const noexcept;
     void _UpdateNextPosition();
 
     void _IncrementCoord(COORD& coord) const noexcept;
@@ -76,7 +81,17 @@ private:
     COORD _coordSelEnd = { 0 };
 
     const COORD _coordAnchor;
-    const std::vector<std::vector<wchar_t>> _needle;
+
+    // The search term with the case sensitivity applied. _needleCells holds the
+    // index of the cell each code unit belongs to. Wide glyphs occupy two cells.
+    std::wstring _needle;
+    std::vector<size_t> _needleCells;
+    // Boyer-Moore-Horspool shifts, indexed by the low byte of the last code unit in the window.
+    std::array<size_t, 256> _shifts{};
+
+    // All matches in the buffer, in forward order. Filled in by the first call to FindAll.
+    std::optional<std::vector<std::pair<COORD, COORD>>> _matches;
+
     const Direction _direction;
     const Sensitivity _sensitivity;
     Microsoft::Console::Types::IUiaData& _uiaData;
@@ -35,20 +35,24 @@ TextBuffer::TextBuffer(const COORD screenBufferSize,
     _firstRow{ 0 },
     _currentAttributes{ defaultAttributes },
     _cursor{ cursorSize, *this },
+    _hyperlinks{},
+    _attrRuns{ til::pmr::get_default_resource() },
+    _cells{ _AllocateCells({ screenBufferSize.X, gsl::narrow_cast<SHORT>(s_HotRowCount(screenBufferSize.X, screenBufferSize.Y)) }) },
     _storage{},
-    _unicodeStorage{},
     _renderTarget{ renderTarget },
     _size{},
-    _currentHyperlinkId{ 1 },
     _currentPatternId{ 0 }
 {
-    // initialize ROWs
+    // initialize ROWs. The ones that don't get cells of their own start out frozen.
+    const auto hotRows = s_HotRowCount(screenBufferSize.X, screenBufferSize.Y);
     _storage.reserve(static_cast<size_t>(screenBufferSize.Y));
     for (size_t i = 0; i < static_cast<size_t>(screenBufferSize.Y); ++i)
     {
-        _storage.emplace_back(static_cast<SHORT>(i), screenBufferSize.X, _currentAttributes, this);
+        const auto cells = i < hotRows ? &_cells[i * screenBufferSize.X] : nullptr;
+        _storage.emplace_back(static_cast<SHORT>(i), cells, screenBufferSize.X, _currentAttributes, this);
     }
 
+    _hyperlinks.SetActiveId(_currentAttributes.GetHyperlinkId());
     _UpdateSize();
 }
 
@@ -88,7 +92,14 @@ const ROW& TextBuffer::GetRowByOffset(const size_t index) const
 
     // Rows are stored circularly, so the index you ask for is offset by the start position and mod the total of rows.
     const size_t offsetIndex = (_firstRow + index) % totalRows;
-    return _storage.at(offsetIndex);
+
+    // Rows that were frozen to save memory get their cells back the first time they're accessed.
+    const auto& row = _storage.at(offsetIndex);
+    if (row.IsFrozen())
+    {
+        _ThawRow(row);
+    }
+    return row;
 }
 
 // Routine Description:
@@ -100,11 +111,24 @@ const ROW& TextBuffer::GetRowByOffset(const size_t index) const
 // - reference to the requested row. Asserts if out of bounds.
 ROW& TextBuffer::GetRowByOffset(const size_t index)
 {
+    // A row that may be written to has to hold what it would after Reflow() by now.
+    // From then on, the rows above it are laid out as if it had been written to.
+    if (index < _reflowTop)
+    {
+        ReflowScrollback(index);
+        _reflowTop = std::min(_reflowTop, index);
+    }
+
     const size_t totalRows = TotalRowCount();
 
     // Rows are stored circularly, so the index you ask for is offset by the start position and mod the total of rows.
     const size_t offsetIndex = (_firstRow + index) % totalRows;
-    return _storage.at(offsetIndex);
+    auto& row = _storage.at(offsetIndex);
+    if (row.IsFrozen())
+    {
+        _ThawRow(row);
+    }
+    return row;
 }
 
 // Routine Description:
@@ -392,6 +416,36 @@ OutputCellIterator TextBuffer::WriteLine(const OutputCellIterator givenIt,
     return newIt;
 }
 
+// Routine Description:
+// - Writes a run of narrow glyphs into a single row of the output buffer.
+// - Unlike Write(), this doesn't go through an OutputCellIterator per glyph.
+//   The text is copied straight into the row and the attributes are applied
+//   once for the whole run. Writing stops at the end of the row.
+// Arguments:
+// - chars - The text to write. Every code unit must be a narrow, non-surrogate glyph.
+// - target - Coordinate targeted within output buffer
+// - wrap - change the wrap flag if we hit the end of the row while writing.
+// Return Value:
+// - The number of code units (and cells) written. 0 if the target is out of bounds.
+size_t TextBuffer::WriteNarrowRun(const std::wstring_view chars,
+                                  const COORD target,
+                                  const std::optional<bool> wrap)
+{
+    // If we're not in bounds, exit early.
+    if (chars.empty() || !GetSize().IsInBounds(target))
+    {
+        return 0;
+    }
+
+    ROW& row = GetRowByOffset(target.Y);
+    const auto written = row.WriteNarrowRun(chars, target.X, _currentAttributes, wrap);
+
+    const Viewport paint = Viewport::FromDimensions(target, { gsl::narrow<SHORT>(written), 1 });
+    _NotifyPaint(paint);
+
+    return written;
+}
+
 //Routine Description:
 // - Inserts one codepoint into the buffer at the current cursor position and advances the cursor as appropriate.
 //Arguments:
@@ -558,9 +612,6 @@ bool TextBuffer::IncrementCircularBuffer(const bool inVtMode)
     // to the logical position 0 in the window (cursor coordinates and all other coordinates).
     _renderTarget.TriggerCircling();
 
-    // Prune hyperlinks to delete obsolete references
-    _PruneHyperlinks();
-
     // Second, clean out the old "first row" as it will become the "last row" of the buffer after the circle is performed.
     auto fillAttributes = _currentAttributes;
     if (inVtMode)
@@ -572,6 +623,13 @@ bool TextBuffer::IncrementCircularBuffer(const bool inVtMode)
     const bool fSuccess = _storage.at(_firstRow).Reset(fillAttributes);
     if (fSuccess)
     {
+        // If the old "first row" was still waiting for a lazy reflow, the lines that
+        // would have ended up in it are gone. Once all of those rows are, so is the reflow.
+        if (_reflowTop > 0 && --_reflowTop == 0)
+        {
+            _DiscardReflowSource();
+        }
+
         // Now proceed to increment.
         // Incrementing it will cause the next line down to become the new "top" of the window (the new "0" in logical coordinates)
         _firstRow++;
@@ -581,10 +639,46 @@ bool TextBuffer::IncrementCircularBuffer(const bool inVtMode)
         {
             _firstRow = 0;
         }
+
+        // The rows written to since the last frame moved up along with their contents.
+        _ScrollDirtyRows();
+
+        // The rows that scrolled up far enough are frozen in batches,
+        // once the rows at the bottom used up the free cells.
+        if (_freeRowCells.empty() || !_overflowCells.empty())
+        {
+            try
+            {
+                _FreezeColdRows();
+            }
+            CATCH_LOG();
+        }
     }
     return fSuccess;
 }
 
+// Routine Description:
+// - Freezes the cold rows again, if the rows that were thawed since they were last
+//   frozen need more than ThawedRowBudget rows of overflow cells. That's what reading
+//   through the scrollback does, like a search does, even if the buffer never circles.
+// - This invalidates references to rows, so it must only be called where none are
+//   held, like at the end of a write.
+// Arguments:
+// - <none>
+// Return Value:
+// - <none>
+void TextBuffer::TrimThawedRows() noexcept
+{
+    if (_overflowCells.size() * HotRowSlack > ThawedRowBudget)
+    {
+        try
+        {
+            _FreezeColdRows();
+        }
+        CATCH_LOG();
+    }
+}
+
 //Routine Description:
 // - Retrieves the position of the last non-space character in the given
 //   viewport
@@ -689,6 +783,14 @@ void TextBuffer::ScrollRows(const SHORT firstRow, const SHORT size, const SHORT
         return;
     }
 
+    // The rows above _reflowTop are tracked by their position in the buffer.
+    // If any of them get moved, they have to be laid out first.
+    if (gsl::narrow_cast<size_t>(std::max(0, std::min<int>(firstRow, firstRow + delta))) < _reflowTop)
+    {
+        ReflowScrollback(0);
+        _reflowTop = 0;
+    }
+
     // OK. We're about to play games by moving rows around within the deque to
     // scroll a massive region in a faster way than copying things.
     // To make this easier, first correct the circular buffer to have the first row be 0 again.
@@ -778,8 +880,49 @@ void TextBuffer::ScrollRows(const SHORT firstRow, const SHORT size, const SHORT
     }
 
     // Renumber the IDs now that we've rearranged where the rows sit within the buffer.
-    // Refreshing should also delegate to the UnicodeStorage to re-key all the stored unicode sequences (where applicable).
-    _RefreshRowIDs(std::nullopt);
+    // Each row carries its own UnicodeStorage and points to its own cells, so both moved along with them.
+    _RefreshRowIDs();
+}
+
+// Routine Description:
+// - Copies a rectangle of cells to another position within the buffer.
+//   Each row of the rectangle is copied as a whole, along with the runs of its attributes.
+// - The source and the target may overlap. The rows are copied starting from the
+//   side of the rectangle that the target lies towards, so that no source row is
+//   overwritten before it's been copied.
+// Arguments:
+// - source - The rectangle to copy. It must lie within the buffer.
+// - targetOrigin - Where to copy the top left corner of the rectangle to.
+//   The whole target rectangle must lie within the buffer.
+// Return Value:
+// - <none>
+void TextBuffer::CopyRectangle(const Viewport& source, const COORD targetOrigin)
+{
+    const auto target = Viewport::FromDimensions(targetOrigin, source.Dimensions());
+    THROW_HR_IF(E_INVALIDARG, !GetSize().IsInBounds(source) || !GetSize().IsInBounds(target));
+
+    const auto copyRow = [&](const int offset) {
+        const auto& sourceRow = GetRowByOffset(gsl::narrow_cast<size_t>(source.Top() + offset));
+        auto& targetRow = GetRowByOffset(gsl::narrow_cast<size_t>(target.Top() + offset));
+        targetRow.CopyCellRange(sourceRow, source.Left(), source.RightExclusive(), target.Left());
+    };
+
+    if (target.Top() > source.Top())
+    {
+        for (auto offset = source.Height() - 1; offset >= 0; --offset)
+        {
+            copyRow(offset);
+        }
+    }
+    else
+    {
+        for (auto offset = 0; offset < source.Height(); ++offset)
+        {
+            copyRow(offset);
+        }
+    }
+
+    _NotifyPaint(target);
 }
 
 Cursor& TextBuffer::GetCursor() noexcept
@@ -800,6 +943,7 @@ const Cursor& TextBuffer::GetCursor() const noexcept
 void TextBuffer::SetCurrentAttributes(const TextAttribute& currentAttributes) noexcept
 {
     _currentAttributes = currentAttributes;
+    _hyperlinks.SetActiveId(currentAttributes.GetHyperlinkId());
 }
 
 void TextBuffer::SetCurrentLineRendition(const LineRendition lineRendition)
@@ -881,6 +1025,9 @@ void TextBuffer::Reset()
 {
     const auto attr = GetCurrentAttributes();
 
+    _DiscardReflowSource();
+    _reflowTop = 0;
+
     for (auto& row : _storage)
     {
         row.Reset(attr);
@@ -899,9 +1046,20 @@ void TextBuffer::Reset()
 
     try
     {
+        // The rows are about to be moved around and resized.
+        ReflowScrollback(0);
+        _reflowTop = 0;
+
+        // Only the rows that aren't frozen get new cells, so there mustn't be more of them than fit.
+        _FreezeColdRows();
+
         const auto currentSize = GetSize().Dimensions();
         const auto attributes = GetCurrentAttributes();
 
+        // Allocate the new cells first, so that we leave the buffer untouched if that fails.
+        const auto hotRows = s_HotRowCount(newSize.X, newSize.Y);
+        auto cells = _AllocateCells({ newSize.X, gsl::narrow_cast<SHORT>(hotRows) });
+
         SHORT TopRow = 0; // new top row of the screen buffer
         if (newSize.Y <= GetCursor().GetPosition().Y)
         {
@@ -910,11 +1068,7 @@ void TextBuffer::Reset()
         const SHORT TopRowIndex = (GetFirstRowIndex() + TopRow) % currentSize.Y;
 
         // rotate rows until the top row is at index 0
-        for (int i = 0; i < TopRowIndex; i++)
-        {
-            _storage.emplace_back(std::move(_storage.front()));
-            _storage.erase(_storage.begin());
-        }
+        std::rotate(_storage.begin(), _storage.begin() + TopRowIndex, _storage.end());
 
         _SetFirstRowIndex(0);
 
@@ -924,74 +1078,400 @@ void TextBuffer::Reset()
         {
             _storage.pop_back();
         }
+
+        // realloc in the X direction by copying the remaining rows into the new cells, in order.
+        // This also drops the UnicodeStorage characters that fall outside the resized rows.
+        // Frozen rows stay frozen, unless there's room for all rows in the new cells.
+        // After _FreezeColdRows() the rows that have cells never outnumber the new cells.
+        size_t hotRow = 0;
+        for (auto& row : _storage)
+        {
+            if (!row.IsFrozen() || hotRows == static_cast<size_t>(newSize.Y))
+            {
+                THROW_IF_FAILED(row.Resize(&cells[hotRow++ * newSize.X], newSize.X));
+            }
+            else
+            {
+                THROW_IF_FAILED(row.Resize(nullptr, newSize.X));
+            }
+        }
+
         // add rows if we're growing
         while (_storage.size() < static_cast<size_t>(newSize.Y))
         {
-            _storage.emplace_back(static_cast<short>(_storage.size()), newSize.X, attributes, this);
+            const auto rowCells = hotRow < hotRows ? &cells[hotRow++ * newSize.X] : nullptr;
+            _storage.emplace_back(static_cast<short>(_storage.size()), rowCells, newSize.X, attributes, this);
+        }
+
+        // None of the rows point to the old cells anymore.
+        _cells = std::move(cells);
+        _overflowCells.clear();
+        _freeRowCells.clear();
+        while (hotRow < hotRows)
+        {
+            _freeRowCells.push_back(&_cells[hotRow++ * newSize.X]);
         }
 
         // Now that we've tampered with the row placement, refresh all the row IDs.
-        // Also take advantage of the row ID refresh loop to resize the rows in the X dimension
-        // and cleanup the UnicodeStorage characters that might fall outside the resized buffer.
-        _RefreshRowIDs(newSize.X);
+        _RefreshRowIDs();
 
         // Update the cached size value
         _UpdateSize();
+
+        // The dirty rows don't line up with the rows anymore.
+        _allDirty = _allDirty || _dirtyTop < _dirtyBottom;
+        _ResetDirtyRows();
     }
     CATCH_RETURN();
 
     return S_OK;
 }
 
-const UnicodeStorage& TextBuffer::GetUnicodeStorage() const noexcept
-{
-    return _unicodeStorage;
-}
-
-UnicodeStorage& TextBuffer::GetUnicodeStorage() noexcept
-{
-    return _unicodeStorage;
-}
-
 // Routine Description:
 // - Method to help refresh all the Row IDs after manipulating the row
 //   by shuffling pointers around.
 // - This will also update parent pointers that are stored in depth within the buffer
 //   (e.g. it will update CharRow parents pointing at Rows that might have been moved around)
-// - Optionally takes a new row width if we're resizing to perform a resize operation and cleanup
-//   any high unicode (UnicodeStorage) runs while we're already looping through the rows.
 // Arguments:
-// - newRowWidth - Optional new value for the row width.
-void TextBuffer::_RefreshRowIDs(std::optional<SHORT> newRowWidth)
+// - <none>
+void TextBuffer::_RefreshRowIDs()
 {
-    std::unordered_map<SHORT, SHORT> rowMap;
     SHORT i = 0;
     for (auto& it : _storage)
     {
-        // Build a map so we can update Unicode Storage
-        rowMap.emplace(it.GetId(), i);
-
         // Update the IDs
         it.SetId(i++);
 
         // Also update the char row parent pointers as they can get shuffled up in the rotates.
         it.GetCharRow().UpdateParent(&it);
+    }
+}
+
+// Routine Description:
+// - Returns how many rows of a buffer of the given size get cells of their own.
+// Arguments:
+// - width - the width of the buffer
+// - height - the height of the buffer
+// Return Value:
+// - The number of rows that _cells holds. Rows are only ever frozen if it's less than the height.
+size_t TextBuffer::s_HotRowCount(const size_t width, const size_t height) noexcept
+{
+    return width > 0 && height > HotRowLimit + HotRowSlack ? HotRowLimit + HotRowSlack : height;
+}
+
+// Routine Description:
+// - Gives a frozen row cells again. They're taken from the parts of _cells
+//   that no row uses, or from newly allocated overflow cells if there are none
+//   left. Either way, no other row loses its cells, so references to rows
+//   stay valid until the next time rows are frozen.
+// - This doesn't change the contents of the buffer as seen from the outside,
+//   which is why the const accessors can do it.
+// Arguments:
+// - row - the frozen row
+// Return Value:
+// - <none>
+void TextBuffer::_ThawRow(const ROW& row) const
+{
+    if (_freeRowCells.empty())
+    {
+        const auto width = GetSize().Width();
+        const auto& cells = _overflowCells.emplace_back(_AllocateCells({ width, gsl::narrow_cast<SHORT>(HotRowSlack) }));
+        _freeRowCells.reserve(HotRowSlack);
+        for (size_t i = 0; i < HotRowSlack; ++i)
+        {
+            _freeRowCells.push_back(&cells[i * width]);
+        }
+    }
+
+    row.Thaw(_freeRowCells.back());
+    _freeRowCells.pop_back();
+}
+
+// Routine Description:
+// - Freezes all rows but the HotRowLimit rows up to the cursor, and frees their cells.
+// - The frozen cells of all of these rows are kept in a single block.
+// - Must only be called where references to rows are invalidated anyway,
+//   which is when the buffer circles or is resized, or in TrimThawedRows().
+// Arguments:
+// - <none>
+// Return Value:
+// - <none>
+void TextBuffer::_FreezeColdRows()
+{
+    const auto height = _storage.size();
+    if (s_HotRowCount(gsl::narrow_cast<size_t>(GetSize().Width()), height) == height)
+    {
+        return;
+    }
+
+    const auto cursorRow = gsl::narrow_cast<size_t>(GetCursor().GetPosition().Y);
+    const auto isHot = [&](const size_t offset) {
+        return offset <= cursorRow && cursorRow - offset < HotRowLimit;
+    };
 
-        // Resize the rows in the X dimension if we have a new width
-        if (newRowWidth.has_value())
+    // Measure first, so that the block is allocated just once.
+    size_t blockSize = 0;
+    for (size_t offset = 0; offset < height; ++offset)
+    {
+        if (!isHot(offset))
+        {
+            blockSize += til::at(_storage, (_firstRow + offset) % height).MeasureFrozenSize();
+        }
+    }
+
+    // Every byte of the block is written to, so it's left uninitialized.
+    const std::shared_ptr<std::byte[]> block{ new std::byte[blockSize] };
+    size_t blockOffset = 0;
+    for (size_t offset = 0; offset < height; ++offset)
+    {
+        auto& row = til::at(_storage, (_firstRow + offset) % height);
+        if (!isHot(offset) && !row.IsFrozen())
+        {
+            blockOffset += row.Freeze(block, blockOffset);
+        }
+    }
+
+    _RefreshFreeRowCells();
+}
+
+// Routine Description:
+// - Finds the parts of _cells that no row uses anymore, after rows were frozen.
+// - Rows that were thawed into overflow cells are moved into _cells,
+//   so that the overflow cells can be released.
+// Arguments:
+// - <none>
+// Return Value:
+// - <none>
+void TextBuffer::_RefreshFreeRowCells()
+{
+    const auto width = gsl::narrow_cast<size_t>(GetSize().Width());
+    const auto hotRows = s_HotRowCount(width, _storage.size());
+    const auto isInCells = [&](const ROW& row) {
+        const auto cells = row.GetCharRow().cbegin();
+        return cells >= _cells.get() && cells < _cells.get() + hotRows * width;
+    };
+
+    std::vector<bool> used(hotRows);
+    for (const auto& row : _storage)
+    {
+        if (!row.IsFrozen() && isInCells(row))
+        {
+            used.at(gsl::narrow_cast<size_t>(row.GetCharRow().cbegin() - _cells.get()) / width) = true;
+        }
+    }
+
+    _freeRowCells.clear();
+    for (size_t i = 0; i < hotRows; ++i)
+    {
+        if (!used.at(i))
+        {
+            _freeRowCells.push_back(&_cells[i * width]);
+        }
+    }
+
+    if (!_overflowCells.empty())
+    {
+        for (auto& row : _storage)
+        {
+            if (!row.IsFrozen() && !isInCells(row))
+            {
+                // There are at most HotRowLimit rows left that aren't frozen, so there's room for all of them.
+                THROW_HR_IF(E_UNEXPECTED, _freeRowCells.empty());
+                THROW_IF_FAILED(row.Resize(_freeRowCells.back(), gsl::narrow_cast<unsigned short>(width)));
+                _freeRowCells.pop_back();
+            }
+        }
+        _overflowCells.clear();
+    }
+}
+
+// The cells are allocated in whole pages.
+static constexpr size_t CellsAlignment = 4096;
+
+void TextBuffer::CellsDeleter::operator()(CharRowCell* const cells) const noexcept
+{
+    // CharRowCell is trivially destructible, so there's nothing to do but to release the memory.
+    ::operator delete(cells, std::align_val_t{ CellsAlignment });
+}
+
+// Routine Description:
+// - Allocates the cells for a buffer of the given size and initializes them to
+//   their default values. The cells of row i start at index i * size.X.
+// Arguments:
+// - size - the width and height of the buffer
+// Return Value:
+// - the cells
+// Note: will throw if unable to allocate memory
+TextBuffer::CellsPtr TextBuffer::_AllocateCells(const COORD size)
+{
+    static_assert(std::is_trivially_destructible_v<CharRowCell>);
+
+    const auto count = gsl::narrow<size_t>(size.X) * gsl::narrow<size_t>(size.Y);
+    CellsPtr cells{ static_cast<CharRowCell*>(::operator new(std::max<size_t>(count, 1) * sizeof(CharRowCell), std::align_val_t{ CellsAlignment })) };
+    std::uninitialized_fill_n(cells.get(), count, CharRowCell{});
+    return cells;
+}
+
+// Routine Description:
+// - Records that the given region was written to.
+// - The renderer collects the dirty rows once per frame with TakeDirtyRegions,
+//   so only the first write since then wakes it up. Any further writes just set
+//   the bits of their rows.
+// Arguments:
+// - viewport - The region of the buffer that changed.
+// Return Value:
+// - <none>
+void TextBuffer::_NotifyPaint(const Viewport& viewport)
+{
+    if (_allDirty || viewport.Width() <= 0 || viewport.Height() <= 0)
+    {
+        return;
+    }
+
+    const auto size = GetSize();
+    const auto rowCount = gsl::narrow_cast<size_t>(size.Height());
+    if (_dirtyRows.size() != rowCount)
+    {
+        _ResetDirtyRows();
+    }
+
+    const auto wasClean = _dirtyTop >= _dirtyBottom;
+    const auto region = viewport.ToExclusive();
+    if (region.Left <= 0 && region.Top <= 0 && region.Right >= size.Width() && region.Bottom >= size.Height())
+    {
+        _allDirty = true;
+    }
+    else
+    {
+        const auto top = gsl::narrow_cast<size_t>(std::max<SHORT>(region.Top, 0));
+        const auto bottom = std::min(gsl::narrow_cast<size_t>(std::max<SHORT>(region.Bottom, 0)), rowCount);
+        if (top >= bottom)
+        {
+            return;
+        }
+
+        auto index = (top + _dirtyOrigin) % rowCount;
+        for (auto y = top; y < bottom; ++y)
         {
-            // Realloc in the X direction
-            THROW_IF_FAILED(it.Resize(newRowWidth.value()));
+            _dirtyRows[index] = true;
+            if (++index == rowCount)
+            {
+                index = 0;
+            }
         }
+
+        _dirtyTop = std::min(_dirtyTop, top);
+        _dirtyBottom = std::max(_dirtyBottom, bottom);
+        _dirtyLeft = std::min(_dirtyLeft, region.Left);
+        _dirtyRight = std::max(_dirtyRight, region.Right);
+    }
+
+    // Wake the renderer up. Whatever else gets written
+    // before it gets around to painting is collected along with it.
+    if (wasClean)
+    {
+        _renderTarget.TriggerRedraw(viewport);
+    }
+}
+
+// Routine Description:
+// - Moves the dirty rows up along with the buffer contents when the buffer circles.
+//   The first row falls off the buffer, and its bit becomes the one of the last row.
+// Arguments:
+// - <none>
+// Return Value:
+// - <none>
+void TextBuffer::_ScrollDirtyRows() noexcept
+{
+    if (_dirtyTop >= _dirtyBottom || _dirtyRows.empty())
+    {
+        return;
+    }
+
+    _dirtyRows[_dirtyOrigin] = false;
+    _dirtyOrigin = (_dirtyOrigin + 1) % _dirtyRows.size();
+    _dirtyTop = _dirtyTop > 0 ? _dirtyTop - 1 : 0;
+    _dirtyBottom--;
+    if (_dirtyTop >= _dirtyBottom)
+    {
+        _dirtyTop = SIZE_MAX;
+        _dirtyBottom = 0;
+        _dirtyLeft = SHRT_MAX;
+        _dirtyRight = 0;
     }
+}
 
-    // Give the new mapping to Unicode Storage
-    _unicodeStorage.Remap(rowMap, newRowWidth);
+// Routine Description:
+// - Clears the dirty rows and sizes them for the buffer. Whoever changes the rows
+//   under them has to set _allDirty first if any of them were dirty.
+// Arguments:
+// - <none>
+// Return Value:
+// - <none>
+void TextBuffer::_ResetDirtyRows()
+{
+    _dirtyRows.assign(gsl::narrow_cast<size_t>(GetSize().Height()), false);
+    _dirtyOrigin = 0;
+    _dirtyTop = SIZE_MAX;
+    _dirtyBottom = 0;
+    _dirtyLeft = SHRT_MAX;
+    _dirtyRight = 0;
 }
 
-void TextBuffer::_NotifyPaint(const Viewport& viewport) const
+// Routine Description:
+// - Hands out the rows written to since the last call and forgets about them.
+// - Consecutive dirty rows are merged into a single region. All regions span the
+//   columns written to in any of the rows.
+// Arguments:
+// - regions - Receives the regions, exclusive and in buffer coordinates. Cleared first.
+// Return Value:
+// - <none>
+void TextBuffer::TakeDirtyRegions(std::vector<SMALL_RECT>& regions)
 {
-    _renderTarget.TriggerRedraw(viewport);
+    regions.clear();
+
+    if (_allDirty)
+    {
+        regions.emplace_back(GetSize().ToExclusive());
+    }
+
+    const auto rowCount = _dirtyRows.size();
+    const auto bottom = std::min(_dirtyBottom, rowCount);
+    if (_dirtyTop < bottom)
+    {
+        auto index = (_dirtyTop + _dirtyOrigin) % rowCount;
+        for (auto y = _dirtyTop; y < bottom; ++y)
+        {
+            if (_dirtyRows[index])
+            {
+                _dirtyRows[index] = false;
+
+                const auto row = gsl::narrow_cast<SHORT>(y);
+                if (_allDirty)
+                {
+                    // The whole buffer is in the regions already.
+                }
+                else if (!regions.empty() && regions.back().Bottom == row)
+                {
+                    regions.back().Bottom = gsl::narrow_cast<SHORT>(row + 1);
+                }
+                else
+                {
+                    regions.push_back({ _dirtyLeft, row, _dirtyRight, gsl::narrow_cast<SHORT>(row + 1) });
+                }
+            }
+            if (++index == rowCount)
+            {
+                index = 0;
+            }
+        }
+    }
+
+    _dirtyTop = SIZE_MAX;
+    _dirtyBottom = 0;
+    _dirtyLeft = SHRT_MAX;
+    _dirtyRight = 0;
+    _allDirty = false;
 }
 
 // Routine Description:
@@ -1023,7 +1503,12 @@ ROW& TextBuffer::_GetPrevRowNoWrap(const ROW& Row)
     }
 
     THROW_HR_IF(E_FAIL, Row.GetId() == _firstRow);
-    return _storage.at(prevRowIndex);
+    auto& prevRow = _storage.at(prevRowIndex);
+    if (prevRow.IsFrozen())
+    {
+        _ThawRow(prevRow);
+    }
+    return prevRow;
 }
 
 // Method Description:
@@ -1305,52 +1790,6 @@ const COORD TextBuffer::_GetWordEndForSelection(const COORD target, const std::w
     return result;
 }
 
-void TextBuffer::_PruneHyperlinks()
-{
-    // Check the old first row for hyperlink references
-    // If there are any, search the entire buffer for the same reference
-    // If the buffer does not contain the same reference, we can remove that hyperlink from our map
-    // This way, obsolete hyperlink references are cleared from our hyperlink map instead of hanging around
-    // Get all the hyperlink references in the row we're erasing
-    const auto hyperlinks = _storage.at(_firstRow).GetAttrRow().GetHyperlinks();
-
-    if (!hyperlinks.empty())
-    {
-        // Move to unordered set so we can use hashed lookup of IDs instead of linear search.
-        // Only make it an unordered set now because set always heap allocates but vector
-        // doesn't when the set is empty (saving an allocation in the common case of no links.)
-        std::unordered_set<uint16_t> firstRowRefs{ hyperlinks.cbegin(), hyperlinks.cend() };
-
-        const auto total = TotalRowCount();
-        // Loop through all the rows in the buffer except the first row -
-        // we have found all hyperlink references in the first row and put them in refs,
-        // now we need to search the rest of the buffer (i.e. all the rows except the first)
-        // to see if those references are anywhere else
-        for (size_t i = 1; i != total; ++i)
-        {
-            const auto nextRowRefs = GetRowByOffset(i).GetAttrRow().GetHyperlinks();
-            for (auto id : nextRowRefs)
-            {
-                if (firstRowRefs.find(id) != firstRowRefs.end())
-                {
-                    firstRowRefs.erase(id);
-                }
-            }
-            if (firstRowRefs.empty())
-            {
-                // No more hyperlink references left to search for, terminate early
-                break;
-            }
-        }
-
-        // Now delete obsolete references from our map
-        for (auto hyperlinkReference : firstRowRefs)
-        {
-            RemoveHyperlinkFromMap(hyperlinkReference);
-        }
-    }
-}
-
 // Method Description:
 // - Update pos to be the position of the first character of the next word. This is used for accessibility
 // Arguments:
@@ -2146,14 +2585,415 @@ std::string TextBuffer::GenRTF(const TextAndColor& rows, const int fontHeightPoi
     }
 }
 
+namespace
+{
+    // ReflowLazily() only leaves the scrollback in the old buffer if it's longer than this.
+    // It's cheap enough to reflow this much right away, and it's a screen or two at most.
+    constexpr int LazyReflowMinRows{ 1024 };
+
+    // A row of the old buffer, or of the buffer that a lazy reflow left the scrollback in.
+    struct ReflowRow
+    {
+        const TextBuffer* buffer;
+        SHORT row;
+        // One past the last cell that gets copied.
+        SHORT right;
+    };
+
+    // A run of cells of a row in the old buffer that ends up in a single row of the new buffer.
+    struct ReflowSegment
+    {
+        size_t row; // index into the ReflowRows
+        SHORT oldBegin;
+        SHORT oldEnd;
+        // The first cell is a leading half that doesn't fit into the last column of
+        // the new row before it, which gets padded with a space and wrapped instead.
+        bool padded;
+        // Where the run ends up, relative to the first row of the line in the new buffer.
+        size_t newRow;
+        SHORT newColumn;
+    };
+
+    // Rows that continue on the same line in the new buffer, because the text
+    // was wrapped at their end, or because they were filled to the last column.
+    struct ReflowLine
+    {
+        size_t firstRow;
+        size_t lastRow; // inclusive
+        // One past the last row of the old buffer that the line takes up.
+        SHORT oldEnd;
+        size_t segmentsBegin;
+        size_t segmentsEnd;
+    };
+
+    // Routine Description:
+    // - Measures the "right" of a row of the old buffer, which is one past the
+    //   last cell of the row that needs to be copied into the new buffer.
+    // Arguments:
+    // - buffer - the text buffer the row is in
+    // - iRow - the row
+    // Return Value:
+    // - the right of the row
+    SHORT MeasureReflowRight(const TextBuffer& buffer, const SHORT iRow)
+    {
+        const ROW& row = buffer.GetRowByOffset(iRow);
+        short iRight = gsl::narrow_cast<short>(row.GetCharRow().MeasureRight());
+
+        // There is a special case here. If the row has a "wrap"
+        // flag on it, but the right isn't equal to the width (one
+        // index past the final valid index in the row) then there
+        // were a bunch trailing of spaces in the row.
+        // (But the measuring functions for each row Left/Right do
+        // not count spaces as "displayable" so they're not
+        // included.)
+        // As such, adjust the "right" to be the width of the row
+        // to capture all these spaces
+        if (row.WasWrapForced())
+        {
+            iRight = buffer.GetLineWidth(iRow);
+
+            // And a combined special case.
+            // If we wrapped off the end of the row by adding a
+            // piece of padding because of a double byte LEADING
+            // character, then remove one from the "right" to
+            // leave this padding out of the copy process.
+            if (row.WasDoubleBytePadded())
+            {
+                iRight--;
+            }
+        }
+        return iRight;
+    }
+
+    // Routine Description:
+    // - Checks if a row of the old buffer continues on the same line as the row below it.
+    // Arguments:
+    // - buffer - the text buffer the row is in
+    // - iRow - the row
+    // - iRight - the right of the row, see MeasureReflowRight()
+    // Return Value:
+    // - true if the row doesn't end its line
+    bool ContinuesReflowLine(const TextBuffer& buffer, const SHORT iRow, const SHORT iRight)
+    {
+        // A row only ends its line if we didn't have a full row to
+        // copy and weren't forced to wrap. If we did force a word
+        // wrap, then the existing line break was only because we
+        // ran out of space.
+        return buffer.GetRowByOffset(iRow).WasWrapForced() || iRight >= buffer.GetLineWidth(iRow);
+    }
+
+    // Routine Description:
+    // - Lays out a logical line of the old buffer in the new buffer. The result
+    //   only depends on the line itself, as every logical line starts at the left
+    //   edge of the new buffer, and ends where the old one ended with a newline.
+    // - This replicates what InsertCharacter() does cell by cell: a row of the new
+    //   buffer is wrapped once it is full, and a leading half that would end up in
+    //   the last column is moved into the next row, after padding the current one.
+    // Arguments:
+    // - rows - the rows of the old buffer
+    // - line - the rows of the logical line
+    // - newWidth - the width of the new buffer
+    // - segments - receives the runs of cells that get copied into the new buffer
+    // - renditions - Optional. Receives the line rendition of each new row that
+    //   an old row starts in, relative to the first row of the line.
+    // Return Value:
+    // - the row the line ends in, relative to its first row. It's empty if the
+    //   text of the line filled the row before it.
+    size_t LayoutReflowLine(const std::vector<ReflowRow>& rows,
+                            const ReflowLine& line,
+                            const SHORT newWidth,
+                            std::vector<ReflowSegment>& segments,
+                            std::vector<std::optional<LineRendition>>* const renditions = nullptr)
+    {
+        SHORT column = 0;
+        SHORT lineWidth = newWidth;
+        size_t newRow = 0;
+        bool padded = false;
+
+        for (auto iRow = line.firstRow; iRow <= line.lastRow; iRow++)
+        {
+            const auto& reflowRow = til::at(rows, iRow);
+            const ROW& row = reflowRow.buffer->GetRowByOffset(reflowRow.row);
+            const CharRow& charRow = row.GetCharRow();
+            const gsl::span<const CharRowCell> cells{ charRow.cbegin(), charRow.size() };
+            const auto iRight = reflowRow.right;
+
+            // Reflow preserves the line rendition of an old row that starts a new row.
+            // Every other row of the new buffer is still single width.
+            if (column == 0)
+            {
+                const SHORT scale = row.GetLineRendition() != LineRendition::SingleWidth ? 1 : 0;
+                lineWidth = newWidth >> scale;
+
+                if (renditions)
+                {
+                    renditions->resize(newRow + 1);
+                    renditions->back() = row.GetLineRendition();
+                }
+            }
+
+            SHORT begin = 0;
+            while (begin < iRight)
+            {
+                // A double width line in a buffer that's a single column wide
+                // has no room at all, but still takes one cell before wrapping.
+                const SHORT available = std::max<SHORT>(lineWidth, 1) - column;
+                SHORT end = std::min<SHORT>(iRight, begin + available);
+
+                // If we're about to lead on the last column in the row, the leading
+                // half is moved into the next row instead. This happens only once
+                // per character, so a lead that was just moved stays where it is.
+                bool pad = false;
+                if (column + end - begin == lineWidth &&
+                    til::at(cells, end - 1).DbcsAttr().IsLeading() &&
+                    !(padded && end - 1 == begin))
+                {
+                    pad = true;
+                    end--;
+                }
+
+                if (end > begin)
+                {
+                    segments.emplace_back(ReflowSegment{ iRow, begin, end, padded, newRow, column });
+                    padded = false;
+                }
+
+                column += end - begin;
+                if (pad || column >= lineWidth)
+                {
+                    padded = pad;
+                    column = 0;
+                    lineWidth = newWidth;
+                    newRow++;
+                }
+                begin = end;
+            }
+        }
+        return newRow;
+    }
+
+    // Routine Description:
+    // - Copies a run of cells of a row of the old buffer into a row of the new
+    //   buffer, and erases the leading halves in it that lost their trailing half.
+    // Arguments:
+    // - newRow - the row to copy the cells to
+    // - oldRow - the row to copy the cells from
+    // - oldBegin, oldEnd - the [oldBegin, oldEnd) range of columns of the old row to copy
+    // - column - the column of the new row to copy the first cell to
+    // Return Value:
+    // - <none>
+    void CopyReflowRun(ROW& newRow, const ROW& oldRow, const SHORT oldBegin, const SHORT oldEnd, const SHORT column)
+    {
+        const gsl::span<const CharRowCell> oldCells{ oldRow.GetCharRow().cbegin(), oldRow.GetCharRow().size() };
+
+        newRow.CopyCells(oldRow, oldBegin, oldEnd, column);
+
+        // A lead needs a trailing pair. If it doesn't have one, erase it.
+        for (auto iOldCol = oldBegin + 1; iOldCol < oldEnd; iOldCol++)
+        {
+            const auto prevDbcsAttr = til::at(oldCells, iOldCol - 1).DbcsAttr();
+            const auto dbcsAttr = til::at(oldCells, iOldCol).DbcsAttr();
+            if (prevDbcsAttr.IsLeading() && !dbcsAttr.IsTrailing())
+            {
+                newRow.ClearColumn(gsl::narrow_cast<size_t>(column + iOldCol - 1 - oldBegin));
+            }
+            else if (!prevDbcsAttr.IsLeading() && dbcsAttr.IsTrailing())
+            {
+                LOG_HR(E_NOT_VALID_STATE);
+            }
+        }
+    }
+}
+
+// Routine Description:
+// - Lays out the logical line that ends in the last row the lazy reflow left in
+//   the old buffer. It ends in the row right above _reflowTop, which moves up
+//   to the first row of the line. The rows of the line that would end up above
+//   the first row of the buffer are dropped, like those that circled out of it.
+// - Lines are laid out from the bottom up, so that each of them only depends on
+//   itself: where it ends is known, and how many rows it takes up is known once
+//   LayoutReflowLine() broke it into rows.
+// Arguments:
+// - <none>
+// Return Value:
+// - <none>
+void TextBuffer::_ReflowPendingLine()
+{
+    auto& source = *_reflowSource;
+    const auto& oldBuffer = *source.buffer;
+
+    // Walk up to the first row of the line.
+    auto iFirstRow = gsl::narrow_cast<SHORT>(source.end - 1);
+    std::vector<ReflowRow> rows{ ReflowRow{ &oldBuffer, iFirstRow, MeasureReflowRight(oldBuffer, iFirstRow) } };
+    while (iFirstRow > source.top)
+    {
+        const auto iRow = gsl::narrow_cast<SHORT>(iFirstRow - 1);
+        const auto iRight = MeasureReflowRight(oldBuffer, iRow);
+        if (!ContinuesReflowLine(oldBuffer, iRow, iRight))
+        {
+            break;
+        }
+        rows.emplace_back(ReflowRow{ &oldBuffer, iRow, iRight });
+        iFirstRow = iRow;
+    }
+    std::reverse(rows.begin(), rows.end());
+
+    const ReflowLine line{ 0, rows.size() - 1, source.end, 0, 0 };
+    const auto newWidth = GetSize().Width();
+    std::vector<ReflowSegment> segments;
+    std::vector<std::optional<LineRendition>> renditions;
+    const auto lastRow = LayoutReflowLine(rows, line, newWidth, segments, &renditions);
+
+    // The rows above _reflowTop haven't been handed out, so they're still blank and
+    // nobody holds a reference to them. That's why we don't go through GetRowByOffset().
+    const auto origin = gsl::narrow_cast<ptrdiff_t>(_reflowTop) - gsl::narrow_cast<ptrdiff_t>(lastRow) - 1;
+    const auto getRow = [&](const size_t i) -> ROW* {
+        const auto offset = origin + gsl::narrow_cast<ptrdiff_t>(i);
+        if (offset < 0)
+        {
+            return nullptr;
+        }
+        auto& row = _storage.at((_firstRow + gsl::narrow_cast<size_t>(offset)) % _storage.size());
+        if (row.IsFrozen())
+        {
+            _ThawRow(row);
+        }
+        return &row;
+    };
+
+    // Every row of the line but the last one was wrapped, which is what
+    // IncrementCursor() would have done if the line was reflowed right away.
+    for (size_t i = 0; i <= lastRow; i++)
+    {
+        if (const auto row = getRow(i))
+        {
+            if (i < renditions.size() && renditions.at(i).has_value())
+            {
+                row->SetLineRendition(renditions.at(i).value());
+            }
+            row->SetWrapForced(i < lastRow);
+        }
+    }
+
+    for (const auto& segment : segments)
+    {
+        const auto newRow = getRow(segment.newRow);
+        if (!newRow)
+        {
+            continue;
+        }
+
+        const auto& reflowRow = til::at(rows, segment.row);
+        const ROW& oldRow = oldBuffer.GetRowByOffset(reflowRow.row);
+
+        // The row before the run was padded, because the leading half didn't fit into it.
+        const auto rowAbove = segment.newRow > 0 ? getRow(segment.newRow - 1) : nullptr;
+        if (segment.padded && rowAbove)
+        {
+            rowAbove->SetDoubleBytePadded(true);
+        }
+
+        // Erase a leading half in front of the run that lost its trailing half,
+        // just like InsertCharacter() does. CopyReflowRun() checks the rest.
+        auto prevRow = newRow;
+        auto prevColumn = segment.newColumn - 1;
+        if (prevColumn < 0 && rowAbove)
+        {
+            const SHORT scale = rowAbove->GetLineRendition() != LineRendition::SingleWidth ? 1 : 0;
+            prevRow = rowAbove;
+            prevColumn = (newWidth >> scale) - 1;
+        }
+        if (prevColumn >= 0 &&
+            prevRow->GetCharRow().DbcsAttrAt(gsl::narrow_cast<size_t>(prevColumn)).IsLeading() &&
+            !oldRow.GetCharRow().DbcsAttrAt(gsl::narrow_cast<size_t>(segment.oldBegin)).IsTrailing())
+        {
+            prevRow->ClearColumn(gsl::narrow_cast<size_t>(prevColumn));
+        }
+
+        CopyReflowRun(*newRow, oldRow, segment.oldBegin, segment.oldEnd, segment.newColumn);
+    }
+
+    source.end = iFirstRow;
+    _reflowTop = gsl::narrow_cast<size_t>(std::max<ptrdiff_t>(origin, 0));
+    if (_reflowTop == 0 || source.end <= source.top)
+    {
+        _DiscardReflowSource();
+    }
+}
+
+// Routine Description:
+// - Lays out the lines that a lazy reflow left in the old buffer, from the
+//   bottom up, until the given row holds what it would after Reflow().
+// Arguments:
+// - firstRow - the first row that needs to be laid out. 0 lays out everything.
+// Return Value:
+// - <none>
+void TextBuffer::ReflowScrollback(const size_t firstRow)
+{
+    while (_reflowSource && _reflowTop > firstRow)
+    {
+        _ReflowPendingLine();
+    }
+}
+
+// Routine Description:
+// - Returns how many rows at the top of the buffer are still waiting for
+//   ReflowScrollback() to lay out the lines that a lazy reflow left behind.
+// Arguments:
+// - <none>
+// Return Value:
+// - The number of rows. 0 once the old buffer was let go of.
+size_t TextBuffer::PendingReflowRows() const noexcept
+{
+    return _reflowSource ? _reflowTop : 0;
+}
+
+// Routine Description:
+// - Takes over the old buffer that was passed to ReflowLazily(), if this buffer
+//   still needs it to lay out its scrollback. Otherwise, the old buffer is freed.
+// - This is meant to be called right after replacing the old buffer with this one.
+// Arguments:
+// - oldBuffer - the buffer this one was reflowed from
+// Return Value:
+// - <none>
+void TextBuffer::TakeReflowSource(std::unique_ptr<TextBuffer> oldBuffer) noexcept
+{
+    if (_reflowSource && _reflowSource->buffer == oldBuffer.get())
+    {
+        _reflowSource->owner = std::move(oldBuffer);
+    }
+}
+
+// Routine Description:
+// - Forgets about the lines that a lazy reflow left in the old buffer, and
+//   lets go of the old buffer and the hyperlinks they use.
+// Arguments:
+// - <none>
+// Return Value:
+// - <none>
+void TextBuffer::_DiscardReflowSource() noexcept
+{
+    if (_reflowSource)
+    {
+        for (const auto id : _reflowSource->hyperlinks)
+        {
+            _hyperlinks.Release(id, 1);
+        }
+        _reflowSource.reset();
+    }
+}
+
 // Function Description:
 // - Reflow the contents from the old buffer into the new buffer. The new buffer
 //   can have different dimensions than the old buffer. If it does, then this
 //   function will attempt to maintain the logical contents of the old buffer,
 //   by continuing wrapped lines onto the next line in the new buffer.
+// - The old buffer is first split into logical lines, which are laid out in the
+//   new buffer one after the other. Their contents are then copied run by run,
+//   instead of inserting every single cell into the new buffer.
 // Arguments:
 // - oldBuffer - the text buffer to copy the contents FROM
-// - newBuffer - the text buffer to copy the contents TO
+// - newBuffer - the text buffer to copy the contents TO. Must be freshly constructed.
 // - lastCharacterViewport - Optional. If the caller knows that the last
 //   nonspace character is in a particular Viewport, the caller can provide this
 //   parameter as an optimization, as opposed to searching the entire buffer.
@@ -2166,6 +3006,57 @@ HRESULT TextBuffer::Reflow(TextBuffer& oldBuffer,
                            TextBuffer& newBuffer,
                            const std::optional<Viewport> lastCharacterViewport,
                            std::optional<std::reference_wrapper<PositionInformation>> positionInfo)
+{
+    return _Reflow(oldBuffer, newBuffer, lastCharacterViewport, positionInfo, std::nullopt);
+}
+
+// Function Description:
+// - Reflow the contents from the old buffer into the new buffer, like Reflow(),
+//   but leave the logical lines that end above eagerTop in the old buffer.
+// - The rows those lines take up in the new buffer are only laid out once they're
+//   needed, which is when a row is written to, or ReflowScrollback() is called.
+//   Until then, they're blank. The new buffer refers to the old buffer until all
+//   of the lines are laid out, or until they circled out of the new buffer.
+// - The caller has to keep the old buffer alive, by handing it to the new buffer
+//   with TakeReflowSource() once it replaced the old buffer with the new one.
+// - If the old buffer was lazily reflowed itself, the lines it didn't lay out yet
+//   are left in its own old buffer instead, which the new buffer takes over.
+// - Lines are only left in the old buffer if there's a fair number of them.
+// - The rows the lines will take up in the new buffer are estimated, and they
+//   are placed at the bottom of that estimate. Whatever is left of it above
+//   the first line stays blank. This only happens if the new buffer has room
+//   for all of the scrollback and then some.
+// Arguments:
+// - oldBuffer - the text buffer to copy the contents FROM
+// - newBuffer - the text buffer to copy the contents TO. Must be freshly constructed.
+// - lastCharacterViewport - see Reflow()
+// - positionInfo - see Reflow()
+// - eagerTop - the first row of the old buffer that must be copied right away.
+//   The rows of the cursor and the position info are always copied right away.
+// Return Value:
+// - S_OK if we successfully reflowed the contents into the new buffer, otherwise an appropriate HRESULT.
+HRESULT TextBuffer::ReflowLazily(TextBuffer& oldBuffer,
+                                 TextBuffer& newBuffer,
+                                 const std::optional<Viewport> lastCharacterViewport,
+                                 std::optional<std::reference_wrapper<PositionInformation>> positionInfo,
+                                 const SHORT eagerTop)
+{
+    return _Reflow(oldBuffer, newBuffer, lastCharacterViewport, positionInfo, eagerTop);
+}
+
+// Function Description:
+// - The implementation of Reflow() and ReflowLazily().
+// Arguments:
+// - oldBuffer, newBuffer, lastCharacterViewport, positionInfo - see Reflow()
+// - eagerTop - see ReflowLazily(). If it's empty, every line is copied right away.
+// Return Value:
+// - S_OK if we successfully reflowed the contents into the new buffer, otherwise an appropriate HRESULT.
+HRESULT TextBuffer::_Reflow(TextBuffer& oldBuffer,
+                            TextBuffer& newBuffer,
+                            const std::optional<Viewport> lastCharacterViewport,
+                            std::optional<std::reference_wrapper<PositionInformation>> positionInfo,
+                            const std::optional<SHORT> eagerTop)
+try
 {
     const Cursor& oldCursor = oldBuffer.GetCursor();
     Cursor& newCursor = newBuffer.GetCursor();
@@ -2174,168 +3065,297 @@ HRESULT TextBuffer::Reflow(TextBuffer& oldBuffer,
     // place the new cursor back on the equivalent character in
     // the new buffer.
     const COORD cOldCursorPos = oldCursor.GetPosition();
-    const COORD cOldLastChar = oldBuffer.GetLastNonSpaceCharacter(lastCharacterViewport);
 
-    const short cOldRowsTotal = cOldLastChar.Y + 1;
+    // The rows from here on are needed to place the cursor and the position info
+    // in the new buffer, so they're always copied right away.
+    SHORT cOldPinnedTop = cOldCursorPos.Y;
+    if (positionInfo.has_value())
+    {
+        cOldPinnedTop = std::min({ cOldPinnedTop,
+                                   positionInfo.value().get().mutableViewportTop,
+                                   positionInfo.value().get().visibleViewportTop });
+    }
+    if (eagerTop.has_value())
+    {
+        cOldPinnedTop = std::min(cOldPinnedTop, eagerTop.value());
+    }
+    cOldPinnedTop = std::max<SHORT>(cOldPinnedTop, 0);
 
-    COORD cNewCursorPos = { 0 };
-    bool fFoundCursorPos = false;
-    bool foundOldMutable = false;
-    bool foundOldVisible = false;
-    HRESULT hr = S_OK;
-    // Loop through all the rows of the old buffer and reprint them into the new buffer
-    for (short iOldRow = 0; iOldRow < cOldRowsTotal; iOldRow++)
+    // If the old buffer was lazily reflowed itself, the rows we copy have to be laid out by now.
+    oldBuffer.ReflowScrollback(eagerTop.has_value() ? cOldPinnedTop : 0);
+
+    // The rows that are still waiting to be laid out are blank. If that's all there's
+    // left above the pinned rows, the last character may well be in one of them.
+    COORD cOldLastChar = oldBuffer.GetLastNonSpaceCharacter(lastCharacterViewport);
+    if (oldBuffer._reflowSource && gsl::narrow_cast<size_t>(cOldLastChar.Y) < oldBuffer._reflowTop)
     {
-        // Fetch the row and its "right" which is the last printable character.
-        const ROW& row = oldBuffer.GetRowByOffset(iOldRow);
-        const short cOldColsTotal = oldBuffer.GetLineWidth(iOldRow);
-        const CharRow& charRow = row.GetCharRow();
-        short iRight = gsl::narrow_cast<short>(charRow.MeasureRight());
+        oldBuffer.ReflowScrollback(0);
+        cOldLastChar = oldBuffer.GetLastNonSpaceCharacter(lastCharacterViewport);
+    }
 
-        // If we're starting a new row, try and preserve the line rendition
-        // from the row in the original buffer.
-        const auto newBufferPos = newBuffer.GetCursor().GetPosition();
-        if (newBufferPos.X == 0)
+    const short cOldRowsTotal = cOldLastChar.Y + 1;
+
+    // When reflowing lazily, the logical lines that end above the pinned rows are left in the
+    // old buffer, or in the buffer the old one left its own scrollback in, if it still has some.
+    // Either way, the rows above the old buffer's _reflowTop aren't copied, as there's nothing in them.
+    const TextBuffer* scrollbackBuffer = nullptr;
+    SHORT cScrollbackTop = 0;
+    SHORT cScrollbackEnd = 0;
+    SHORT cOldTop = 0;
+    if (eagerTop.has_value())
+    {
+        if (oldBuffer._reflowSource)
         {
-            auto& newRow = newBuffer.GetRowByOffset(newBufferPos.Y);
-            newRow.SetLineRendition(row.GetLineRendition());
+            const auto& source = *oldBuffer._reflowSource;
+            if (source.end - source.top > LazyReflowMinRows)
+            {
+                scrollbackBuffer = source.buffer;
+                cScrollbackTop = source.top;
+                cScrollbackEnd = source.end;
+                cOldTop = gsl::narrow_cast<SHORT>(oldBuffer._reflowTop);
+            }
         }
-
-        // There is a special case here. If the row has a "wrap"
-        // flag on it, but the right isn't equal to the width (one
-        // index past the final valid index in the row) then there
-        // were a bunch trailing of spaces in the row.
-        // (But the measuring functions for each row Left/Right do
-        // not count spaces as "displayable" so they're not
-        // included.)
-        // As such, adjust the "right" to be the width of the row
-        // to capture all these spaces
-        if (row.WasWrapForced())
+        else
         {
-            iRight = cOldColsTotal;
-
-            // And a combined special case.
-            // If we wrapped off the end of the row by adding a
-            // piece of padding because of a double byte LEADING
-            // character, then remove one from the "right" to
-            // leave this padding out of the copy process.
-            if (row.WasDoubleBytePadded())
+            // The pinned rows might continue a line that starts further up.
+            const auto cOldReflowTop = gsl::narrow_cast<SHORT>(std::min(oldBuffer._reflowTop, gsl::narrow_cast<size_t>(cOldPinnedTop)));
+            auto cLineTop = std::min<SHORT>(cOldPinnedTop, cOldRowsTotal - 1);
+            while (cLineTop > cOldReflowTop)
             {
-                iRight--;
+                const auto iRow = gsl::narrow_cast<SHORT>(cLineTop - 1);
+                if (!ContinuesReflowLine(oldBuffer, iRow, MeasureReflowRight(oldBuffer, iRow)))
+                {
+                    break;
+                }
+                cLineTop = iRow;
+            }
+            if (cLineTop - cOldReflowTop > LazyReflowMinRows)
+            {
+                scrollbackBuffer = &oldBuffer;
+                cScrollbackTop = cOldReflowTop;
+                cScrollbackEnd = cLineTop;
+                cOldTop = cLineTop;
             }
         }
+    }
+    if (!scrollbackBuffer)
+    {
+        oldBuffer.ReflowScrollback(0);
+        cOldTop = gsl::narrow_cast<SHORT>(std::min<size_t>({ oldBuffer._reflowTop,
+                                                             gsl::narrow_cast<size_t>(cOldPinnedTop),
+                                                             gsl::narrow_cast<size_t>(cOldRowsTotal - 1) }));
+    }
+
+    // Measure the "right" of every row, which is one past the last printable
+    // character, and join the rows that continue on the same line.
+    std::vector<ReflowRow> rows;
+    std::vector<ReflowLine> lines;
+    bool continuesLine = false;
+    rows.reserve(gsl::narrow_cast<size_t>(cOldRowsTotal - cOldTop));
+    for (short iOldRow = cOldTop; iOldRow < cOldRowsTotal; iOldRow++)
+    {
+        const short iRight = MeasureReflowRight(oldBuffer, iOldRow);
+        rows.emplace_back(ReflowRow{ &oldBuffer, iOldRow, iRight });
+
+        if (continuesLine)
+        {
+            lines.back().lastRow = rows.size() - 1;
+            lines.back().oldEnd = gsl::narrow_cast<SHORT>(iOldRow + 1);
+        }
+        else
+        {
+            lines.emplace_back(ReflowLine{ rows.size() - 1, rows.size() - 1, gsl::narrow_cast<SHORT>(iOldRow + 1), 0, 0 });
+        }
+
+        continuesLine = ContinuesReflowLine(oldBuffer, iOldRow, iRight);
+    }
+
+    // Lay out the new rows of every logical line. They don't depend on each
+    // other, so this could be split up, but it's cheap compared to the copy:
+    // only the cells that end up in the last column of a row are looked at.
+    const auto newWidth = newBuffer.GetSize().Width();
+    std::vector<ReflowSegment> segments;
+    segments.reserve(rows.size());
+    for (auto& line : lines)
+    {
+        line.segmentsBegin = segments.size();
+        LayoutReflowLine(rows, line, newWidth, segments);
+        line.segmentsEnd = segments.size();
+    }
+
+    COORD cNewCursorPos = { 0 };
+    bool fFoundCursorPos = false;
+    bool foundOldMutable = false;
+    bool foundOldVisible = false;
+    HRESULT hr = S_OK;
+    // Loop through all the lines of the old buffer and reprint them into the new buffer
+    for (const auto& line : lines)
+    {
+        auto segmentIndex = line.segmentsBegin;
 
-        // Loop through every character in the current row (up to
-        // the "right" boundary, which is one past the final valid
-        // character)
-        for (short iOldCol = 0; iOldCol < iRight; iOldCol++)
+        for (auto iRow = line.firstRow; iRow <= line.lastRow; iRow++)
         {
-            if (iOldCol == cOldCursorPos.X && iOldRow == cOldCursorPos.Y)
+            const auto iOldRow = til::at(rows, iRow).row;
+            const ROW& row = std::as_const(oldBuffer).GetRowByOffset(iOldRow);
+            const gsl::span<const CharRowCell> oldCells{ row.GetCharRow().cbegin(), row.GetCharRow().size() };
+
+            // If we're starting a new row, try and preserve the line rendition
+            // from the row in the original buffer.
+            const auto newBufferPos = newCursor.GetPosition();
+            if (newBufferPos.X == 0)
             {
-                cNewCursorPos = newCursor.GetPosition();
-                fFoundCursorPos = true;
+                auto& newRow = newBuffer.GetRowByOffset(newBufferPos.Y);
+                newRow.SetLineRendition(row.GetLineRendition());
             }
 
-            try
+            // Copy the runs of cells of the current row. Each of them fits
+            // into the row of the new buffer that the cursor is on.
+            for (; segmentIndex < line.segmentsEnd && til::at(segments, segmentIndex).row == iRow; segmentIndex++)
             {
-                // TODO: MSFT: 19446208 - this should just use an iterator and the inserter...
-                const auto glyph = row.GetCharRow().GlyphAt(iOldCol);
-                const auto dbcsAttr = row.GetCharRow().DbcsAttrAt(iOldCol);
-                const auto textAttr = row.GetAttrRow().GetAttrByColumn(iOldCol);
+                const auto& segment = til::at(segments, segmentIndex);
+                const bool cursorInSegment = iOldRow == cOldCursorPos.Y &&
+                                             cOldCursorPos.X >= segment.oldBegin &&
+                                             cOldCursorPos.X < segment.oldEnd;
 
-                if (!newBuffer.InsertCharacter(glyph, dbcsAttr, textAttr))
+                if (cursorInSegment && cOldCursorPos.X == segment.oldBegin)
                 {
-                    hr = E_OUTOFMEMORY;
-                    break;
+                    cNewCursorPos = newCursor.GetPosition();
+                    fFoundCursorPos = true;
                 }
-            }
-            CATCH_RETURN();
-        }
 
-        // If we found the old row that the caller was interested in, set the
-        // out value of that parameter to the cursor's current Y position (the
-        // new location of the _end_ of that row in the buffer).
-        if (positionInfo.has_value())
-        {
-            if (!foundOldMutable)
-            {
-                if (iOldRow >= positionInfo.value().get().mutableViewportTop)
+                // Ensure consistent buffer state for double byte characters, just like
+                // InsertCharacter() does. The cells within the segment are checked below.
+                LOG_HR_IF(E_NOT_VALID_STATE, !newBuffer._AssertValidDoubleByteSequence(til::at(oldCells, segment.oldBegin).DbcsAttr()));
+
+                if (segment.padded)
                 {
-                    positionInfo.value().get().mutableViewportTop = newCursor.GetPosition().Y;
-                    foundOldMutable = true;
+                    // set that we're wrapping for double byte reasons
+                    newBuffer.GetRowByOffset(newCursor.GetPosition().Y).SetDoubleBytePadded(true);
+                    RETURN_HR_IF(E_OUTOFMEMORY, !newBuffer.IncrementCursor());
                 }
-            }
 
-            if (!foundOldVisible)
-            {
-                if (iOldRow >= positionInfo.value().get().visibleViewportTop)
+                const auto position = newCursor.GetPosition();
+                const SHORT count = segment.oldEnd - segment.oldBegin;
+                RETURN_HR_IF(E_UNEXPECTED, position.X + count > newWidth);
+
+                if (cursorInSegment && cOldCursorPos.X != segment.oldBegin)
                 {
-                    positionInfo.value().get().visibleViewportTop = newCursor.GetPosition().Y;
-                    foundOldVisible = true;
+                    cNewCursorPos = { gsl::narrow_cast<SHORT>(position.X + cOldCursorPos.X - segment.oldBegin), position.Y };
+                    fFoundCursorPos = true;
                 }
+
+                CopyReflowRun(newBuffer.GetRowByOffset(position.Y), row, segment.oldBegin, segment.oldEnd, position.X);
+
+                // Advance the cursor past the run, wrapping it if it filled the row.
+                newCursor.IncrementXPosition(count - 1);
+                RETURN_HR_IF(E_OUTOFMEMORY, !newBuffer.IncrementCursor());
             }
-        }
 
-        if (SUCCEEDED(hr))
-        {
-            // If we didn't have a full row to copy, insert a new
-            // line into the new buffer.
-            // Only do so if we were not forced to wrap. If we did
-            // force a word wrap, then the existing line break was
-            // only because we ran out of space.
-            if (iRight < cOldColsTotal && !row.WasWrapForced())
+            // If we found the old row that the caller was interested in, set the
+            // out value of that parameter to the cursor's current Y position (the
+            // new location of the _end_ of that row in the buffer).
+            if (positionInfo.has_value())
             {
-                if (iRight == cOldCursorPos.X && iOldRow == cOldCursorPos.Y)
+                if (!foundOldMutable)
                 {
-                    cNewCursorPos = newCursor.GetPosition();
-                    fFoundCursorPos = true;
+                    if (iOldRow >= positionInfo.value().get().mutableViewportTop)
+                    {
+                        positionInfo.value().get().mutableViewportTop = newCursor.GetPosition().Y;
+                        foundOldMutable = true;
+                    }
                 }
-                // Only do this if it's not the final line in the buffer.
-                // On the final line, we want the cursor to sit
-                // where it is done printing for the cursor
-                // adjustment to follow.
-                if (iOldRow < cOldRowsTotal - 1)
+
+                if (!foundOldVisible)
                 {
-                    hr = newBuffer.NewlineCursor() ? hr : E_OUTOFMEMORY;
+                    if (iOldRow >= positionInfo.value().get().visibleViewportTop)
+                    {
+                        positionInfo.value().get().visibleViewportTop = newCursor.GetPosition().Y;
+                        foundOldVisible = true;
+                    }
                 }
-                else
+            }
+        }
+
+        const auto& lastRow = til::at(rows, line.lastRow);
+        const auto iOldRow = lastRow.row;
+        const ROW& row = std::as_const(oldBuffer).GetRowByOffset(iOldRow);
+        const short cOldColsTotal = oldBuffer.GetLineWidth(iOldRow);
+        const short iRight = lastRow.right;
+
+        // If we didn't have a full row to copy, insert a new
+        // line into the new buffer.
+        // Only do so if we were not forced to wrap. If we did
+        // force a word wrap, then the existing line break was
+        // only because we ran out of space.
+        if (iRight < cOldColsTotal && !row.WasWrapForced())
+        {
+            if (iRight == cOldCursorPos.X && iOldRow == cOldCursorPos.Y)
+            {
+                cNewCursorPos = newCursor.GetPosition();
+                fFoundCursorPos = true;
+            }
+            // Only do this if it's not the final line in the buffer.
+            // On the final line, we want the cursor to sit
+            // where it is done printing for the cursor
+            // adjustment to follow.
+            if (iOldRow < cOldRowsTotal - 1)
+            {
+                hr = newBuffer.NewlineCursor() ? hr : E_OUTOFMEMORY;
+            }
+            else
+            {
+                // If we are on the final line of the buffer, we have one more check.
+                // We got into this code path because we are at the right most column of a row in the old buffer
+                // that had a hard return (no wrap was forced).
+                // However, as we're inserting, the old row might have just barely fit into the new buffer and
+                // caused a new soft return (wrap was forced) putting the cursor at x=0 on the line just below.
+                // We need to preserve the memory of the hard return at this point by inserting one additional
+                // hard newline, otherwise we've lost that information.
+                // We only do this when the cursor has just barely poured over onto the next line so the hard return
+                // isn't covered by the soft one.
+                // e.g.
+                // The old line was:
+                // |aaaaaaaaaaaaaaaaaaa | with no wrap which means there was a newline after that final a.
+                // The cursor was here ^
+                // And the new line will be:
+                // |aaaaaaaaaaaaaaaaaaa| and show a wrap at the end
+                // |                   |
+                //  ^ and the cursor is now there.
+                // If we leave it like this, we've lost the newline information.
+                // So we insert one more newline so a continued reflow of this buffer by resizing larger will
+                // continue to look as the original output intended with the newline data.
+                // After this fix, it looks like this:
+                // |aaaaaaaaaaaaaaaaaaa| no wrap at the end (preserved hard newline)
+                // |                   |
+                //  ^ and the cursor is now here.
+                const COORD coordNewCursor = newCursor.GetPosition();
+                if (coordNewCursor.X == 0 && coordNewCursor.Y > 0)
                 {
-                    // If we are on the final line of the buffer, we have one more check.
-                    // We got into this code path because we are at the right most column of a row in the old buffer
-                    // that had a hard return (no wrap was forced).
-                    // However, as we're inserting, the old row might have just barely fit into the new buffer and
-                    // caused a new soft return (wrap was forced) putting the cursor at x=0 on the line just below.
-                    // We need to preserve the memory of the hard return at this point by inserting one additional
-                    // hard newline, otherwise we've lost that information.
-                    // We only do this when the cursor has just barely poured over onto the next line so the hard return
-                    // isn't covered by the soft one.
-                    // e.g.
-                    // The old line was:
-                    // |aaaaaaaaaaaaaaaaaaa | with no wrap which means there was a newline after that final a.
-                    // The cursor was here ^
-                    // And the new line will be:
-                    // |aaaaaaaaaaaaaaaaaaa| and show a wrap at the end
-                    // |                   |
-                    //  ^ and the cursor is now there.
-                    // If we leave it like this, we've lost the newline information.
-                    // So we insert one more newline so a continued reflow of this buffer by resizing larger will
-                    // continue to look as the original output intended with the newline data.
-                    // After this fix, it looks like this:
-                    // |aaaaaaaaaaaaaaaaaaa| no wrap at the end (preserved hard newline)
-                    // |                   |
-                    //  ^ and the cursor is now here.
-                    const COORD coordNewCursor = newCursor.GetPosition();
-                    if (coordNewCursor.X == 0 && coordNewCursor.Y > 0)
+                    if (newBuffer.GetRowByOffset(gsl::narrow_cast<size_t>(coordNewCursor.Y) - 1).WasWrapForced())
                     {
-                        if (newBuffer.GetRowByOffset(gsl::narrow_cast<size_t>(coordNewCursor.Y) - 1).WasWrapForced())
-                        {
-                            hr = newBuffer.NewlineCursor() ? hr : E_OUTOFMEMORY;
-                        }
+                        hr = newBuffer.NewlineCursor() ? hr : E_OUTOFMEMORY;
                     }
                 }
             }
         }
     }
+
+    // The last row the lines we copied take up in the new buffer.
+    const auto cNewBottom = newCursor.GetPosition().Y;
+
+    // The lines we leave in the old buffer don't reference their hyperlinks in
+    // the new buffer yet, so we do that on their behalf until they're laid out.
+    // We don't know which of them they use, short of looking at every row.
+    std::vector<uint16_t> scrollbackHyperlinks;
+    if (SUCCEEDED(hr) && scrollbackBuffer)
+    {
+        scrollbackHyperlinks = scrollbackBuffer == &oldBuffer ? oldBuffer._hyperlinks.GetReferencedIds() : oldBuffer._reflowSource->hyperlinks;
+        for (const auto id : scrollbackHyperlinks)
+        {
+            newBuffer._hyperlinks.AddRef(id, 1);
+        }
+    }
+
     if (SUCCEEDED(hr))
     {
         // Finish copying remaining parameters from the old text buffer to the new one
@@ -2368,7 +3388,7 @@ HRESULT TextBuffer::Reflow(TextBuffer& oldBuffer,
             {
                 // if this buffer didn't wrap, but the old one DID, then the d(columns) of the
                 //   old buffer will be one more than in this buffer, so new need one LESS.
-                if (oldBuffer.GetRowByOffset(cOldLastChar.Y).WasWrapForced())
+                if (std::as_const(oldBuffer).GetRowByOffset(cOldLastChar.Y).WasWrapForced())
                 {
                     iNewlines = std::max(iNewlines - 1, 0);
                 }
@@ -2396,6 +3416,64 @@ HRESULT TextBuffer::Reflow(TextBuffer& oldBuffer,
         }
     }
 
+    // Make room for the lines we left in the old buffer above the ones we copied.
+    // We only know how many rows they take up once they're laid out, but there
+    // can't be more than this. If the lines we copied scrolled the new buffer,
+    // there's no room left for them, just like there wouldn't be after Reflow().
+    size_t cNewScrollbackRows = 0;
+    if (SUCCEEDED(hr) && scrollbackBuffer && newBuffer._firstRow == 0)
+    {
+        const auto cNewRowsTotal = gsl::narrow_cast<size_t>(newBuffer.TotalRowCount());
+        const auto cNewRowsUsed = gsl::narrow_cast<size_t>(std::max(cNewBottom, newCursor.GetPosition().Y)) + 1;
+        const auto cOldWidth = scrollbackBuffer->GetSize().Width();
+        const auto cNewColsMin = std::max(newWidth - 1, 1); // a row may be padded
+        const auto cRowsPerOldRow = newWidth >= cOldWidth ? 1 : (cOldWidth + cNewColsMin - 1) / cNewColsMin;
+        const auto cScrollbackRows = gsl::narrow_cast<size_t>(cScrollbackEnd - cScrollbackTop) * gsl::narrow_cast<size_t>(cRowsPerOldRow);
+        cNewScrollbackRows = cNewRowsUsed < cNewRowsTotal ? std::min(cNewRowsTotal - cNewRowsUsed, cScrollbackRows) : 0;
+    }
+
+    if (cNewScrollbackRows > 0)
+    {
+        // The rows at the bottom are blank, so we can rotate them to the top.
+        newBuffer._firstRow = gsl::narrow_cast<SHORT>(newBuffer.TotalRowCount() - cNewScrollbackRows);
+        const auto shift = gsl::narrow_cast<SHORT>(cNewScrollbackRows);
+
+        const auto cursorPos = newCursor.GetPosition();
+        newCursor.SetPosition({ cursorPos.X, gsl::narrow_cast<SHORT>(cursorPos.Y + shift) });
+        if (positionInfo.has_value())
+        {
+            auto& info = positionInfo.value().get();
+            info.mutableViewportTop += foundOldMutable ? shift : 0;
+            info.visibleViewportTop += foundOldVisible ? shift : 0;
+        }
+
+        // The regions written to so far moved along with the rows.
+        if (newBuffer._dirtyTop < newBuffer._dirtyBottom)
+        {
+            newBuffer._allDirty = true;
+        }
+
+        if (scrollbackBuffer == &oldBuffer)
+        {
+            newBuffer._reflowSource = std::make_unique<ReflowSource>(ReflowSource{ &oldBuffer, nullptr, cScrollbackTop, cScrollbackEnd, std::move(scrollbackHyperlinks) });
+        }
+        else
+        {
+            // The old buffer is done with its own old buffer. The references it holds
+            // to the hyperlinks go away with it.
+            newBuffer._reflowSource = std::move(oldBuffer._reflowSource);
+            newBuffer._reflowSource->hyperlinks = std::move(scrollbackHyperlinks);
+        }
+        newBuffer._reflowTop = cNewScrollbackRows;
+    }
+    else
+    {
+        for (const auto id : scrollbackHyperlinks)
+        {
+            newBuffer._hyperlinks.Release(id, 1);
+        }
+    }
+
     if (SUCCEEDED(hr))
     {
         // Save old cursor size before we delete it
@@ -2407,6 +3485,7 @@ HRESULT TextBuffer::Reflow(TextBuffer& oldBuffer,
 
     return hr;
 }
+CATCH_RETURN();
 
 // Method Description:
 // - Adds or updates a hyperlink in our hyperlink table
@@ -2414,7 +3493,7 @@ HRESULT TextBuffer::Reflow(TextBuffer& oldBuffer,
 // - The hyperlink URI, the hyperlink id (could be new or old)
 void TextBuffer::AddHyperlinkToMap(std::wstring_view uri, uint16_t id)
 {
-    _hyperlinkMap[id] = uri;
+    _hyperlinks.SetUri(id, uri);
 }
 
 // Method Description:
@@ -2425,7 +3504,7 @@ void TextBuffer::AddHyperlinkToMap(std::wstring_view uri, uint16_t id)
 // - The URI
 std::wstring TextBuffer::GetHyperlinkUriFromId(uint16_t id) const
 {
-    return _hyperlinkMap.at(id);
+    return _hyperlinks.GetUri(id);
 }
 
 // Method description:
@@ -2436,33 +3515,7 @@ std::wstring TextBuffer::GetHyperlinkUriFromId(uint16_t id) const
 // - The internal hyperlink ID
 uint16_t TextBuffer::GetHyperlinkId(std::wstring_view uri, std::wstring_view id)
 {
-    uint16_t numericId = 0;
-    if (id.empty())
-    {
-        // no custom id specified, return our internal count
-        numericId = _currentHyperlinkId;
-        ++_currentHyperlinkId;
-    }
-    else
-    {
-        // assign _currentHyperlinkId if the custom id does not already exist
-        std::wstring newId{ id };
-        // hash the URL and add it to the custom ID - GH#7698
-        newId += L"%" + std::to_wstring(til::hash(uri));
-        const auto result = _hyperlinkCustomIdMap.emplace(newId, _currentHyperlinkId);
-        if (result.second)
-        {
-            // the custom id did not already exist
-            ++_currentHyperlinkId;
-        }
-        numericId = (*(result.first)).second;
-    }
-    // _currentHyperlinkId could overflow, make sure its not 0
-    if (_currentHyperlinkId == 0)
-    {
-        ++_currentHyperlinkId;
-    }
-    return numericId;
+    return _hyperlinks.GetId(uri, id);
 }
 
 // Method Description:
@@ -2472,15 +3525,7 @@ uint16_t TextBuffer::GetHyperlinkId(std::wstring_view uri, std::wstring_view id)
 // - The ID of the hyperlink to be removed
 void TextBuffer::RemoveHyperlinkFromMap(uint16_t id) noexcept
 {
-    _hyperlinkMap.erase(id);
-    for (const auto& customIdPair : _hyperlinkCustomIdMap)
-    {
-        if (customIdPair.second == id)
-        {
-            _hyperlinkCustomIdMap.erase(customIdPair.first);
-            break;
-        }
-    }
+    _hyperlinks.Remove(id);
 }
 
 // Method Description:
@@ -2492,14 +3537,7 @@ void TextBuffer::RemoveHyperlinkFromMap(uint16_t id) noexcept
 // - The custom ID if there was one, empty string otherwise
 std::wstring TextBuffer::GetCustomIdFromId(uint16_t id) const
 {
-    for (auto customIdPair : _hyperlinkCustomIdMap)
-    {
-        if (customIdPair.second == id)
-        {
-            return customIdPair.first;
-        }
-    }
-    return {};
+    return _hyperlinks.GetCustomId(id);
 }
 
 // Method Description:
@@ -2509,9 +3547,25 @@ std::wstring TextBuffer::GetCustomIdFromId(uint16_t id) const
 // - The other buffer
 void TextBuffer::CopyHyperlinkMaps(const TextBuffer& other)
 {
-    _hyperlinkMap = other._hyperlinkMap;
-    _hyperlinkCustomIdMap = other._hyperlinkCustomIdMap;
-    _currentHyperlinkId = other._currentHyperlinkId;
+    _hyperlinks.CopyFrom(other._hyperlinks);
+}
+
+// Method Description:
+// - Gets the registry that the hyperlinks used by the rows of this buffer are reference counted in.
+// Return Value:
+// - The hyperlink registry
+HyperlinkRegistry& TextBuffer::GetHyperlinkRegistry() noexcept
+{
+    return _hyperlinks;
+}
+
+// Method Description:
+// - Provides the memory resource that the attribute runs of the rows are allocated from.
+// Return Value:
+// - The memory resource
+std::pmr::memory_resource& TextBuffer::GetAttrRunResource() noexcept
+{
+    return _attrRuns;
 }
 
 // Method Description:
@@ -2524,7 +3578,9 @@ void TextBuffer::CopyHyperlinkMaps(const TextBuffer& other)
 const size_t TextBuffer::AddPatternRecognizer(const std::wstring_view regexString)
 {
     ++_currentPatternId;
-    _idsAndPatterns.emplace(std::make_pair(_currentPatternId, regexString));
+    // Compile the regex once here, instead of every time we search for it.
+    _idsAndPatterns.emplace(std::make_pair(_currentPatternId, std::wregex{ regexString.data(), regexString.size() }));
+    _patternCache.clear();
     return _currentPatternId;
 }
 
@@ -2533,6 +3589,7 @@ const size_t TextBuffer::AddPatternRecognizer(const std::wstring_view regexStrin
 void TextBuffer::ClearPatternRecognizers() noexcept
 {
     _idsAndPatterns.clear();
+    _patternCache.clear();
     _currentPatternId = 0;
 }
 
@@ -2543,39 +3600,91 @@ void TextBuffer::ClearPatternRecognizers() noexcept
 void TextBuffer::CopyPatterns(const TextBuffer& OtherBuffer)
 {
     _idsAndPatterns = OtherBuffer._idsAndPatterns;
+    _patternCache.clear();
     _currentPatternId = OtherBuffer._currentPatternId;
 }
 
 // Method Description:
 // - Finds patterns within the requested region of the text buffer
+// - The rows are split into blocks of text that a match could span: a block
+//   only continues on the next row if the row was wrapped, or if its last column
+//   isn't blank. The matches of each block are cached by the text of the block,
+//   so only the blocks that changed since the last call are searched again,
+//   no matter whether they moved up because the buffer scrolled.
 // Arguments:
 // - The firstRow to start searching from
 // - The lastRow to search
 // Return value:
-// - An interval tree containing the patterns found
-PointTree TextBuffer::GetPatterns(const size_t firstRow, const size_t lastRow) const
+// - The intervals of the patterns found, relative to the firstRow
+PointTree::interval_vector TextBuffer::GetPatterns(const size_t firstRow, const size_t lastRow)
 {
     PointTree::interval_vector intervals;
+    decltype(_patternCache) patternCache;
 
-    std::wstring concatAll;
     const auto rowSize = GetRowByOffset(0).size();
-    concatAll.reserve(rowSize * (lastRow - firstRow + 1));
+    std::wstring block;
+    block.reserve(rowSize);
 
-    // to deal with text that spans multiple lines, we will first concatenate
-    // all the text into one string and find the patterns in that string
+    auto blockFirstRow = firstRow;
     for (auto i = firstRow; i <= lastRow; ++i)
     {
-        auto& row = GetRowByOffset(i);
-        concatAll += row.GetText();
+        const auto& row = GetRowByOffset(i);
+        block += row.GetText();
+
+        if (i != lastRow && (row.WasWrapForced() || (!block.empty() && block.back() != UNICODE_SPACE)))
+        {
+            continue;
+        }
+
+        // Blocks that we've already searched last time around get moved over to the
+        // new cache, so that the cache never holds more than what's visible.
+        auto it = patternCache.find(block);
+        if (it == patternCache.end())
+        {
+            auto node = _patternCache.extract(block);
+            if (node.empty())
+            {
+                auto matches = _FindPatterns(block, rowSize);
+                it = patternCache.emplace(std::move(block), std::move(matches)).first;
+            }
+            else
+            {
+                it = patternCache.insert(std::move(node)).position;
+            }
+        }
+
+        const auto offset = gsl::narrow<ptrdiff_t>(blockFirstRow - firstRow);
+        for (const auto& match : it->second)
+        {
+            const til::point startCoord{ match.start.x(), match.start.y() + offset };
+            const til::point endCoord{ match.stop.x(), match.stop.y() + offset };
+            intervals.push_back(PointTree::interval(startCoord, endCoord, match.value));
+        }
+
+        block.clear();
+        blockFirstRow = i + 1;
     }
 
+    _patternCache = std::move(patternCache);
+    return intervals;
+}
+
+// Method Description:
+// - Finds the patterns we know of within a block of rows
+// Arguments:
+// - text - The concatenated text of the rows
+// - rowSize - The width of the rows
+// Return value:
+// - The intervals of the patterns found, relative to the first row of the block
+PointTree::interval_vector TextBuffer::_FindPatterns(const std::wstring& text, const size_t rowSize) const
+{
+    PointTree::interval_vector intervals;
+
     // for each pattern we know of, iterate through the string
     for (const auto& idAndPattern : _idsAndPatterns)
     {
-        std::wregex regexObj{ idAndPattern.second };
-
         // search through the run with our regex object
-        auto words_begin = std::wsregex_iterator(concatAll.begin(), concatAll.end(), regexObj);
+        auto words_begin = std::wsregex_iterator(text.begin(), text.end(), idAndPattern.second);
         auto words_end = std::wsregex_iterator();
 
         size_t lenUpToThis = 0;
@@ -2612,6 +3721,5 @@ PointTree TextBuffer::GetPatterns(const size_t firstRow, const size_t lastRow) c
             intervals.push_back(PointTree::interval(startCoord, endCoord, idAndPattern.first));
         }
     }
-    PointTree result(std::move(intervals));
-    return result;
+    return intervals;
 }
@@ -23,12 +23,16 @@ ScreenBuffer data structure overview:
 each screen buffer has an array of ROW structures.  each ROW structure
 contains the data for one row of text.  the data stored for one row of
 text is a character array and an attribute array.  the character array
-is allocated the full length of the row from the heap, regardless of the
-non-space length. we also maintain the non-space length.  the character
-array is initialized to spaces.  the attribute
-array is run length encoded (i.e 5 BLUE, 3 RED). if there is only one
-attribute for the whole row (the normal case), it is stored in the ATTR_ROW
-structure.  otherwise the attr string is allocated from the heap.
+is the full length of the row, regardless of the non-space length, and is
+initialized to spaces.  the character arrays of the rows around the cursor
+are slices of a single page-aligned block of cells, one row after the
+other.  rows that are thawed once the block ran out of room take theirs
+from overflow blocks, until the buffer is trimmed again.  the rows further
+up in the scrollback are frozen into shared blocks, at a byte per cell if
+they only hold narrow characters.  the attribute array is run length
+encoded (i.e 5 BLUE, 3 RED). if there is only one attribute for the whole
+row (the normal case), it is stored in the ATTR_ROW structure.  otherwise
+the attr string is allocated from a pool owned by the text buffer.
 
 ROW - CHAR_ROW - CHAR string
 \          \ length of char string
@@ -49,12 +53,14 @@ filling in the last row, and updating the screen.
 
 #pragma once
 
+#include <memory>
 #include <vector>
 
 #include "cursor.h"
 #include "Row.hpp"
 #include "TextAttribute.hpp"
 #include "UnicodeStorage.hpp"
+#include "HyperlinkRegistry.hpp"
 #include "../types/inc/Viewport.hpp"
 
 #include "../buffer/out/textBufferCellIterator.hpp"
@@ -97,6 +103,10 @@ public:
                                  const std::optional<bool> setWrap = std::nullopt,
                                  const std::optional<size_t> limitRight = std::nullopt);
 
+    size_t WriteNarrowRun(const std::wstring_view chars,
+                          const COORD target,
+                          const std::optional<bool> wrap = true);
+
     bool InsertCharacter(const wchar_t wch, const DbcsAttribute dbcsAttribute, const TextAttribute attr);
     bool InsertCharacter(const std::wstring_view chars, const DbcsAttribute dbcsAttribute, const TextAttribute attr);
     bool IncrementCursor();
@@ -104,6 +114,7 @@ public:
 
     // Scroll needs access to this to quickly rotate around the buffer.
     bool IncrementCircularBuffer(const bool inVtMode = false);
+    void TrimThawedRows() noexcept;
 
     COORD GetLastNonSpaceCharacter(std::optional<const Microsoft::Console::Types::Viewport> viewOptional = std::nullopt) const;
 
@@ -115,6 +126,7 @@ public:
     const Microsoft::Console::Types::Viewport GetSize() const noexcept;
 
     void ScrollRows(const SHORT firstRow, const SHORT size, const SHORT delta);
+    void CopyRectangle(const Microsoft::Console::Types::Viewport& source, const COORD targetOrigin);
 
     UINT TotalRowCount() const noexcept;
 
@@ -136,11 +148,10 @@ public:
 
     [[nodiscard]] HRESULT ResizeTraditional(const COORD newSize) noexcept;
 
-    const UnicodeStorage& GetUnicodeStorage() const noexcept;
-    UnicodeStorage& GetUnicodeStorage() noexcept;
-
     Microsoft::Console::Render::IRenderTarget& GetRenderTarget() noexcept;
 
+    void TakeDirtyRegions(std::vector<SMALL_RECT>& regions);
+
     const COORD GetWordStart(const COORD target, const std::wstring_view wordDelimiters, bool accessibilityMode = false, std::optional<til::point> limitOptional = std::nullopt) const;
     const COORD GetWordEnd(const COORD target, const std::wstring_view wordDelimiters, bool accessibilityMode = false, std::optional<til::point> limitOptional = std::nullopt) const;
     bool MoveToNextWord(COORD& pos, const std::wstring_view wordDelimiters, std::optional<til::point> limitOptional = std::nullopt) const;
@@ -159,6 +170,8 @@ public:
     void RemoveHyperlinkFromMap(uint16_t id) noexcept;
     std::wstring GetCustomIdFromId(uint16_t id) const;
     void CopyHyperlinkMaps(const TextBuffer& OtherBuffer);
+    HyperlinkRegistry& GetHyperlinkRegistry() noexcept;
+    std::pmr::memory_resource& GetAttrRunResource() noexcept;
 
     class TextAndColor
     {
@@ -195,14 +208,66 @@ public:
                           const std::optional<Microsoft::Console::Types::Viewport> lastCharacterViewport,
                           std::optional<std::reference_wrapper<PositionInformation>> positionInfo);
 
+    static HRESULT ReflowLazily(TextBuffer& oldBuffer,
+                                TextBuffer& newBuffer,
+                                const std::optional<Microsoft::Console::Types::Viewport> lastCharacterViewport,
+                                std::optional<std::reference_wrapper<PositionInformation>> positionInfo,
+                                const SHORT eagerTop);
+    void TakeReflowSource(std::unique_ptr<TextBuffer> oldBuffer) noexcept;
+    void ReflowScrollback(const size_t firstRow);
+    size_t PendingReflowRows() const noexcept;
+
     const size_t AddPatternRecognizer(const std::wstring_view regexString);
     void ClearPatternRecognizers() noexcept;
     void CopyPatterns(const TextBuffer& OtherBuffer);
-    interval_tree::IntervalTree<til::point, size_t> GetPatterns(const size_t firstRow, const size_t lastRow) const;
+    interval_tree::IntervalTree<til::point, size_t>::interval_vector GetPatterns(const size_t firstRow, const size_t lastRow);
 
 private:
     void _UpdateSize();
     Microsoft::Console::Types::Viewport _size;
+    // Declared ahead of _storage, since the rows release their hyperlinks in here when they're destroyed.
+    HyperlinkRegistry _hyperlinks;
+
+    // The attribute runs of rows with more than one attribute are allocated in here, and so
+    // are ahead of _storage too. A row with a single attribute keeps it in its ATTR_ROW.
+    // The pool holds on to the memory it got, so rows that are reset and written to
+    // again while the buffer circles reuse it instead of going back to the heap.
+    std::pmr::unsynchronized_pool_resource _attrRuns;
+
+    // The cells of all rows are kept in a single allocation, which the rows point into.
+    // Moving rows around only moves those pointers, never the cells themselves.
+    struct CellsDeleter
+    {
+        void operator()(CharRowCell* const cells) const noexcept;
+    };
+    using CellsPtr = std::unique_ptr<CharRowCell[], CellsDeleter>;
+    static CellsPtr _AllocateCells(const COORD size);
+    CellsPtr _cells;
+
+    // Buffers with a long scrollback don't keep the cells of all of their rows.
+    // When such a buffer circles or is resized, the rows more than HotRowLimit rows
+    // above the cursor are frozen: their cells are moved into a compact block and
+    // their part of _cells is free for other rows. A frozen row is thawed when it's
+    // accessed, which never takes the cells of another row, so rows only ever lose
+    // their cells in IncrementCircularBuffer, ResizeTraditional and TrimThawedRows.
+    static constexpr size_t HotRowLimit = 1024;
+    // _cells holds this many rows on top of the HotRowLimit, so that thawing the
+    // new rows at the bottom only runs out of them every so often.
+    static constexpr size_t HotRowSlack = HotRowLimit / 4;
+    // TrimThawedRows() freezes the cold rows again once the rows that were thawed
+    // since they were last frozen need more than this many rows of overflow cells.
+    static constexpr size_t ThawedRowBudget = HotRowLimit;
+    static size_t s_HotRowCount(const size_t width, const size_t height) noexcept;
+    // The parts of _cells that no row uses, and the cells of the rows that were
+    // thawed once those ran out, until the rows are frozen again.
+    // Thawing doesn't change the contents of the buffer, hence mutable.
+    mutable std::vector<CharRowCell*> _freeRowCells;
+    mutable std::vector<CellsPtr> _overflowCells;
+
+    void _ThawRow(const ROW& row) const;
+    void _FreezeColdRows();
+    void _RefreshFreeRowCells();
+
     std::vector<ROW> _storage;
     Cursor _cursor;
 
@@ -210,14 +275,35 @@ private:
 
     TextAttribute _currentAttributes;
 
-    // storage location for glyphs that can't fit into the buffer normally
-    UnicodeStorage _unicodeStorage;
+    void _RefreshRowIDs();
 
-    std::unordered_map<uint16_t, std::wstring> _hyperlinkMap;
-    std::unordered_map<std::wstring, uint16_t> _hyperlinkCustomIdMap;
-    uint16_t _currentHyperlinkId;
+    // The scrollback that a lazy reflow left in the old buffer: the logical lines
+    // of its rows [top, end), which are laid out in this buffer one at a time,
+    // from the bottom up, as the rows above _reflowTop are needed.
+    struct ReflowSource
+    {
+        const TextBuffer* buffer;
+        // Set by TakeReflowSource(). Until then, the caller of ReflowLazily() owns the buffer.
+        std::unique_ptr<TextBuffer> owner;
+        SHORT top;
+        SHORT end;
+        // The hyperlinks the rows may use. We hold a reference to each of them in
+        // _hyperlinks, so that they're still around when the rows are laid out.
+        std::vector<uint16_t> hyperlinks;
+    };
+    std::unique_ptr<ReflowSource> _reflowSource;
+    // The rows above this one don't hold anything of their own yet: they're
+    // either waiting for the lines of the _reflowSource, or blank.
+    size_t _reflowTop{ 0 };
 
-    void _RefreshRowIDs(std::optional<SHORT> newRowWidth);
+    void _ReflowPendingLine();
+    void _DiscardReflowSource() noexcept;
+
+    static HRESULT _Reflow(TextBuffer& oldBuffer,
+                           TextBuffer& newBuffer,
+                           const std::optional<Microsoft::Console::Types::Viewport> lastCharacterViewport,
+                           std::optional<std::reference_wrapper<PositionInformation>> positionInfo,
+                           const std::optional<SHORT> eagerTop);
 
     Microsoft::Console::Render::IRenderTarget& _renderTarget;
 
@@ -228,7 +314,21 @@ private:
     void _SetWrapOnCurrentRow();
     void _AdjustWrapOnCurrentRow(const bool fSet);
 
-    void _NotifyPaint(const Microsoft::Console::Types::Viewport& viewport) const;
+    void _NotifyPaint(const Microsoft::Console::Types::Viewport& viewport);
+    void _ScrollDirtyRows() noexcept;
+    void _ResetDirtyRows();
+
+    // One bit per row written to since the renderer last called TakeDirtyRegions.
+    // Row y is at (y + _dirtyOrigin) % size, so that circling only moves the origin.
+    std::vector<bool> _dirtyRows;
+    size_t _dirtyOrigin{ 0 };
+    // The rows that may have their bit set and the columns written to in any of them.
+    size_t _dirtyTop{ SIZE_MAX };
+    size_t _dirtyBottom{ 0 };
+    SHORT _dirtyLeft{ SHRT_MAX };
+    SHORT _dirtyRight{ 0 };
+    // Set once the whole buffer needs to be redrawn. Writes don't record anything then.
+    bool _allDirty{ false };
 
     // Assist with maintaining proper buffer state for Double Byte character sequences
     bool _PrepareForDoubleByteSequence(const DbcsAttribute dbcsAttribute);
@@ -245,9 +345,12 @@ private:
     const COORD _GetWordEndForAccessibility(const COORD target, const std::wstring_view wordDelimiters, const COORD limit) const;
     const COORD _GetWordEndForSelection(const COORD target, const std::wstring_view wordDelimiters) const;
 
-    void _PruneHyperlinks();
 
-    std::unordered_map<size_t, std::wstring> _idsAndPatterns;
+    interval_tree::IntervalTree<til::point, size_t>::interval_vector _FindPatterns(const std::wstring& text, const size_t rowSize) const;
+
+    std::unordered_map<size_t, std::wregex> _idsAndPatterns;
+    // The patterns found in each block of rows by the last call to GetPatterns, keyed by the text of the block.
+    std::unordered_map<std::wstring, interval_tree::IntervalTree<til::point, size_t>::interval_vector> _patternCache;
     size_t _currentPatternId;
 
 #ifdef UNIT_TESTING
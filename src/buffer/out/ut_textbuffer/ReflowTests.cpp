@@ -12,6 +12,8 @@
 
 #include <IDataSource.h>
 
+#include <chrono>
+
 template<>
 class WEX::TestExecution::VerifyOutputTraits<wchar_t>
 {
@@ -851,6 +853,241 @@ class ReflowTests
             _compareTextBufferAgainstTestBuffer(*textBuffer, testBuffer);
         }
     }
+
+    TEST_METHOD(TestReflowPreservesAttributesAndGlyphs)
+    {
+        // Reflow copies whole runs of cells and attributes.
+        // Make sure that neither the attributes of the cells,
+        // nor glyphs that don't fit into a single cell get lost.
+        auto textBuffer = std::make_unique<TextBuffer>(COORD{ 10, 5 }, TextAttribute{ 0x7 }, 0, target);
+        const TextAttribute attrs[] = { TextAttribute{ 0x1f }, TextAttribute{ 0x2e }, TextAttribute{ 0x3d } };
+        static constexpr std::wstring_view emoji{ L"\xD83D\xDE00" };
+
+        // |abcdefghij| wrapped
+        // |klXX      | with a wide emoji in XX
+        for (size_t i = 0; i < 12; ++i)
+        {
+            VERIFY_IS_TRUE(textBuffer->InsertCharacter(gsl::narrow_cast<wchar_t>(L'a' + i), DbcsAttribute{}, til::at(attrs, i / 4)));
+        }
+        DbcsAttribute leading;
+        leading.SetLeading();
+        DbcsAttribute trailing;
+        trailing.SetTrailing();
+        VERIFY_IS_TRUE(textBuffer->InsertCharacter(emoji, leading, til::at(attrs, 2)));
+        VERIFY_IS_TRUE(textBuffer->InsertCharacter(emoji, trailing, til::at(attrs, 2)));
+
+        // |abcdefg| wrapped
+        // |hijklXX|
+        auto newBuffer = _textBufferByReflowingTextBuffer(*textBuffer, { 7, 5 });
+
+        for (size_t i = 0; i < 12; ++i)
+        {
+            const auto& row = newBuffer->GetRowByOffset(i / 7);
+            const std::wstring_view glyph{ row.GetCharRow().GlyphAt(i % 7) };
+            VERIFY_ARE_EQUAL(std::wstring(1, gsl::narrow_cast<wchar_t>(L'a' + i)), std::wstring{ glyph });
+            VERIFY_ARE_EQUAL(til::at(attrs, i / 4), row.GetAttrRow().GetAttrByColumn(gsl::narrow_cast<uint16_t>(i % 7)));
+        }
+        VERIFY_IS_TRUE(newBuffer->GetRowByOffset(0).WasWrapForced());
+
+        const auto& row = newBuffer->GetRowByOffset(1);
+        for (const size_t column : { 5, 6 })
+        {
+            const std::wstring_view glyph{ row.GetCharRow().GlyphAt(column) };
+            VERIFY_ARE_EQUAL(std::wstring{ emoji }, std::wstring{ glyph });
+            VERIFY_ARE_EQUAL(til::at(attrs, 2), row.GetAttrRow().GetAttrByColumn(gsl::narrow_cast<uint16_t>(column)));
+        }
+        VERIFY_IS_TRUE(row.GetCharRow().DbcsAttrAt(5).IsLeading());
+        VERIFY_IS_TRUE(row.GetCharRow().DbcsAttrAt(6).IsTrailing());
+    }
+
+    static std::unique_ptr<TextBuffer> _textBufferWithScrollback(const COORD size, const SHORT rows)
+    {
+        // Fill the given number of rows with lines of all lengths and a few colors.
+        // Every third line continues in the next row, like a long line would.
+        auto buffer = std::make_unique<TextBuffer>(size, TextAttribute{ 0x7 }, 0, target);
+        const std::wstring text(size.X, L'x');
+        for (SHORT y = 0; y < rows; ++y)
+        {
+            auto& row = buffer->GetRowByOffset(y);
+            const bool wrap = y % 3 == 0;
+            const auto length = gsl::narrow_cast<size_t>(wrap ? size.X : (y * 7) % size.X + 1);
+            row.WriteNarrowRun({ text.data(), length }, 0, TextAttribute{ gsl::narrow_cast<WORD>(y % 16) });
+            row.SetWrapForced(wrap);
+        }
+        buffer->GetCursor().SetPosition({ 0, rows });
+        return buffer;
+    }
+
+    static void _compareReflowedRows(const TextBuffer& eagerBuffer, const TextBuffer& lazyBuffer)
+    {
+        // The lazily reflowed buffer may keep a few blank rows above its scrollback,
+        // so the rows are lined up by the cursor, which is in the same column of both.
+        const auto eagerCursor = eagerBuffer.GetCursor().GetPosition();
+        const auto lazyCursor = lazyBuffer.GetCursor().GetPosition();
+        VERIFY_ARE_EQUAL(eagerCursor.X, lazyCursor.X);
+        VERIFY_IS_GREATER_THAN_OR_EQUAL(lazyCursor.Y, eagerCursor.Y);
+
+        const auto offset = lazyCursor.Y - eagerCursor.Y;
+        for (SHORT y = lazyBuffer.GetSize().BottomInclusive(); y >= 0; --y)
+        {
+            const auto indexString = NoThrowString().Format(L"[Row %d]", y);
+            const auto& lazyRow = lazyBuffer.GetRowByOffset(y);
+            if (y < offset)
+            {
+                VERIFY_IS_FALSE(lazyRow.GetCharRow().ContainsText(), indexString);
+                continue;
+            }
+
+            const auto& eagerRow = eagerBuffer.GetRowByOffset(gsl::narrow_cast<size_t>(y - offset));
+            VERIFY_ARE_EQUAL(eagerRow.GetText(), lazyRow.GetText(), indexString);
+            VERIFY_ARE_EQUAL(eagerRow.WasWrapForced(), lazyRow.WasWrapForced(), indexString);
+            VERIFY_ARE_EQUAL(eagerRow.WasDoubleBytePadded(), lazyRow.WasDoubleBytePadded(), indexString);
+            VERIFY_IS_TRUE(std::equal(eagerRow.GetAttrRow().begin(), eagerRow.GetAttrRow().end(), lazyRow.GetAttrRow().begin(), lazyRow.GetAttrRow().end()), indexString);
+        }
+    }
+
+    TEST_METHOD(TestLazyReflowMatchesReflow)
+    {
+        // Resize a buffer back and forth with ReflowLazily() and Reflow() side by
+        // side. The scrollback is left in the old buffer, and every other resize
+        // happens before any of it was laid out. Once it is, the lazily reflowed
+        // rows must be identical to the eagerly reflowed ones. The buffer is tall
+        // enough for none of the lines to circle out of it at any of the widths.
+        const COORD bufferSize{ 30, 3000 };
+        auto eagerBuffer = _textBufferWithScrollback(bufferSize, 1300);
+        auto lazyBuffer = _textBufferWithScrollback(bufferSize, 1300);
+
+        static constexpr SHORT widths[] = { 17, 41, 23, 30, 60, 29 };
+        for (size_t i = 0; i < std::size(widths); ++i)
+        {
+            const auto width = til::at(widths, i);
+            Log::Comment(NoThrowString().Format(L"Resizing to %d columns", width));
+
+            auto newEagerBuffer = std::make_unique<TextBuffer>(COORD{ width, bufferSize.Y }, TextAttribute{ 0x7 }, 0, target);
+            VERIFY_SUCCEEDED(TextBuffer::Reflow(*eagerBuffer, *newEagerBuffer, std::nullopt, std::nullopt));
+            std::swap(eagerBuffer, newEagerBuffer);
+
+            auto newLazyBuffer = std::make_unique<TextBuffer>(COORD{ width, bufferSize.Y }, TextAttribute{ 0x7 }, 0, target);
+            const auto eagerTop = gsl::narrow_cast<SHORT>(lazyBuffer->GetCursor().GetPosition().Y - 40);
+            VERIFY_SUCCEEDED(TextBuffer::ReflowLazily(*lazyBuffer, *newLazyBuffer, std::nullopt, std::nullopt, eagerTop));
+            std::swap(lazyBuffer, newLazyBuffer);
+            lazyBuffer->TakeReflowSource(std::move(newLazyBuffer));
+
+            if (i % 2 == 0)
+            {
+                continue;
+            }
+
+            // Write into the middle of the scrollback, which lays out the lines below it.
+            const auto eagerCursor = eagerBuffer->GetCursor().GetPosition();
+            const auto lazyCursor = lazyBuffer->GetCursor().GetPosition();
+            const auto distance = gsl::narrow_cast<SHORT>(eagerCursor.Y / 2);
+            eagerBuffer->GetRowByOffset(eagerCursor.Y - distance).WriteNarrowRun(L"new", 0, TextAttribute{ 0x4 });
+            lazyBuffer->GetRowByOffset(lazyCursor.Y - distance).WriteNarrowRun(L"new", 0, TextAttribute{ 0x4 });
+            VERIFY_IS_LESS_THAN_OR_EQUAL(lazyBuffer->PendingReflowRows(), gsl::narrow_cast<size_t>(lazyCursor.Y - distance));
+        }
+
+        lazyBuffer->ReflowScrollback(0);
+        VERIFY_ARE_EQUAL(size_t{ 0 }, lazyBuffer->PendingReflowRows());
+        _compareReflowedRows(*eagerBuffer, *lazyBuffer);
+    }
+
+    TEST_METHOD(TestLazyReflowReleasesItsSource)
+    {
+        const COORD bufferSize{ 30, 2000 };
+        const COORD newSize{ 41, bufferSize.Y };
+        auto eagerBuffer = std::make_unique<TextBuffer>(newSize, TextAttribute{ 0x7 }, 0, target);
+        {
+            auto oldBuffer = _textBufferWithScrollback(bufferSize, bufferSize.Y - 10);
+            VERIFY_SUCCEEDED(TextBuffer::Reflow(*oldBuffer, *eagerBuffer, std::nullopt, std::nullopt));
+        }
+
+        // A short scrollback is copied right away.
+        {
+            auto oldBuffer = _textBufferWithScrollback({ bufferSize.X, 200 }, 190);
+            auto newBuffer = std::make_unique<TextBuffer>(COORD{ newSize.X, 200 }, TextAttribute{ 0x7 }, 0, target);
+            VERIFY_SUCCEEDED(TextBuffer::ReflowLazily(*oldBuffer, *newBuffer, std::nullopt, std::nullopt, 150));
+            newBuffer->TakeReflowSource(std::move(oldBuffer));
+            VERIFY_ARE_EQUAL(size_t{ 0 }, newBuffer->PendingReflowRows());
+        }
+
+        // The old buffer is let go of once all of its lines were laid out...
+        {
+            auto oldBuffer = _textBufferWithScrollback(bufferSize, bufferSize.Y - 10);
+            auto newBuffer = std::make_unique<TextBuffer>(newSize, TextAttribute{ 0x7 }, 0, target);
+            VERIFY_SUCCEEDED(TextBuffer::ReflowLazily(*oldBuffer, *newBuffer, std::nullopt, std::nullopt, bufferSize.Y - 50));
+            newBuffer->TakeReflowSource(std::move(oldBuffer));
+
+            // ...which is done from the bottom up, a line at a time.
+            auto pending = newBuffer->PendingReflowRows();
+            VERIFY_IS_GREATER_THAN(pending, size_t{ 1024 });
+            newBuffer->ReflowScrollback(pending - 1);
+            VERIFY_IS_LESS_THAN(newBuffer->PendingReflowRows(), pending);
+            VERIFY_IS_GREATER_THAN(newBuffer->PendingReflowRows(), pending - 10);
+
+            newBuffer->ReflowScrollback(0);
+            VERIFY_ARE_EQUAL(size_t{ 0 }, newBuffer->PendingReflowRows());
+            _compareReflowedRows(*eagerBuffer, *newBuffer);
+        }
+
+        // ...or once the rows they'd be laid out in circled out of the buffer.
+        {
+            auto oldBuffer = _textBufferWithScrollback(bufferSize, bufferSize.Y - 10);
+            auto newBuffer = std::make_unique<TextBuffer>(newSize, TextAttribute{ 0x7 }, 0, target);
+            VERIFY_SUCCEEDED(TextBuffer::ReflowLazily(*oldBuffer, *newBuffer, std::nullopt, std::nullopt, bufferSize.Y - 50));
+            newBuffer->TakeReflowSource(std::move(oldBuffer));
+
+            const auto pending = newBuffer->PendingReflowRows();
+            for (size_t i = 0; i < pending; ++i)
+            {
+                VERIFY_ARE_EQUAL(pending - i, newBuffer->PendingReflowRows());
+                VERIFY_IS_TRUE(newBuffer->IncrementCircularBuffer());
+            }
+            VERIFY_ARE_EQUAL(size_t{ 0 }, newBuffer->PendingReflowRows());
+        }
+    }
+
+    TEST_METHOD(TestReflowThroughput)
+    {
+        BEGIN_TEST_METHOD_PROPERTIES()
+            TEST_METHOD_PROPERTY(L"IsPerfTest", L"true")
+        END_TEST_METHOD_PROPERTIES()
+
+        // Resize a full scrollback back and forth, like dragging the edge of the window.
+        const COORD bufferSize{ 120, 9001 };
+        auto textBuffer = std::make_unique<TextBuffer>(bufferSize, TextAttribute{ 0x7 }, 0, target);
+
+        // Fill it with lines of all lengths and a few colors. Every
+        // third line continues in the next row, like a long line would.
+        const std::wstring text(bufferSize.X, L'x');
+        for (SHORT y = 0; y < bufferSize.Y; ++y)
+        {
+            auto& row = textBuffer->GetRowByOffset(y);
+            const bool wrap = y % 3 == 0;
+            const auto length = gsl::narrow_cast<size_t>(wrap ? bufferSize.X : (y * 37) % bufferSize.X + 1);
+            row.WriteNarrowRun({ text.data(), length }, 0, TextAttribute{ gsl::narrow_cast<WORD>(y % 16) });
+            row.SetWrapForced(wrap);
+        }
+        textBuffer->GetCursor().SetPosition({ 0, bufferSize.Y - 1 });
+
+        constexpr size_t iterations = 10;
+        static constexpr SHORT widths[] = { 80, 120 };
+
+        const auto start = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < iterations; ++i)
+        {
+            for (const auto width : widths)
+            {
+                auto newBuffer = std::make_unique<TextBuffer>(COORD{ width, bufferSize.Y }, TextAttribute{ 0x7 }, 0, target);
+                VERIFY_SUCCEEDED(TextBuffer::Reflow(*textBuffer, *newBuffer, std::nullopt, std::nullopt));
+                std::swap(textBuffer, newBuffer);
+            }
+        }
+        const auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        const auto resizes = iterations * std::size(widths);
+        Log::Comment(NoThrowString().Format(L"%zu resizes of %d rows: %.2f ms per resize", resizes, bufferSize.Y, elapsed * 1000 / resizes));
+    }
 };
 
 DummyRenderTarget ReflowTests::target{};
@@ -18,34 +18,80 @@ class UnicodeStorageTests
     TEST_METHOD(CanOverwriteEmoji)
     {
         UnicodeStorage storage;
-        const COORD coord{ 1, 3 };
-        const std::vector<wchar_t> newMoon{ 0xD83C, 0xDF11 };
-        const std::vector<wchar_t> fullMoon{ 0xD83C, 0xDF15 };
+        const size_t column = 1;
+        const std::wstring_view newMoon{ L"\xD83C\xDF11" };
+        const std::wstring_view fullMoon{ L"\xD83C\xDF15" };
 
         // store initial glyph
-        storage.StoreGlyph(coord, newMoon);
+        storage.StoreGlyph(column, newMoon);
 
         // verify it was stored
-        auto findIt = storage._map.find(coord);
-        VERIFY_ARE_NOT_EQUAL(findIt, storage._map.end());
-        const std::vector<wchar_t>& newMoonGlyph = findIt->second;
-        VERIFY_ARE_EQUAL(newMoonGlyph.size(), newMoon.size());
-        for (size_t i = 0; i < newMoon.size(); ++i)
-        {
-            VERIFY_ARE_EQUAL(newMoonGlyph.at(i), newMoon.at(i));
-        }
+        VERIFY_ARE_EQUAL(1u, storage.size());
+        VERIFY_ARE_EQUAL(newMoon, storage.GetText(column));
 
         // overwrite it
-        storage.StoreGlyph(coord, fullMoon);
+        storage.StoreGlyph(column, fullMoon);
 
         // verify the glyph was overwritten
-        findIt = storage._map.find(coord);
-        VERIFY_ARE_NOT_EQUAL(findIt, storage._map.end());
-        const std::vector<wchar_t>& fullMoonGlyph = findIt->second;
-        VERIFY_ARE_EQUAL(fullMoonGlyph.size(), fullMoon.size());
-        for (size_t i = 0; i < fullMoon.size(); ++i)
+        VERIFY_ARE_EQUAL(1u, storage.size());
+        VERIFY_ARE_EQUAL(fullMoon, storage.GetText(column));
+    }
+
+    TEST_METHOD(KeepsGlyphsSortedByColumn)
+    {
+        UnicodeStorage storage;
+        const std::wstring_view glyphs[] = { L"e\x301", L"\xD83C\xDF46", L"\xD83D\xDC68\x200D\xD83D\xDC69" };
+
+        // store them out of order
+        storage.StoreGlyph(40, glyphs[2]);
+        storage.StoreGlyph(3, glyphs[0]);
+        storage.StoreGlyph(17, glyphs[1]);
+
+        VERIFY_ARE_EQUAL(3u, storage.size());
+        VERIFY_ARE_EQUAL(3u, storage._entries.at(0).column);
+        VERIFY_ARE_EQUAL(17u, storage._entries.at(1).column);
+        VERIFY_ARE_EQUAL(40u, storage._entries.at(2).column);
+
+        VERIFY_ARE_EQUAL(glyphs[0], storage.GetText(3));
+        VERIFY_ARE_EQUAL(glyphs[1], storage.GetText(17));
+        VERIFY_ARE_EQUAL(glyphs[2], storage.GetText(40));
+        VERIFY_THROWS(storage.GetText(4), wil::ResultException);
+
+        storage.Erase(17);
+        VERIFY_ARE_EQUAL(2u, storage.size());
+        VERIFY_ARE_EQUAL(glyphs[0], storage.GetText(3));
+        VERIFY_ARE_EQUAL(glyphs[2], storage.GetText(40));
+
+        // truncating drops everything at or beyond the new width
+        storage.Truncate(40);
+        VERIFY_ARE_EQUAL(1u, storage.size());
+        VERIFY_ARE_EQUAL(glyphs[0], storage.GetText(3));
+
+        // and the arena is released along with the last glyph
+        storage.Erase(3);
+        VERIFY_IS_TRUE(storage.empty());
+        VERIFY_IS_TRUE(storage._arena.empty());
+    }
+
+    TEST_METHOD(CompactsArenaAfterRepeatedOverwrites)
+    {
+        UnicodeStorage storage;
+        const std::wstring_view shortGlyph{ L"\xD83C\xDF46" };
+        const std::wstring_view longGlyph{ L"\xD83D\xDC68\x200D\xD83D\xDC69\x200D\xD83D\xDC67" };
+
+        // Alternating between a short and a long glyph in the same column forces
+        // every long one to be appended to the arena instead of written in place.
+        storage.StoreGlyph(0, L"x\x301");
+        for (auto i = 0; i < 1000; ++i)
         {
-            VERIFY_ARE_EQUAL(fullMoonGlyph.at(i), fullMoon.at(i));
+            storage.StoreGlyph(0, shortGlyph);
+            storage.StoreGlyph(0, longGlyph);
+            storage.StoreGlyph(1, shortGlyph);
         }
+
+        VERIFY_ARE_EQUAL(2u, storage.size());
+        VERIFY_ARE_EQUAL(longGlyph, storage.GetText(0));
+        VERIFY_ARE_EQUAL(shortGlyph, storage.GetText(1));
+        VERIFY_IS_LESS_THAN_OR_EQUAL(storage._arena.size(), 2 * (longGlyph.size() + shortGlyph.size()) + 64);
     }
 };
@@ -387,9 +387,30 @@ namespace winrt::Microsoft::Terminal::TerminalConnection::implementation
 
         _startTime = std::chrono::high_resolution_clock::now();
 
-        // Create our own output handling thread
+        _CreateOutputPipeline();
+
+        // Create our own output handling threads
         // This must be done after the pipes are populated.
         // Each connection needs to make sure to drain the output from its backing host.
+        _hParseThread.reset(CreateThread(
+            nullptr,
+            0,
+            [](LPVOID lpParameter) noexcept {
+                ConptyConnection* const pInstance = static_cast<ConptyConnection*>(lpParameter);
+                if (pInstance)
+                {
+                    return pInstance->_ParseThread();
+                }
+                return gsl::narrow_cast<DWORD>(E_INVALIDARG);
+            },
+            this,
+            0,
+            nullptr));
+
+        THROW_LAST_ERROR_IF_NULL(_hParseThread);
+
+        LOG_IF_FAILED(SetThreadDescription(_hParseThread.get(), L"ConptyConnection Parse Thread"));
+
         _hOutputThread.reset(CreateThread(
             nullptr,
             0,
@@ -492,6 +513,10 @@ namespace winrt::Microsoft::Terminal::TerminalConnection::implementation
         {
             LOG_LAST_ERROR_IF(WAIT_FAILED == WaitForSingleObject(localOutputThreadHandle.get(), INFINITE));
         }
+        if (auto localParseThreadHandle = std::move(_hParseThread))
+        {
+            LOG_LAST_ERROR_IF(WAIT_FAILED == WaitForSingleObject(localParseThreadHandle.get(), INFINITE));
+        }
 
         _indicateExitWithStatus(exitCode);
 
@@ -559,6 +584,13 @@ namespace winrt::Microsoft::Terminal::TerminalConnection::implementation
                 _hOutputThread.reset();
             }
 
+            if (_hParseThread)
+            {
+                // The parse thread exits once it has passed on what the output thread read.
+                LOG_LAST_ERROR_IF(WAIT_FAILED == WaitForSingleObject(_hParseThread.get(), INFINITE));
+                _hParseThread.reset();
+            }
+
             if (_piClient.hProcess)
             {
                 // Wait for the client to terminate (which it should do successfully)
@@ -603,18 +635,57 @@ namespace winrt::Microsoft::Terminal::TerminalConnection::implementation
         return commandline.to_hstring();
     }
 
+    // Method Description:
+    // - Creates the queues that the output and parse threads pass the chunks of output through,
+    //   and fills the pool of free chunks.
+    void ConptyConnection::_CreateOutputPipeline()
+    {
+        auto [chunkProducer, chunkConsumer] = til::spsc::channel<OutputChunk>(OutputChunkCount);
+        auto [freeChunkProducer, freeChunkConsumer] = til::spsc::channel<OutputChunk>(OutputChunkCount);
+
+        for (uint32_t i = 0; i < OutputChunkCount; ++i)
+        {
+            freeChunkProducer.emplace(OutputChunk{ std::make_unique<char[]>(OutputChunkSize), 0 });
+        }
+
+        _chunkProducer = std::move(chunkProducer);
+        _chunkConsumer = std::move(chunkConsumer);
+        _freeChunkProducer = std::move(freeChunkProducer);
+        _freeChunkConsumer = std::move(freeChunkConsumer);
+        _freeChunkCount = OutputChunkCount;
+    }
+
     DWORD ConptyConnection::_OutputThread()
     {
         // Keep us alive until the output thread terminates; the destructor
         // won't wait for us, and the known exit points _do_.
         auto strongThis{ get_strong() };
 
+        // Dropping our end of the queue tells the parse thread that there's no more output coming.
+        auto dropProducer = wil::scope_exit([&]() noexcept {
+            _chunkProducer = til::spsc::producer<OutputChunk>{ nullptr };
+        });
+
         // process the data of the output pipe in a loop
         while (true)
         {
+            // If the parse thread holds all of the chunks, it's the terminal that's holding us up.
+            if (_freeChunkCount.load(std::memory_order_relaxed) == 0)
+            {
+                _outputStatistics.readStalls.fetch_add(1, std::memory_order_relaxed);
+            }
+
+            auto chunk = _freeChunkConsumer.pop();
+            if (!chunk)
+            {
+                // The parse thread is gone.
+                return 0;
+            }
+            _freeChunkCount.fetch_sub(1, std::memory_order_relaxed);
+
             DWORD read{};
 
-            const auto readFail{ !ReadFile(_outPipe.get(), _buffer.data(), gsl::narrow_cast<DWORD>(_buffer.size()), &read, nullptr) };
+            const auto readFail{ !ReadFile(_outPipe.get(), chunk->data.get(), OutputChunkSize, &read, nullptr) };
             if (readFail) // reading failed (we must check this first, because read will also be 0.)
             {
                 const auto lastError = GetLastError();
@@ -625,10 +696,59 @@ namespace winrt::Microsoft::Terminal::TerminalConnection::implementation
                     _transitionToState(ConnectionState::Failed);
                     return gsl::narrow_cast<DWORD>(HRESULT_FROM_WIN32(lastError));
                 }
-                // else we call convertUTF8ChunkToUTF16 with an empty string_view to convert possible remaining partials to U+FFFD
+                // else the parse thread converts possible remaining partials to U+FFFD once we're gone
+                return 0;
             }
 
-            const HRESULT result{ til::u8u16(std::string_view{ _buffer.data(), read }, _u16Str, _u8State) };
+            if (read == 0)
+            {
+                return 0;
+            }
+
+            _outputStatistics.reads.fetch_add(1, std::memory_order_relaxed);
+            _outputStatistics.bytes.fetch_add(read, std::memory_order_relaxed);
+
+            chunk->size = read;
+            if (!_chunkProducer.emplace(std::move(*chunk)))
+            {
+                // The parse thread is gone.
+                return 0;
+            }
+        }
+    }
+
+    DWORD ConptyConnection::_ParseThread()
+    {
+        // Keep us alive until the parse thread terminates; the destructor
+        // won't wait for us, and the known exit points _do_.
+        auto strongThis{ get_strong() };
+
+        // Dropping our ends of the queues lets the output thread exit as well, if we fail first.
+        auto dropConsumer = wil::scope_exit([&]() noexcept {
+            _chunkConsumer = til::spsc::consumer<OutputChunk>{ nullptr };
+            _freeChunkProducer = til::spsc::producer<OutputChunk>{ nullptr };
+            _LogOutputStatistics();
+        });
+
+        std::array<OutputChunk, OutputChunkCount> chunks{};
+
+        while (true)
+        {
+            // Wait for the output thread to queue up at least one chunk and take all that are pending.
+            // We only get none once the output thread is gone.
+            const auto count = _chunkConsumer.pop_n(til::spsc::block_initially, chunks.begin(), chunks.size()).first;
+
+            _u8Str.clear();
+            for (size_t i = 0; i < count; ++i)
+            {
+                auto& chunk = til::at(chunks, i);
+                _u8Str.append(chunk.data.get(), chunk.size);
+                _freeChunkProducer.emplace(std::move(chunk));
+                _freeChunkCount.fetch_add(1, std::memory_order_relaxed);
+            }
+
+            // Without any chunks this converts possible remaining partials to U+FFFD.
+            const HRESULT result{ til::u8u16(_u8Str, _u16Str, _u8State) };
             if (FAILED(result))
             {
                 if (_isStateAtOrBeyond(ConnectionState::Closing))
@@ -645,7 +765,13 @@ namespace winrt::Microsoft::Terminal::TerminalConnection::implementation
 
             if (_u16Str.empty())
             {
-                return 0;
+                if (count == 0)
+                {
+                    return 0;
+                }
+
+                // The chunks ended in the middle of a UTF-8 sequence.
+                continue;
             }
 
             if (!_receivedFirstByte)
@@ -665,10 +791,50 @@ namespace winrt::Microsoft::Terminal::TerminalConnection::implementation
             }
 
             // Pass the output to our registered event handlers
+            const auto handlerStart = std::chrono::steady_clock::now();
             _TerminalOutputHandlers(_u16Str);
+            const auto handlerTime = gsl::narrow_cast<uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - handlerStart).count());
+
+            _outputStatistics.batches.fetch_add(1, std::memory_order_relaxed);
+            _outputStatistics.handlerMicroseconds.fetch_add(handlerTime, std::memory_order_relaxed);
+            if (handlerTime > _outputStatistics.maxHandlerMicroseconds.load(std::memory_order_relaxed))
+            {
+                _outputStatistics.maxHandlerMicroseconds.store(handlerTime, std::memory_order_relaxed);
+            }
+            if (count > _outputStatistics.maxQueueDepth.load(std::memory_order_relaxed))
+            {
+                _outputStatistics.maxQueueDepth.store(gsl::narrow_cast<uint32_t>(count), std::memory_order_relaxed);
+            }
+
+#pragma warning(suppress : 26477 26485 26494 26482 26446) // We don't control TraceLoggingWrite
+            TraceLoggingWrite(g_hTerminalConnectionProvider,
+                              "OutputBatch",
+                              TraceLoggingDescription("An event emitted whenever the parse thread passes on a batch of output"),
+                              TraceLoggingGuid(_guid, "SessionGuid", "The WT_SESSION's GUID"),
+                              TraceLoggingUInt32(gsl::narrow_cast<uint32_t>(count), "QueueDepth"),
+                              TraceLoggingUInt32(gsl::narrow_cast<uint32_t>(_u8Str.size()), "Bytes"),
+                              TraceLoggingUInt64(handlerTime, "HandlerMicroseconds"),
+                              TraceLoggingLevel(WINEVENT_LEVEL_VERBOSE));
         }
+    }
 
-        return 0;
+    // Method Description:
+    // - Logs the counters of the output and parse threads.
+    void ConptyConnection::_LogOutputStatistics() noexcept
+    {
+#pragma warning(suppress : 26477 26485 26494 26482 26446) // We don't control TraceLoggingWrite
+        TraceLoggingWrite(g_hTerminalConnectionProvider,
+                          "OutputStatistics",
+                          TraceLoggingDescription("An event emitted when the connection stops passing on output"),
+                          TraceLoggingGuid(_guid, "SessionGuid", "The WT_SESSION's GUID"),
+                          TraceLoggingUInt64(_outputStatistics.reads.load(std::memory_order_relaxed), "Reads"),
+                          TraceLoggingUInt64(_outputStatistics.bytes.load(std::memory_order_relaxed), "Bytes"),
+                          TraceLoggingUInt64(_outputStatistics.readStalls.load(std::memory_order_relaxed), "ReadStalls"),
+                          TraceLoggingUInt64(_outputStatistics.batches.load(std::memory_order_relaxed), "Batches"),
+                          TraceLoggingUInt32(_outputStatistics.maxQueueDepth.load(std::memory_order_relaxed), "MaxQueueDepth"),
+                          TraceLoggingUInt64(_outputStatistics.handlerMicroseconds.load(std::memory_order_relaxed), "HandlerMicroseconds"),
+                          TraceLoggingUInt64(_outputStatistics.maxHandlerMicroseconds.load(std::memory_order_relaxed), "MaxHandlerMicroseconds"),
+                          TraceLoggingLevel(WINEVENT_LEVEL_VERBOSE));
     }
 
     static winrt::event<NewConnectionHandler> _newConnectionHandlers;
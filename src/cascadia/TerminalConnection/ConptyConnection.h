@@ -82,11 +82,50 @@ namespace winrt::Microsoft::Terminal::TerminalConnection::implementation
         wil::unique_static_pseudoconsole_handle _hPC;
         wil::unique_threadpool_wait _clientExitWait;
 
+        // The output thread reads the output pipe into a small pool of large chunks and queues them up
+        // for the parse thread, which converts and passes on all pending chunks in one go. The parse
+        // thread returns the chunks to the pool before it calls the output handlers (which lock the
+        // terminal), so that the output thread can keep reading in the meantime.
+        struct OutputChunk
+        {
+            std::unique_ptr<char[]> data;
+            DWORD size;
+        };
+
+        static constexpr DWORD OutputChunkSize = 64 * 1024;
+        static constexpr uint32_t OutputChunkCount = 4;
+
+        // Counters that show whether the terminal keeps up with the output of the client.
+        // They're logged whenever the parse thread exits.
+        struct OutputStatistics
+        {
+            std::atomic<uint64_t> reads{};
+            std::atomic<uint64_t> bytes{};
+            // The number of reads that had to wait for the parse thread to return a chunk first.
+            std::atomic<uint64_t> readStalls{};
+            std::atomic<uint64_t> batches{};
+            std::atomic<uint32_t> maxQueueDepth{};
+            // The time spent in the output handlers, which wait for and then hold the terminal's write lock.
+            std::atomic<uint64_t> handlerMicroseconds{};
+            std::atomic<uint64_t> maxHandlerMicroseconds{};
+        };
+
+        wil::unique_handle _hParseThread;
+        til::spsc::producer<OutputChunk> _chunkProducer{ nullptr };
+        til::spsc::consumer<OutputChunk> _chunkConsumer{ nullptr };
+        til::spsc::producer<OutputChunk> _freeChunkProducer{ nullptr };
+        til::spsc::consumer<OutputChunk> _freeChunkConsumer{ nullptr };
+        std::atomic<uint32_t> _freeChunkCount{};
+        OutputStatistics _outputStatistics{};
+
         til::u8state _u8State{};
+        std::string _u8Str{};
         std::wstring _u16Str{};
-        std::array<char, 4096> _buffer{};
 
+        void _CreateOutputPipeline();
         DWORD _OutputThread();
+        DWORD _ParseThread();
+        void _LogOutputStatistics() noexcept;
     };
 }
 
@@ -237,6 +237,8 @@ namespace winrt::Microsoft::Terminal::Control::implementation
                 _renderEngine = std::make_unique<::Microsoft::Console::Render::DxEngine>();
             }
 
+            // Painting isn't enabled until EnablePainting() is called. Until then,
+            // the engine can be set up directly instead of through UpdateEngines().
             _renderer->AddRenderEngine(_renderEngine.get());
 
             // Initialize our font with the renderer
@@ -468,7 +470,9 @@ namespace winrt::Microsoft::Terminal::Control::implementation
         // cleartype -> grayscale if the BG is transparent / acrylic.
         if (_renderEngine)
         {
-            _renderEngine->EnableTransparentBackground(_isBackgroundTransparent());
+            _renderer->UpdateEngines([&]() {
+                _renderEngine->EnableTransparentBackground(_isBackgroundTransparent());
+            });
         }
 
         auto eventArgs = winrt::make_self<TransparencyChangedEventArgs>(newOpacity);
@@ -483,19 +487,21 @@ namespace winrt::Microsoft::Terminal::Control::implementation
         // specify a custom pixel shader, manually enable the legacy retro
         // effect first. This will ensure that a toggle off->on will still work,
         // even if they currently have retro effect off.
-        if (_settings->PixelShaderPath().empty() && !_renderEngine->GetRetroTerminalEffect())
-        {
-            // SetRetroTerminalEffect to true will enable the effect. In this
-            // case, the shader effect will already be disabled (because neither
-            // a pixel shader nor the retro effects were originally requested).
-            // So we _don't_ want to toggle it again below, because that would
-            // toggle it back off.
-            _renderEngine->SetRetroTerminalEffect(true);
-        }
-        else
-        {
-            _renderEngine->ToggleShaderEffects();
-        }
+        _renderer->UpdateEngines([&]() {
+            if (_settings->PixelShaderPath().empty() && !_renderEngine->GetRetroTerminalEffect())
+            {
+                // SetRetroTerminalEffect to true will enable the effect. In this
+                // case, the shader effect will already be disabled (because neither
+                // a pixel shader nor the retro effects were originally requested).
+                // So we _don't_ want to toggle it again below, because that would
+                // toggle it back off.
+                _renderEngine->SetRetroTerminalEffect(true);
+            }
+            else
+            {
+                _renderEngine->ToggleShaderEffects();
+            }
+        });
         // Always redraw after toggling effects. This way even if the control
         // does not have focus it will update immediately.
         _renderer->TriggerRedrawAll();
@@ -559,7 +565,9 @@ namespace winrt::Microsoft::Terminal::Control::implementation
 
                 _lastHoveredId = newId;
                 _lastHoveredInterval = newInterval;
-                _renderEngine->UpdateHyperlinkHoveredId(newId);
+                _renderer->UpdateEngines([&]() {
+                    _renderEngine->UpdateHyperlinkHoveredId(newId);
+                });
                 _renderer->UpdateLastHoveredInterval(newInterval);
                 _renderer->TriggerRedrawAll();
             }
@@ -634,10 +642,12 @@ namespace winrt::Microsoft::Terminal::Control::implementation
             return;
         }
 
-        _renderEngine->SetForceFullRepaintRendering(_settings->ForceFullRepaintRendering());
-        _renderEngine->SetSoftwareRendering(_settings->SoftwareRendering());
-        // Inform the renderer of our opacity
-        _renderEngine->EnableTransparentBackground(_isBackgroundTransparent());
+        _renderer->UpdateEngines([&]() {
+            _renderEngine->SetForceFullRepaintRendering(_settings->ForceFullRepaintRendering());
+            _renderEngine->SetSoftwareRendering(_settings->SoftwareRendering());
+            // Inform the renderer of our opacity
+            _renderEngine->EnableTransparentBackground(_isBackgroundTransparent());
+        });
 
         _updateAntiAliasingMode();
 
@@ -665,10 +675,12 @@ namespace winrt::Microsoft::Terminal::Control::implementation
         if (_renderEngine)
         {
             // Update DxEngine settings under the lock
-            _renderEngine->SetSelectionBackground(til::color{ newAppearance->SelectionBackground() });
-            _renderEngine->SetRetroTerminalEffect(newAppearance->RetroTerminalEffect());
-            _renderEngine->SetPixelShaderPath(newAppearance->PixelShaderPath());
-            _renderEngine->SetIntenseIsBold(_settings->IntenseIsBold());
+            _renderer->UpdateEngines([&]() {
+                _renderEngine->SetSelectionBackground(til::color{ newAppearance->SelectionBackground() });
+                _renderEngine->SetRetroTerminalEffect(newAppearance->RetroTerminalEffect());
+                _renderEngine->SetPixelShaderPath(newAppearance->PixelShaderPath());
+                _renderEngine->SetIntenseIsBold(_settings->IntenseIsBold());
+            });
             _renderer->TriggerRedrawAll();
         }
     }
@@ -690,7 +702,9 @@ namespace winrt::Microsoft::Terminal::Control::implementation
             break;
         }
 
-        _renderEngine->SetAntialiasingMode(mode);
+        _renderer->UpdateEngines([&]() {
+            _renderEngine->SetAntialiasingMode(mode);
+        });
     }
 
     // Method Description:
@@ -735,8 +749,10 @@ namespace winrt::Microsoft::Terminal::Control::implementation
 
             // TODO: MSFT:20895307 If the font doesn't exist, this doesn't
             //      actually fail. We need a way to gracefully fallback.
-            LOG_IF_FAILED(_renderEngine->UpdateDpi(newDpi));
-            LOG_IF_FAILED(_renderEngine->UpdateFont(_desiredFont, _actualFont, featureMap, axesMap));
+            _renderer->UpdateEngines([&]() {
+                LOG_IF_FAILED(_renderEngine->UpdateDpi(newDpi));
+                LOG_IF_FAILED(_renderEngine->UpdateFont(_desiredFont, _actualFont, featureMap, axesMap));
+            });
         }
 
         // If the actual font isn't what was requested...
@@ -850,7 +866,10 @@ namespace winrt::Microsoft::Terminal::Control::implementation
         // Convert our new dimensions to characters
         const auto viewInPixels = Viewport::FromDimensions({ 0, 0 },
                                                            { static_cast<short>(size.cx), static_cast<short>(size.cy) });
-        const auto vp = _renderEngine->GetViewportInCharacters(viewInPixels);
+        Viewport vp;
+        _renderer->UpdateEngines([&]() {
+            vp = _renderEngine->GetViewportInCharacters(viewInPixels);
+        });
         const auto currentVP = _terminal->GetViewport();
 
         // Don't actually resize if viewport dimensions didn't change
@@ -862,7 +881,9 @@ namespace winrt::Microsoft::Terminal::Control::implementation
         _terminal->ClearSelection();
 
         // Tell the dx engine that our window is now the new size.
-        THROW_IF_FAILED(_renderEngine->SetWindowSize(size));
+        _renderer->UpdateEngines([&]() {
+            THROW_IF_FAILED(_renderEngine->SetWindowSize(size));
+        });
 
         // Invalidate everything
         _renderer->TriggerRedrawAll();
@@ -1369,7 +1390,12 @@ namespace winrt::Microsoft::Terminal::Control::implementation
         // * TermControl::_InitializeTerminal, after the call to Initialize, for
         //   _AttachDxgiSwapChainToXaml.
         // In both cases, we'll have a _renderEngine by then.
-        return reinterpret_cast<uint64_t>(_renderEngine->GetSwapChainHandle());
+        auto lock = _terminal->LockForReading();
+        HANDLE swapChainHandle{};
+        _renderer->UpdateEngines([&]() {
+            swapChainHandle = _renderEngine->GetSwapChainHandle();
+        });
+        return reinterpret_cast<uint64_t>(swapChainHandle);
     }
 
     void ControlCore::_rendererWarning(const HRESULT hr)
@@ -1699,7 +1725,9 @@ namespace winrt::Microsoft::Terminal::Control::implementation
         _settings->FocusedAppearance()->SetColorTableEntry(15, scheme.BrightWhite);
 
         _terminal->ApplyScheme(scheme);
-        _renderEngine->SetSelectionBackground(til::color{ _settings->SelectionBackground() });
+        _renderer->UpdateEngines([&]() {
+            _renderEngine->SetSelectionBackground(til::color{ _settings->SelectionBackground() });
+        });
 
         _renderer->TriggerRedrawAll();
         _BackgroundColorChangedHandlers(*this, nullptr);
@@ -303,10 +303,14 @@ void Terminal::UpdateAppearance(const ICoreAppearance& appearance)
         oldRows.visibleViewportTop = newVisibleTop;
 
         const std::optional<short> oldViewStart{ oldViewportTop };
-        RETURN_IF_FAILED(TextBuffer::Reflow(*_buffer.get(),
-                                            *newTextBuffer.get(),
-                                            _mutableViewport,
-                                            { oldRows }));
+        // Only the rows from a screen above the visible viewport are reflowed right
+        // away. The scrollback above gets reflowed once it's scrolled into view.
+        const short eagerTop = ::base::ClampSub(std::min(oldViewportTop, newVisibleTop), oldDimensions.Y);
+        RETURN_IF_FAILED(TextBuffer::ReflowLazily(*_buffer.get(),
+                                                  *newTextBuffer.get(),
+                                                  _mutableViewport,
+                                                  { oldRows },
+                                                  eagerTop));
 
         newViewportTop = oldRows.mutableViewportTop;
         newVisibleTop = oldRows.visibleViewportTop;
@@ -420,6 +424,7 @@ void Terminal::UpdateAppearance(const ICoreAppearance& appearance)
     _mutableViewport = Viewport::FromDimensions({ 0, proposedTop }, viewportSize);
 
     _buffer.swap(newTextBuffer);
+    _buffer->TakeReflowSource(std::move(newTextBuffer));
 
     // GH#3494: Maintain scrollbar position during resize
     // Make sure that we don't scroll past the mutableViewport at the bottom of the buffer
@@ -447,6 +452,10 @@ void Terminal::Write(std::wstring_view stringView)
     auto lock = LockForWriting();
 
     _stateMachine->ProcessString(stringView);
+
+    // Nothing refers to any rows once the write is done, so this is
+    // where the rows that were read in the meantime get frozen again.
+    _buffer->TrimThawedRows();
 }
 
 void Terminal::WritePastedText(std::wstring_view stringView)
@@ -713,14 +722,20 @@ bool Terminal::SendCharEvent(const wchar_t ch, const WORD scanCode, const Contro
 // Arguments:
 // - The interval tree containing regions that need to be invalidated
 void Terminal::_InvalidatePatternTree(interval_tree::IntervalTree<til::point, size_t>& tree)
+{
+    tree.visit_all([this](const PointTree::interval& interval) { _InvalidatePatternInterval(interval); });
+}
+
+// Method Description:
+// - Invalidates the region described by the given pattern interval for the rendering purposes
+// Arguments:
+// - The interval that needs to be invalidated
+void Terminal::_InvalidatePatternInterval(const interval_tree::IntervalTree<til::point, size_t>::interval& interval)
 {
     const auto vis = _VisibleStartIndex();
-    auto invalidate = [=](const PointTree::interval& interval) {
-        COORD startCoord{ gsl::narrow<SHORT>(interval.start.x()), gsl::narrow<SHORT>(interval.start.y() + vis) };
-        COORD endCoord{ gsl::narrow<SHORT>(interval.stop.x()), gsl::narrow<SHORT>(interval.stop.y() + vis) };
-        _InvalidateFromCoords(startCoord, endCoord);
-    };
-    tree.visit_all(invalidate);
+    COORD startCoord{ gsl::narrow<SHORT>(interval.start.x()), gsl::narrow<SHORT>(interval.start.y() + vis) };
+    COORD endCoord{ gsl::narrow<SHORT>(interval.stop.x()), gsl::narrow<SHORT>(interval.stop.y() + vis) };
+    _InvalidateFromCoords(startCoord, endCoord);
 }
 
 // Method Description:
@@ -934,6 +949,33 @@ Viewport Terminal::_GetVisibleViewport() const noexcept
                                     _mutableViewport.Dimensions());
 }
 
+// Routine Description:
+// - Measures the length of the leading run of text in the given string that
+//   can be written with TextBuffer::WriteNarrowRun, i.e. the run of code units
+//   which each occupy exactly one cell.
+// Arguments:
+// - text - The text to measure.
+// Return Value:
+// - The number of leading code units that are narrow, non-surrogate glyphs.
+static size_t _MeasureNarrowRun(const std::wstring_view text) noexcept
+{
+    size_t length = 0;
+    for (const auto wch : text)
+    {
+        // ASCII is by far the most common case and is always narrow.
+        if (wch >= 0x80)
+        {
+            const auto isSurrogate = wch >= 0xD800 && wch <= 0xDFFF;
+            if (isSurrogate || IsGlyphFullWidth(wch))
+            {
+                break;
+            }
+        }
+        ++length;
+    }
+    return length;
+}
+
 // Writes a string of text to the buffer, then moves the cursor (and viewport)
 //      in accordance with the written text.
 // This method is our proverbial `WriteCharsLegacy`, and great care should be made to
@@ -950,44 +992,57 @@ void Terminal::_WriteBuffer(const std::wstring_view& stringView)
     // We can not waste time displaying a cursor event when we know more text is coming right behind it.
     cursor.StartDeferDrawing();
 
-    for (size_t i = 0; i < stringView.size(); i++)
+    for (size_t i = 0; i < stringView.size();)
     {
-        const auto wch = stringView.at(i);
         const COORD cursorPosBefore = cursor.GetPosition();
         COORD proposedCursorPosition = cursorPosBefore;
 
-        // TODO: MSFT 21006766
-        // This is not great but I need it demoable. Fix by making a buffer stream writer.
-        //
-        // If wch is a surrogate character we need to read 2 code units
-        // from the stringView to form a single code point.
-        const auto isSurrogate = wch >= 0xD800 && wch <= 0xDFFF;
-        const auto view = stringView.substr(i, isSurrogate ? 2 : 1);
-        const OutputCellIterator it{ view, _buffer->GetCurrentAttributes() };
-        const auto end = _buffer->Write(it);
-        const auto cellDistance = end.GetCellDistance(it);
-        const auto inputDistance = end.GetInputDistance(it);
+        // Runs of narrow glyphs (the vast majority of all output) are copied
+        // into the current row in one go. Only surrogates and wide glyphs
+        // need to go through the OutputCellIterator one glyph at a time.
+        // Nothing past the end of the row is written, so there's no point in
+        // measuring further than that. We measure at least one code unit though,
+        // so that a narrow glyph at the end of a row still takes the path
+        // that wraps the line below.
+        const auto columnsLeft = std::max(1, _buffer->GetSize().Width() - cursorPosBefore.X);
+        const auto narrowLength = _MeasureNarrowRun(stringView.substr(i, gsl::narrow_cast<size_t>(columnsLeft)));
+        size_t inputDistance = 0;
+        ptrdiff_t cellDistance = 0;
+        if (narrowLength > 0)
+        {
+            inputDistance = _buffer->WriteNarrowRun(stringView.substr(i, narrowLength), cursorPosBefore);
+            cellDistance = inputDistance;
+        }
+        else
+        {
+            // If wch is a surrogate character we need to read 2 code units
+            // from the stringView to form a single code point.
+            const auto wch = stringView.at(i);
+            const auto isSurrogate = wch >= 0xD800 && wch <= 0xDFFF;
+            const auto view = stringView.substr(i, isSurrogate ? 2 : 1);
+            const OutputCellIterator it{ view, _buffer->GetCurrentAttributes() };
+            const auto end = _buffer->Write(it);
+            cellDistance = end.GetCellDistance(it);
+            inputDistance = end.GetInputDistance(it);
+        }
 
         if (inputDistance > 0)
         {
             // If "wch" was a surrogate character, we just consumed 2 code units above.
-            // -> Increment "i" by 1 in that case and thus by 2 in total in this iteration.
             proposedCursorPosition.X += gsl::narrow<SHORT>(cellDistance);
-            i += inputDistance - 1;
+            i += inputDistance;
         }
         else
         {
             // If _WriteBuffer() is called with a consecutive string longer than the viewport/buffer width
-            // the call to _buffer->Write() will refuse to write anything on the current line.
-            // GetInputDistance() thus returns 0, which would in turn cause i to be
-            // decremented by 1 below and force the outer loop to loop forever.
+            // the write above will refuse to write anything on the current line.
+            // inputDistance is thus 0, which would cause the outer loop to loop forever.
             // This if() basically behaves as if "\r\n" had been encountered above and retries the write.
             // With well behaving shells during normal operation this safeguard should normally not be encountered.
             proposedCursorPosition.X = 0;
             proposedCursorPosition.Y++;
 
-            // Try the character again.
-            i--;
+            // Since "i" wasn't advanced, we'll try the same characters again.
 
             // If we write the last cell of the row here, TextBuffer::Write will
             // mark this line as wrapped for us. If the next character we
@@ -1053,6 +1108,7 @@ void Terminal::_AdjustCursorPosition(const COORD proposedPosition)
 
         // manually erase our pattern intervals since the locations have changed now
         _patternIntervalTree = {};
+        _patternIntervals.clear();
     }
 
     // Update Cursor Position
@@ -1258,10 +1314,31 @@ bool Terminal::IsCursorBlinkingAllowed() const noexcept
 // - INVARIANT: this function can only be called if the caller has the writing lock on the terminal
 void Terminal::UpdatePatternsUnderLock() noexcept
 {
-    auto oldTree = _patternIntervalTree;
-    _patternIntervalTree = _buffer->GetPatterns(_VisibleStartIndex(), _VisibleEndIndex());
-    _InvalidatePatternTree(oldTree);
-    _InvalidatePatternTree(_patternIntervalTree);
+    static constexpr auto intervalLess = [](const PointTree::interval& a, const PointTree::interval& b) noexcept {
+        return std::tie(a.start, a.stop, a.value) < std::tie(b.start, b.stop, b.value);
+    };
+
+    auto intervals = _buffer->GetPatterns(_VisibleStartIndex(), _VisibleEndIndex());
+    std::sort(intervals.begin(), intervals.end(), intervalLess);
+
+    // Most output doesn't touch the patterns on screen at all,
+    // in which case there's neither a tree to rebuild nor anything to redraw.
+    if (intervals == _patternIntervals)
+    {
+        return;
+    }
+
+    // Only the patterns that appeared or disappeared need to be redrawn.
+    PointTree::interval_vector changed;
+    std::set_symmetric_difference(_patternIntervals.begin(), _patternIntervals.end(), intervals.begin(), intervals.end(), std::back_inserter(changed), intervalLess);
+
+    _patternIntervalTree = PointTree{ PointTree::interval_vector{ intervals } };
+    _patternIntervals = std::move(intervals);
+
+    for (const auto& interval : changed)
+    {
+        _InvalidatePatternInterval(interval);
+    }
 }
 
 // Method Description:
@@ -1272,6 +1349,7 @@ void Terminal::ClearPatternTree() noexcept
 {
     auto oldTree = _patternIntervalTree;
     _patternIntervalTree = {};
+    _patternIntervals.clear();
     _InvalidatePatternTree(oldTree);
 }
 
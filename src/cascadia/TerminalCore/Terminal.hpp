@@ -179,6 +179,7 @@ public:
     const std::wstring GetHyperlinkUri(uint16_t id) const noexcept override;
     const std::wstring GetHyperlinkCustomId(uint16_t id) const noexcept override;
     const std::vector<size_t> GetPatternId(const COORD location) const noexcept override;
+    void TakeDirtyRegions(std::vector<SMALL_RECT>& regions) override;
 #pragma endregion
 
 #pragma region IUiaData
@@ -192,6 +193,7 @@ public:
     const std::wstring_view GetConsoleTitle() const noexcept override;
     void ColorSelection(const COORD coordSelectionStart, const COORD coordSelectionEnd, const TextAttribute) override;
     const bool IsUiaDataInitialized() const noexcept override;
+    void ReflowScrollback() noexcept override;
 #pragma endregion
 
     void SetWriteInputCallback(std::function<void(std::wstring&)> pfn) noexcept;
@@ -345,7 +347,10 @@ private:
     //      Either way, we should make this behavior controlled by a setting.
 
     interval_tree::IntervalTree<til::point, size_t> _patternIntervalTree;
+    // The intervals _patternIntervalTree was built from, sorted, so that updates can be diffed against them.
+    interval_tree::IntervalTree<til::point, size_t>::interval_vector _patternIntervals;
     void _InvalidatePatternTree(interval_tree::IntervalTree<til::point, size_t>& tree);
+    void _InvalidatePatternInterval(const interval_tree::IntervalTree<til::point, size_t>::interval& interval);
     void _InvalidateFromCoords(const COORD start, const COORD end);
 
     // Since virtual keys are non-zero, you assume that this field is empty/invalid if it is.
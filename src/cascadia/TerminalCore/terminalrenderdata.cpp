@@ -29,6 +29,13 @@ COORD Terminal::GetTextBufferEndPosition() const noexcept
 
 const TextBuffer& Terminal::GetTextBuffer() noexcept
 {
+    // A resize may have left the scrollback to be reflowed later. The rows
+    // from the top of the visible viewport down are what gets presented.
+    try
+    {
+        _buffer->ReflowScrollback(gsl::narrow_cast<size_t>(std::max(0, _VisibleStartIndex())));
+    }
+    CATCH_LOG();
     return *_buffer;
 }
 
@@ -191,6 +198,11 @@ const std::vector<size_t> Terminal::GetPatternId(const COORD location) const noe
     return {};
 }
 
+void Terminal::TakeDirtyRegions(std::vector<SMALL_RECT>& regions)
+{
+    _buffer->TakeDirtyRegions(regions);
+}
+
 std::vector<Microsoft::Console::Types::Viewport> Terminal::GetSelectionRects() noexcept
 try
 {
@@ -301,6 +313,21 @@ const bool Terminal::IsUiaDataInitialized() const noexcept
     return !!_buffer;
 }
 
+// Method Description:
+// - Lays out any scrollback a resize left to be reflowed later, so that
+//   the whole buffer can be read (e.g. by a search or a screen reader).
+void Terminal::ReflowScrollback() noexcept
+{
+    if (_buffer)
+    {
+        try
+        {
+            _buffer->ReflowScrollback(0);
+        }
+        CATCH_LOG();
+    }
+}
+
 // Method Description:
 // - Creates the adjusted color array, which contains the possible foreground colors,
 //   adjusted for perceivability
@@ -38,6 +38,10 @@ class TerminalCoreUnitTests::TerminalBufferTests final
 
     TEST_METHOD(TestWrappingCharByChar);
     TEST_METHOD(TestWrappingALongString);
+    TEST_METHOD(TestWrappingMixedNarrowAndWide);
+
+    TEST_METHOD(WriteThroughputAscii);
+    TEST_METHOD(WriteThroughputCjk);
 
     TEST_METHOD(DontSnapToOutputTest);
 
@@ -67,6 +71,7 @@ class TerminalCoreUnitTests::TerminalBufferTests final
 
 private:
     void _SetTabStops(std::list<short> columns, bool replace);
+    void _MeasureWriteThroughput(const std::wstring_view line);
     std::list<short> _GetTabStops();
 
     DummyRenderTarget emptyRT;
@@ -165,6 +170,53 @@ void TerminalBufferTests::TestWrappingALongString()
     TestUtils::VerifyExpectedString(termTb, TestUtils::Test100CharsString, { 0, 0 });
 }
 
+void TerminalBufferTests::TestWrappingMixedNarrowAndWide()
+{
+    auto& termTb = *term->_buffer;
+    auto& termSm = *term->_stateMachine;
+    auto& cursor = termTb.GetCursor();
+
+    Log::Comment(L"Fill all but the last column with narrow text, then print a wide glyph. "
+                 L"The wide glyph doesn't fit and must be moved to the next row.");
+    const std::wstring narrow(TerminalViewWidth - 1, L'a');
+    termSm.ProcessString(narrow);
+    VERIFY_ARE_EQUAL(TerminalViewWidth - 1, cursor.GetPosition().X);
+    VERIFY_ARE_EQUAL(0, cursor.GetPosition().Y);
+
+    termSm.ProcessString(L"\x30a2" L"b");
+
+    VERIFY_IS_TRUE(termTb.GetRowByOffset(0).WasWrapForced());
+    VERIFY_IS_TRUE(termTb.GetRowByOffset(0).WasDoubleBytePadded());
+    VERIFY_ARE_EQUAL(3, cursor.GetPosition().X);
+    VERIFY_ARE_EQUAL(1, cursor.GetPosition().Y);
+
+    TestUtils::VerifyExpectedString(termTb, narrow, { 0, 0 });
+    auto iter = termTb.GetCellDataAt({ 0, 1 });
+    VERIFY_ARE_EQUAL(L"\x30a2", iter->Chars());
+    VERIFY_IS_TRUE(iter->DbcsAttr().IsLeading());
+    iter += 2;
+    VERIFY_ARE_EQUAL(L"b", iter->Chars());
+    VERIFY_IS_TRUE(iter->DbcsAttr().IsSingle());
+}
+
+void TerminalBufferTests::WriteThroughputAscii()
+{
+    BEGIN_TEST_METHOD_PROPERTIES()
+        TEST_METHOD_PROPERTY(L"IsPerfTest", L"true")
+    END_TEST_METHOD_PROPERTIES()
+
+    _MeasureWriteThroughput(L"The quick brown fox jumps over the lazy dog. 0123456789 [build] -- ok\r\n");
+}
+
+void TerminalBufferTests::WriteThroughputCjk()
+{
+    BEGIN_TEST_METHOD_PROPERTIES()
+        TEST_METHOD_PROPERTY(L"IsPerfTest", L"true")
+    END_TEST_METHOD_PROPERTIES()
+
+    _MeasureWriteThroughput(L"build \x30d3\x30eb\x30c9\x6210\x529f: \x4e2d\x6587\x6d4b\x8bd5 \xd55c\xad6d\xc5b4 mixed ascii \xd83d\xde00\r\n");
+}
+
 void TerminalBufferTests::DontSnapToOutputTest()
 {
     auto& termTb = *term->_buffer;
@@ -592,3 +644,34 @@ void TerminalBufferTests::TestGetReverseTab()
                          L"Cursor adjusted to last item in the sample list from position beyond end.");
     }
 }
+
+// Routine Description:
+// - Writes about 16 MB of the given line into the terminal and logs the
+//   achieved throughput of the output path (parser + buffer) in MB/s.
+// Arguments:
+// - line: the text to write repeatedly. Should end in a newline.
+void TerminalBufferTests::_MeasureWriteThroughput(const std::wstring_view line)
+{
+    auto& termSm = *term->_stateMachine;
+
+    // Process the input in 128 KiB chunks, similar to how ConptyConnection delivers it.
+    std::wstring chunk;
+    while (chunk.size() < 64 * 1024)
+    {
+        chunk.append(line);
+    }
+
+    constexpr size_t totalBytes = 16 * 1024 * 1024;
+    const auto chunkBytes = chunk.size() * sizeof(wchar_t);
+    const auto iterations = totalBytes / chunkBytes;
+
+    const auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < iterations; ++i)
+    {
+        termSm.ProcessString(chunk);
+    }
+    const auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    const auto megabytes = static_cast<double>(iterations * chunkBytes) / (1024 * 1024);
+    Log::Comment(NoThrowString().Format(L"Wrote %.1f MB (UTF-16) in %.3f s: %.1f MB/s", megabytes, elapsed, megabytes / elapsed));
+}
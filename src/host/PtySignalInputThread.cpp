@@ -8,6 +8,7 @@
 #include "output.h"
 #include "handle.h"
 #include "../interactivity/inc/ServiceLocator.hpp"
+#include "../server/ApiMetrics.h"
 #include "../terminal/adapter/DispatchCommon.hpp"
 
 using namespace Microsoft::Console;
@@ -120,6 +121,12 @@ void PtySignalInputThread::ConnectConsole() noexcept
 
             break;
         }
+        case PtySignal::DumpApiMetrics:
+        {
+            // The statistics are written as trace events, as the signal pipe has no way to reply.
+            ApiMetrics::s_TraceSnapshot();
+            break;
+        }
         default:
         {
             THROW_HR(E_UNEXPECTED);
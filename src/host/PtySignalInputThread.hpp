@@ -36,7 +36,8 @@ namespace Microsoft::Console
         enum class PtySignal : unsigned short
         {
             ClearBuffer = 2,
-            ResizeWindow = 8
+            ResizeWindow = 8,
+            DumpApiMetrics = 16
         };
 
         struct ResizeWindowData
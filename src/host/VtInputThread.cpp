@@ -30,6 +30,7 @@ VtInputThread::VtInputThread(_In_ wil::unique_hfile hPipe,
     _hThread{},
     _u8State{},
     _dwThreadId{ 0 },
+    _chunks{},
     _exitRequested{ false },
     _exitResult{ S_OK }
 {
@@ -41,35 +42,51 @@ VtInputThread::VtInputThread(_In_ wil::unique_hfile hPipe,
 
     auto dispatch = std::make_unique<InteractDispatch>(std::move(pGetSet));
 
+    _pDispatch = dispatch.get();
+
     auto engine = std::make_unique<InputStateMachineEngine>(std::move(dispatch), inheritCursor);
 
-    auto engineRef = engine.get();
+    _pInputEngine = engine.get();
 
     _pInputStateMachine = std::make_unique<StateMachine>(std::move(engine));
 
     // we need this callback to be able to flush an unknown input sequence to the app
     auto flushCallback = std::bind(&StateMachine::FlushToTerminal, _pInputStateMachine.get());
-    engineRef->SetFlushToInputQueueCallback(flushCallback);
+    _pInputEngine->SetFlushToInputQueueCallback(flushCallback);
+
+    for (auto& chunk : _chunks)
+    {
+        chunk.data = std::make_unique<char[]>(ReadSize);
+    }
+
+    auto [chunkProducer, chunkConsumer] = til::spsc::channel<uint32_t>(InputChunkCount);
+    auto [freeChunkProducer, freeChunkConsumer] = til::spsc::channel<uint32_t>(InputChunkCount);
+
+    for (uint32_t i = 0; i < InputChunkCount; ++i)
+    {
+        freeChunkProducer.emplace(i);
+    }
+
+    _chunkProducer = std::move(chunkProducer);
+    _chunkConsumer = std::move(chunkConsumer);
+    _freeChunkProducer = std::move(freeChunkProducer);
+    _freeChunkConsumer = std::move(freeChunkConsumer);
 }
 
 // Method Description:
 // - Processes a string of input characters. The characters should be UTF-8
 //      encoded, and will get converted to wstring to be processed by the
 //      input state machine.
+// - Each string must be the result of exactly one read from the pipe, because
+//      the state machine flushes incomplete sequences at the end of a string.
+//      A lone ESC is only an Escape key press if nothing else came with it.
+// - Must be called under the console lock, see _HandleRunInputBatch.
 // Arguments:
 // - u8Str - the UTF-8 string received.
 // Return Value:
 // - S_OK on success, otherwise an appropriate failure.
 [[nodiscard]] HRESULT VtInputThread::_HandleRunInput(const std::string_view u8Str)
 {
-    // Make sure to call the GLOBAL Lock/Unlock, not the gci's lock/unlock.
-    // Only the global unlock attempts to dispatch ctrl events. If you use the
-    //      gci's unlock, when you press C-c, it won't be dispatched until the
-    //      next console API call. For something like `powershell sleep 60`,
-    //      that won't happen for 60s
-    LockConsole();
-    auto Unlock = wil::scope_exit([&] { UnlockConsole(); });
-
     try
     {
         std::wstring wstr{};
@@ -80,12 +97,58 @@ VtInputThread::VtInputThread(_In_ wil::unique_hfile hPipe,
             return S_FALSE;
         }
         _pInputStateMachine->ProcessString(wstr);
+        // A bracketed paste usually spans many reads. Whatever part of it
+        // arrived with this one is written along with the rest.
+        _pInputEngine->FlushPastedText();
     }
     CATCH_RETURN();
 
     return S_OK;
 }
 
+// Method Description:
+// - Passes the given reads to _HandleRunInput one after the other, under a
+//      single lock. Everything they turn into is handed to the input buffer
+//      in one write, rather than waking up the client for every key and
+//      mouse report in them.
+// Arguments:
+// - u8Strs - the UTF-8 strings received, one per read from the pipe.
+// Return Value:
+// - S_OK on success, otherwise the first failure. The reads after a failed
+//      one aren't processed.
+[[nodiscard]] HRESULT VtInputThread::_HandleRunInputBatch(const gsl::span<const std::string_view> u8Strs)
+{
+    // Make sure to call the GLOBAL Lock/Unlock, not the gci's lock/unlock.
+    // Only the global unlock attempts to dispatch ctrl events. If you use the
+    //      gci's unlock, when you press C-c, it won't be dispatched until the
+    //      next console API call. For something like `powershell sleep 60`,
+    //      that won't happen for 60s
+    LockConsole();
+    auto Unlock = wil::scope_exit([&] { UnlockConsole(); });
+    ++_statistics.lockAcquisitions;
+
+    HRESULT hr = S_OK;
+    _pDispatch->BeginInputBatch();
+    for (const auto& u8Str : u8Strs)
+    {
+        hr = _HandleRunInput(u8Str);
+        if (FAILED(hr))
+        {
+            break;
+        }
+    }
+
+    try
+    {
+        const auto events = gsl::narrow_cast<uint64_t>(_pDispatch->EndInputBatch());
+        _statistics.events += events;
+        _statistics.maxEventsPerLock = std::max(_statistics.maxEventsPerLock, events);
+    }
+    CATCH_LOG();
+
+    return hr;
+}
+
 // Function Description:
 // - Static function used for initializing an instance's ThreadProc.
 // Arguments:
@@ -98,19 +161,28 @@ DWORD WINAPI VtInputThread::StaticVtInputThreadProc(_In_ LPVOID lpParameter)
     return pInstance->_InputThread();
 }
 
+// Function Description:
+// - Static function used for initializing an instance's decode ThreadProc.
+// Arguments:
+// - lpParameter - A pointer to the VtInputThread instance that should be called.
+// Return Value:
+// - The return value of the underlying instance's _DecodeThread
+DWORD WINAPI VtInputThread::StaticVtDecodeThreadProc(_In_ LPVOID lpParameter)
+{
+    VtInputThread* const pInstance = reinterpret_cast<VtInputThread*>(lpParameter);
+    return pInstance->_DecodeThread();
+}
+
 // Method Description:
-// - Do a single ReadFile from our pipe, and try and handle it. If handling
-//      failed, throw or log, depending on what the caller wants.
+// - Does a single ReadFile from our pipe into the given chunk.
 // Arguments:
-// - throwOnFail: If true, throw an exception if there was an error processing
-//      the input received. Otherwise, log the error.
+// - chunk: The chunk to read into.
 // Return Value:
-// - <none>
-void VtInputThread::DoReadInput(const bool throwOnFail)
+// - false if the read failed, with the error in _exitResult.
+bool VtInputThread::_ReadChunk(InputChunk& chunk)
 {
-    char buffer[256];
     DWORD dwRead = 0;
-    bool fSuccess = !!ReadFile(_hFile.get(), buffer, ARRAYSIZE(buffer), &dwRead, nullptr);
+    bool fSuccess = !!ReadFile(_hFile.get(), chunk.data.get(), ReadSize, &dwRead, nullptr);
 
     // If we failed to read because the terminal broke our pipe (usually due
     //      to dying itself), close gracefully with ERROR_BROKEN_PIPE.
@@ -118,12 +190,36 @@ void VtInputThread::DoReadInput(const bool throwOnFail)
     //       we want to gracefully close in.
     if (!fSuccess)
     {
-        _exitRequested = true;
         _exitResult = HRESULT_FROM_WIN32(GetLastError());
+        return false;
+    }
+
+    chunk.size = dwRead;
+    _statistics.reads++;
+    _statistics.bytes += dwRead;
+    return true;
+}
+
+// Method Description:
+// - Do a single ReadFile from our pipe, and try and handle it. If handling
+//      failed, throw or log, depending on what the caller wants.
+// - This is only used before the threads are started, so the first chunk is ours.
+// Arguments:
+// - throwOnFail: If true, throw an exception if there was an error processing
+//      the input received. Otherwise, log the error.
+// Return Value:
+// - <none>
+void VtInputThread::DoReadInput(const bool throwOnFail)
+{
+    auto& chunk = til::at(_chunks, 0);
+    if (!_ReadChunk(chunk))
+    {
+        _exitRequested = true;
         return;
     }
 
-    HRESULT hr = _HandleRunInput({ buffer, gsl::narrow_cast<size_t>(dwRead) });
+    const std::string_view u8Str{ chunk.data.get(), gsl::narrow_cast<size_t>(chunk.size) };
+    HRESULT hr = _HandleRunInputBatch({ &u8Str, 1 });
     if (FAILED(hr))
     {
         if (throwOnFail)
@@ -139,21 +235,118 @@ void VtInputThread::DoReadInput(const bool throwOnFail)
 }
 
 // Method Description:
-// - The ThreadProc for the VT Input Thread. Reads input from the pipe, and
-//      passes it to _HandleRunInput to be processed by the
-//      InputStateMachineEngine.
+// - The ThreadProc for the VT Input Thread. Reads input from the pipe into
+//      the free chunks, and queues them up for the decode thread.
+// Return Value:
+// - Any error from reading the pipe that might have caused us to exit.
+DWORD VtInputThread::_InputThread()
+{
+    // Dropping our end of the queue tells the decode thread that there's no more input coming.
+    auto dropProducer = wil::scope_exit([&]() noexcept {
+        _chunkProducer = til::spsc::producer<uint32_t>{ nullptr };
+    });
+
+    for (;;)
+    {
+        // We only get no chunk once the decode thread is gone. It may also have asked
+        // us to exit while we waited for one, in which case we mustn't start reading.
+        // See _DecodeThread.
+        const auto index = _freeChunkConsumer.pop();
+        if (!index || _exitRequested || !_ReadChunk(til::at(_chunks, *index)) || !_chunkProducer.emplace(*index))
+        {
+            break;
+        }
+    }
+
+    return _exitResult;
+}
+
+// Method Description:
+// - The ThreadProc for the VT Decode Thread. Takes all the chunks that the
+//      input thread queued up at once, and passes them to _HandleRunInputBatch
+//      to be processed by the InputStateMachineEngine under a single lock.
 // Return Value:
 // - Any error from reading the pipe or writing to the input buffer that might
 //      have caused us to exit.
-DWORD VtInputThread::_InputThread()
+DWORD VtInputThread::_DecodeThread()
 {
-    while (!_exitRequested)
+    std::array<uint32_t, InputChunkCount> indices{};
+    std::array<std::string_view, InputChunkCount> u8Strs{};
+    HRESULT hr = S_OK;
+
+    while (SUCCEEDED(hr))
     {
-        DoReadInput(true);
+        // Wait for the input thread to queue up at least one chunk and take all that are pending.
+        // We only get none once the input thread is gone.
+        const auto count = _chunkConsumer.pop_n(til::spsc::block_initially, indices.begin(), indices.size()).first;
+        if (count == 0)
+        {
+            break;
+        }
+
+        // The chunks are handled one by one rather than joined, so that every
+        // read is parsed exactly as if it had been the only one.
+        for (size_t i = 0; i < count; ++i)
+        {
+            const auto& chunk = til::at(_chunks, til::at(indices, i));
+            til::at(u8Strs, i) = { chunk.data.get(), gsl::narrow_cast<size_t>(chunk.size) };
+        }
+
+        hr = _HandleRunInputBatch({ u8Strs.data(), count });
+
+        // The input thread may only reuse the chunks once we're done with them.
+        for (size_t i = 0; i < count; ++i)
+        {
+            _freeChunkProducer.emplace(til::at(indices, i));
+        }
     }
+
+    // Dropping our ends of the queues lets the input thread exit as well, if we failed first.
+    // It's most likely waiting for the pipe then, so its read is cancelled.
+    _chunkConsumer = til::spsc::consumer<uint32_t>{ nullptr };
+    _freeChunkProducer = til::spsc::producer<uint32_t>{ nullptr };
+    if (FAILED(hr))
+    {
+        _exitRequested = true;
+
+        // CancelSynchronousIo only cancels a read that's already in progress. The input thread
+        // checks _exitRequested before it starts one, but it may have done so just before we set
+        // it. So we keep cancelling until it's gone, instead of waiting for the client to type.
+        do
+        {
+            if (!CancelSynchronousIo(_hThread.get()))
+            {
+                LOG_LAST_ERROR_IF(GetLastError() != ERROR_NOT_FOUND);
+            }
+        } while (WaitForSingleObject(_hThread.get(), 10) == WAIT_TIMEOUT);
+    }
+
+    // The input thread has to be done with us before we're closed.
+    LOG_LAST_ERROR_IF(WAIT_FAILED == WaitForSingleObject(_hThread.get(), INFINITE));
+    const auto exitResult = FAILED(hr) ? hr : _exitResult;
+
+    _LogStatistics();
     ServiceLocator::LocateGlobals().getConsoleInformation().GetVtIo()->CloseInput();
 
-    return _exitResult;
+    return exitResult;
+}
+
+// Method Description:
+// - Logs the counters of the input and decode threads. The average number of
+//      events written per lock acquisition is Events / LockAcquisitions.
+void VtInputThread::_LogStatistics() const noexcept
+{
+#pragma warning(suppress : 26477 26485 26494 26482 26446) // We don't control TraceLoggingWrite
+    TraceLoggingWrite(g_hConhostV2EventTraceProvider,
+                      "VtInputStatistics",
+                      TraceLoggingDescription("An event emitted when the VT input thread stops passing on input"),
+                      TraceLoggingUInt64(_statistics.reads, "Reads"),
+                      TraceLoggingUInt64(_statistics.bytes, "Bytes"),
+                      TraceLoggingUInt64(_statistics.lockAcquisitions, "LockAcquisitions"),
+                      TraceLoggingUInt64(_statistics.events, "Events"),
+                      TraceLoggingUInt64(_statistics.maxEventsPerLock, "MaxEventsPerLock"),
+                      TraceLoggingLevel(WINEVENT_LEVEL_VERBOSE),
+                      TraceLoggingKeyword(TIL_KEYWORD_TRACE));
 }
 
 // Method Description:
@@ -178,5 +371,25 @@ DWORD VtInputThread::_InputThread()
     _dwThreadId = dwThreadId;
     LOG_IF_FAILED(SetThreadDescription(hThread, L"ConPTY Input Handler Thread"));
 
+    // The decode thread waits for the input thread before it closes the input,
+    // which is why the input thread has to exist first.
+    hThread = CreateThread(nullptr,
+                           0,
+                           VtInputThread::StaticVtDecodeThreadProc,
+                           this,
+                           0,
+                           nullptr);
+
+    if (!hThread)
+    {
+        const auto hr = HRESULT_FROM_WIN32(GetLastError());
+        // Without a decode thread, the input thread would wait for it forever.
+        _chunkConsumer = til::spsc::consumer<uint32_t>{ nullptr };
+        _freeChunkProducer = til::spsc::producer<uint32_t>{ nullptr };
+        RETURN_HR(hr);
+    }
+    _hDecodeThread.reset(hThread);
+    LOG_IF_FAILED(SetThreadDescription(hThread, L"ConPTY Input Decode Thread"));
+
     return S_OK;
 }
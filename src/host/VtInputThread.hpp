@@ -15,30 +15,85 @@ Author(s):
 #pragma once
 
 #include "../terminal/parser/StateMachine.hpp"
+#include "../terminal/parser/InputStateMachineEngine.hpp"
+#include "../terminal/adapter/InteractDispatch.hpp"
+
+// fwdecl unittest classes
+#ifdef UNIT_TESTING
+namespace Microsoft::Console::VirtualTerminal
+{
+    class VtIoTests;
+};
+#endif
 
 namespace Microsoft::Console
 {
     class VtInputThread
     {
     public:
+        // The size of each read from the pipe. Pastes and floods of mouse reports
+        // arrive in large reads, while a single key press only fills a few bytes.
+        static constexpr DWORD ReadSize = 64 * 1024;
+
         VtInputThread(_In_ wil::unique_hfile hPipe, const bool inheritCursor);
 
         [[nodiscard]] HRESULT Start();
         static DWORD WINAPI StaticVtInputThreadProc(_In_ LPVOID lpParameter);
+        static DWORD WINAPI StaticVtDecodeThreadProc(_In_ LPVOID lpParameter);
         void DoReadInput(const bool throwOnFail);
 
     private:
+        // The input thread reads the pipe into one of two chunks, while the decode
+        // thread passes the input in the other one on to the input buffer. The chunks
+        // travel between the two threads as indices into _chunks.
+        struct InputChunk
+        {
+            std::unique_ptr<char[]> data;
+            DWORD size;
+        };
+
+        static constexpr uint32_t InputChunkCount = 2;
+
+        // Counters that show how well the input is batched up. They're logged when the decode
+        // thread exits. reads and bytes belong to the input thread, the rest to the decode thread.
+        struct InputStatistics
+        {
+            uint64_t reads{};
+            uint64_t bytes{};
+            uint64_t lockAcquisitions{};
+            uint64_t events{};
+            uint64_t maxEventsPerLock{};
+        };
+
         [[nodiscard]] HRESULT _HandleRunInput(const std::string_view u8Str);
+        [[nodiscard]] HRESULT _HandleRunInputBatch(const gsl::span<const std::string_view> u8Strs);
+        [[nodiscard]] bool _ReadChunk(InputChunk& chunk);
         DWORD _InputThread();
+        DWORD _DecodeThread();
+        void _LogStatistics() const noexcept;
 
         wil::unique_hfile _hFile;
         wil::unique_handle _hThread;
         DWORD _dwThreadId;
+        wil::unique_handle _hDecodeThread;
 
-        bool _exitRequested;
+        std::array<InputChunk, InputChunkCount> _chunks;
+        til::spsc::producer<uint32_t> _chunkProducer{ nullptr };
+        til::spsc::consumer<uint32_t> _chunkConsumer{ nullptr };
+        til::spsc::producer<uint32_t> _freeChunkProducer{ nullptr };
+        til::spsc::consumer<uint32_t> _freeChunkConsumer{ nullptr };
+        InputStatistics _statistics{};
+
+        std::atomic<bool> _exitRequested;
         HRESULT _exitResult;
 
         std::unique_ptr<Microsoft::Console::VirtualTerminal::StateMachine> _pInputStateMachine;
+        Microsoft::Console::VirtualTerminal::InputStateMachineEngine* _pInputEngine{ nullptr }; // owned by _pInputStateMachine
+        Microsoft::Console::VirtualTerminal::InteractDispatch* _pDispatch{ nullptr }; // owned by _pInputEngine
         til::u8state _u8State;
+
+#ifdef UNIT_TESTING
+        friend class Microsoft::Console::VirtualTerminal::VtIoTests;
+#endif
     };
 }
@@ -21,6 +21,11 @@
 
 #include "../interactivity/inc/ServiceLocator.hpp"
 
+#if defined(_M_IX86) || defined(_M_AMD64)
+#include <intrin.h>
+#include <emmintrin.h>
+#endif
+
 #pragma hdrstop
 using namespace Microsoft::Console::Types;
 using Microsoft::Console::Interactivity::ServiceLocator;
@@ -28,6 +33,83 @@ using Microsoft::Console::VirtualTerminal::StateMachine;
 // Used by WriteCharsLegacy.
 #define IS_GLYPH_CHAR(wch) (((wch) >= L' ') && ((wch) != 0x007F))
 
+// Routine Description:
+// - Finds the first code unit in the given text that isn't printable ASCII (0x20 - 0x7E).
+//   Where SSE2 is available, 8 code units are tested at a time.
+// Arguments:
+// - text - The text to scan.
+// Return Value:
+// - The index of the first code unit that isn't printable ASCII, or text.size() if there is none.
+static size_t _FindNonPrintableAscii(const std::wstring_view text) noexcept
+{
+    const auto data = text.data();
+    const auto size = text.size();
+    size_t i = 0;
+
+#if defined(_M_IX86) || defined(_M_AMD64)
+    // SSE2 lacks unsigned 16-bit comparisons, so "x <= limit" is computed as
+    // "saturating_sub(x, limit) == 0" instead. With wraparound, (wch - 0x20) <= 0x5E
+    // holds for printable ASCII only.
+    const auto offset = _mm_set1_epi16(0x20);
+    const auto limit = _mm_set1_epi16(0x5E);
+    const auto zero = _mm_setzero_si128();
+    for (; i + 8 <= size; i += 8)
+    {
+        const auto chars = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i));
+        const auto excess = _mm_subs_epu16(_mm_sub_epi16(chars, offset), limit);
+        const auto printable = _mm_movemask_epi8(_mm_cmpeq_epi16(excess, zero));
+        if (printable != 0xFFFF)
+        {
+            unsigned long index = 0;
+            _BitScanForward(&index, static_cast<unsigned long>(~printable & 0xFFFF));
+            // Each code unit covers 2 bits of the byte mask.
+            return i + index / 2;
+        }
+    }
+#endif
+
+    for (; i < size; ++i)
+    {
+        const auto wch = data[i];
+        if (wch < L' ' || wch > L'~')
+        {
+            break;
+        }
+    }
+    return i;
+}
+
+// Routine Description:
+// - Measures the leading run of text that WriteCharsLegacy can copy as is:
+//   glyph characters which each occupy exactly one cell.
+// - Printable ASCII is skipped over in bulk. Any other code unit is checked
+//   on its own, since it might be a wide glyph or half of a surrogate pair.
+// Arguments:
+// - text - The text to measure.
+// Return Value:
+// - The number of leading code units that are narrow glyph characters.
+static size_t _MeasureNarrowGlyphRun(const std::wstring_view text) noexcept
+{
+    size_t length = 0;
+    while (length < text.size())
+    {
+        length += _FindNonPrintableAscii(text.substr(length));
+        if (length == text.size())
+        {
+            break;
+        }
+
+        const auto wch = til::at(text, length);
+        const auto isSurrogate = wch >= 0xD800 && wch <= 0xDFFF;
+        if (!IS_GLYPH_CHAR(wch) || isSurrogate || IsGlyphFullWidth(wch))
+        {
+            break;
+        }
+        ++length;
+    }
+    return length;
+}
+
 // Routine Description:
 // - This routine updates the cursor position.  Its input is the non-special
 //   cased new location of the cursor.  For example, if the cursor were being
@@ -388,8 +470,30 @@ using Microsoft::Console::VirtualTerminal::StateMachine;
         XPosition = cursor.GetPosition().X;
         size_t i = 0;
         wchar_t* LocalBufPtr = LocalBuffer;
+        // How many of the characters in the buffer were copied by the narrow glyph fast path below.
+        size_t NarrowGlyphs = 0;
         while (*pcb < BufferSize && i < LOCAL_BUFFER_SIZE && XPosition < coordScreenBufferSize.X)
         {
+            // Runs of narrow glyphs (the vast majority of all output) are measured and
+            // copied in one go. Everything else is handled one character at a time below.
+            const auto RunLimit = std::min({ (BufferSize - *pcb) / sizeof(WCHAR),
+                                             LOCAL_BUFFER_SIZE - i,
+                                             gsl::narrow_cast<size_t>(coordScreenBufferSize.X - XPosition) });
+            const auto RunLength = _MeasureNarrowGlyphRun({ pwchRealUnicode, RunLimit });
+            if (RunLength != 0)
+            {
+                std::copy_n(pwchRealUnicode, RunLength, LocalBufPtr);
+                LocalBufPtr += RunLength;
+                XPosition += gsl::narrow_cast<SHORT>(RunLength);
+                i += RunLength;
+                NarrowGlyphs += RunLength;
+                pwchBuffer += RunLength;
+                lpString += RunLength;
+                pwchRealUnicode += RunLength;
+                *pcb += RunLength * sizeof(WCHAR);
+                continue;
+            }
+
 #pragma prefast(suppress : 26019, "Buffer is taken in multiples of 2. Validation is ok.")
             const wchar_t Char = *lpString;
             // WCL-NOTE: We believe RealUnicodeChar to be identical to Char, because we believe pwchRealUnicode
@@ -553,8 +657,18 @@ using Microsoft::Console::VirtualTerminal::StateMachine;
             }
 
             // line was wrapped if we're writing up to the end of the current row
-            OutputCellIterator it(std::wstring_view(LocalBuffer, i), Attributes);
-            const auto itEnd = screenInfo.Write(it);
+            size_t CellsWritten = 0;
+            if (NarrowGlyphs == i)
+            {
+                // Narrow glyphs go straight into the row, without an OutputCellIterator walking them one by one.
+                CellsWritten = textBuffer.WriteNarrowRun(std::wstring_view(LocalBuffer, i), CursorPosition);
+            }
+            else
+            {
+                OutputCellIterator it(std::wstring_view(LocalBuffer, i), Attributes);
+                const auto itEnd = screenInfo.Write(it);
+                CellsWritten = itEnd.GetCellDistance(it);
+            }
 
             // Notify accessibility
             if (screenInfo.HasAccessibilityEventing())
@@ -564,7 +678,7 @@ using Microsoft::Console::VirtualTerminal::StateMachine;
 
             // The number of "spaces" or "cells" we have consumed needs to be reported and stored for later
             // when/if we need to erase the command line.
-            TempNumSpaces += itEnd.GetCellDistance(it);
+            TempNumSpaces += CellsWritten;
             // WCL-NOTE: We are using the "estimated" X position delta instead of the actual delta from
             // WCL-NOTE: the iterator. It is not clear why. If they differ, the cursor ends up in the
             // WCL-NOTE: wrong place (typically inside another character).
@@ -1040,15 +1154,20 @@ using Microsoft::Console::VirtualTerminal::StateMachine;
     }
 
     const auto& textBuffer = screenInfo.GetTextBuffer();
-    return WriteChars(screenInfo,
-                      pwchBuffer,
-                      pwchBuffer,
-                      pwchBuffer,
-                      pcbBuffer,
-                      nullptr,
-                      textBuffer.GetCursor().GetPosition().X,
-                      WC_LIMIT_BACKSPACE,
-                      nullptr);
+    const auto Status = WriteChars(screenInfo,
+                                   pwchBuffer,
+                                   pwchBuffer,
+                                   pwchBuffer,
+                                   pcbBuffer,
+                                   nullptr,
+                                   textBuffer.GetCursor().GetPosition().X,
+                                   WC_LIMIT_BACKSPACE,
+                                   nullptr);
+
+    // Nothing refers to any rows once the write is done, so this is where the rows that were
+    // read in the meantime get frozen again. The write may have switched the active buffer.
+    ServiceLocator::LocateGlobals().getConsoleInformation().GetActiveOutputBuffer().GetTextBuffer().TrimThawedRows();
+    return Status;
 }
 
 // Routine Description:
@@ -7,6 +7,7 @@
 #include "misc.h"
 #include "output.h"
 #include "srvinit.h"
+#include "../server/ApiMetrics.h"
 
 #include "../interactivity/inc/ServiceLocator.hpp"
 #include "../types/inc/convert.hpp"
@@ -62,7 +63,13 @@ bool CONSOLE_INFORMATION::IsConsoleLocked() const
 #pragma prefast(suppress : 26135, "Adding lock annotation spills into entire project. Future work.")
 void CONSOLE_INFORMATION::LockConsole()
 {
-    EnterCriticalSection(&_csConsoleLock);
+    // Only time the acquisition when we actually have to wait, to keep the common case cheap.
+    if (!TryEnterCriticalSection(&_csConsoleLock))
+    {
+        const auto start = std::chrono::steady_clock::now();
+        EnterCriticalSection(&_csConsoleLock);
+        ApiMetrics::s_AddLockWait(std::chrono::steady_clock::now() - start);
+    }
 }
 
 #pragma prefast(suppress : 26135, "Adding lock annotation spills into entire project. Future work.")
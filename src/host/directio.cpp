@@ -461,6 +461,37 @@ void EventsToUnicode(_Inout_ std::deque<std::unique_ptr<IInputEvent>>& inEvents,
     return _WriteConsoleInputWImplHelper(*pInputBuffer, events, eventsWritten, append);
 }
 
+// Routine Description:
+// - Writes records to the input buffer without wrapping them in IInputEvents (private call)
+// Arguments:
+// - context - the input buffer to write to
+// - records - the records to written
+// - written  - on output, the number of events written
+// - append - true if events should be written to the end of the input
+// buffer, false if they should be written to the front
+// Return Value:
+// - HRESULT indicating success or failure
+[[nodiscard]] HRESULT DoSrvPrivateWriteConsoleInputW(_Inout_ InputBuffer* const pInputBuffer,
+                                                     const gsl::span<const INPUT_RECORD> records,
+                                                     _Out_ size_t& eventsWritten,
+                                                     const bool append) noexcept
+{
+    try
+    {
+        if (append)
+        {
+            eventsWritten = pInputBuffer->Write(records);
+        }
+        else
+        {
+            eventsWritten = pInputBuffer->Prepend(records);
+        }
+
+        return S_OK;
+    }
+    CATCH_RETURN();
+}
+
 // Routine Description:
 // - Writes events to the input buffer, translating from codepage to unicode first
 // Arguments:
@@ -527,9 +558,18 @@ void EventsToUnicode(_Inout_ std::deque<std::unique_ptr<IInputEvent>>& inEvents,
 
     try
     {
-        auto events = IInputEvent::Create(buffer);
+        // The records go straight into the input buffer's storage,
+        // without being wrapped in an IInputEvent one by one.
+        if (append)
+        {
+            written = context.Write(buffer);
+        }
+        else
+        {
+            written = context.Prepend(buffer);
+        }
 
-        return _WriteConsoleInputWImplHelper(context, events, written, append);
+        return S_OK;
     }
     CATCH_RETURN();
 }
@@ -17,6 +17,188 @@ using Microsoft::Console::Interactivity::ServiceLocator;
 using Microsoft::Console::VirtualTerminal::TerminalInput;
 using namespace Microsoft::Console;
 
+// The smallest allocation the ring makes, and the largest one it will
+// keep around once it has been drained. Anything in between is reused,
+// so typing never allocates while a paste only grows the ring once.
+static constexpr size_t INPUT_RING_MIN_CAPACITY = 64;
+static constexpr size_t INPUT_RING_MAX_RETAINED_CAPACITY = 4096;
+
+bool InputRecordRing::empty() const noexcept
+{
+    return _size == 0;
+}
+
+size_t InputRecordRing::size() const noexcept
+{
+    return _size;
+}
+
+INPUT_RECORD& InputRecordRing::operator[](const size_t index) noexcept
+{
+    return _buffer[(_head + index) & (_capacity - 1)];
+}
+
+const INPUT_RECORD& InputRecordRing::operator[](const size_t index) const noexcept
+{
+    return _buffer[(_head + index) & (_capacity - 1)];
+}
+
+INPUT_RECORD& InputRecordRing::front() noexcept
+{
+    return (*this)[0];
+}
+
+INPUT_RECORD& InputRecordRing::back() noexcept
+{
+    return (*this)[_size - 1];
+}
+
+// Routine Description:
+// - Appends a single record to the end of the ring.
+// Arguments:
+// - record - the record to store
+// Return Value:
+// - <none>
+void InputRecordRing::push_back(const INPUT_RECORD& record)
+{
+    _Reserve(_size + 1);
+    (*this)[_size] = record;
+    ++_size;
+}
+
+// Routine Description:
+// - Appends records to the end of the ring, copying them in at most two
+//   contiguous chunks.
+// Arguments:
+// - records - the records to store
+// Return Value:
+// - <none>
+void InputRecordRing::append(const gsl::span<const INPUT_RECORD> records)
+{
+    const auto count = gsl::narrow_cast<size_t>(records.size());
+    if (count == 0)
+    {
+        return;
+    }
+    _Reserve(_size + count);
+
+    const auto tail = (_head + _size) & (_capacity - 1);
+    const auto firstChunk = std::min(count, _capacity - tail);
+    std::copy_n(records.data(), firstChunk, _buffer.get() + tail);
+    std::copy_n(records.data() + firstChunk, count - firstChunk, _buffer.get());
+    _size += count;
+}
+
+// Routine Description:
+// - Inserts records in front of the ones already in the ring, keeping
+//   their order.
+// Arguments:
+// - records - the records to store
+// Return Value:
+// - <none>
+void InputRecordRing::prepend(const gsl::span<const INPUT_RECORD> records)
+{
+    const auto count = gsl::narrow_cast<size_t>(records.size());
+    if (count == 0)
+    {
+        return;
+    }
+    _Reserve(_size + count);
+
+    _head = (_head - count) & (_capacity - 1);
+    const auto firstChunk = std::min(count, _capacity - _head);
+    std::copy_n(records.data(), firstChunk, _buffer.get() + _head);
+    std::copy_n(records.data() + firstChunk, count - firstChunk, _buffer.get());
+    _size += count;
+}
+
+// Routine Description:
+// - Drops records from the front of the ring.
+// Arguments:
+// - count - the number of records to drop. Must not exceed size().
+// Return Value:
+// - <none>
+void InputRecordRing::pop_front(const size_t count) noexcept
+{
+    _head = (_head + count) & (_capacity - 1);
+    _size -= count;
+    if (_size == 0)
+    {
+        _head = 0;
+    }
+}
+
+// Routine Description:
+// - Copies all records in the ring, oldest first, to the end of records.
+// Arguments:
+// - records - where to copy the records to
+// Return Value:
+// - <none>
+void InputRecordRing::copy_to(std::vector<INPUT_RECORD>& records) const
+{
+    records.reserve(records.size() + _size);
+    const auto firstChunk = std::min(_size, _capacity - _head);
+    records.insert(records.end(), _buffer.get() + _head, _buffer.get() + _head + firstChunk);
+    records.insert(records.end(), _buffer.get(), _buffer.get() + (_size - firstChunk));
+}
+
+void InputRecordRing::clear() noexcept
+{
+    _head = 0;
+    _size = 0;
+}
+
+// Routine Description:
+// - Frees the storage of an empty ring that grew past what is worth keeping
+//   around, usually because a large paste went through it.
+// Arguments:
+// - <none>
+// Return Value:
+// - <none>
+void InputRecordRing::shrink() noexcept
+{
+    if (_size == 0 && _capacity > INPUT_RING_MAX_RETAINED_CAPACITY)
+    {
+        _buffer.reset();
+        _capacity = 0;
+        _head = 0;
+    }
+}
+
+// Routine Description:
+// - Grows the ring to hold at least capacity records, unwrapping the stored
+//   records to the start of the new allocation.
+// Arguments:
+// - capacity - the number of records the ring needs to hold
+// Return Value:
+// - <none>
+void InputRecordRing::_Reserve(const size_t capacity)
+{
+    if (capacity <= _capacity)
+    {
+        return;
+    }
+
+    auto newCapacity = std::max(_capacity, INPUT_RING_MIN_CAPACITY);
+    while (newCapacity < capacity)
+    {
+        THROW_HR_IF(E_OUTOFMEMORY, newCapacity > SIZE_MAX / 2 / sizeof(INPUT_RECORD));
+        newCapacity *= 2;
+    }
+
+    auto newBuffer = std::make_unique<INPUT_RECORD[]>(newCapacity);
+    if (_size != 0)
+    {
+        const auto firstChunk = std::min(_size, _capacity - _head);
+        std::copy_n(_buffer.get() + _head, firstChunk, newBuffer.get());
+        std::copy_n(_buffer.get(), _size - firstChunk, newBuffer.get() + firstChunk);
+    }
+
+    _buffer = std::move(newBuffer);
+    _capacity = newCapacity;
+    _head = 0;
+}
+
 // Routine Description:
 // - This method creates an input buffer.
 // Arguments:
@@ -201,6 +383,7 @@ size_t InputBuffer::GetNumberOfReadyEvents() const noexcept
 void InputBuffer::Flush()
 {
     _storage.clear();
+    _storage.shrink();
     ServiceLocator::LocateGlobals().hInputEvent.ResetEvent();
 }
 
@@ -214,10 +397,9 @@ void InputBuffer::Flush()
 // - The console lock must be held when calling this routine.
 void InputBuffer::FlushAllButKeys()
 {
-    auto newEnd = std::remove_if(_storage.begin(), _storage.end(), [](const std::unique_ptr<IInputEvent>& event) {
-        return event->EventType() != InputEventType::KeyEvent;
+    _storage.remove_if([](const INPUT_RECORD& record) noexcept {
+        return record.EventType != KEY_EVENT;
     });
-    _storage.erase(newEnd, _storage.end());
 }
 
 void InputBuffer::SetTerminalConnection(_In_ ITerminalOutputConnection* const pTtyConnection)
@@ -263,6 +445,99 @@ void InputBuffer::PassThroughWin32MouseRequest(bool enable)
                                          const bool WaitForData,
                                          const bool Unicode,
                                          const bool Stream)
+{
+    try
+    {
+        std::vector<INPUT_RECORD> records;
+        const auto Status = Read(records,
+                                 AmountToRead,
+                                 Peek,
+                                 WaitForData,
+                                 Unicode,
+                                 Stream);
+
+        for (const auto& record : records)
+        {
+            OutEvents.push_back(IInputEvent::Create(record));
+        }
+        return Status;
+    }
+    catch (...)
+    {
+        return NTSTATUS_FROM_HRESULT(wil::ResultFromCaughtException());
+    }
+}
+
+// Routine Description:
+// - This routine reads a single event from the input buffer.
+// - It can convert returned data to through the currently set Input CP, it can optionally return a wait condition
+//   if there isn't enough data in the buffer, and it can be set to not remove records as it reads them out.
+// Note:
+// - The console lock must be held when calling this routine.
+// Arguments:
+// - outEvent - where the read event is stored
+// - Peek - If true, copy events to pInputRecord but don't remove them from the input buffer.
+// - WaitForData - if true, wait until an event is input (if there aren't enough to fill client buffer). if false, return immediately
+// - Unicode - true if the data in key events should be treated as unicode. false if they should be converted by the current input CP.
+// - Stream - true if read should unpack KeyEvents that have a >1 repeat count.
+// Return Value:
+// - STATUS_SUCCESS if records were read into the client buffer and everything is OK.
+// - CONSOLE_STATUS_WAIT if there weren't enough records to satisfy the request (and waits are allowed)
+// - otherwise a suitable memory/math/string error in NTSTATUS form.
+[[nodiscard]] NTSTATUS InputBuffer::Read(_Out_ std::unique_ptr<IInputEvent>& outEvent,
+                                         const bool Peek,
+                                         const bool WaitForData,
+                                         const bool Unicode,
+                                         const bool Stream)
+{
+    // A single event takes up a single slot no matter its width,
+    // so a unicode read doesn't change what gets read here.
+    UNREFERENCED_PARAMETER(Unicode);
+
+    NTSTATUS Status;
+    try
+    {
+        std::optional<INPUT_RECORD> record;
+        Status = Read(record,
+                      Peek,
+                      WaitForData,
+                      Stream);
+        if (record)
+        {
+            outEvent = IInputEvent::Create(*record);
+        }
+    }
+    catch (...)
+    {
+        Status = NTSTATUS_FROM_HRESULT(wil::ResultFromCaughtException());
+    }
+
+    return Status;
+}
+
+// Routine Description:
+// - This routine reads records from the input buffer without wrapping each of them in an IInputEvent.
+// - It can convert returned data to through the currently set Input CP, it can optionally return a wait condition
+//   if there isn't enough data in the buffer, and it can be set to not remove records as it reads them out.
+// Note:
+// - The console lock must be held when calling this routine.
+// Arguments:
+// - outRecords - the read records are appended to this vector
+// - AmountToRead - the amount of events to try to read
+// - Peek - If true, copy events to pInputRecord but don't remove them from the input buffer.
+// - WaitForData - if true, wait until an event is input (if there aren't enough to fill client buffer). if false, return immediately
+// - Unicode - true if the data in key events should be treated as unicode. false if they should be converted by the current input CP.
+// - Stream - true if read should unpack KeyEvents that have a >1 repeat count. AmountToRead must be 1 if Stream is true.
+// Return Value:
+// - STATUS_SUCCESS if records were read into the client buffer and everything is OK.
+// - CONSOLE_STATUS_WAIT if there weren't enough records to satisfy the request (and waits are allowed)
+// - otherwise a suitable memory/math/string error in NTSTATUS form.
+[[nodiscard]] NTSTATUS InputBuffer::Read(_Inout_ std::vector<INPUT_RECORD>& outRecords,
+                                         const size_t AmountToRead,
+                                         const bool Peek,
+                                         const bool WaitForData,
+                                         const bool Unicode,
+                                         const bool Stream)
 {
     try
     {
@@ -276,10 +551,9 @@ void InputBuffer::PassThroughWin32MouseRequest(bool enable)
         }
 
         // read from buffer
-        std::deque<std::unique_ptr<IInputEvent>> events;
         size_t eventsRead;
         bool resetWaitEvent;
-        _ReadBuffer(events,
+        _ReadBuffer(outRecords,
                     AmountToRead,
                     eventsRead,
                     Peek,
@@ -287,13 +561,6 @@ void InputBuffer::PassThroughWin32MouseRequest(bool enable)
                     Unicode,
                     Stream);
 
-        // copy events to outEvents
-        while (!events.empty())
-        {
-            OutEvents.push_back(std::move(events.front()));
-            events.pop_front();
-        }
-
         if (resetWaitEvent)
         {
             ServiceLocator::LocateGlobals().hInputEvent.ResetEvent();
@@ -307,54 +574,90 @@ void InputBuffer::PassThroughWin32MouseRequest(bool enable)
 }
 
 // Routine Description:
-// - This routine reads a single event from the input buffer.
-// - It can convert returned data to through the currently set Input CP, it can optionally return a wait condition
-//   if there isn't enough data in the buffer, and it can be set to not remove records as it reads them out.
+// - This routine reads a single record from the input buffer without wrapping it in an IInputEvent.
+// - It can optionally return a wait condition if the buffer is empty, and it can be set to not remove
+//   the record as it reads it out.
 // Note:
 // - The console lock must be held when calling this routine.
 // Arguments:
-// - outEvent - where the read event is stored
-// - Peek - If true, copy events to pInputRecord but don't remove them from the input buffer.
-// - WaitForData - if true, wait until an event is input (if there aren't enough to fill client buffer). if false, return immediately
-// - Unicode - true if the data in key events should be treated as unicode. false if they should be converted by the current input CP.
+// - outRecord - where the read record is stored. Left empty if there was nothing to read.
+// - Peek - If true, copy the record but don't remove it from the input buffer.
+// - WaitForData - if true, wait until an event is input (if the buffer is empty). if false, return immediately
 // - Stream - true if read should unpack KeyEvents that have a >1 repeat count.
 // Return Value:
-// - STATUS_SUCCESS if records were read into the client buffer and everything is OK.
-// - CONSOLE_STATUS_WAIT if there weren't enough records to satisfy the request (and waits are allowed)
-// - otherwise a suitable memory/math/string error in NTSTATUS form.
-[[nodiscard]] NTSTATUS InputBuffer::Read(_Out_ std::unique_ptr<IInputEvent>& outEvent,
+// - STATUS_SUCCESS if a record was read or the buffer was empty and waiting wasn't allowed.
+// - CONSOLE_STATUS_WAIT if the buffer was empty (and waits are allowed)
+[[nodiscard]] NTSTATUS InputBuffer::Read(_Out_ std::optional<INPUT_RECORD>& outRecord,
                                          const bool Peek,
                                          const bool WaitForData,
-                                         const bool Unicode,
                                          const bool Stream)
 {
-    NTSTATUS Status;
-    try
+    outRecord.reset();
+
+    if (_storage.empty())
     {
-        std::deque<std::unique_ptr<IInputEvent>> outEvents;
-        Status = Read(outEvents,
-                      1,
-                      Peek,
-                      WaitForData,
-                      Unicode,
-                      Stream);
-        if (!outEvents.empty())
+        if (!WaitForData)
         {
-            outEvent.swap(outEvents.front());
+            return STATUS_SUCCESS;
         }
+        return CONSOLE_STATUS_WAIT;
     }
-    catch (...)
+
+    INPUT_RECORD record;
+    if (_ReadRecord(0, Peek, Stream, record) && !Peek)
     {
-        Status = NTSTATUS_FROM_HRESULT(wil::ResultFromCaughtException());
+        _storage.pop_front(1);
     }
+    outRecord = record;
 
-    return Status;
+    // signal if we emptied the buffer
+    if (_storage.empty())
+    {
+        _storage.shrink();
+        ServiceLocator::LocateGlobals().hInputEvent.ResetEvent();
+    }
+    return STATUS_SUCCESS;
+}
+
+// Routine Description:
+// - Copies a record out of the storage for a read.
+// Arguments:
+// - index - the position of the record in the storage
+// - peek - if true, don't modify the stored record
+// - streamRead - true if a key event with a >1 repeat count should be split
+// - outRecord - the record that was read
+// Return Value:
+// - true if the whole record was read and can be removed from the storage,
+//   false if only part of its repeat count was.
+bool InputBuffer::_ReadRecord(const size_t index,
+                              const bool peek,
+                              const bool streamRead,
+                              _Out_ INPUT_RECORD& outRecord) noexcept
+{
+    auto& record = _storage[index];
+    outRecord = record;
+
+    // for stream reads we need to split any key events that have been coalesced.
+    // A peek leaves the stored repeat count alone, which is equivalent to splitting
+    // the event off and coalescing it right back.
+    if (streamRead &&
+        record.EventType == KEY_EVENT &&
+        record.Event.KeyEvent.wRepeatCount > 1)
+    {
+        outRecord.Event.KeyEvent.wRepeatCount = 1;
+        if (!peek)
+        {
+            --record.Event.KeyEvent.wRepeatCount;
+        }
+        return false;
+    }
+    return true;
 }
 
 // Routine Description:
 // - This routine reads from a buffer. It does the buffer manipulation.
 // Arguments:
-// - outEvents - where read events are placed
+// - outRecords - where read records are appended
 // - readCount - amount of events to read
 // - eventsRead - where to store number of events read
 // - peek - if true , don't remove data from buffer, just copy it.
@@ -365,7 +668,7 @@ void InputBuffer::PassThroughWin32MouseRequest(bool enable)
 // - <none>
 // Note:
 // - The console lock must be held when calling this routine.
-void InputBuffer::_ReadBuffer(_Out_ std::deque<std::unique_ptr<IInputEvent>>& outEvents,
+void InputBuffer::_ReadBuffer(_Inout_ std::vector<INPUT_RECORD>& outRecords,
                               const size_t readCount,
                               _Out_ size_t& eventsRead,
                               const bool peek,
@@ -379,98 +682,47 @@ void InputBuffer::_ReadBuffer(_Out_ std::deque<std::unique_ptr<IInputEvent>>& ou
 
     resetWaitEvent = false;
 
-    std::deque<std::unique_ptr<IInputEvent>> readEvents;
+    const auto initialOutSize = outRecords.size();
     // we need another var to keep track of how many we've read
     // because dbcs records count for two when we aren't doing a
     // unicode read but the eventsRead count should return the number
     // of events actually put into outRecords.
     size_t virtualReadCount = 0;
+    // the number of records that are consumed from the front of storage
+    size_t consumed = 0;
 
-    while (!_storage.empty() && virtualReadCount < readCount)
+    while (consumed < _storage.size() && virtualReadCount < readCount)
     {
-        bool performNormalRead = true;
-        // for stream reads we need to split any key events that have been coalesced
-        if (streamRead)
+        if (_ReadRecord(consumed, peek, streamRead, outRecords.emplace_back()))
         {
-            if (_storage.front()->EventType() == InputEventType::KeyEvent)
-            {
-                KeyEvent* const pKeyEvent = static_cast<KeyEvent* const>(_storage.front().get());
-                if (pKeyEvent->GetRepeatCount() > 1)
-                {
-                    // split the key event
-                    std::unique_ptr<KeyEvent> streamKeyEvent = std::make_unique<KeyEvent>(*pKeyEvent);
-                    streamKeyEvent->SetRepeatCount(1);
-                    readEvents.push_back(std::move(streamKeyEvent));
-                    pKeyEvent->SetRepeatCount(pKeyEvent->GetRepeatCount() - 1);
-                    performNormalRead = false;
-                }
-            }
-        }
-
-        if (performNormalRead)
-        {
-            readEvents.push_back(std::move(_storage.front()));
-            _storage.pop_front();
+            ++consumed;
         }
 
         ++virtualReadCount;
         if (!unicode)
         {
-            if (readEvents.back()->EventType() == InputEventType::KeyEvent)
+            const auto& readRecord = outRecords.back();
+            if (readRecord.EventType == KEY_EVENT &&
+                IsGlyphFullWidth(readRecord.Event.KeyEvent.uChar.UnicodeChar))
             {
-                const KeyEvent* const pKeyEvent = static_cast<const KeyEvent* const>(readEvents.back().get());
-                if (IsGlyphFullWidth(pKeyEvent->GetCharData()))
-                {
-                    ++virtualReadCount;
-                }
+                ++virtualReadCount;
             }
         }
     }
 
     // the amount of events that were actually read
-    eventsRead = readEvents.size();
-
-    // copy the events back if we were supposed to peek
-    if (peek)
-    {
-        if (streamRead)
-        {
-            // we need to check and see if the event was split from a coalesced key event
-            // or if it was unrelated to the current front event in storage
-            if (!readEvents.empty() &&
-                !_storage.empty() &&
-                readEvents.back()->EventType() == InputEventType::KeyEvent &&
-                _storage.front()->EventType() == InputEventType::KeyEvent &&
-                _CanCoalesce(static_cast<const KeyEvent&>(*readEvents.back()),
-                             static_cast<const KeyEvent&>(*_storage.front())))
-            {
-                KeyEvent& keyEvent = static_cast<KeyEvent&>(*_storage.front());
-                keyEvent.SetRepeatCount(keyEvent.GetRepeatCount() + 1);
-            }
-            else
-            {
-                _storage.push_front(IInputEvent::Create(readEvents.back()->ToInputRecord()));
-            }
-        }
-        else
-        {
-            for (auto it = readEvents.crbegin(); it != readEvents.crend(); ++it)
-            {
-                _storage.push_front(IInputEvent::Create((*it)->ToInputRecord()));
-            }
-        }
-    }
+    eventsRead = outRecords.size() - initialOutSize;
 
-    // move events read to proper deque
-    while (!readEvents.empty())
+    // only remove the events if we weren't supposed to peek
+    if (!peek)
     {
-        outEvents.push_back(std::move(readEvents.front()));
-        readEvents.pop_front();
+        _storage.pop_front(consumed);
     }
 
     // signal if we emptied the buffer
     if (_storage.empty())
     {
+        _storage.shrink();
         resetWaitEvent = true;
     }
 }
@@ -485,13 +737,37 @@ void InputBuffer::_ReadBuffer(_Out_ std::deque<std::unique_ptr<IInputEvent>>& ou
 // Note:
 // - The console lock must be held when calling this routine.
 size_t InputBuffer::Prepend(_Inout_ std::deque<std::unique_ptr<IInputEvent>>& inEvents)
+{
+    try
+    {
+        const auto inRecords = IInputEvent::ToInputRecords(inEvents);
+        inEvents.clear();
+        return Prepend(inRecords);
+    }
+    catch (...)
+    {
+        LOG_HR(wil::ResultFromCaughtException());
+        return 0;
+    }
+}
+
+// Routine Description:
+// -  Writes records to the beginning of the input buffer.
+// Arguments:
+// - inRecords - records to write to buffer.
+// Return Value:
+// - The number of events that were written to the input buffer.
+// Note:
+// - The console lock must be held when calling this routine.
+size_t InputBuffer::Prepend(const gsl::span<const INPUT_RECORD> inRecords)
 {
     try
     {
         _vtInputShouldSuppress = true;
         auto resetVtInputSuppress = wil::scope_exit([&]() { _vtInputShouldSuppress = false; });
-        _HandleConsoleSuspensionEvents(inEvents);
-        if (inEvents.empty())
+        std::vector<INPUT_RECORD> keptRecords;
+        const auto records = _HandleConsoleSuspensionEvents(inRecords, keptRecords);
+        if (records.empty())
         {
             return STATUS_SUCCESS;
         }
@@ -500,18 +776,19 @@ size_t InputBuffer::Prepend(_Inout_ std::deque<std::unique_ptr<IInputEvent>>& in
         // this way to handle any coalescing that might occur.
 
         // get all of the existing records, "emptying" the buffer
-        std::deque<std::unique_ptr<IInputEvent>> existingStorage;
-        existingStorage.swap(_storage);
+        std::vector<INPUT_RECORD> existingStorage;
+        _storage.copy_to(existingStorage);
+        _storage.clear();
 
         // We will need this variable to pass to _WriteBuffer so it can attempt to determine wait status.
-        // However, because we swapped the storage out from under it with an empty deque, it will always
-        // return true after the first one (as it is filling the newly emptied backing deque.)
+        // However, because we emptied the storage out from under it, it will always
+        // return true after the first one (as it is filling the newly emptied storage.)
         // Then after the second one, because we've inserted some input, it will always say false.
         bool unusedWaitStatus = false;
 
         // write the prepend records
         size_t prependEventsWritten;
-        _WriteBuffer(inEvents, prependEventsWritten, unusedWaitStatus);
+        _WriteBuffer(records, prependEventsWritten, unusedWaitStatus);
         FAIL_FAST_IF(!(unusedWaitStatus));
 
         // write all previously existing records
@@ -524,7 +801,7 @@ size_t InputBuffer::Prepend(_Inout_ std::deque<std::unique_ptr<IInputEvent>>& in
         // Because we did interesting manipulation of the wait queue
         // in order to prepend, we can't trust what _WriteBuffer said
         // and instead need to set the event if the original backing
-        // buffer (the one we swapped out at the top) was empty
+        // buffer (the one we copied out at the top) was empty
         // when this whole thing started.
         if (existingStorage.empty())
         {
@@ -556,9 +833,9 @@ size_t InputBuffer::Write(_Inout_ std::unique_ptr<IInputEvent> inEvent)
 {
     try
     {
-        std::deque<std::unique_ptr<IInputEvent>> inEvents;
-        inEvents.push_back(std::move(inEvent));
-        return Write(inEvents);
+        const auto record = inEvent->ToInputRecord();
+        inEvent.reset();
+        return Write(gsl::make_span(&record, 1));
     }
     catch (...)
     {
@@ -577,13 +854,38 @@ size_t InputBuffer::Write(_Inout_ std::unique_ptr<IInputEvent> inEvent)
 // Note:
 // - The console lock must be held when calling this routine.
 size_t InputBuffer::Write(_Inout_ std::deque<std::unique_ptr<IInputEvent>>& inEvents)
+{
+    try
+    {
+        const auto inRecords = IInputEvent::ToInputRecords(inEvents);
+        inEvents.clear();
+        return Write(inRecords);
+    }
+    catch (...)
+    {
+        LOG_HR(wil::ResultFromCaughtException());
+        return 0;
+    }
+}
+
+// Routine Description:
+// - Writes records to the input buffer. Wakes up any readers that are
+// waiting for additional input events.
+// Arguments:
+// - inRecords - input records to store in the buffer.
+// Return Value:
+// - The number of events that were written to input buffer.
+// Note:
+// - The console lock must be held when calling this routine.
+size_t InputBuffer::Write(const gsl::span<const INPUT_RECORD> inRecords)
 {
     try
     {
         _vtInputShouldSuppress = true;
         auto resetVtInputSuppress = wil::scope_exit([&]() { _vtInputShouldSuppress = false; });
-        _HandleConsoleSuspensionEvents(inEvents);
-        if (inEvents.empty())
+        std::vector<INPUT_RECORD> keptRecords;
+        const auto records = _HandleConsoleSuspensionEvents(inRecords, keptRecords);
+        if (records.empty())
         {
             return 0;
         }
@@ -591,7 +893,7 @@ size_t InputBuffer::Write(_Inout_ std::deque<std::unique_ptr<IInputEvent>>& inEv
         // Write to buffer.
         size_t EventsWritten;
         bool SetWaitEvent;
-        _WriteBuffer(inEvents, EventsWritten, SetWaitEvent);
+        _WriteBuffer(records, EventsWritten, SetWaitEvent);
 
         if (SetWaitEvent)
         {
@@ -610,9 +912,9 @@ size_t InputBuffer::Write(_Inout_ std::deque<std::unique_ptr<IInputEvent>>& inEv
 }
 
 // Routine Description:
-// - Coalesces input events and transfers them to storage queue.
+// - Coalesces input records and transfers them to storage queue.
 // Arguments:
-// - inRecords - The events to store.
+// - inRecords - The records to store.
 // - eventsWritten - The number of events written since this function
 // was called.
 // - setWaitEvent - on exit, true if buffer became non-empty.
@@ -621,77 +923,62 @@ size_t InputBuffer::Write(_Inout_ std::deque<std::unique_ptr<IInputEvent>>& inEv
 // Note:
 // - The console lock must be held when calling this routine.
 // - will throw on failure
-void InputBuffer::_WriteBuffer(_Inout_ std::deque<std::unique_ptr<IInputEvent>>& inEvents,
+void InputBuffer::_WriteBuffer(const gsl::span<const INPUT_RECORD> inRecords,
                                _Out_ size_t& eventsWritten,
                                _Out_ bool& setWaitEvent)
 {
     eventsWritten = 0;
     setWaitEvent = false;
     const bool initiallyEmptyQueue = _storage.empty();
-    const size_t initialInEventsSize = inEvents.size();
     const bool vtInputMode = IsInVirtualTerminalInputMode();
 
-    while (!inEvents.empty())
+    if (!vtInputMode && inRecords.size() != 1)
     {
-        // Pop the next event.
-        // If we're in vt mode, try and handle it with the vt input module.
-        // If it was handled, do nothing else for it.
-        // If there was one event passed in, try coalescing it with the previous event currently in the buffer.
-        // If it's not coalesced, append it to the buffer.
-        std::unique_ptr<IInputEvent> inEvent = std::move(inEvents.front());
-        inEvents.pop_front();
-        if (vtInputMode)
+        // Nothing gets translated or coalesced, so the whole batch
+        // can be copied into storage in one go.
+        _storage.append(inRecords);
+        eventsWritten = inRecords.size();
+    }
+    else
+    {
+        for (const auto& inRecord : inRecords)
         {
-            const bool handled = _termInput.HandleKey(inEvent.get());
-            if (handled)
+            // If we're in vt mode, try and handle it with the vt input module.
+            // If it was handled, do nothing else for it.
+            // If there was one event passed in, try coalescing it with the previous event currently in the buffer.
+            // If it's not coalesced, append it to the buffer.
+            if (vtInputMode && inRecord.EventType == KEY_EVENT)
             {
-                eventsWritten++;
-                continue;
+                const KeyEvent keyEvent{ inRecord.Event.KeyEvent };
+                const bool handled = _termInput.HandleKey(&keyEvent);
+                if (handled)
+                {
+                    eventsWritten++;
+                    continue;
+                }
             }
-        }
 
-        // we only check for possible coalescing when storing one
-        // record at a time because this is the original behavior of
-        // the input buffer. Changing this behavior may break stuff
-        // that was depending on it.
-        if (initialInEventsSize == 1 && !_storage.empty())
-        {
-            // coalescing requires a deque of events, so push it back onto the front.
-            inEvents.push_front(std::move(inEvent));
-
-            bool coalesced = false;
+            // we only check for possible coalescing when storing one
+            // record at a time because this is the original behavior of
+            // the input buffer. Changing this behavior may break stuff
+            // that was depending on it.
+            //
             // this looks kinda weird but we don't want to coalesce a
             // mouse event and then try to coalesce a key event right after.
-            //
-            // we also pass the whole deque to the coalescing methods
-            // even though they only want one event because it should
-            // be their responsibility to maintain the correct state
-            // of the deque if they process any records in it.
-            if (_CoalesceMouseMovedEvents(inEvents))
-            {
-                coalesced = true;
-            }
-            else if (_CoalesceRepeatedKeyPressEvents(inEvents))
-            {
-                coalesced = true;
-            }
-            if (coalesced)
+            if (inRecords.size() == 1 &&
+                !_storage.empty() &&
+                (_CoalesceMouseMovedEvents(inRecord) || _CoalesceRepeatedKeyPressEvents(inRecord)))
             {
                 eventsWritten = 1;
                 return;
             }
-            else
-            {
-                // We didn't coalesce the event. pull it from the queue again,
-                //  to keep the state consistent with the start of this block.
-                inEvent = std::move(inEvents.front());
-                inEvents.pop_front();
-            }
+
+            // At this point, the event was neither coalesced, nor processed by VT.
+            _storage.push_back(inRecord);
+            ++eventsWritten;
         }
-        // At this point, the event was neither coalesced, nor processed by VT.
-        _storage.push_back(std::move(inEvent));
-        ++eventsWritten;
     }
+
     if (initiallyEmptyQueue && !_storage.empty())
     {
         setWaitEvent = true;
@@ -699,42 +986,33 @@ void InputBuffer::_WriteBuffer(_Inout_ std::deque<std::unique_ptr<IInputEvent>>&
 }
 
 // Routine Description:
-// - Checks if the last saved event and the first event of inRecords are
-// both MOUSE_MOVED events. If they are, the last saved event is
-// updated with the new mouse position and the first event of inRecords is
-// dropped.
+// - Checks if the last saved event and inRecord are both MOUSE_MOVED
+// events. If they are, the last saved event is updated with the new
+// mouse position and inRecord doesn't need to be stored.
 // Arguments:
-// - inRecords - The incoming records to process.
+// - inRecord - The incoming record to process.
 // Return Value:
 // true if events were coalesced, false if they were not.
 // Note:
-// - The size of inRecords must be 1.
 // - Coalescing here means updating a record that already exists in
 // the buffer with updated values from an incoming event, instead of
 // storing the incoming event (which would make the original one
 // redundant/out of date with the most current state).
-bool InputBuffer::_CoalesceMouseMovedEvents(_Inout_ std::deque<std::unique_ptr<IInputEvent>>& inEvents)
+bool InputBuffer::_CoalesceMouseMovedEvents(const INPUT_RECORD& inRecord) noexcept
 {
-    FAIL_FAST_IF(!(inEvents.size() == 1));
     FAIL_FAST_IF(_storage.empty());
-    const IInputEvent* const pFirstInEvent = inEvents.front().get();
-    const IInputEvent* const pLastStoredEvent = _storage.back().get();
-    if (pFirstInEvent->EventType() == InputEventType::MouseEvent &&
-        pLastStoredEvent->EventType() == InputEventType::MouseEvent)
+    auto& lastRecord = _storage.back();
+    if (inRecord.EventType == MOUSE_EVENT &&
+        lastRecord.EventType == MOUSE_EVENT)
     {
-        const MouseEvent* const pInMouseEvent = static_cast<const MouseEvent* const>(pFirstInEvent);
-        const MouseEvent* const pLastMouseEvent = static_cast<const MouseEvent* const>(pLastStoredEvent);
+        const MouseEvent inMouseEvent{ inRecord.Event.MouseEvent };
+        const MouseEvent lastMouseEvent{ lastRecord.Event.MouseEvent };
 
-        if (pInMouseEvent->IsMouseMoveEvent() &&
-            pLastMouseEvent->IsMouseMoveEvent())
+        if (inMouseEvent.IsMouseMoveEvent() &&
+            lastMouseEvent.IsMouseMoveEvent())
         {
             // update mouse moved position
-            MouseEvent* const pMouseEvent = static_cast<MouseEvent* const>(_storage.back().release());
-            pMouseEvent->SetPosition(pInMouseEvent->GetPosition());
-            std::unique_ptr<IInputEvent> tempPtr(pMouseEvent);
-            tempPtr.swap(_storage.back());
-
-            inEvents.pop_front();
+            lastRecord.Event.MouseEvent.dwMousePosition = inRecord.Event.MouseEvent.dwMousePosition;
             return true;
         }
     }
@@ -767,44 +1045,35 @@ bool InputBuffer::_CanCoalesce(const KeyEvent& a, const KeyEvent& b) const noexc
 }
 
 // Routine Description::
-// - If the last input event saved and the first input event in inRecords
-// are both a keypress down event for the same key, update the repeat
-// count of the saved event and drop the first from inRecords.
+// - If the last input event saved and inRecord are both a keypress down
+// event for the same key, update the repeat count of the saved event
+// and report inRecord as stored.
 // Arguments:
-// - inRecords - The incoming records to process.
+// - inRecord - The incoming record to process.
 // Return Value:
 // true if events were coalesced, false if they were not.
 // Note:
-// - The size of inRecords must be 1.
 // - Coalescing here means updating a record that already exists in
 // the buffer with updated values from an incoming event, instead of
 // storing the incoming event (which would make the original one
 // redundant/out of date with the most current state).
-bool InputBuffer::_CoalesceRepeatedKeyPressEvents(_Inout_ std::deque<std::unique_ptr<IInputEvent>>& inEvents)
+bool InputBuffer::_CoalesceRepeatedKeyPressEvents(const INPUT_RECORD& inRecord) noexcept
 {
-    FAIL_FAST_IF(!(inEvents.size() == 1));
     FAIL_FAST_IF(_storage.empty());
-    const IInputEvent* const pFirstInEvent = inEvents.front().get();
-    const IInputEvent* const pLastStoredEvent = _storage.back().get();
-    if (pFirstInEvent->EventType() == InputEventType::KeyEvent &&
-        pLastStoredEvent->EventType() == InputEventType::KeyEvent)
-    {
-        const KeyEvent* const pInKeyEvent = static_cast<const KeyEvent* const>(pFirstInEvent);
-        const KeyEvent* const pLastKeyEvent = static_cast<const KeyEvent* const>(pLastStoredEvent);
-
-        if (pInKeyEvent->IsKeyDown() &&
-            pLastKeyEvent->IsKeyDown() &&
-            !IsGlyphFullWidth(pInKeyEvent->GetCharData()) &&
-            _CanCoalesce(*pInKeyEvent, *pLastKeyEvent))
+    auto& lastRecord = _storage.back();
+    if (inRecord.EventType == KEY_EVENT &&
+        lastRecord.EventType == KEY_EVENT)
+    {
+        const KeyEvent inKeyEvent{ inRecord.Event.KeyEvent };
+        const KeyEvent lastKeyEvent{ lastRecord.Event.KeyEvent };
+
+        if (inKeyEvent.IsKeyDown() &&
+            lastKeyEvent.IsKeyDown() &&
+            !IsGlyphFullWidth(inKeyEvent.GetCharData()) &&
+            _CanCoalesce(inKeyEvent, lastKeyEvent))
         {
             // increment repeat count
-            KeyEvent* const pKeyEvent = static_cast<KeyEvent* const>(_storage.back().release());
-            WORD repeatCount = pKeyEvent->GetRepeatCount() + pInKeyEvent->GetRepeatCount();
-            pKeyEvent->SetRepeatCount(repeatCount);
-            std::unique_ptr<IInputEvent> tempPtr(pKeyEvent);
-            tempPtr.swap(_storage.back());
-
-            inEvents.pop_front();
+            lastRecord.Event.KeyEvent.wRepeatCount += inKeyEvent.GetRepeatCount();
             return true;
         }
     }
@@ -814,42 +1083,61 @@ bool InputBuffer::_CoalesceRepeatedKeyPressEvents(_Inout_ std::deque<std::unique
 // Routine Description:
 // - Handles records that suspend/resume the console.
 // Arguments:
-// - records - records to check for pause/unpause events
+// - inRecords - records to check for pause/unpause events
+// - keptRecords - scratch storage for the records that remain, used only
+// if any of inRecords had to be dropped
 // Return Value:
-// - None
+// - The records that should be written to the buffer. This is either
+// inRecords itself or a view of keptRecords.
 // Note:
 // - The console lock must be held when calling this routine.
 // - will throw exception on error
-void InputBuffer::_HandleConsoleSuspensionEvents(_Inout_ std::deque<std::unique_ptr<IInputEvent>>& inEvents)
+gsl::span<const INPUT_RECORD> InputBuffer::_HandleConsoleSuspensionEvents(const gsl::span<const INPUT_RECORD> inRecords,
+                                                                          _Inout_ std::vector<INPUT_RECORD>& keptRecords)
 {
     CONSOLE_INFORMATION& gci = ServiceLocator::LocateGlobals().getConsoleInformation();
 
-    std::deque<std::unique_ptr<IInputEvent>> outEvents;
-    while (!inEvents.empty())
+    bool droppedAny = false;
+    for (auto it = inRecords.begin(); it != inRecords.end(); ++it)
     {
-        std::unique_ptr<IInputEvent> currEvent = std::move(inEvents.front());
-        inEvents.pop_front();
-        if (currEvent->EventType() == InputEventType::KeyEvent)
+        bool drop = false;
+        if (it->EventType == KEY_EVENT)
         {
-            const KeyEvent* const pKeyEvent = static_cast<const KeyEvent* const>(currEvent.get());
-            if (pKeyEvent->IsKeyDown())
+            const KeyEvent keyEvent{ it->Event.KeyEvent };
+            if (keyEvent.IsKeyDown())
             {
                 if (WI_IsFlagSet(gci.Flags, CONSOLE_SUSPENDED) &&
-                    !IsSystemKey(pKeyEvent->GetVirtualKeyCode()))
+                    !IsSystemKey(keyEvent.GetVirtualKeyCode()))
                 {
                     UnblockWriteConsole(CONSOLE_OUTPUT_SUSPENDED);
-                    continue;
+                    drop = true;
                 }
-                else if (WI_IsFlagSet(InputMode, ENABLE_LINE_INPUT) && pKeyEvent->IsPauseKey())
+                else if (WI_IsFlagSet(InputMode, ENABLE_LINE_INPUT) && keyEvent.IsPauseKey())
                 {
                     WI_SetFlag(gci.Flags, CONSOLE_SUSPENDED);
-                    continue;
+                    drop = true;
                 }
             }
         }
-        outEvents.push_back(std::move(currEvent));
+
+        if (drop && !droppedAny)
+        {
+            // Most writes don't contain any of these, so we only start
+            // copying records once the first one has to be dropped.
+            droppedAny = true;
+            keptRecords.assign(inRecords.begin(), it);
+        }
+        else if (!drop && droppedAny)
+        {
+            keptRecords.push_back(*it);
+        }
+    }
+
+    if (droppedAny)
+    {
+        return keptRecords;
     }
-    inEvents.swap(outEvents);
+    return inRecords;
 }
 
 // Routine Description:
@@ -877,9 +1165,8 @@ void InputBuffer::_HandleTerminalInputCallback(std::deque<std::unique_ptr<IInput
         // add all input events to the storage queue
         while (!inEvents.empty())
         {
-            std::unique_ptr<IInputEvent> inEvent = std::move(inEvents.front());
+            _storage.push_back(inEvents.front()->ToInputRecord());
             inEvents.pop_front();
-            _storage.push_back(std::move(inEvent));
         }
 
         if (!_vtInputShouldSuppress)
@@ -30,6 +30,54 @@ Revision History:
 
 #include <deque>
 
+// A growable ring of INPUT_RECORDs. Records are stored by value in one
+// contiguous allocation, so writing, reading and prepending input only
+// copies records around instead of allocating an object per event.
+class InputRecordRing final
+{
+public:
+    InputRecordRing() = default;
+
+    bool empty() const noexcept;
+    size_t size() const noexcept;
+
+    INPUT_RECORD& operator[](const size_t index) noexcept;
+    const INPUT_RECORD& operator[](const size_t index) const noexcept;
+    INPUT_RECORD& front() noexcept;
+    INPUT_RECORD& back() noexcept;
+
+    void push_back(const INPUT_RECORD& record);
+    void append(const gsl::span<const INPUT_RECORD> records);
+    void prepend(const gsl::span<const INPUT_RECORD> records);
+    void pop_front(const size_t count) noexcept;
+    void copy_to(std::vector<INPUT_RECORD>& records) const;
+    void clear() noexcept;
+    void shrink() noexcept;
+
+    template<typename Predicate>
+    void remove_if(Predicate pred)
+    {
+        size_t kept = 0;
+        for (size_t i = 0; i < _size; ++i)
+        {
+            const auto& record = (*this)[i];
+            if (!pred(record))
+            {
+                (*this)[kept++] = record;
+            }
+        }
+        _size = kept;
+    }
+
+private:
+    void _Reserve(const size_t capacity);
+
+    std::unique_ptr<INPUT_RECORD[]> _buffer;
+    size_t _capacity{ 0 }; // always 0 or a power of two
+    size_t _head{ 0 };
+    size_t _size{ 0 };
+};
+
 class InputBuffer final : public ConsoleObjectHeader
 {
 public:
@@ -70,10 +118,24 @@ public:
                                 const bool Unicode,
                                 const bool Stream);
 
+    [[nodiscard]] NTSTATUS Read(_Inout_ std::vector<INPUT_RECORD>& outRecords,
+                                const size_t AmountToRead,
+                                const bool Peek,
+                                const bool WaitForData,
+                                const bool Unicode,
+                                const bool Stream);
+
+    [[nodiscard]] NTSTATUS Read(_Out_ std::optional<INPUT_RECORD>& outRecord,
+                                const bool Peek,
+                                const bool WaitForData,
+                                const bool Stream);
+
     size_t Prepend(_Inout_ std::deque<std::unique_ptr<IInputEvent>>& inEvents);
+    size_t Prepend(const gsl::span<const INPUT_RECORD> inRecords);
 
     size_t Write(_Inout_ std::unique_ptr<IInputEvent> inEvent);
     size_t Write(_Inout_ std::deque<std::unique_ptr<IInputEvent>>& inEvents);
+    size_t Write(const gsl::span<const INPUT_RECORD> inRecords);
 
     bool IsInVirtualTerminalInputMode() const;
     Microsoft::Console::VirtualTerminal::TerminalInput& GetTerminalInput();
@@ -81,7 +143,7 @@ public:
     void PassThroughWin32MouseRequest(bool enable);
 
 private:
-    std::deque<std::unique_ptr<IInputEvent>> _storage;
+    InputRecordRing _storage;
     std::unique_ptr<IInputEvent> _readPartialByteSequence;
     std::unique_ptr<IInputEvent> _writePartialByteSequence;
     Microsoft::Console::VirtualTerminal::TerminalInput _termInput;
@@ -93,7 +155,7 @@ private:
     // Otherwise, we should be calling them.
     bool _vtInputShouldSuppress{ false };
 
-    void _ReadBuffer(_Out_ std::deque<std::unique_ptr<IInputEvent>>& outEvents,
+    void _ReadBuffer(_Inout_ std::vector<INPUT_RECORD>& outRecords,
                      const size_t readCount,
                      _Out_ size_t& eventsRead,
                      const bool peek,
@@ -101,14 +163,20 @@ private:
                      const bool unicode,
                      const bool streamRead);
 
-    void _WriteBuffer(_Inout_ std::deque<std::unique_ptr<IInputEvent>>& inRecords,
+    bool _ReadRecord(const size_t index,
+                     const bool peek,
+                     const bool streamRead,
+                     _Out_ INPUT_RECORD& outRecord) noexcept;
+
+    void _WriteBuffer(const gsl::span<const INPUT_RECORD> inRecords,
                       _Out_ size_t& eventsWritten,
                       _Out_ bool& setWaitEvent);
 
     bool _CanCoalesce(const KeyEvent& a, const KeyEvent& b) const noexcept;
-    bool _CoalesceMouseMovedEvents(_Inout_ std::deque<std::unique_ptr<IInputEvent>>& inEvents);
-    bool _CoalesceRepeatedKeyPressEvents(_Inout_ std::deque<std::unique_ptr<IInputEvent>>& inEvents);
-    void _HandleConsoleSuspensionEvents(_Inout_ std::deque<std::unique_ptr<IInputEvent>>& inEvents);
+    bool _CoalesceMouseMovedEvents(const INPUT_RECORD& inRecord) noexcept;
+    bool _CoalesceRepeatedKeyPressEvents(const INPUT_RECORD& inRecord) noexcept;
+    gsl::span<const INPUT_RECORD> _HandleConsoleSuspensionEvents(const gsl::span<const INPUT_RECORD> inRecords,
+                                                                 _Inout_ std::vector<INPUT_RECORD>& keptRecords);
 
     void _HandleTerminalInputCallback(_In_ std::deque<std::unique_ptr<IInputEvent>>& inEvents);
 
@@ -226,6 +226,25 @@ bool ConhostInternalGetSet::PrivateWriteConsoleInputW(std::deque<std::unique_ptr
                                                     true)); // append
 }
 
+// Routine Description:
+// - Connects the WriteConsoleInput API call directly into our Driver Message servicing call inside Conhost.exe
+// Arguments:
+// - records - the input records to be copied into the tail of the input
+//            buffer for the underlying attached process
+// - eventsWritten - on output, the number of events written
+// Return Value:
+// - true if successful (see DoSrvWriteConsoleInput). false otherwise.
+bool ConhostInternalGetSet::PrivateWriteConsoleInputW(const gsl::span<const INPUT_RECORD> records,
+                                                      size_t& eventsWritten)
+{
+    eventsWritten = 0;
+
+    return SUCCEEDED(DoSrvPrivateWriteConsoleInputW(_io.GetActiveInputBuffer(),
+                                                    records,
+                                                    eventsWritten,
+                                                    true)); // append
+}
+
 // Routine Description:
 // - Connects the SetConsoleWindowInfo API call directly into our Driver Message servicing call inside Conhost.exe
 // Arguments:
@@ -46,8 +46,17 @@ COORD RenderData::GetTextBufferEndPosition() const noexcept
 // - Text buffer with cell information for display
 const TextBuffer& RenderData::GetTextBuffer() noexcept
 {
-    const CONSOLE_INFORMATION& gci = ServiceLocator::LocateGlobals().getConsoleInformation();
-    return gci.GetActiveOutputBuffer().GetTextBuffer();
+    CONSOLE_INFORMATION& gci = ServiceLocator::LocateGlobals().getConsoleInformation();
+    SCREEN_INFORMATION& screenInfo = gci.GetActiveOutputBuffer();
+    TextBuffer& textBuffer = screenInfo.GetTextBuffer();
+    // A resize may have left the scrollback to be reflowed later. The rows
+    // from the top of the viewport down are what gets presented.
+    try
+    {
+        textBuffer.ReflowScrollback(gsl::narrow_cast<size_t>(std::max<SHORT>(0, screenInfo.GetViewport().Top())));
+    }
+    CATCH_LOG();
+    return textBuffer;
 }
 
 // Routine Description:
@@ -353,6 +362,18 @@ const std::vector<size_t> RenderData::GetPatternId(const COORD /*location*/) con
     return {};
 }
 
+// Routine Description:
+// - Hands out the regions of the active buffer that were written to since the last call.
+// Arguments:
+// - regions - Receives the regions, exclusive and in buffer coordinates.
+// Return Value:
+// - <none>
+void RenderData::TakeDirtyRegions(std::vector<SMALL_RECT>& regions)
+{
+    CONSOLE_INFORMATION& gci = ServiceLocator::LocateGlobals().getConsoleInformation();
+    gci.GetActiveOutputBuffer().GetTextBuffer().TakeDirtyRegions(regions);
+}
+
 // Routine Description:
 // - Converts a text attribute into the RGB values that should be presented, applying
 //   relevant table translation information and preferences.
@@ -469,6 +490,23 @@ void RenderData::ColorSelection(const COORD coordSelectionStart, const COORD coo
     Selection::Instance().ColorSelection(coordSelectionStart, coordSelectionEnd, attr);
 }
 
+// Method Description:
+// - Lays out any scrollback a resize left to be reflowed later, so that
+//   the whole buffer can be read (e.g. by a search or a screen reader).
+// Arguments:
+// - <none>
+// Return Value:
+// - <none>
+void RenderData::ReflowScrollback() noexcept
+{
+    CONSOLE_INFORMATION& gci = ServiceLocator::LocateGlobals().getConsoleInformation();
+    try
+    {
+        gci.GetActiveOutputBuffer().GetTextBuffer().ReflowScrollback(0);
+    }
+    CATCH_LOG();
+}
+
 // Method Description:
 // - Returns true if the screen is globally inverted
 // Arguments:
@@ -60,6 +60,8 @@ public:
     const std::wstring GetHyperlinkCustomId(uint16_t id) const noexcept override;
 
     const std::vector<size_t> GetPatternId(const COORD location) const noexcept override;
+
+    void TakeDirtyRegions(std::vector<SMALL_RECT>& regions) override;
 #pragma endregion
 
 #pragma region IUiaData
@@ -71,5 +73,6 @@ public:
     const COORD GetSelectionEnd() const noexcept;
     void ColorSelection(const COORD coordSelectionStart, const COORD coordSelectionEnd, const TextAttribute attr);
     const bool IsUiaDataInitialized() const noexcept override { return true; }
+    void ReflowScrollback() noexcept override;
 #pragma endregion
 };
@@ -1459,7 +1459,10 @@ bool SCREEN_INFORMATION::IsMaximizedY() const
     // we're capturing _textBuffer by reference here because when we exit, we want to EndDefer on the current active buffer.
     auto endDefer = wil::scope_exit([&]() noexcept { _textBuffer->GetCursor().EndDeferDrawing(); });
 
-    HRESULT hr = TextBuffer::Reflow(*_textBuffer.get(), *newTextBuffer.get(), std::nullopt, std::nullopt);
+    // Only the rows from a screen above the viewport are reflowed right away.
+    // The ones above get reflowed once they're scrolled into view.
+    const SHORT eagerTop = _viewport.Top() - _viewport.Height();
+    HRESULT hr = TextBuffer::ReflowLazily(*_textBuffer.get(), *newTextBuffer.get(), std::nullopt, std::nullopt, eagerTop);
 
     if (SUCCEEDED(hr))
     {
@@ -1473,6 +1476,7 @@ bool SCREEN_INFORMATION::IsMaximizedY() const
         _textBuffer->SetCurrentAttributes(oldPrimaryAttributes);
 
         _textBuffer.swap(newTextBuffer);
+        _textBuffer->TakeReflowSource(std::move(newTextBuffer));
     }
 
     return NTSTATUS_FROM_HRESULT(hr);
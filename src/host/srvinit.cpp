@@ -931,6 +931,9 @@ PWSTR TranslateConsoleTitle(_In_ PCWSTR pwszConsoleTitle, const BOOL fUnexpand,
 // Routine Description:
 // - This routine is the main one in the console server IO thread.
 // - It reads IO requests submitted by clients through the driver, services and completes them in a loop.
+// - Every request costs one round trip to the driver: the reply to the previous request is handed back
+//   along with the read of the next one. ConDrvDeviceComm issues its IOCTLs without an OVERLAPPED,
+//   so there's never more than one read outstanding.
 // Arguments:
 // - lpParameter - PCONSOLE_API_MSG being handed off to us from the previous I/O.
 // Return Value:
@@ -0,0 +1,84 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+
+#include "precomp.h"
+#include "WexTestClass.h"
+#include "../../inc/consoletaeftemplates.hpp"
+
+#include "../../server/ApiMetrics.h"
+
+using namespace WEX::Common;
+using namespace WEX::Logging;
+using namespace WEX::TestExecution;
+using namespace std::chrono_literals;
+
+class ApiMetricsTests
+{
+    TEST_CLASS(ApiMetricsTests);
+
+    TEST_METHOD(BucketsCoverEveryDuration)
+    {
+        Log::Comment(L"Every duration falls into a bucket that's at most a quarter as wide as the duration itself.");
+        for (uint64_t value = 0; value < 1'000'000; value += 1 + value / 64)
+        {
+            const auto bucket = ApiMetrics::_BucketFromMicroseconds(value);
+            const auto upper = ApiMetrics::_BucketUpperBound(bucket);
+            const auto lower = bucket == 0 ? 0 : ApiMetrics::_BucketUpperBound(bucket - 1) + 1;
+            VERIFY_IS_LESS_THAN_OR_EQUAL(lower, value);
+            VERIFY_IS_GREATER_THAN_OR_EQUAL(upper, value);
+            VERIFY_IS_LESS_THAN_OR_EQUAL((upper - lower) * 4, std::max<uint64_t>(value, 4));
+        }
+
+        Log::Comment(L"Anything too large for the histogram ends up in the last bucket.");
+        VERIFY_ARE_EQUAL(ApiMetrics::BucketCount - 1, ApiMetrics::_BucketFromMicroseconds(UINT64_MAX));
+    }
+
+    TEST_METHOD(CallsOfAllThreadsAreSummarized)
+    {
+        // The last slot of the last layer isn't used by any API, so no other test records into it.
+        constexpr auto apiNumber = gsl::narrow_cast<ULONG>((ApiMetrics::LayerCount << 24) | (ApiMetrics::ApisPerLayer - 1));
+        constexpr auto name = "TestApi";
+
+        for (auto i = 0; i < 90; ++i)
+        {
+            ApiMetrics::s_Record(apiNumber, name, 10us, 1us, 100, 10);
+        }
+        std::thread other{ [&]() {
+            for (auto i = 0; i < 10; ++i)
+            {
+                ApiMetrics::s_Record(apiNumber, name, 5000us, 1us, 100, 10);
+            }
+        } };
+        other.join();
+
+        const auto summaries = ApiMetrics::s_Collect();
+        const auto summary = std::find_if(summaries.begin(), summaries.end(), [&](const auto& s) { return s.apiNumber == apiNumber; });
+        VERIFY_IS_TRUE(summary != summaries.end());
+
+        VERIFY_ARE_EQUAL(0, strcmp(name, summary->name));
+        VERIFY_ARE_EQUAL(uint64_t{ 100 }, summary->calls);
+        VERIFY_ARE_EQUAL(uint64_t{ 10000 }, summary->bytesIn);
+        VERIFY_ARE_EQUAL(uint64_t{ 1000 }, summary->bytesOut);
+        VERIFY_ARE_EQUAL(int64_t{ 50900 }, summary->totalTime.count());
+        VERIFY_ARE_EQUAL(int64_t{ 100 }, summary->lockWaitTime.count());
+
+        Log::Comment(L"Percentiles are reported as the upper bound of their bucket, but never above the maximum.");
+        VERIFY_ARE_EQUAL(int64_t{ 11 }, summary->p50.count());
+        VERIFY_ARE_EQUAL(int64_t{ 11 }, summary->p90.count());
+        VERIFY_ARE_EQUAL(int64_t{ 5000 }, summary->p99.count());
+        VERIFY_ARE_EQUAL(int64_t{ 5000 }, summary->max.count());
+    }
+
+    TEST_METHOD(LockWaitIsTrackedPerThread)
+    {
+        const auto before = ApiMetrics::s_GetLockWait();
+        ApiMetrics::s_AddLockWait(5ms);
+
+        std::thread other{ []() {
+            ApiMetrics::s_AddLockWait(1s);
+        } };
+        other.join();
+
+        VERIFY_IS_TRUE(ApiMetrics::s_GetLockWait() - before == 5ms);
+    }
+};
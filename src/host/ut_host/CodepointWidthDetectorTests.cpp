@@ -81,21 +81,157 @@ class CodepointWidthDetectorTests
         widthDetector.SetFallbackMethod(std::bind(&FallbackMethod, std::placeholders::_1));
 
         // Ensure fallback cache is empty.
-        VERIFY_ARE_EQUAL(0u, widthDetector._fallbackCache.size());
+        VERIFY_ARE_EQUAL(0u, widthDetector._fallbackCacheSize);
 
         // Lookup ambiguous width character.
         widthDetector.IsWide(ambiguous);
 
         // Cache should hold it.
-        VERIFY_ARE_EQUAL(1u, widthDetector._fallbackCache.size());
+        VERIFY_ARE_EQUAL(1u, widthDetector._fallbackCacheSize);
 
         // Cached item should match what we expect
-        const auto it = widthDetector._fallbackCache.begin();
-        VERIFY_ARE_EQUAL(ambiguous, it->first);
-        VERIFY_ARE_EQUAL(FallbackMethod(ambiguous), it->second);
+        const auto slot = widthDetector._findFallbackCacheSlot(widthDetector._extractCodepoint(ambiguous));
+        VERIFY_IS_NOT_NULL(slot);
+        VERIFY_ARE_EQUAL(0x414u, slot->codepoint);
+        VERIFY_ARE_EQUAL(FallbackMethod(ambiguous), slot->isWide);
 
         // Cache should empty when font changes.
         widthDetector.NotifyFontChanged();
-        VERIFY_ARE_EQUAL(0u, widthDetector._fallbackCache.size());
+        VERIFY_ARE_EQUAL(0u, widthDetector._fallbackCacheSize);
+        VERIFY_ARE_NOT_EQUAL(0x414u, widthDetector._findFallbackCacheSlot(0x414)->codepoint);
+    }
+
+    TEST_METHOD(AmbiguousCacheGrows)
+    {
+        // Count how often the detector has to fall back.
+        size_t fallbacks = 0;
+        CodepointWidthDetector widthDetector;
+        widthDetector.SetFallbackMethod([&](const std::wstring_view glyph) {
+            ++fallbacks;
+            return FallbackMethod(glyph.substr(1));
+        });
+
+        // The supplementary private use area is all ambiguous.
+        for (auto pass = 0; pass < 2; ++pass)
+        {
+            for (unsigned int codepoint = 0xF0000; codepoint < 0xF1000; ++codepoint)
+            {
+                const auto glyph = Encode(codepoint);
+                VERIFY_ARE_EQUAL(FallbackMethod(glyph.substr(1)), widthDetector.IsWide(glyph));
+            }
+        }
+
+        // Every codepoint was only looked up once, and still is in the cache.
+        VERIFY_ARE_EQUAL(0x1000u, fallbacks);
+        VERIFY_ARE_EQUAL(0x1000u, widthDetector._fallbackCacheSize);
+        VERIFY_IS_GREATER_THAN_OR_EQUAL(widthDetector._fallbackCache.size(), static_cast<size_t>(0x2000));
+    }
+
+    TEST_METHOD(AmbiguousCacheSkipsClusters)
+    {
+        // Pretend the font draws the emoji presentation of U+2640 wide, but the text presentation narrow.
+        size_t fallbacks = 0;
+        CodepointWidthDetector widthDetector;
+        widthDetector.SetFallbackMethod([&](const std::wstring_view glyph) {
+            ++fallbacks;
+            return glyph.size() > 1 && glyph.back() == 0xFE0F;
+        });
+
+        static constexpr std::wstring_view textPresentation{ L"\x2640" };
+        static constexpr std::wstring_view emojiPresentation{ L"\x2640\xFE0F" };
+
+        Log::Comment(L"The variation selector must not pick up the cached width of the bare codepoint.");
+        VERIFY_IS_FALSE(widthDetector.IsWide(textPresentation));
+        VERIFY_IS_TRUE(widthDetector.IsWide(emojiPresentation));
+        VERIFY_IS_FALSE(widthDetector.IsWide(textPresentation));
+        VERIFY_IS_TRUE(widthDetector.IsWide(emojiPresentation));
+
+        Log::Comment(L"Only the bare codepoint is cached, the cluster always asks the fallback.");
+        VERIFY_ARE_EQUAL(size_t{ 1 }, widthDetector._fallbackCacheSize);
+        VERIFY_ARE_EQUAL(size_t{ 3 }, fallbacks);
+    }
+
+    TEST_METHOD(CanLookUpRangeBoundaries)
+    {
+        CodepointWidthDetector widthDetector;
+
+        // The first and last codepoints of ranges, and their neighbors,
+        // including ranges that start or end within a page of the lookup table.
+        static constexpr std::array<std::pair<unsigned int, CodepointWidth>, 12> boundaries{ {
+            { 0xa0, CodepointWidth::Narrow },
+            { 0xa1, CodepointWidth::Ambiguous },
+            { 0xa2, CodepointWidth::Narrow },
+            { 0x1f6cb, CodepointWidth::Narrow },
+            { 0x1f6cc, CodepointWidth::Wide },
+            { 0x1f6cd, CodepointWidth::Narrow },
+            { 0x1ffff, CodepointWidth::Narrow },
+            { 0x20000, CodepointWidth::Wide },
+            { 0x2fffd, CodepointWidth::Wide },
+            { 0x2fffe, CodepointWidth::Narrow },
+            { 0x10fffd, CodepointWidth::Ambiguous },
+            { 0x10fffe, CodepointWidth::Narrow },
+        } };
+
+        for (const auto& [codepoint, width] : boundaries)
+        {
+            const auto glyph = Encode(codepoint);
+            VERIFY_ARE_EQUAL(width, widthDetector._lookupGlyphWidth(glyph), NoThrowString().Format(L"U+%X", codepoint));
+        }
+    }
+
+    TEST_METHOD(MixedCorpusThroughput)
+    {
+        BEGIN_TEST_METHOD_PROPERTIES()
+            TEST_METHOD_PROPERTY(L"IsPerfTest", L"true")
+        END_TEST_METHOD_PROPERTIES()
+
+        // A mix of CJK ideographs, hangul, emoji and cyrillic, none of which the quick lookup can answer.
+        std::vector<std::wstring> corpus;
+        for (unsigned int i = 0; i < 4096; ++i)
+        {
+            switch (i % 4)
+            {
+            case 0:
+                corpus.emplace_back(Encode(0x4E00 + (i * 7) % 0x5000));
+                break;
+            case 1:
+                corpus.emplace_back(Encode(0xAC00 + (i * 13) % 0x2BA4));
+                break;
+            case 2:
+                corpus.emplace_back(Encode(0x1F300 + (i * 3) % 0x350));
+                break;
+            default:
+                corpus.emplace_back(Encode(0x400 + i % 0x100));
+                break;
+            }
+        }
+
+        CodepointWidthDetector widthDetector;
+        constexpr size_t iterations = 1000;
+        size_t wide = 0;
+
+        const auto start = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < iterations; ++i)
+        {
+            for (const auto& glyph : corpus)
+            {
+                wide += widthDetector.GetWidth(glyph) == CodepointWidth::Wide;
+            }
+        }
+        const auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        Log::Comment(NoThrowString().Format(L"%zu glyphs classified (%zu wide): %.1f M glyphs/s", iterations * corpus.size(), wide, iterations * corpus.size() / elapsed / 1e6));
+    }
+
+private:
+    static std::wstring Encode(const unsigned int codepoint)
+    {
+        if (codepoint < 0x10000)
+        {
+            return std::wstring(1, static_cast<wchar_t>(codepoint));
+        }
+
+        const auto offset = codepoint - 0x10000;
+        return { static_cast<wchar_t>(0xD800 + (offset >> 10)), static_cast<wchar_t>(0xDC00 + (offset & 0x3FF)) };
     }
 };
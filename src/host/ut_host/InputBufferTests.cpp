@@ -78,7 +78,7 @@ class InputBufferTests
             INPUT_RECORD record;
             record.EventType = MENU_EVENT;
             VERIFY_IS_GREATER_THAN(inputBuffer.Write(IInputEvent::Create(record)), 0u);
-            VERIFY_ARE_EQUAL(record, inputBuffer._storage.back()->ToInputRecord());
+            VERIFY_ARE_EQUAL(record, inputBuffer._storage.back());
         }
         VERIFY_ARE_EQUAL(inputBuffer.GetNumberOfReadyEvents(), RECORD_INSERT_COUNT);
     }
@@ -98,7 +98,7 @@ class InputBufferTests
         // verify that the events are the same in storage
         for (size_t i = 0; i < RECORD_INSERT_COUNT; ++i)
         {
-            VERIFY_ARE_EQUAL(inputBuffer._storage[i]->ToInputRecord(), record);
+            VERIFY_ARE_EQUAL(inputBuffer._storage[i], record);
         }
     }
 
@@ -121,10 +121,9 @@ class InputBufferTests
         // check that they coalesced
         VERIFY_ARE_EQUAL(inputBuffer.GetNumberOfReadyEvents(), 1u);
         // check that the mouse position is being updated correctly
-        const IInputEvent* const pOutEvent = inputBuffer._storage.front().get();
-        const MouseEvent* const pMouseEvent = static_cast<const MouseEvent* const>(pOutEvent);
-        VERIFY_ARE_EQUAL(pMouseEvent->GetPosition().X, static_cast<SHORT>(RECORD_INSERT_COUNT));
-        VERIFY_ARE_EQUAL(pMouseEvent->GetPosition().Y, static_cast<SHORT>(RECORD_INSERT_COUNT * 2));
+        const MouseEvent mouseEvent{ inputBuffer._storage.front().Event.MouseEvent };
+        VERIFY_ARE_EQUAL(mouseEvent.GetPosition().X, static_cast<SHORT>(RECORD_INSERT_COUNT));
+        VERIFY_ARE_EQUAL(mouseEvent.GetPosition().Y, static_cast<SHORT>(RECORD_INSERT_COUNT * 2));
 
         // add a key event and another mouse event to make sure that
         // an event between two mouse events stopped the coalescing.
@@ -162,10 +161,10 @@ class InputBufferTests
         // no events should have been coalesced
         VERIFY_ARE_EQUAL(inputBuffer.GetNumberOfReadyEvents(), RECORD_INSERT_COUNT + 1);
         // check that the events stored match those inserted
-        VERIFY_ARE_EQUAL(inputBuffer._storage.front()->ToInputRecord(), mouseRecords[0]);
+        VERIFY_ARE_EQUAL(inputBuffer._storage.front(), mouseRecords[0]);
         for (size_t i = 0; i < RECORD_INSERT_COUNT; ++i)
         {
-            VERIFY_ARE_EQUAL(inputBuffer._storage[i + 1]->ToInputRecord(), mouseRecords[i]);
+            VERIFY_ARE_EQUAL(inputBuffer._storage[i + 1], mouseRecords[i]);
         }
     }
 
@@ -221,10 +220,10 @@ class InputBufferTests
         // no events should have been coalesced
         VERIFY_ARE_EQUAL(inputBuffer.GetNumberOfReadyEvents(), RECORD_INSERT_COUNT + 1);
         // check that the events stored match those inserted
-        VERIFY_ARE_EQUAL(inputBuffer._storage.front()->ToInputRecord(), keyRecords[0]);
+        VERIFY_ARE_EQUAL(inputBuffer._storage.front(), keyRecords[0]);
         for (size_t i = 0; i < RECORD_INSERT_COUNT; ++i)
         {
-            VERIFY_ARE_EQUAL(inputBuffer._storage[i + 1]->ToInputRecord(), keyRecords[i]);
+            VERIFY_ARE_EQUAL(inputBuffer._storage[i + 1], keyRecords[i]);
         }
     }
 
@@ -239,7 +238,7 @@ class InputBufferTests
         for (size_t i = 0; i < RECORD_INSERT_COUNT; ++i)
         {
             VERIFY_IS_GREATER_THAN(inputBuffer.Write(IInputEvent::Create(record)), 0u);
-            VERIFY_ARE_EQUAL(inputBuffer._storage.back()->ToInputRecord(), record);
+            VERIFY_ARE_EQUAL(inputBuffer._storage.back(), record);
         }
 
         // The events shouldn't be coalesced
@@ -382,10 +381,10 @@ class InputBufferTests
         VERIFY_IS_GREATER_THAN(inputBuffer.Write(inEvents), 0u);
 
         // read one record, make sure ResetWaitEvent isn't set
-        std::deque<std::unique_ptr<IInputEvent>> outEvents;
+        std::vector<INPUT_RECORD> outRecords;
         size_t eventsRead = 0;
         bool resetWaitEvent = false;
-        inputBuffer._ReadBuffer(outEvents,
+        inputBuffer._ReadBuffer(outRecords,
                                 1,
                                 eventsRead,
                                 false,
@@ -396,8 +395,8 @@ class InputBufferTests
         VERIFY_IS_FALSE(!!resetWaitEvent);
 
         // read the rest, resetWaitEvent should be set to true
-        outEvents.clear();
-        inputBuffer._ReadBuffer(outEvents,
+        outRecords.clear();
+        inputBuffer._ReadBuffer(outRecords,
                                 RECORD_INSERT_COUNT - 1,
                                 eventsRead,
                                 false,
@@ -431,10 +430,10 @@ class InputBufferTests
         VERIFY_IS_GREATER_THAN(inputBuffer.Write(inEvents), 0u);
 
         // read them out non-unicode style and compare
-        std::deque<std::unique_ptr<IInputEvent>> outEvents;
+        std::vector<INPUT_RECORD> outRecords;
         size_t eventsRead = 0;
         bool resetWaitEvent = false;
-        inputBuffer._ReadBuffer(outEvents,
+        inputBuffer._ReadBuffer(outRecords,
                                 recordInsertCount,
                                 eventsRead,
                                 false,
@@ -444,10 +443,10 @@ class InputBufferTests
         // the dbcs record should have counted for two elements in
         // the array, making it so that we get less events read
         VERIFY_ARE_EQUAL(eventsRead, recordInsertCount - 1);
-        VERIFY_ARE_EQUAL(eventsRead, outEvents.size());
+        VERIFY_ARE_EQUAL(eventsRead, outRecords.size());
         for (size_t i = 0; i < eventsRead; ++i)
         {
-            VERIFY_ARE_EQUAL(outEvents[i]->ToInputRecord(), inRecords[i]);
+            VERIFY_ARE_EQUAL(outRecords[i], inRecords[i]);
         }
     }
 
@@ -589,22 +588,17 @@ class InputBufferTests
     {
         InputBuffer inputBuffer;
         INPUT_RECORD record = MakeKeyEvent(true, 1, L'a', 0, L'a', 0);
-        std::unique_ptr<IInputEvent> inputEvent = IInputEvent::Create(record);
         size_t eventsWritten;
         bool waitEvent = false;
         inputBuffer.Flush();
         // write one event to an empty buffer
-        std::deque<std::unique_ptr<IInputEvent>> storage;
-        storage.push_back(std::move(inputEvent));
-        inputBuffer._WriteBuffer(storage, eventsWritten, waitEvent);
+        inputBuffer._WriteBuffer(gsl::make_span(&record, 1), eventsWritten, waitEvent);
         VERIFY_IS_TRUE(waitEvent);
         // write another, it shouldn't signal this time
         INPUT_RECORD record2 = MakeKeyEvent(true, 1, L'b', 0, L'b', 0);
-        std::unique_ptr<IInputEvent> inputEvent2 = IInputEvent::Create(record2);
         // write another event to a non-empty buffer
         waitEvent = false;
-        storage.push_back(std::move(inputEvent2));
-        inputBuffer._WriteBuffer(storage, eventsWritten, waitEvent);
+        inputBuffer._WriteBuffer(gsl::make_span(&record2, 1), eventsWritten, waitEvent);
 
         VERIFY_IS_FALSE(waitEvent);
     }
@@ -625,7 +619,7 @@ class InputBufferTests
                                                  true));
         VERIFY_ARE_EQUAL(outEvents.size(), 1u);
         VERIFY_ARE_EQUAL(inputBuffer._storage.size(), 1u);
-        VERIFY_ARE_EQUAL(static_cast<const KeyEvent&>(*inputBuffer._storage.front()).GetRepeatCount(), repeatCount - 1);
+        VERIFY_ARE_EQUAL(inputBuffer._storage.front().Event.KeyEvent.wRepeatCount, repeatCount - 1);
         VERIFY_ARE_EQUAL(static_cast<const KeyEvent&>(*outEvents.front()).GetRepeatCount(), 1u);
     }
 
@@ -645,7 +639,147 @@ class InputBufferTests
                                                  true));
         VERIFY_ARE_EQUAL(outEvents.size(), 1u);
         VERIFY_ARE_EQUAL(inputBuffer._storage.size(), 1u);
-        VERIFY_ARE_EQUAL(static_cast<const KeyEvent&>(*inputBuffer._storage.front()).GetRepeatCount(), repeatCount);
+        VERIFY_ARE_EQUAL(inputBuffer._storage.front().Event.KeyEvent.wRepeatCount, repeatCount);
         VERIFY_ARE_EQUAL(static_cast<const KeyEvent&>(*outEvents.front()).GetRepeatCount(), 1u);
     }
+
+    TEST_METHOD(SingleRecordStreamReadingDeCoalesces)
+    {
+        InputBuffer inputBuffer;
+        const WORD repeatCount = 3;
+        INPUT_RECORD record = MakeKeyEvent(true, repeatCount, L'a', 0, L'a', 0);
+        std::optional<INPUT_RECORD> outRecord;
+
+        VERIFY_ARE_EQUAL(inputBuffer.Write(IInputEvent::Create(record)), 1u);
+        for (WORD i = 0; i < repeatCount; ++i)
+        {
+            VERIFY_SUCCESS_NTSTATUS(inputBuffer.Read(outRecord, false, false, true));
+            VERIFY_IS_TRUE(outRecord.has_value());
+            VERIFY_ARE_EQUAL(outRecord->Event.KeyEvent.wRepeatCount, 1u);
+            VERIFY_ARE_EQUAL(outRecord->Event.KeyEvent.uChar.UnicodeChar, L'a');
+        }
+        VERIFY_ARE_EQUAL(inputBuffer.GetNumberOfReadyEvents(), 0u);
+
+        // an empty buffer leaves the record empty, or asks for a wait
+        VERIFY_SUCCESS_NTSTATUS(inputBuffer.Read(outRecord, false, false, true));
+        VERIFY_IS_FALSE(outRecord.has_value());
+        VERIFY_ARE_EQUAL(inputBuffer.Read(outRecord, false, true, true), CONSOLE_STATUS_WAIT);
+    }
+
+    TEST_METHOD(BulkRecordsKeepOrderAcrossWrapAround)
+    {
+        Log::Comment(L"Records should come out in order even once the storage ring has wrapped around and grown");
+
+        InputBuffer inputBuffer;
+        std::vector<INPUT_RECORD> records;
+        for (unsigned int i = 0; i < 300; ++i)
+        {
+            records.push_back(MakeKeyEvent(TRUE, 1, static_cast<WCHAR>(L'A' + i % 26), 0, static_cast<WCHAR>(L'A' + i % 26), i));
+        }
+        const auto recordSpan = gsl::make_span(records);
+
+        // Move the head of the ring away from the start of its allocation,
+        // so that the next writes wrap around its end.
+        VERIFY_ARE_EQUAL(inputBuffer.Write(recordSpan.first(50)), 50u);
+        std::vector<INPUT_RECORD> outRecords;
+        VERIFY_SUCCESS_NTSTATUS(inputBuffer.Read(outRecords, 40, false, false, true, false));
+        VERIFY_ARE_EQUAL(outRecords.size(), 40u);
+
+        // Fill the wrapped ring and then grow it.
+        VERIFY_ARE_EQUAL(inputBuffer.Write(recordSpan.subspan(50, 50)), 50u);
+        VERIFY_ARE_EQUAL(inputBuffer.Write(recordSpan.subspan(100)), 200u);
+
+        // Put the ones that were read back in front of the rest.
+        VERIFY_ARE_EQUAL(inputBuffer.Prepend(outRecords), 40u);
+        VERIFY_ARE_EQUAL(inputBuffer.GetNumberOfReadyEvents(), records.size());
+
+        outRecords.clear();
+        VERIFY_SUCCESS_NTSTATUS(inputBuffer.Read(outRecords, records.size(), false, false, true, false));
+        VERIFY_ARE_EQUAL(inputBuffer.GetNumberOfReadyEvents(), 0u);
+        VERIFY_ARE_EQUAL(outRecords.size(), records.size());
+        for (size_t i = 0; i < records.size(); ++i)
+        {
+            VERIFY_ARE_EQUAL(outRecords[i], records[i]);
+        }
+    }
+
+    TEST_METHOD(PasteThroughput)
+    {
+        BEGIN_TEST_METHOD_PROPERTIES()
+            TEST_METHOD_PROPERTY(L"IsPerfTest", L"true")
+        END_TEST_METHOD_PROPERTIES()
+
+        // A 64 KiB paste arrives as a key down and a key up per character,
+        // and is read back out in chunks the size of a typical client buffer.
+        std::vector<INPUT_RECORD> paste;
+        for (unsigned int i = 0; i < 65536; ++i)
+        {
+            const auto wch = static_cast<WCHAR>(L' ' + i % 95);
+            paste.push_back(MakeKeyEvent(TRUE, 1, 0, 0, wch, 0));
+            paste.push_back(MakeKeyEvent(FALSE, 1, 0, 0, wch, 0));
+        }
+
+        InputBuffer inputBuffer;
+        constexpr size_t iterations = 20;
+        constexpr size_t readChunk = 512;
+        std::vector<INPUT_RECORD> outRecords;
+        outRecords.reserve(readChunk);
+        size_t eventsRead = 0;
+
+        const auto start = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < iterations; ++i)
+        {
+            VERIFY_ARE_EQUAL(inputBuffer.Write(paste), paste.size());
+            while (inputBuffer.GetNumberOfReadyEvents() != 0)
+            {
+                outRecords.clear();
+                VERIFY_SUCCESS_NTSTATUS(inputBuffer.Read(outRecords, readChunk, false, false, true, false));
+                eventsRead += outRecords.size();
+            }
+        }
+        const auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        VERIFY_ARE_EQUAL(eventsRead, iterations * paste.size());
+        Log::Comment(NoThrowString().Format(L"%zu records written and read: %.1f M records/s", eventsRead, eventsRead / elapsed / 1e6));
+    }
+
+    TEST_METHOD(StreamPasteThroughput)
+    {
+        BEGIN_TEST_METHOD_PROPERTIES()
+            TEST_METHOD_PROPERTY(L"IsPerfTest", L"true")
+        END_TEST_METHOD_PROPERTIES()
+
+        // Cooked reads pull a paste out one record at a time, the way GetChar does.
+        std::vector<INPUT_RECORD> paste;
+        for (unsigned int i = 0; i < 65536; ++i)
+        {
+            const auto wch = static_cast<WCHAR>(L' ' + i % 95);
+            paste.push_back(MakeKeyEvent(TRUE, 1, 0, 0, wch, 0));
+            paste.push_back(MakeKeyEvent(FALSE, 1, 0, 0, wch, 0));
+        }
+
+        InputBuffer inputBuffer;
+        constexpr size_t iterations = 20;
+        std::optional<INPUT_RECORD> outRecord;
+        size_t eventsRead = 0;
+
+        const auto start = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < iterations; ++i)
+        {
+            VERIFY_ARE_EQUAL(inputBuffer.Write(paste), paste.size());
+            for (;;)
+            {
+                VERIFY_SUCCESS_NTSTATUS(inputBuffer.Read(outRecord, false, false, true));
+                if (!outRecord)
+                {
+                    break;
+                }
+                ++eventsRead;
+            }
+        }
+        const auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        VERIFY_ARE_EQUAL(eventsRead, iterations * paste.size());
+        Log::Comment(NoThrowString().Format(L"%zu records streamed: %.1f M records/s", eventsRead, eventsRead / elapsed / 1e6));
+    }
 };
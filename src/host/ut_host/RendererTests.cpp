@@ -0,0 +1,242 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+
+#include "precomp.h"
+#include "WexTestClass.h"
+#include "../../inc/consoletaeftemplates.hpp"
+
+#include "CommonState.hpp"
+
+#include "../../renderer/base/Renderer.hpp"
+
+using namespace WEX::Common;
+using namespace WEX::Logging;
+using namespace WEX::TestExecution;
+using namespace Microsoft::Console::Render;
+using Microsoft::Console::Interactivity::ServiceLocator;
+
+// By default, an engine that paints without the console lock, like GdiEngine does.
+// It stops in PaintBackground until it's released and logs the calls the renderer makes.
+// Otherwise, it paints under the lock without stopping and, like VtEngine, wants to
+// be painted before the buffer circles.
+class StandInRenderEngine final : public RenderEngineBase
+{
+public:
+    StandInRenderEngine(const bool paintsWithoutLock = true) :
+        _paintsWithoutLock{ paintsWithoutLock }
+    {
+        painting.create(wil::EventOptions::ManualReset);
+        release.create(wil::EventOptions::ManualReset);
+        if (!_paintsWithoutLock)
+        {
+            release.SetEvent();
+        }
+    }
+
+    bool Logged(const std::wstring_view call) const
+    {
+        const std::lock_guard guard{ _logLock };
+        return std::find(_log.begin(), _log.end(), call) != _log.end();
+    }
+
+    // Returns whether first was logged and second was logged after it.
+    bool LoggedInOrder(const std::wstring_view first, const std::wstring_view second) const
+    {
+        const std::lock_guard guard{ _logLock };
+        const auto it = std::find(_log.begin(), _log.end(), first);
+        return it != _log.end() && std::find(it, _log.end(), second) != _log.end();
+    }
+
+    [[nodiscard]] bool CanPaintWithoutLock() noexcept override { return _paintsWithoutLock; }
+
+    [[nodiscard]] HRESULT StartPaint() noexcept override { return _Log(L"StartPaint"); }
+    [[nodiscard]] HRESULT EndPaint() noexcept override { return _Log(L"EndPaint"); }
+    [[nodiscard]] HRESULT Present() noexcept override { return S_FALSE; }
+    [[nodiscard]] HRESULT PrepareForTeardown(_Out_ bool* pForcePaint) noexcept override
+    {
+        *pForcePaint = false;
+        return S_OK;
+    }
+    [[nodiscard]] HRESULT ScrollFrame() noexcept override { return S_OK; }
+    [[nodiscard]] HRESULT Invalidate(const SMALL_RECT*) noexcept override { return S_OK; }
+    [[nodiscard]] HRESULT InvalidateCursor(const SMALL_RECT*) noexcept override { return S_OK; }
+    [[nodiscard]] HRESULT InvalidateSystem(const RECT*) noexcept override { return S_OK; }
+    [[nodiscard]] HRESULT InvalidateSelection(const std::vector<SMALL_RECT>&) noexcept override { return S_OK; }
+    [[nodiscard]] HRESULT InvalidateScroll(const COORD*) noexcept override { return S_OK; }
+    [[nodiscard]] HRESULT InvalidateAll() noexcept override { return _Log(L"InvalidateAll"); }
+    [[nodiscard]] HRESULT InvalidateCircling(_Out_ bool* pForcePaint) noexcept override
+    {
+        *pForcePaint = !_paintsWithoutLock;
+        return _Log(L"InvalidateCircling");
+    }
+    [[nodiscard]] HRESULT PaintBackground() noexcept override
+    {
+        painting.SetEvent();
+        release.wait();
+        return _Log(L"PaintBackground");
+    }
+    [[nodiscard]] HRESULT PaintBufferLine(gsl::span<const Cluster>, COORD, bool, bool) noexcept override { return S_OK; }
+    [[nodiscard]] HRESULT PaintBufferGridLines(GridLineSet, COLORREF, size_t, COORD) noexcept override { return S_OK; }
+    [[nodiscard]] HRESULT PaintSelection(SMALL_RECT) noexcept override { return S_OK; }
+    [[nodiscard]] HRESULT PaintCursor(const CursorOptions&) noexcept override { return S_OK; }
+    [[nodiscard]] HRESULT UpdateDrawingBrushes(const TextAttribute&, gsl::not_null<IRenderData*>, bool, bool) noexcept override { return S_OK; }
+    [[nodiscard]] HRESULT UpdateFont(const FontInfoDesired&, _Out_ FontInfo&) noexcept override { return _Log(L"UpdateFont"); }
+    [[nodiscard]] HRESULT UpdateDpi(int) noexcept override { return S_OK; }
+    [[nodiscard]] HRESULT UpdateViewport(SMALL_RECT) noexcept override { return S_OK; }
+    [[nodiscard]] HRESULT GetProposedFont(const FontInfoDesired&, _Out_ FontInfo&, int) noexcept override { return S_FALSE; }
+    [[nodiscard]] HRESULT GetDirtyArea(gsl::span<const til::rectangle>& area) noexcept override
+    {
+        area = {};
+        return S_OK;
+    }
+    [[nodiscard]] HRESULT GetFontSize(_Out_ COORD* pFontSize) noexcept override
+    {
+        *pFontSize = { 8, 16 };
+        return S_OK;
+    }
+    [[nodiscard]] HRESULT IsGlyphWideByFont(std::wstring_view, _Out_ bool* pResult) noexcept override
+    {
+        *pResult = false;
+        return S_FALSE;
+    }
+
+    wil::unique_event painting;
+    wil::unique_event release;
+
+protected:
+    [[nodiscard]] HRESULT _DoUpdateTitle(const std::wstring_view) noexcept override { return S_OK; }
+
+private:
+    HRESULT _Log(const wchar_t* call) noexcept
+    try
+    {
+        const std::lock_guard guard{ _logLock };
+        _log.emplace_back(call);
+        return S_OK;
+    }
+    CATCH_RETURN()
+
+    const bool _paintsWithoutLock;
+    mutable std::mutex _logLock;
+    std::vector<std::wstring> _log;
+};
+
+class RendererTests
+{
+    CommonState* m_state;
+
+    TEST_CLASS(RendererTests);
+
+    TEST_CLASS_SETUP(ClassSetup)
+    {
+        m_state = new CommonState();
+
+        m_state->InitEvents();
+        m_state->PrepareGlobalFont();
+        m_state->PrepareGlobalScreenBuffer();
+        m_state->PrepareGlobalInputBuffer();
+
+        return true;
+    }
+
+    TEST_CLASS_CLEANUP(ClassCleanup)
+    {
+        m_state->CleanupGlobalScreenBuffer();
+        m_state->CleanupGlobalFont();
+        m_state->CleanupGlobalInputBuffer();
+
+        delete m_state;
+
+        return true;
+    }
+
+    TEST_METHOD(WaitingForUnlockedPaintDoesNotDeadlock)
+    {
+        auto& gci = ServiceLocator::LocateGlobals().getConsoleInformation();
+
+        StandInRenderEngine engine;
+        Renderer renderer{ &gci.renderData, nullptr, 0, nullptr };
+        renderer.AddRenderEngine(&engine);
+
+        auto paintResult = E_UNEXPECTED;
+        std::thread painter{ [&]() {
+            paintResult = renderer.PaintFrame();
+        } };
+        auto joinPainter = wil::scope_exit([&]() {
+            engine.release.SetEvent();
+            painter.join();
+        });
+
+        VERIFY_IS_TRUE(engine.painting.wait(5000));
+
+        Log::Comment(L"The console lock is free while the engine paints.");
+        gci.LockConsole();
+        auto unlock = wil::scope_exit([&]() {
+            gci.UnlockConsole();
+        });
+
+        Log::Comment(L"Invalidations are held back until the engine is done painting.");
+        renderer.TriggerRedrawAll();
+        VERIFY_IS_FALSE(engine.Logged(L"InvalidateAll"));
+
+        Log::Comment(L"A font change under the console lock waits for the paint to finish, which doesn't need the lock.");
+        auto fontInfo = gci.GetActiveOutputBuffer().GetCurrentFont();
+        const FontInfoDesired fontInfoDesired{ fontInfo };
+        engine.release.SetEvent();
+        renderer.TriggerFontChange(USER_DEFAULT_SCREEN_DPI, fontInfoDesired, fontInfo);
+
+        VERIFY_IS_TRUE(engine.LoggedInOrder(L"EndPaint", L"InvalidateAll"));
+        VERIFY_IS_TRUE(engine.LoggedInOrder(L"EndPaint", L"UpdateFont"));
+
+        Log::Comment(L"Once we let go of the console lock, the painter catches up and finishes the frame.");
+        unlock.reset();
+        joinPainter.reset();
+        VERIFY_ARE_EQUAL(S_OK, paintResult);
+    }
+
+    TEST_METHOD(CirclingDoesNotWaitForUnlockedPaint)
+    {
+        auto& gci = ServiceLocator::LocateGlobals().getConsoleInformation();
+
+        StandInRenderEngine unlockedEngine;
+        StandInRenderEngine lockedEngine{ false };
+        Renderer renderer{ &gci.renderData, nullptr, 0, nullptr };
+        renderer.AddRenderEngine(&unlockedEngine);
+        renderer.AddRenderEngine(&lockedEngine);
+
+        auto paintResult = E_UNEXPECTED;
+        std::thread painter{ [&]() {
+            paintResult = renderer.PaintFrame();
+        } };
+        auto joinPainter = wil::scope_exit([&]() {
+            unlockedEngine.release.SetEvent();
+            painter.join();
+        });
+
+        VERIFY_IS_TRUE(unlockedEngine.painting.wait(5000));
+
+        Log::Comment(L"Circling the buffer while the first engine paints doesn't wait for it.");
+        wil::unique_event circled{ wil::EventOptions::ManualReset };
+        std::thread circler{ [&]() {
+            gci.LockConsole();
+            renderer.TriggerCircling();
+            gci.UnlockConsole();
+            circled.SetEvent();
+        } };
+        auto joinCircler = wil::scope_exit([&]() {
+            unlockedEngine.release.SetEvent();
+            circler.join();
+        });
+        VERIFY_IS_TRUE(circled.wait(5000));
+
+        Log::Comment(L"The engine that asked for it got painted right away, with the other frame.");
+        VERIFY_IS_TRUE(lockedEngine.LoggedInOrder(L"InvalidateCircling", L"EndPaint"));
+
+        Log::Comment(L"The engine that's still painting gets the circling once it's done.");
+        VERIFY_IS_FALSE(unlockedEngine.Logged(L"InvalidateCircling"));
+        joinCircler.reset();
+        joinPainter.reset();
+        VERIFY_ARE_EQUAL(S_OK, paintResult);
+        VERIFY_IS_TRUE(unlockedEngine.LoggedInOrder(L"EndPaint", L"InvalidateCircling"));
+    }
+};
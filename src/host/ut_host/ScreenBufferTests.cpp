@@ -12,6 +12,7 @@
 #include "input.h"
 #include "getset.h"
 #include "_stream.h" // For WriteCharsLegacy
+#include "output.h" // For ScrollRegion
 
 #include "../interactivity/inc/ServiceLocator.hpp"
 #include "../../inc/conattrs.hpp"
@@ -221,6 +222,11 @@ class ScreenBufferTests
     TEST_METHOD(RetainHorizontalOffsetWhenMovingToBottom);
 
     TEST_METHOD(TestWriteConsoleVTQuirkMode);
+
+    TEST_METHOD(WriteCharsLegacyMixedRuns);
+    TEST_METHOD(WriteCharsLegacyThroughput);
+
+    TEST_METHOD(ScrollRegionThroughput);
 };
 
 void ScreenBufferTests::SingleAlternateBufferCreationTest()
@@ -6250,3 +6256,86 @@ void ScreenBufferTests::TestWriteConsoleVTQuirkMode()
         verifyLastAttribute(vtWhiteOnBlack256Attribute);
     }
 }
+
+void ScreenBufferTests::WriteCharsLegacyMixedRuns()
+{
+    auto& gci = ServiceLocator::LocateGlobals().getConsoleInformation();
+    auto& si = gci.GetActiveOutputBuffer().GetActiveBuffer();
+    const auto& tbi = si.GetTextBuffer();
+    auto& cursor = si.GetTextBuffer().GetCursor();
+
+    Log::Comment(L"Narrow glyphs are copied in runs around the wide glyphs and control characters.");
+    const std::wstring_view text{ L"ab\u00e9\u4e2dcd\tX" };
+    auto numBytes = text.size() * sizeof(wchar_t);
+    VERIFY_SUCCESS_NTSTATUS(WriteCharsLegacy(si, text.data(), text.data(), text.data(), &numBytes, nullptr, 0, 0, nullptr));
+    VERIFY_ARE_EQUAL(text.size() * sizeof(wchar_t), numBytes);
+    VERIFY_ARE_EQUAL(COORD({ 9, 0 }), cursor.GetPosition());
+
+    auto iter = tbi.GetCellDataAt({ 0, 0 });
+    for (const auto expected : { L"a", L"b", L"\u00e9", L"\u4e2d", L"\u4e2d", L"c", L"d", L" ", L"X" })
+    {
+        VERIFY_ARE_EQUAL(std::wstring_view{ expected }, iter->Chars());
+        iter++;
+    }
+
+    Log::Comment(L"A run that's longer than the row continues on the next one.");
+    const auto width = si.GetBufferSize().Width();
+    const std::wstring line(width + 5, L'x');
+    cursor.SetPosition({ 0, 1 });
+    numBytes = line.size() * sizeof(wchar_t);
+    VERIFY_SUCCESS_NTSTATUS(WriteCharsLegacy(si, line.data(), line.data(), line.data(), &numBytes, nullptr, 0, 0, nullptr));
+    VERIFY_ARE_EQUAL(COORD({ 5, 2 }), cursor.GetPosition());
+    VERIFY_ARE_EQUAL(String(line.substr(0, width).c_str()), String(tbi.GetRowByOffset(1).GetText().c_str()));
+    VERIFY_ARE_EQUAL(String(L"xxxxx "), String(tbi.GetRowByOffset(2).GetText().substr(0, 6).c_str()));
+}
+
+void ScreenBufferTests::WriteCharsLegacyThroughput()
+{
+    BEGIN_TEST_METHOD_PROPERTIES()
+        TEST_METHOD_PROPERTY(L"IsPerfTest", L"true")
+    END_TEST_METHOD_PROPERTIES()
+
+    auto& gci = ServiceLocator::LocateGlobals().getConsoleInformation();
+    auto& si = gci.GetActiveOutputBuffer().GetActiveBuffer();
+
+    // Lines of plain text, like a classic console program writing a large block of output.
+    std::wstring text;
+    while (text.size() < 1024 * 1024)
+    {
+        text.append(L"The quick brown fox jumps over the lazy dog 0123456789.\r\n");
+    }
+
+    const auto start = std::chrono::steady_clock::now();
+    auto numBytes = text.size() * sizeof(wchar_t);
+    VERIFY_SUCCESS_NTSTATUS(WriteCharsLegacy(si, text.data(), text.data(), text.data(), &numBytes, nullptr, 0, 0, nullptr));
+    const auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    Log::Comment(NoThrowString().Format(L"%zu characters: %.1f MB/s", text.size(), numBytes / elapsed / (1024 * 1024)));
+}
+
+void ScreenBufferTests::ScrollRegionThroughput()
+{
+    BEGIN_TEST_METHOD_PROPERTIES()
+        TEST_METHOD_PROPERTY(L"IsPerfTest", L"true")
+    END_TEST_METHOD_PROPERTIES()
+
+    auto& gci = ServiceLocator::LocateGlobals().getConsoleInformation();
+    auto& si = gci.GetActiveOutputBuffer().GetActiveBuffer();
+    const auto bufferWidth = si.GetBufferSize().Width();
+
+    // Scroll a region that doesn't span the full width of the buffer, like an
+    // editor with left and right margins would, so that every cell has to be copied.
+    const SHORT regionHeight = 50;
+    const SMALL_RECT scrollRect{ 1, 1, gsl::narrow_cast<SHORT>(bufferWidth - 2), regionHeight };
+    const COORD destination{ 1, 0 };
+    const size_t scrollCount = 10000;
+
+    const auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < scrollCount; ++i)
+    {
+        ScrollRegion(si, scrollRect, std::nullopt, destination, UNICODE_SPACE, si.GetAttributes());
+    }
+    const auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    Log::Comment(NoThrowString().Format(L"%zu scrolls of a %dx%d region: %.0f scrolls/s", scrollCount, bufferWidth - 2, regionHeight, scrollCount / elapsed));
+}
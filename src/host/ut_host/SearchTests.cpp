@@ -156,4 +156,52 @@ class SearchTests
         Search s(gci.renderData, L"\x304b", Search::Direction::Backward, Search::Sensitivity::CaseInsensitive);
         DoFoundChecks(s, coordStartExpected, -1);
     }
+
+    TEST_METHOD(FindAllReturnsEveryMatch)
+    {
+        auto& gci = ServiceLocator::LocateGlobals().getConsoleInformation();
+
+        Search s(gci.renderData, L"\x304b", Search::Direction::Forward, Search::Sensitivity::CaseSensitive);
+        const auto& matches = s.FindAll();
+
+        VERIFY_ARE_EQUAL(4u, matches.size());
+        for (SHORT y = 0; y < 4; ++y)
+        {
+            // The glyph is wide, so the match covers two cells.
+            const auto [start, end] = til::at(matches, y);
+            VERIFY_ARE_EQUAL((COORD{ 2, y }), start);
+            VERIFY_ARE_EQUAL((COORD{ 3, y }), end);
+        }
+
+        // FindNext steps through the same matches.
+        COORD coordStartExpected = { 2, 0 };
+        DoFoundChecks(s, coordStartExpected, 1);
+    }
+
+    TEST_METHOD(MatchesSpanWrappedRowsOnly)
+    {
+        auto& gci = ServiceLocator::LocateGlobals().getConsoleInformation();
+        auto& textBuffer = gci.GetActiveOutputBuffer().GetTextBuffer();
+        const SHORT width = textBuffer.GetSize().Width();
+
+        // Put "YZ" at the end of the first row, which is followed by "AB" at the start of the second one.
+        auto& row = textBuffer.GetRowByOffset(0);
+        row.WriteNarrowRun(L"YZ", width - 2, TextAttribute{});
+
+        {
+            Search s(gci.renderData, L"ZAB", Search::Direction::Forward, Search::Sensitivity::CaseSensitive);
+            VERIFY_IS_TRUE(s.FindAll().empty(), L"Rows that didn't wrap are separate lines.");
+            VERIFY_IS_FALSE(s.FindNext());
+        }
+
+        row.SetWrapForced(true);
+
+        {
+            Search s(gci.renderData, L"ZAB", Search::Direction::Forward, Search::Sensitivity::CaseSensitive);
+            VERIFY_ARE_EQUAL(1u, s.FindAll().size());
+            VERIFY_IS_TRUE(s.FindNext());
+            VERIFY_ARE_EQUAL((COORD{ width - 1, 0 }), s._coordSelStart);
+            VERIFY_ARE_EQUAL((COORD{ 1, 1 }), s._coordSelEnd);
+        }
+    }
 };
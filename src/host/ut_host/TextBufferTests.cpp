@@ -17,6 +17,8 @@
 #include "../interactivity/inc/ServiceLocator.hpp"
 #include "../renderer/inc/DummyRenderTarget.hpp"
 
+#include <psapi.h>
+
 using namespace Microsoft::Console::Types;
 using namespace Microsoft::Console::Interactivity;
 using namespace Microsoft::Console::VirtualTerminal;
@@ -143,6 +145,7 @@ class TextBufferTests
 
     TEST_METHOD(ResizeTraditionalHighUnicodeRowRemoval);
     TEST_METHOD(ResizeTraditionalHighUnicodeColumnRemoval);
+    TEST_METHOD(ResizeTraditionalCompactsScrolledRows);
 
     TEST_METHOD(TestBurrito);
 
@@ -156,6 +159,22 @@ class TextBufferTests
 
     TEST_METHOD(HyperlinkTrim);
     TEST_METHOD(NoHyperlinkTrim);
+    TEST_METHOD(HyperlinkOverwrite);
+    TEST_METHOD(HyperlinkCopyBetweenBuffers);
+    TEST_METHOD(HyperlinkStreamThroughput);
+
+    TEST_METHOD(GetPatternsReusesUnchangedRows);
+
+    TEST_METHOD(WritesAreCollectedAsDirtyRegions);
+    TEST_METHOD(DirtyRowsFloodThroughput);
+
+    TEST_METHOD(FrozenRowsKeepTheirContents);
+    TEST_METHOD(ScrollbackMemoryPerMillionLines);
+    TEST_METHOD(MemoryPerTenThousandRows);
+
+    TEST_METHOD(CopyRectangleMovesCellsAndAttributes);
+
+    TEST_METHOD(WriteNarrowRunErasesStoredGlyphs);
 };
 
 void TextBufferTests::TestBufferCreate()
@@ -1928,14 +1947,17 @@ void TextBufferTests::ResizeTraditionalHighUnicodeRowRemoval()
     const auto readBackText = *readBack;
     VERIFY_ARE_EQUAL(String(emoji), String(readBackText.data(), gsl::narrow<int>(readBackText.size())));
 
-    VERIFY_ARE_EQUAL(1u, _buffer->GetUnicodeStorage()._map.size(), L"There should be one item in the map.");
+    VERIFY_ARE_EQUAL(1u, _buffer->_storage[pos.Y].GetUnicodeStorage().size(), L"There should be one item in the row's storage.");
 
     // Perform resize to trim off the row of the buffer that included the emoji
     COORD trimmedBufferSize{ bufferSize.X, bufferSize.Y - 1 };
 
     VERIFY_NT_SUCCESS(_buffer->ResizeTraditional(trimmedBufferSize));
 
-    VERIFY_IS_TRUE(_buffer->GetUnicodeStorage()._map.empty(), L"The map should now be empty.");
+    for (const auto& row : _buffer->_storage)
+    {
+        VERIFY_IS_TRUE(row.GetUnicodeStorage().empty(), L"No row should have any items in its storage.");
+    }
 }
 
 // This tests that columns removed from the buffer while resizing traditionally will also drop the high unicode
@@ -1963,14 +1985,51 @@ void TextBufferTests::ResizeTraditionalHighUnicodeColumnRemoval()
     const auto readBackText = *readBack;
     VERIFY_ARE_EQUAL(String(emoji), String(readBackText.data(), gsl::narrow<int>(readBackText.size())));
 
-    VERIFY_ARE_EQUAL(1u, _buffer->GetUnicodeStorage()._map.size(), L"There should be one item in the map.");
+    VERIFY_ARE_EQUAL(1u, _buffer->_storage[pos.Y].GetUnicodeStorage().size(), L"There should be one item in the row's storage.");
 
     // Perform resize to trim off the column of the buffer that included the emoji
     COORD trimmedBufferSize{ bufferSize.X - 1, bufferSize.Y };
 
     VERIFY_NT_SUCCESS(_buffer->ResizeTraditional(trimmedBufferSize));
 
-    VERIFY_IS_TRUE(_buffer->GetUnicodeStorage()._map.empty(), L"The map should now be empty.");
+    VERIFY_IS_TRUE(_buffer->_storage[pos.Y].GetUnicodeStorage().empty(), L"The row's storage should now be empty.");
+}
+
+// This tests that rows which were shuffled around by scrolling are copied into
+// the new cells in order while resizing traditionally.
+void TextBufferTests::ResizeTraditionalCompactsScrolledRows()
+{
+    const COORD bufferSize{ 10, 6 };
+    const UINT cursorSize = 12;
+    const TextAttribute attr{ 0x7f };
+    auto _buffer = std::make_unique<TextBuffer>(bufferSize, attr, cursorSize, _renderTarget);
+
+    // Fill every row with its own letter.
+    for (SHORT y = 0; y < bufferSize.Y; ++y)
+    {
+        const std::wstring text(bufferSize.X, static_cast<wchar_t>(L'A' + y));
+        _buffer->GetRowByOffset(y).WriteNarrowRun(text, 0, attr);
+    }
+
+    // Move rows C and D (2 and 3) down by 2 rows, which puts E and F (4 and 5) above them.
+    _buffer->ScrollRows(2, 2, 2);
+    const std::wstring_view expectedLetters{ L"ABEFCD" };
+
+    const COORD newSize{ 12, bufferSize.Y };
+    VERIFY_NT_SUCCESS(_buffer->ResizeTraditional(newSize));
+
+    const CharRowCell* const firstCells = _buffer->GetRowByOffset(0).GetCharRow().begin();
+    for (SHORT y = 0; y < newSize.Y; ++y)
+    {
+        const auto& row = _buffer->GetRowByOffset(y);
+
+        std::wstring expected(bufferSize.X, expectedLetters.at(y));
+        expected.append(newSize.X - bufferSize.X, L' ');
+        VERIFY_ARE_EQUAL(String(expected.c_str()), String(row.GetText().c_str()));
+
+        // The rows are laid out one after the other in the new cells, in the order they're in now.
+        VERIFY_IS_TRUE(firstCells + y * newSize.X == row.GetCharRow().begin());
+    }
 }
 
 void TextBufferTests::TestBurrito()
@@ -2606,17 +2665,14 @@ void TextBufferTests::HyperlinkTrim()
     // Increment the circular buffer
     _buffer->IncrementCircularBuffer();
 
-    const auto finalCustomId = fmt::format(L"{}%{}", customId, til::hash(url));
-    const auto finalOtherCustomId = fmt::format(L"{}%{}", otherCustomId, til::hash(otherUrl));
-
     // The hyperlink reference that was only in the first row should be deleted from the map
-    VERIFY_ARE_EQUAL(_buffer->_hyperlinkMap.find(id), _buffer->_hyperlinkMap.end());
-    // Since there was a custom id, that should be deleted as well
-    VERIFY_ARE_EQUAL(_buffer->_hyperlinkCustomIdMap.find(finalCustomId), _buffer->_hyperlinkCustomIdMap.end());
+    VERIFY_THROWS(_buffer->GetHyperlinkUriFromId(id), std::out_of_range);
+    // Since there was a custom id, that should be deleted as well, so it's given a new id
+    VERIFY_ARE_NOT_EQUAL(id, _buffer->GetHyperlinkId(url, customId));
 
     // The other hyperlink reference should not be deleted
-    VERIFY_ARE_EQUAL(_buffer->_hyperlinkMap[otherId], otherUrl);
-    VERIFY_ARE_EQUAL(_buffer->_hyperlinkCustomIdMap[finalOtherCustomId], otherId);
+    VERIFY_ARE_EQUAL(_buffer->GetHyperlinkUriFromId(otherId), otherUrl);
+    VERIFY_ARE_EQUAL(otherId, _buffer->GetHyperlinkId(otherUrl, otherCustomId));
 }
 
 // This tests that when we increment the circular buffer, non-obsolete hyperlink references
@@ -2647,9 +2703,589 @@ void TextBufferTests::NoHyperlinkTrim()
     // Increment the circular buffer
     _buffer->IncrementCircularBuffer();
 
-    const auto finalCustomId = fmt::format(L"{}%{}", customId, til::hash(url));
-
     // The hyperlink reference should not be deleted from the map since it is still present in the buffer
     VERIFY_ARE_EQUAL(_buffer->GetHyperlinkUriFromId(id), url);
-    VERIFY_ARE_EQUAL(_buffer->_hyperlinkCustomIdMap[finalCustomId], id);
+    VERIFY_ARE_EQUAL(id, _buffer->GetHyperlinkId(url, customId));
+}
+
+// This tests that a hyperlink is removed from the map as soon as the last cell
+// that uses it is overwritten, unless it's part of the current attributes
+void TextBufferTests::HyperlinkOverwrite()
+{
+    // Set up a text buffer for us
+    const COORD bufferSize{ 80, 10 };
+    const UINT cursorSize = 12;
+    const TextAttribute attr{ 0x7f };
+    auto _buffer = std::make_unique<TextBuffer>(bufferSize, attr, cursorSize, _renderTarget);
+
+    static constexpr std::wstring_view url{ L"test.url" };
+    static constexpr std::wstring_view customId{ L"CustomId" };
+
+    // Write a hyperlink into two rows
+    const auto id = _buffer->GetHyperlinkId(url, customId);
+    _buffer->AddHyperlinkToMap(url, id);
+    TextAttribute linkAttr{ 0x7f };
+    linkAttr.SetHyperlinkId(id);
+    _buffer->GetRowByOffset(2).GetAttrRow().Replace(10, 20, linkAttr);
+    _buffer->GetRowByOffset(7).GetAttrRow().Replace(30, 35, linkAttr);
+
+    // Overwriting part of the link, or all of it in one row, keeps it around
+    _buffer->GetRowByOffset(2).GetAttrRow().Replace(5, 15, attr);
+    _buffer->GetRowByOffset(7).GetAttrRow().SetAttrToEnd(0, attr);
+    VERIFY_ARE_EQUAL(_buffer->GetHyperlinkUriFromId(id), url);
+
+    // Overwriting the remaining cells removes it, along with its custom id
+    _buffer->GetRowByOffset(2).GetAttrRow().Replace(15, 20, attr);
+    VERIFY_THROWS(_buffer->GetHyperlinkUriFromId(id), std::out_of_range);
+    VERIFY_ARE_NOT_EQUAL(id, _buffer->GetHyperlinkId(url, customId));
+
+    // A hyperlink that's part of the current attributes survives while it's written and erased
+    const auto otherId = _buffer->GetHyperlinkId(url, {});
+    _buffer->AddHyperlinkToMap(url, otherId);
+    linkAttr.SetHyperlinkId(otherId);
+    _buffer->SetCurrentAttributes(linkAttr);
+    _buffer->GetRowByOffset(3).GetAttrRow().Replace(0, 10, linkAttr);
+    _buffer->GetRowByOffset(3).Reset(attr);
+    VERIFY_ARE_EQUAL(_buffer->GetHyperlinkUriFromId(otherId), url);
+
+    // Copying a row adds references for its cells, and destroying the copy releases them
+    _buffer->GetRowByOffset(4).GetAttrRow().Replace(0, 10, linkAttr);
+    _buffer->SetCurrentAttributes(attr);
+    {
+        const auto copy = _buffer->GetRowByOffset(4).GetAttrRow();
+        _buffer->GetRowByOffset(4).Reset(attr);
+        VERIFY_ARE_EQUAL(_buffer->GetHyperlinkUriFromId(otherId), url);
+    }
+    VERIFY_THROWS(_buffer->GetHyperlinkUriFromId(otherId), std::out_of_range);
+}
+
+// This tests that a row that's assigned a copy of a row of another buffer
+// keeps counting the references to its hyperlinks in its own buffer
+void TextBufferTests::HyperlinkCopyBetweenBuffers()
+{
+    const COORD bufferSize{ 80, 10 };
+    const UINT cursorSize = 12;
+    const TextAttribute attr{ 0x7f };
+    auto sourceBuffer = std::make_unique<TextBuffer>(bufferSize, attr, cursorSize, _renderTarget);
+    auto targetBuffer = std::make_unique<TextBuffer>(bufferSize, attr, cursorSize, _renderTarget);
+
+    static constexpr std::wstring_view url{ L"test.url" };
+
+    const auto id = sourceBuffer->GetHyperlinkId(url, {});
+    sourceBuffer->AddHyperlinkToMap(url, id);
+    targetBuffer->AddHyperlinkToMap(url, id);
+    TextAttribute linkAttr{ 0x7f };
+    linkAttr.SetHyperlinkId(id);
+    sourceBuffer->GetRowByOffset(0).GetAttrRow().Replace(0, 10, linkAttr);
+
+    auto& targetRow = targetBuffer->GetRowByOffset(0).GetAttrRow();
+    targetRow = sourceBuffer->GetRowByOffset(0).GetAttrRow();
+
+    // Erasing the link in the source buffer removes it there, but not from the copy
+    sourceBuffer->GetRowByOffset(0).Reset(attr);
+    VERIFY_THROWS(sourceBuffer->GetHyperlinkUriFromId(id), std::out_of_range);
+    VERIFY_ARE_EQUAL(targetBuffer->GetHyperlinkUriFromId(id), url);
+
+    // A replacement that throws leaves the references alone,
+    // so the link is only removed once all 10 of its cells are overwritten
+    VERIFY_THROWS(targetRow.Replace(90, 95, attr), std::out_of_range);
+    targetRow.Replace(0, 9, attr);
+    VERIFY_ARE_EQUAL(targetBuffer->GetHyperlinkUriFromId(id), url);
+    targetRow.Replace(9, 10, attr);
+    VERIFY_THROWS(targetBuffer->GetHyperlinkUriFromId(id), std::out_of_range);
+}
+
+void TextBufferTests::HyperlinkStreamThroughput()
+{
+    BEGIN_TEST_METHOD_PROPERTIES()
+        TEST_METHOD_PROPERTY(L"IsPerfTest", L"true")
+    END_TEST_METHOD_PROPERTIES()
+
+    // Stream a lot of lines through a full scrollback, where each line is
+    // a hyperlink of its own, like the output of `ls --hyperlink`.
+    const COORD bufferSize{ 120, 9001 };
+    const UINT cursorSize = 12;
+    const TextAttribute attr{ 0x7f };
+    auto _buffer = std::make_unique<TextBuffer>(bufferSize, attr, cursorSize, _renderTarget);
+
+    constexpr size_t lineCount = 100000;
+    static constexpr std::wstring_view text{ L"src/buffer/out/textBuffer.cpp" };
+
+    const auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < lineCount; ++i)
+    {
+        const auto uri = fmt::format(L"file://localhost/src/buffer/out/textBuffer.cpp?line={}", i);
+        auto linkAttr = attr;
+        linkAttr.SetHyperlinkId(_buffer->GetHyperlinkId(uri, {}));
+        _buffer->AddHyperlinkToMap(uri, linkAttr.GetHyperlinkId());
+
+        _buffer->SetCurrentAttributes(linkAttr);
+        _buffer->WriteNarrowRun(text, { 0, bufferSize.Y - 1 });
+        _buffer->SetCurrentAttributes(attr);
+        _buffer->IncrementCircularBuffer();
+    }
+    const auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    Log::Comment(NoThrowString().Format(L"%zu hyperlinked lines: %.0f lines/s, %zu hyperlinks left in the map", lineCount, lineCount / elapsed, _buffer->GetHyperlinkRegistry().size()));
+
+    // Only the hyperlinks still in the buffer may be left.
+    VERIFY_IS_LESS_THAN_OR_EQUAL(_buffer->GetHyperlinkRegistry().size(), static_cast<size_t>(bufferSize.Y));
+}
+
+void TextBufferTests::GetPatternsReusesUnchangedRows()
+{
+    const COORD bufferSize{ 80, 10 };
+    const UINT cursorSize = 12;
+    const TextAttribute attr{ 0x7f };
+    auto _buffer = std::make_unique<TextBuffer>(bufferSize, attr, cursorSize, _renderTarget);
+
+    using interval = interval_tree::IntervalTree<til::point, size_t>::interval;
+    const auto id = _buffer->AddPatternRecognizer(LR"(https?://[^ ]+)");
+
+    // One link within a row, and one that wraps from row 3 into row 4.
+    _buffer->WriteNarrowRun(L"https://a.b/c", { 5, 1 });
+    VERIFY_ARE_EQUAL(10u, _buffer->WriteNarrowRun(L"https://example.com/path", { 70, 3 }));
+    _buffer->WriteNarrowRun(L"ample.com/path", { 0, 4 });
+
+    auto intervals = _buffer->GetPatterns(0, bufferSize.Y - 1);
+    VERIFY_ARE_EQUAL(2u, intervals.size());
+    VERIFY_IS_TRUE(intervals[0] == interval(til::point{ 5, 1 }, til::point{ 18, 1 }, id));
+    VERIFY_IS_TRUE(intervals[1] == interval(til::point{ 70, 3 }, til::point{ 14, 4 }, id));
+
+    Log::Comment(L"Asking again without any changes gives the same matches.");
+    VERIFY_IS_TRUE(intervals == _buffer->GetPatterns(0, bufferSize.Y - 1));
+
+    Log::Comment(L"Scrolling moves the cached matches up along with their rows.");
+    _buffer->IncrementCircularBuffer();
+    intervals = _buffer->GetPatterns(0, bufferSize.Y - 1);
+    VERIFY_ARE_EQUAL(2u, intervals.size());
+    VERIFY_IS_TRUE(intervals[0] == interval(til::point{ 5, 0 }, til::point{ 18, 0 }, id));
+    VERIFY_IS_TRUE(intervals[1] == interval(til::point{ 70, 2 }, til::point{ 14, 3 }, id));
+
+    Log::Comment(L"Changing a row searches it again and drops what was cached for its old text.");
+    _buffer->WriteNarrowRun(L"     ", { 5, 0 });
+    intervals = _buffer->GetPatterns(0, bufferSize.Y - 1);
+    VERIFY_ARE_EQUAL(1u, intervals.size());
+    VERIFY_IS_TRUE(intervals[0] == interval(til::point{ 70, 2 }, til::point{ 14, 3 }, id));
+
+    Log::Comment(L"Writing the link back finds it again.");
+    _buffer->WriteNarrowRun(L"https", { 5, 0 });
+    intervals = _buffer->GetPatterns(0, bufferSize.Y - 1);
+    VERIFY_ARE_EQUAL(2u, intervals.size());
+    VERIFY_IS_TRUE(intervals[0] == interval(til::point{ 5, 0 }, til::point{ 18, 0 }, id));
+}
+
+// Counts how often the text buffer wakes up the renderer.
+class RedrawCountingRenderTarget final : public Microsoft::Console::Render::IRenderTarget
+{
+public:
+    void TriggerRedraw(const Microsoft::Console::Types::Viewport& /*region*/) override { ++redraws; }
+    void TriggerRedraw(const COORD* const /*pcoord*/) override { ++redraws; }
+    void TriggerRedrawCursor(const COORD* const /*pcoord*/) override {}
+    void TriggerRedrawAll() override {}
+    void TriggerTeardown() noexcept override {}
+    void TriggerSelection() override {}
+    void TriggerScroll() override {}
+    void TriggerScroll(const COORD* const /*pcoordDelta*/) override {}
+    void TriggerCircling() override {}
+    void TriggerTitleChange() override {}
+
+    size_t redraws{ 0 };
+};
+
+void TextBufferTests::WritesAreCollectedAsDirtyRegions()
+{
+    const COORD bufferSize{ 80, 10 };
+    const UINT cursorSize = 12;
+    const TextAttribute attr{ 0x7f };
+    RedrawCountingRenderTarget renderTarget;
+    auto _buffer = std::make_unique<TextBuffer>(bufferSize, attr, cursorSize, renderTarget);
+    std::vector<SMALL_RECT> regions;
+
+    Log::Comment(L"Only the first write since the regions were collected wakes up the renderer.");
+    _buffer->WriteNarrowRun(L"abc", { 10, 2 });
+    _buffer->WriteNarrowRun(L"def", { 20, 2 });
+    _buffer->WriteNarrowRun(L"ghi", { 5, 2 });
+    _buffer->WriteNarrowRun(L"abc", { 0, 3 });
+    _buffer->WriteNarrowRun(L"abc", { 0, 4 });
+    _buffer->WriteNarrowRun(L"abcdef", { 0, 6 });
+    VERIFY_ARE_EQUAL(1u, renderTarget.redraws);
+
+    Log::Comment(L"Neighboring dirty rows are merged, and all regions span the columns written to.");
+    _buffer->TakeDirtyRegions(regions);
+    VERIFY_ARE_EQUAL(2u, regions.size());
+    VERIFY_ARE_EQUAL((SMALL_RECT{ 0, 2, 23, 5 }), regions[0]);
+    VERIFY_ARE_EQUAL((SMALL_RECT{ 0, 6, 23, 7 }), regions[1]);
+
+    Log::Comment(L"Collecting the regions forgets them.");
+    _buffer->TakeDirtyRegions(regions);
+    VERIFY_ARE_EQUAL(0u, regions.size());
+    _buffer->WriteNarrowRun(L"abc", { 10, 2 });
+    VERIFY_ARE_EQUAL(2u, renderTarget.redraws);
+
+    Log::Comment(L"Circling moves the dirty rows up along with their contents.");
+    _buffer->IncrementCircularBuffer();
+    _buffer->WriteNarrowRun(L"abc", { 0, 8 });
+    VERIFY_ARE_EQUAL(2u, renderTarget.redraws);
+    _buffer->TakeDirtyRegions(regions);
+    VERIFY_ARE_EQUAL(2u, regions.size());
+    VERIFY_ARE_EQUAL((SMALL_RECT{ 0, 1, 13, 2 }), regions[0]);
+    VERIFY_ARE_EQUAL((SMALL_RECT{ 0, 8, 13, 9 }), regions[1]);
+
+    Log::Comment(L"A dirty first row falls off the buffer when it circles.");
+    _buffer->WriteNarrowRun(L"abc", { 0, 0 });
+    VERIFY_ARE_EQUAL(3u, renderTarget.redraws);
+    _buffer->IncrementCircularBuffer();
+    _buffer->TakeDirtyRegions(regions);
+    VERIFY_ARE_EQUAL(0u, regions.size());
+
+    Log::Comment(L"A flood of lines wakes up the renderer once per frame, not once per line.");
+    for (auto i = 0; i < 1000; ++i)
+    {
+        _buffer->WriteNarrowRun(L"abcdefghijklmnopqrstuvwxyz0123", { 0, bufferSize.Y - 1 });
+        _buffer->IncrementCircularBuffer();
+    }
+    VERIFY_ARE_EQUAL(4u, renderTarget.redraws);
+    _buffer->TakeDirtyRegions(regions);
+    VERIFY_ARE_EQUAL(1u, regions.size());
+    VERIFY_ARE_EQUAL((SMALL_RECT{ 0, 0, 30, 9 }), regions[0]);
+
+    Log::Comment(L"Resizing the buffer with dirty rows left marks the whole buffer as dirty.");
+    _buffer->WriteNarrowRun(L"abc", { 0, 4 });
+    VERIFY_ARE_EQUAL(5u, renderTarget.redraws);
+    VERIFY_SUCCEEDED(_buffer->ResizeTraditional({ 80, 12 }));
+    _buffer->WriteNarrowRun(L"abc", { 0, 11 });
+    VERIFY_ARE_EQUAL(5u, renderTarget.redraws);
+    _buffer->TakeDirtyRegions(regions);
+    VERIFY_ARE_EQUAL(1u, regions.size());
+    VERIFY_ARE_EQUAL(_buffer->GetSize().ToExclusive(), regions[0]);
+
+    _buffer->TakeDirtyRegions(regions);
+    VERIFY_ARE_EQUAL(0u, regions.size());
+}
+
+void TextBufferTests::DirtyRowsFloodThroughput()
+{
+    BEGIN_TEST_METHOD_PROPERTIES()
+        TEST_METHOD_PROPERTY(L"IsPerfTest", L"true")
+    END_TEST_METHOD_PROPERTIES()
+
+    // Flood the buffer with lines and collect the dirty rows every so many lines,
+    // like the renderer does once per frame. Collecting them after every line
+    // wakes the renderer up for every write, which is what it used to hear about.
+    const COORD bufferSize{ 120, 9001 };
+    const UINT cursorSize = 12;
+    const TextAttribute attr{ 0x7f };
+    static constexpr std::wstring_view text{ L"The quick brown fox jumps over the lazy dog. 0123456789 The quick brown fox jumps over the lazy dog." };
+    constexpr size_t lineCount = 1000000;
+
+    const auto flood = [&](const size_t linesPerFrame) {
+        RedrawCountingRenderTarget renderTarget;
+        auto _buffer = std::make_unique<TextBuffer>(bufferSize, attr, cursorSize, renderTarget);
+        std::vector<SMALL_RECT> regions;
+        size_t regionCount = 0;
+
+        const auto start = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < lineCount; ++i)
+        {
+            _buffer->WriteNarrowRun(text, { 0, bufferSize.Y - 1 });
+            _buffer->IncrementCircularBuffer();
+            if ((i + 1) % linesPerFrame == 0)
+            {
+                _buffer->TakeDirtyRegions(regions);
+                regionCount += regions.size();
+            }
+        }
+        const auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        Log::Comment(NoThrowString().Format(L"%zu lines collected every %zu lines: %.0f lines/s, %zu wake-ups, %zu regions", lineCount, linesPerFrame, lineCount / elapsed, renderTarget.redraws, regionCount));
+        return renderTarget.redraws;
+    };
+
+    VERIFY_ARE_EQUAL(lineCount / 1000, flood(1000));
+    VERIFY_ARE_EQUAL(lineCount, flood(1));
+}
+
+void TextBufferTests::FrozenRowsKeepTheirContents()
+{
+    const COORD bufferSize{ 80, 3000 };
+    const UINT cursorSize = 12;
+    const TextAttribute attr{ 0x7f };
+    auto _buffer = std::make_unique<TextBuffer>(bufferSize, attr, cursorSize, _renderTarget);
+
+    // Rows whose cells are all narrow and fit into a byte are frozen differently from the rest,
+    // so the lines end in text that doesn't fit into a byte, a wide glyph, or a surrogate pair.
+    const auto textOf = [](const size_t line) {
+        static constexpr std::wstring_view endings[] = { L"", L"\x0101", L"\x30a2", L"\xD83D\xDE00" };
+        return L"row " + std::to_wstring(line) + std::wstring(line % 50, L'x') + std::wstring{ til::at(endings, line % std::size(endings)) };
+    };
+    const auto writeLine = [&](TextBuffer& buffer, const SHORT y, const size_t line) {
+        const TextAttribute lineAttr{ gsl::narrow_cast<WORD>(line % 16) };
+        buffer.WriteLine(OutputCellIterator{ textOf(line), lineAttr }, { 0, y }, false);
+    };
+
+    // The expected row is written into a buffer that's too short for any of its rows to be frozen.
+    auto expectedBuffer = std::make_unique<TextBuffer>(COORD{ bufferSize.X, 1 }, attr, cursorSize, _renderTarget);
+    const auto verifyRow = [&](const SHORT y, const size_t line) {
+        auto& expectedRow = expectedBuffer->GetRowByOffset(0);
+        VERIFY_IS_TRUE(expectedRow.Reset(attr));
+        writeLine(*expectedBuffer, 0, line);
+
+        const auto& row = std::as_const(*_buffer).GetRowByOffset(y);
+        VERIFY_IS_FALSE(row.IsFrozen());
+        VERIFY_ARE_EQUAL(expectedRow.size(), row.size());
+        for (size_t x = 0; x < row.size(); ++x)
+        {
+            const std::wstring_view expectedGlyph{ expectedRow.GetCharRow().GlyphAt(x) };
+            const std::wstring_view glyph{ row.GetCharRow().GlyphAt(x) };
+            VERIFY_ARE_EQUAL(String(std::wstring{ expectedGlyph }.c_str()), String(std::wstring{ glyph }.c_str()));
+            VERIFY_IS_TRUE(expectedRow.GetCharRow().DbcsAttrAt(x) == row.GetCharRow().DbcsAttrAt(x));
+            const auto column = gsl::narrow_cast<uint16_t>(x);
+            VERIFY_ARE_EQUAL(expectedRow.GetAttrRow().GetAttrByColumn(column), row.GetAttrRow().GetAttrByColumn(column));
+        }
+    };
+    const auto verifyText = [&](const SHORT y, const std::wstring& expected) {
+        auto text = _buffer->GetRowByOffset(y).GetText();
+        VERIFY_ARE_EQUAL(_buffer->GetSize().Width(), gsl::narrow<SHORT>(text.size()));
+        text.erase(text.find_last_not_of(L' ') + 1);
+        VERIFY_ARE_EQUAL(String(expected.c_str()), String(text.c_str()));
+    };
+
+    WEX::TestExecution::SetVerifyOutput verifyOutputScope{ WEX::TestExecution::VerifyOutputSettings::LogOnlyFailures };
+
+    for (SHORT y = 0; y < bufferSize.Y; ++y)
+    {
+        writeLine(*_buffer, y, y);
+    }
+
+    Log::Comment(L"Rows are frozen when the buffer circles, and keep their contents when they're thawed.");
+    _buffer->GetCursor().SetYPosition(bufferSize.Y - 1);
+    VERIFY_IS_TRUE(_buffer->IncrementCircularBuffer());
+
+    Log::Comment(L"Thawing a row never takes the cells of another one, so a held row stays put.");
+    const auto& held = _buffer->GetRowByOffset(10);
+    const auto heldCells = held.GetCharRow().cbegin();
+    for (SHORT y = 0; y < bufferSize.Y - 1; ++y)
+    {
+        verifyRow(y, y + 1);
+    }
+    verifyText(bufferSize.Y - 1, L"");
+    VERIFY_IS_TRUE(heldCells == held.GetCharRow().cbegin());
+
+    Log::Comment(L"Rows that were read are frozen again once there are enough of them, without changing their contents.");
+    _buffer->TrimThawedRows();
+    for (SHORT y = 0; y < bufferSize.Y - 1; ++y)
+    {
+        verifyRow(y, y + 1);
+    }
+
+    Log::Comment(L"Frozen rows move along when rows are scrolled around.");
+    VERIFY_IS_TRUE(_buffer->IncrementCircularBuffer());
+    _buffer->ScrollRows(100, 1500, 1000);
+    verifyRow(1100, 102);
+    verifyRow(2599, 1601);
+    verifyRow(100, 1602);
+    verifyRow(2997, 2999);
+
+    Log::Comment(L"Frozen rows get cut off when the buffer gets narrower.");
+    VERIFY_NT_SUCCESS(_buffer->ResizeTraditional({ 5, bufferSize.Y }));
+    verifyText(1100, L"row 1");
+    verifyText(2997, L"row 2");
+
+    Log::Comment(L"All rows get their cells back when the buffer gets short enough.");
+    _buffer->GetCursor().SetYPosition(0);
+    VERIFY_NT_SUCCESS(_buffer->ResizeTraditional({ 20, 500 }));
+    verifyText(99, textOf(101).substr(0, 5));
+}
+
+void TextBufferTests::ScrollbackMemoryPerMillionLines()
+{
+    BEGIN_TEST_METHOD_PROPERTIES()
+        TEST_METHOD_PROPERTY(L"IsPerfTest", L"true")
+    END_TEST_METHOD_PROPERTIES()
+
+    // The memory of the buffer is measured as what it adds to the private bytes of the process.
+    const auto privateBytes = []() {
+        PROCESS_MEMORY_COUNTERS_EX counters{};
+        VERIFY_WIN32_BOOL_SUCCEEDED(GetProcessMemoryInfo(GetCurrentProcess(), reinterpret_cast<PROCESS_MEMORY_COUNTERS*>(&counters), sizeof(counters)));
+        return counters.PrivateUsage;
+    };
+
+    const COORD bufferSize{ 200, SHRT_MAX };
+    const UINT cursorSize = 12;
+    const TextAttribute attr{ 0x7f };
+    const auto baseline = privateBytes();
+    auto _buffer = std::make_unique<TextBuffer>(bufferSize, attr, cursorSize, _renderTarget);
+
+    // Output lines of varying length until the whole scrollback was filled twice.
+    _buffer->GetCursor().SetYPosition(bufferSize.Y - 1);
+    const size_t lineCount = 2 * bufferSize.Y;
+    const auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < lineCount; ++i)
+    {
+        const std::wstring text(20 + i % 80, static_cast<wchar_t>(L'a' + i % 26));
+        _buffer->WriteNarrowRun(text, { 0, bufferSize.Y - 1 });
+        _buffer->IncrementCircularBuffer();
+    }
+    const auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    const auto frozenBytes = privateBytes() - baseline;
+
+    // Reading through all of the scrollback, like a search does, thaws every row.
+    size_t rowsWithText = 0;
+    for (SHORT y = 0; y < bufferSize.Y; ++y)
+    {
+        rowsWithText += std::as_const(*_buffer).GetRowByOffset(y).GetCharRow().ContainsText() ? 1 : 0;
+    }
+    const auto thawedBytes = privateBytes() - baseline;
+
+    // They're frozen again after the next write.
+    _buffer->TrimThawedRows();
+    const auto trimmedBytes = privateBytes() - baseline;
+
+    const auto perMillion = [&](const size_t bytes) {
+        return static_cast<double>(bytes) / bufferSize.Y * 1e6 / (1024 * 1024);
+    };
+    const auto unfrozenCellBytes = static_cast<size_t>(bufferSize.Y) * bufferSize.X * sizeof(CharRowCell);
+
+    Log::Comment(NoThrowString().Format(L"%zu lines of %d columns: %.0f lines/s", lineCount, bufferSize.X, lineCount / elapsed));
+    Log::Comment(NoThrowString().Format(L"MB per million lines: %.1f frozen, %.1f after reading all of them, %.1f trimmed again",
+                                        perMillion(frozenBytes),
+                                        perMillion(thawedBytes),
+                                        perMillion(trimmedBytes)));
+    Log::Comment(NoThrowString().Format(L"MB per million lines for the cells alone, if no rows were frozen: %.1f", perMillion(unfrozenCellBytes)));
+
+    VERIFY_ARE_EQUAL(static_cast<size_t>(bufferSize.Y) - 1, rowsWithText);
+    VERIFY_IS_LESS_THAN(frozenBytes, unfrozenCellBytes / 2);
+    VERIFY_IS_LESS_THAN(trimmedBytes, thawedBytes);
+}
+
+void TextBufferTests::MemoryPerTenThousandRows()
+{
+    BEGIN_TEST_METHOD_PROPERTIES()
+        TEST_METHOD_PROPERTY(L"IsPerfTest", L"true")
+    END_TEST_METHOD_PROPERTIES()
+
+    // The memory of a buffer is measured as what it adds to the private bytes of the process.
+    const auto privateBytes = []() {
+        PROCESS_MEMORY_COUNTERS_EX counters{};
+        VERIFY_WIN32_BOOL_SUCCEEDED(GetProcessMemoryInfo(GetCurrentProcess(), reinterpret_cast<PROCESS_MEMORY_COUNTERS*>(&counters), sizeof(counters)));
+        return counters.PrivateUsage;
+    };
+
+    constexpr SHORT rowCount = 10000;
+    const UINT cursorSize = 12;
+    const TextAttribute attr{ 0x7f };
+    const auto megabytes = [](const size_t bytes) {
+        return static_cast<double>(bytes) / (1024 * 1024);
+    };
+
+    // Scrolls a full row of text through each row of a new buffer, in as many attribute runs as given,
+    // and returns what the buffer takes before and after.
+    const auto measure = [&](const SHORT width, const SHORT runs) {
+        const auto baseline = privateBytes();
+        auto _buffer = std::make_unique<TextBuffer>(COORD{ width, rowCount }, attr, cursorSize, _renderTarget);
+        const auto emptyBytes = privateBytes() - baseline;
+
+        _buffer->GetCursor().SetYPosition(rowCount - 1);
+        const std::wstring text(width / runs, L'x');
+        for (SHORT i = 0; i < rowCount; ++i)
+        {
+            for (SHORT run = 0; run < runs; ++run)
+            {
+                _buffer->SetCurrentAttributes(TextAttribute{ gsl::narrow_cast<WORD>(run % 16) });
+                _buffer->WriteNarrowRun(text, { gsl::narrow_cast<SHORT>(run * text.size()), rowCount - 1 });
+            }
+            _buffer->IncrementCircularBuffer();
+        }
+        return std::make_pair(emptyBytes, privateBytes() - baseline);
+    };
+
+    for (const SHORT width : { SHORT{ 80 }, SHORT{ 120 }, SHORT{ 240 } })
+    {
+        const auto [emptyBytes, filledBytes] = measure(width, 1);
+        const auto coloredBytes = measure(width, 16).second;
+        const auto cellBytes = static_cast<size_t>(rowCount) * width * sizeof(CharRowCell);
+
+        Log::Comment(NoThrowString().Format(L"%d columns, MB per 10k rows: %.1f empty, %.1f filled with one attribute per row, %.1f with 16 attributes per row, %.1f for the cells of all rows",
+                                            width,
+                                            megabytes(emptyBytes),
+                                            megabytes(filledBytes),
+                                            megabytes(coloredBytes),
+                                            megabytes(cellBytes)));
+
+        // Only the rows around the cursor have cells of their own, so wide buffers take a lot less than their cells would.
+        if (width == 240)
+        {
+            VERIFY_IS_LESS_THAN(filledBytes, cellBytes);
+        }
+    }
+}
+
+void TextBufferTests::CopyRectangleMovesCellsAndAttributes()
+{
+    const COORD bufferSize{ 10, 5 };
+    const UINT cursorSize = 12;
+    const TextAttribute attrA{ 0x1f };
+    const TextAttribute attrB{ 0x2e };
+    auto _buffer = std::make_unique<TextBuffer>(bufferSize, attrA, cursorSize, _renderTarget);
+
+    const std::wstring_view rows[] = { L"0123456789", L"ABCDEFGHIJ", L"abcdefghij", L"KLMNOPQRST", L"klmnopqrst" };
+    for (SHORT y = 0; y < bufferSize.Y; ++y)
+    {
+        _buffer->SetCurrentAttributes(attrA);
+        _buffer->WriteNarrowRun(til::at(rows, y).substr(0, 5), { 0, y }, false);
+        _buffer->SetCurrentAttributes(attrB);
+        _buffer->WriteNarrowRun(til::at(rows, y).substr(5), { 5, y }, false);
+    }
+
+    // expectedAttrs holds an 'A' or 'B' for each column, depending on which attribute it should have.
+    const auto verifyRow = [&](const SHORT y, const std::wstring_view expectedText, const std::wstring_view expectedAttrs) {
+        const auto& row = _buffer->GetRowByOffset(y);
+        VERIFY_ARE_EQUAL(String(std::wstring{ expectedText }.c_str()), String(row.GetText().c_str()));
+        for (SHORT x = 0; x < bufferSize.X; ++x)
+        {
+            VERIFY_ARE_EQUAL(til::at(expectedAttrs, x) == L'A' ? attrA : attrB, row.GetAttrRow().GetAttrByColumn(x));
+        }
+    };
+
+    Log::Comment(L"Copy part of a row onto itself, to the right. The source must not be overwritten before it's been read.");
+    _buffer->CopyRectangle(Viewport::FromInclusive({ 0, 0, 5, 0 }), { 2, 0 });
+    verifyRow(0, L"0101234589", L"AAAAAAABBB");
+
+    Log::Comment(L"Copy a partial-width rectangle down onto itself. Cells outside of it must be left alone.");
+    _buffer->CopyRectangle(Viewport::FromInclusive({ 2, 1, 4, 3 }), { 3, 2 });
+    verifyRow(1, L"ABCDEFGHIJ", L"AAAAABBBBB");
+    verifyRow(2, L"abcCDEghij", L"AAAAAABBBB");
+    verifyRow(3, L"KLMcdeQRST", L"AAAAAABBBB");
+    verifyRow(4, L"klmMNOqrst", L"AAAAAABBBB");
+
+    Log::Comment(L"Copy a rectangle up and to the left.");
+    _buffer->CopyRectangle(Viewport::FromInclusive({ 5, 3, 9, 4 }), { 0, 1 });
+    verifyRow(1, L"eQRSTFGHIJ", L"ABBBBBBBBB");
+    verifyRow(2, L"OqrstEghij", L"ABBBBABBBB");
+    verifyRow(3, L"KLMcdeQRST", L"AAAAAABBBB");
+}
+
+void TextBufferTests::WriteNarrowRunErasesStoredGlyphs()
+{
+    const COORD bufferSize{ 10, 2 };
+    const UINT cursorSize = 12;
+    const TextAttribute attr{ 0x7f };
+    auto _buffer = std::make_unique<TextBuffer>(bufferSize, attr, cursorSize, _renderTarget);
+
+    // U+1F600 is a wide surrogate pair, stored outside of the cells in both of its columns.
+    _buffer->Write(OutputCellIterator{ L"\xD83D\xDE00" }, { 0, 0 });
+    _buffer->Write(OutputCellIterator{ L"\xD83D\xDE00" }, { 4, 0 });
+    const auto& storage = _buffer->GetRowByOffset(0).GetUnicodeStorage();
+    VERIFY_ARE_EQUAL(size_t{ 4 }, storage.size());
+
+    Log::Comment(L"Overwriting the first glyph with narrow text drops it from the storage, and only it.");
+    _buffer->WriteNarrowRun(L"ab", { 0, 0 });
+    VERIFY_ARE_EQUAL(size_t{ 2 }, storage.size());
+    VERIFY_ARE_EQUAL(String(L"\xD83D\xDE00"), String(std::wstring{ storage.GetText(4) }.c_str()));
+
+    Log::Comment(L"Once the second glyph is gone too, nothing is left.");
+    _buffer->WriteNarrowRun(L"cd", { 4, 0 });
+    VERIFY_IS_TRUE(storage.empty());
+    VERIFY_ARE_EQUAL(String(L"ab  cd    "), String(_buffer->GetRowByOffset(0).GetText().c_str()));
 }
@@ -11,6 +11,8 @@
 #include "../../renderer/base/Renderer.hpp"
 #include "../Settings.hpp"
 #include "../VtIo.hpp"
+#include "../VtInputThread.hpp"
+#include "CommonState.hpp"
 
 #if TIL_FEATURE_CONHOSTDXENGINE_ENABLED
 #include "../../renderer/dx/DxRenderer.hpp"
@@ -43,6 +45,9 @@ class Microsoft::Console::VirtualTerminal::VtIoTests
 #endif
 
     TEST_METHOD(BasicAnonymousPipeOpeningWithSignalChannelTest);
+
+    TEST_METHOD(InputReadsAreParsedSeparately);
+    TEST_METHOD(InputThreadDoesNotReadAfterExitRequest);
 };
 
 using namespace Microsoft::Console;
@@ -397,6 +402,10 @@ public:
         return true;
     }
 
+    void ReflowScrollback() noexcept
+    {
+    }
+
     const std::wstring GetHyperlinkUri(uint16_t /*id*/) const noexcept
     {
         return {};
@@ -411,6 +420,11 @@ public:
     {
         return {};
     }
+
+    void TakeDirtyRegions(std::vector<SMALL_RECT>& regions)
+    {
+        regions.clear();
+    }
 };
 
 void VtIoTests::RendererDtorAndThread()
@@ -497,3 +511,69 @@ void VtIoTests::BasicAnonymousPipeOpeningWithSignalChannelTest()
     VERIFY_IS_TRUE(vtio.IsUsingVt());
     VERIFY_ARE_NOT_EQUAL(nullptr, vtio._pPtySignalInputThread);
 }
+
+void VtIoTests::InputReadsAreParsedSeparately()
+{
+    Log::Comment(L"Reads that are handled under one lock must still be parsed one by one, "
+                 L"since an incomplete sequence is flushed at the end of each read.");
+
+    CommonState state;
+    state.PrepareGlobalInputBuffer();
+    auto cleanup = wil::scope_exit([&] { state.CleanupGlobalInputBuffer(); });
+    auto& inputBuffer = *Microsoft::Console::Interactivity::ServiceLocator::LocateGlobals().getConsoleInformation().pInputBuffer;
+
+    wil::unique_handle readSide;
+    wil::unique_handle writeSide;
+    VERIFY_WIN32_BOOL_SUCCEEDED(CreatePipe(&readSide, &writeSide, nullptr, 0), L"Create anonymous in pipe.");
+    VtInputThread inputThread{ wil::unique_hfile{ readSide.release() }, false };
+
+    const auto readKeys = [&]() {
+        std::vector<INPUT_RECORD> records;
+        VERIFY_SUCCESS_NTSTATUS(inputBuffer.Read(records, inputBuffer.GetNumberOfReadyEvents(), false, false, true, false));
+        std::vector<INPUT_RECORD> keyDowns;
+        std::copy_if(records.begin(), records.end(), std::back_inserter(keyDowns), [](const auto& record) {
+            return record.EventType == KEY_EVENT && record.Event.KeyEvent.bKeyDown;
+        });
+        return keyDowns;
+    };
+
+    Log::Comment(L"A single read of ESC [ A is the up arrow.");
+    const std::string_view arrow{ "\x1b[A" };
+    VERIFY_SUCCEEDED(inputThread._HandleRunInputBatch({ &arrow, 1 }));
+    auto keys = readKeys();
+    VERIFY_ARE_EQUAL(size_t{ 1 }, keys.size());
+    VERIFY_ARE_EQUAL(WORD{ VK_UP }, keys.at(0).Event.KeyEvent.wVirtualKeyCode);
+
+    Log::Comment(L"ESC [ followed by a separate read of A is alt+[ and then A.");
+    const std::array<std::string_view, 2> reads{ "\x1b[", "A" };
+    VERIFY_SUCCEEDED(inputThread._HandleRunInputBatch(reads));
+    keys = readKeys();
+    VERIFY_IS_FALSE(std::any_of(keys.begin(), keys.end(), [](const auto& key) { return key.Event.KeyEvent.wVirtualKeyCode == VK_UP; }));
+    VERIFY_IS_TRUE(std::any_of(keys.begin(), keys.end(), [](const auto& key) {
+        return key.Event.KeyEvent.uChar.UnicodeChar == L'[' && WI_IsFlagSet(key.Event.KeyEvent.dwControlKeyState, LEFT_ALT_PRESSED);
+    }));
+    VERIFY_ARE_EQUAL(L'A', keys.back().Event.KeyEvent.uChar.UnicodeChar);
+
+    Log::Comment(L"Both reads were handled under a single lock.");
+    VERIFY_ARE_EQUAL(uint64_t{ 2 }, inputThread._statistics.lockAcquisitions);
+}
+
+void VtIoTests::InputThreadDoesNotReadAfterExitRequest()
+{
+    Log::Comment(L"Once the decode thread asked it to exit, the input thread mustn't start another read. "
+                 L"Nothing would cancel it and it would wait for the client to send more input.");
+
+    CommonState state;
+    state.PrepareGlobalInputBuffer();
+    auto cleanup = wil::scope_exit([&] { state.CleanupGlobalInputBuffer(); });
+
+    // Nothing is ever written into the pipe, so a read would never return.
+    wil::unique_handle readSide;
+    wil::unique_handle writeSide;
+    VERIFY_WIN32_BOOL_SUCCEEDED(CreatePipe(&readSide, &writeSide, nullptr, 0), L"Create anonymous in pipe.");
+    VtInputThread inputThread{ wil::unique_hfile{ readSide.release() }, false };
+
+    inputThread._exitRequested = true;
+    VERIFY_ARE_EQUAL(DWORD{ S_OK }, inputThread._InputThread());
+    VERIFY_ARE_EQUAL(uint64_t{ 0 }, inputThread._statistics.reads);
+}
@@ -79,6 +79,8 @@ class Microsoft::Console::Render::VtRendererTest
 
     TEST_METHOD(TestWrapping);
 
+    TEST_METHOD(TestUnchangedCellsAreSkipped);
+
     TEST_METHOD(TestResize);
 
     TEST_METHOD(TestCursorVisibility);
@@ -203,6 +205,38 @@ void VtRendererTest::VtSequenceHelperTests()
 
     qExpectedInput.push_back("\x1b[10C");
     VERIFY_SUCCEEDED(engine->_CursorForward(10));
+
+    // The common sequences are put together from lookup tables, up to a point,
+    // and formatted beyond that. Both need to produce the same sequences.
+    qExpectedInput.push_back("\x1b[999C");
+    VERIFY_SUCCEEDED(engine->_CursorForward(999));
+
+    qExpectedInput.push_back("\x1b[1000C");
+    VERIFY_SUCCEEDED(engine->_CursorForward(1000));
+
+    qExpectedInput.push_back("\x1b[120;1000H");
+    VERIFY_SUCCEEDED(engine->_CursorPosition({ 999, 119 }));
+
+    qExpectedInput.push_back("\x1b[1001;1H");
+    VERIFY_SUCCEEDED(engine->_CursorPosition({ 0, 1000 }));
+
+    qExpectedInput.push_back("\x1b[1234X");
+    VERIFY_SUCCEEDED(engine->_EraseCharacter(1234));
+
+    qExpectedInput.push_back("\x1b[300M");
+    VERIFY_SUCCEEDED(engine->_DeleteLine(300));
+
+    qExpectedInput.push_back("\x1b[97m");
+    VERIFY_SUCCEEDED(engine->_SetGraphicsRendition16Color(15, true));
+
+    qExpectedInput.push_back("\x1b[40m");
+    VERIFY_SUCCEEDED(engine->_SetGraphicsRendition16Color(0, false));
+
+    qExpectedInput.push_back("\x1b[48;5;255m");
+    VERIFY_SUCCEEDED(engine->_SetGraphicsRendition256Color(255, false));
+
+    qExpectedInput.push_back("\x1b[38;2;0;100;255m");
+    VERIFY_SUCCEEDED(engine->_SetGraphicsRenditionRGBColor(RGB(0, 100, 255), true));
 }
 
 void VtRendererTest::Xterm256TestInvalidate()
@@ -1427,6 +1461,73 @@ void VtRendererTest::TestWrapping()
     });
 }
 
+void VtRendererTest::TestUnchangedCellsAreSkipped()
+{
+    wil::unique_hfile hFile = wil::unique_hfile(INVALID_HANDLE_VALUE);
+    std::unique_ptr<Xterm256Engine> engine = std::make_unique<Xterm256Engine>(std::move(hFile), SetUpViewport());
+    auto pfn = std::bind(&VtRendererTest::WriteCallback, this, std::placeholders::_1, std::placeholders::_2);
+    engine->SetTestCallback(pfn);
+
+    qExpectedInput.push_back("\x1b[2J");
+    TestPaint(*engine, [&]() {
+        VERIFY_IS_FALSE(engine->_firstPaint);
+    });
+
+    std::wstring line = L"0123456789abcdefghij";
+    const auto paintLine = [&]() {
+        std::vector<Cluster> clusters;
+        for (size_t i = 0; i < line.size(); i++)
+        {
+            clusters.emplace_back(std::wstring_view{ &line[i], 1 }, 1u);
+        }
+        VERIFY_SUCCEEDED(engine->PaintBufferLine({ clusters.data(), clusters.size() }, { 0, 0 }, false, false));
+    };
+
+    TestPaint(*engine, [&]() {
+        Log::Comment(L"The first time, the whole line is painted.");
+        qExpectedInput.push_back("\x1b[H");
+        qExpectedInput.push_back("0123456789abcdefghij");
+        paintLine();
+    });
+
+    TestPaint(*engine, [&]() {
+        Log::Comment(L"Painting the same line again sends nothing.");
+        qExpectedInput.push_back(EMPTY_CALLBACK_SENTINEL);
+        paintLine();
+        WriteCallback(EMPTY_CALLBACK_SENTINEL, 1);
+    });
+
+    TestPaint(*engine, [&]() {
+        Log::Comment(L"Only the changed cell is painted, the unchanged ones around it are skipped.");
+        line[15] = L'x';
+        qExpectedInput.push_back("\x1b[1;16H");
+        qExpectedInput.push_back("x");
+        paintLine();
+    });
+
+    TestPaint(*engine, [&]() {
+        Log::Comment(L"Short unchanged spans are printed again, long ones are skipped with a CUF.");
+        line[2] = L'X';
+        line[12] = L'Y';
+        qExpectedInput.push_back("\x1b[H");
+        qExpectedInput.push_back("01X");
+        qExpectedInput.push_back("\x1b[9C");
+        qExpectedInput.push_back("Y");
+        paintLine();
+    });
+
+    COORD scrollDelta = { 0, 1 };
+    VERIFY_SUCCEEDED(engine->InvalidateScroll(&scrollDelta));
+    TestPaint(*engine, [&]() {
+        Log::Comment(L"After a scroll, the rows that were scrolled in are painted again.");
+        qExpectedInput.push_back("\x1b[H");
+        qExpectedInput.push_back("\x1b[L");
+        VERIFY_SUCCEEDED(engine->ScrollFrame());
+        qExpectedInput.push_back("01X3456789abYdexghij");
+        paintLine();
+    });
+}
+
 void VtRendererTest::TestResize()
 {
     Viewport view = SetUpViewport();
@@ -15,6 +15,7 @@
 #include "til/rectangle.h"
 #include "til/rle.h"
 #include "til/bitmap.h"
+#include "til/cpu.h"
 #include "til/u8u16convert.h"
 #include "til/spsc.h"
 #include "til/coalesce.h"
@@ -0,0 +1,42 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+
+#pragma once
+
+#if defined(_M_IX86) || defined(_M_AMD64)
+#include <intrin.h>
+#endif
+
+namespace til // Terminal Implementation Library. Also: "Today I Learned"
+{
+    // Returns true if the CPU and the OS support AVX2. The result is determined once.
+    // The CPU has to report AVX2 in CPUID leaf 7, and the OS has to save and restore
+    // the upper halves of the YMM registers (XCR0 bits 1 and 2).
+    inline bool is_avx2_supported() noexcept
+    {
+#if defined(_M_IX86) || defined(_M_AMD64)
+        static const bool supported = []() noexcept {
+            int info[4]{};
+            __cpuid(info, 0);
+            if (info[0] < 7)
+            {
+                return false;
+            }
+            // ECX bit 27 is OSXSAVE and bit 28 is AVX.
+            __cpuid(info, 1);
+            if ((info[2] & (1 << 27)) == 0 || (info[2] & (1 << 28)) == 0 || (_xgetbv(0) & 0x6) != 0x6)
+            {
+                return false;
+            }
+            // EBX bit 5 is AVX2.
+            __cpuidex(info, 7, 0);
+            return (info[1] & (1 << 5)) != 0;
+        }();
+        return supported;
+#elif defined(__AVX2__)
+        return true;
+#else
+        return false;
+#endif
+    }
+}
@@ -376,6 +376,25 @@ namespace til // Terminal Implementation Library. Also: "Today I Learned"
             }
         }
 
+        basic_rle(const size_type length, const value_type& value, const allocator_type& allocator) :
+            _runs(allocator), _total_length(length)
+        {
+            if (length)
+            {
+                _runs.emplace_back(value, length);
+            }
+        }
+
+        basic_rle(const basic_rle& other, const allocator_type& allocator) :
+            _runs(other._runs, allocator), _total_length(other._total_length)
+        {
+        }
+
+        allocator_type get_allocator() const noexcept
+        {
+            return _runs.get_allocator();
+        }
+
         void swap(basic_rle& other) noexcept
         {
             _runs.swap(other._runs);
@@ -1024,6 +1043,12 @@ namespace til // Terminal Implementation Library. Also: "Today I Learned"
 #ifdef BOOST_CONTAINER_CONTAINER_SMALL_VECTOR_HPP
     template<typename T, typename S = std::size_t, std::size_t N = 1>
     using small_rle = basic_rle<T, S, boost::container::small_vector<rle_pair<T, S>, N>>;
+
+    namespace pmr
+    {
+        template<typename T, typename S = std::size_t, std::size_t N = 1>
+        using small_rle = basic_rle<T, S, boost::container::small_vector<rle_pair<T, S>, N, std::pmr::polymorphic_allocator<rle_pair<T, S>>>>;
+    }
 #endif
 };
 
@@ -9,11 +9,14 @@ Abstract:
 - Defines classes which hold the status of the current partials handling.
 - Defines functions for converting between UTF-8 and UTF-16 strings.
 
-Tests have been made in order to investigate whether or not own algorithms
-could overcome disadvantages of syscalls. Test results can be read up
-in PR #4093 and the test algorithms are available in src\tools\U8U16Test.
-Based on the results the decision was made to keep using the platform
-functions MultiByteToWideChar and WideCharToMultiByte.
+The conversions used to be done by the platform functions MultiByteToWideChar
+and WideCharToMultiByte (see PR #4093 and src\tools\U8U16Test for the original
+comparison). Since all output of the pty goes through them, they're now
+implemented here: ASCII is converted in blocks of 16 or 32 code units with SSE2
+or AVX2 (picked at runtime) and everything else one code point at a time.
+Invalid UTF-8 and unpaired surrogates are replaced with U+FFFD, once per
+maximal subpart of an ill-formed sequence, just like the platform functions do.
+The conversion core in til::details doesn't depend on the OS.
 
 Author(s):
 - Steffen Illhardt (german-one), Leonard Hecker (lhecker) 2020-2021
@@ -21,6 +24,21 @@ Author(s):
 
 #pragma once
 
+#if defined(_M_IX86) || defined(_M_AMD64)
+#define TIL_U8U16_SSE2 1
+#define TIL_U8U16_AVX2 1
+#include <intrin.h>
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#define TIL_U8U16_SSE2 1
+#ifdef __AVX2__
+#define TIL_U8U16_AVX2 1
+#endif
+#include <immintrin.h>
+#endif
+
+#include "cpu.h"
+
 namespace til // Terminal Implementation Library. Also: "Today I Learned"
 {
     // state structure for maintenance of UTF-8 partials
@@ -47,6 +65,305 @@ namespace til // Terminal Implementation Library. Also: "Today I Learned"
         }
     };
 
+    namespace details
+    {
+#pragma warning(push)
+#pragma warning(disable : 26429 26481 26490) // use not_null, pointer arithmetic, reinterpret_cast
+
+        // Routine Description:
+        // - Converts the run of ASCII at the start of a UTF-8 string in blocks of up to 32 code units.
+        // Return Value:
+        // - The number of code units converted. The run may continue after them, if it didn't fill a whole block.
+        inline size_t u8u16_ascii(const char* in, const size_t size, char16_t* out) noexcept
+        {
+            size_t i = 0;
+
+#ifdef TIL_U8U16_AVX2
+            if (is_avx2_supported())
+            {
+                for (; i + 32 <= size; i += 32)
+                {
+                    const auto bytes = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(in + i));
+                    if (_mm256_movemask_epi8(bytes) != 0)
+                    {
+                        break;
+                    }
+                    _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i), _mm256_cvtepu8_epi16(_mm256_castsi256_si128(bytes)));
+                    _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i + 16), _mm256_cvtepu8_epi16(_mm256_extracti128_si256(bytes, 1)));
+                }
+            }
+#endif
+
+#ifdef TIL_U8U16_SSE2
+            const auto zero = _mm_setzero_si128();
+            for (; i + 16 <= size; i += 16)
+            {
+                const auto bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i));
+                if (_mm_movemask_epi8(bytes) != 0)
+                {
+                    break;
+                }
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), _mm_unpacklo_epi8(bytes, zero));
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i + 8), _mm_unpackhi_epi8(bytes, zero));
+            }
+#endif
+
+            for (; i + 8 <= size; i += 8)
+            {
+                uint64_t bytes;
+                memcpy(&bytes, in + i, sizeof(bytes));
+                if ((bytes & 0x8080808080808080) != 0)
+                {
+                    break;
+                }
+                for (size_t j = 0; j < 8; ++j)
+                {
+                    out[i + j] = static_cast<char16_t>(in[i + j]);
+                }
+            }
+
+            return i;
+        }
+
+        // Routine Description:
+        // - Converts a UTF-8 string to UTF-16. Ill-formed sequences, including an incomplete one
+        //   at the end of the string, are replaced with one U+FFFD per maximal subpart.
+        // Arguments:
+        // - in - UTF-8 string to be converted
+        // - size - the length of the string
+        // - out - the output buffer, which needs to have room for at least size code units
+        // Return Value:
+        // - The number of UTF-16 code units written
+        inline size_t u8u16_convert(const char* const in, const size_t size, char16_t* const out) noexcept
+        {
+            const auto bytes = reinterpret_cast<const uint8_t*>(in);
+            size_t i = 0;
+            size_t o = 0;
+
+            while (i < size)
+            {
+                const auto ascii = u8u16_ascii(in + i, size - i, out + o);
+                i += ascii;
+                o += ascii;
+
+                // The block the ASCII conversion stopped at is done one code point at a time,
+                // as well as any non-ASCII that follows it, before we try blocks again.
+                const auto blockEnd = i + 32;
+                while (i < size && (i < blockEnd || bytes[i] >= 0x80))
+                {
+                    const auto b0 = bytes[i];
+                    if (b0 < 0x80)
+                    {
+                        out[o++] = b0;
+                        i += 1;
+                        continue;
+                    }
+
+                    // The valid range of the second byte depends on the lead byte, which rules out
+                    // overlong encodings, surrogates and code points above U+10FFFF.
+                    uint8_t length = 0;
+                    uint8_t min = 0x80;
+                    uint8_t max = 0xBF;
+                    if (b0 >= 0xC2 && b0 <= 0xDF)
+                    {
+                        length = 2;
+                    }
+                    else if (b0 >= 0xE0 && b0 <= 0xEF)
+                    {
+                        length = 3;
+                        min = b0 == 0xE0 ? 0xA0 : 0x80;
+                        max = b0 == 0xED ? 0x9F : 0xBF;
+                    }
+                    else if (b0 >= 0xF0 && b0 <= 0xF4)
+                    {
+                        length = 4;
+                        min = b0 == 0xF0 ? 0x90 : 0x80;
+                        max = b0 == 0xF4 ? 0x8F : 0xBF;
+                    }
+
+                    // Count how many bytes form a valid prefix of a sequence.
+                    uint8_t valid = 1;
+                    if (length != 0 && i + 1 < size && bytes[i + 1] >= min && bytes[i + 1] <= max)
+                    {
+                        valid = 2;
+                        while (valid < length && i + valid < size && (bytes[i + valid] & 0xC0) == 0x80)
+                        {
+                            ++valid;
+                        }
+                    }
+
+                    if (valid != length)
+                    {
+                        out[o++] = 0xFFFD;
+                        i += valid;
+                        continue;
+                    }
+
+                    char32_t codepoint = b0 & (0x7F >> length);
+                    for (uint8_t j = 1; j < length; ++j)
+                    {
+                        codepoint = (codepoint << 6) | (bytes[i + j] & 0x3F);
+                    }
+                    i += length;
+
+                    if (codepoint < 0x10000)
+                    {
+                        out[o++] = static_cast<char16_t>(codepoint);
+                    }
+                    else
+                    {
+                        codepoint -= 0x10000;
+                        out[o++] = static_cast<char16_t>(0xD800 | (codepoint >> 10));
+                        out[o++] = static_cast<char16_t>(0xDC00 | (codepoint & 0x3FF));
+                    }
+                }
+            }
+
+            return o;
+        }
+
+        // Routine Description:
+        // - Converts the run of ASCII at the start of a UTF-16 string in blocks of up to 32 code units.
+        // Return Value:
+        // - The number of code units converted. The run may continue after them, if it didn't fill a whole block.
+        inline size_t u16u8_ascii(const char16_t* in, const size_t size, char* out) noexcept
+        {
+            size_t i = 0;
+
+#ifdef TIL_U8U16_AVX2
+            if (is_avx2_supported())
+            {
+                const auto nonAscii = _mm256_set1_epi16(static_cast<short>(0xFF80));
+                for (; i + 32 <= size; i += 32)
+                {
+                    const auto a = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(in + i));
+                    const auto b = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(in + i + 16));
+                    if (!_mm256_testz_si256(_mm256_or_si256(a, b), nonAscii))
+                    {
+                        break;
+                    }
+                    // packus works within 128-bit lanes, so the 64-bit quarters have to be put back in order.
+                    const auto packed = _mm256_permute4x64_epi64(_mm256_packus_epi16(a, b), 0b11'01'10'00);
+                    _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i), packed);
+                }
+            }
+#endif
+
+#ifdef TIL_U8U16_SSE2
+            const auto zero = _mm_setzero_si128();
+            const auto nonAscii = _mm_set1_epi16(static_cast<short>(0xFF80));
+            for (; i + 16 <= size; i += 16)
+            {
+                const auto a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i));
+                const auto b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i + 8));
+                const auto ascii = _mm_cmpeq_epi16(_mm_and_si128(_mm_or_si128(a, b), nonAscii), zero);
+                if (_mm_movemask_epi8(ascii) != 0xFFFF)
+                {
+                    break;
+                }
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), _mm_packus_epi16(a, b));
+            }
+#endif
+
+            for (; i + 4 <= size; i += 4)
+            {
+                uint64_t units;
+                memcpy(&units, in + i, sizeof(units));
+                if ((units & 0xFF80FF80FF80FF80) != 0)
+                {
+                    break;
+                }
+                for (size_t j = 0; j < 4; ++j)
+                {
+                    out[i + j] = static_cast<char>(in[i + j]);
+                }
+            }
+
+            return i;
+        }
+
+        // Routine Description:
+        // - Converts a UTF-16 string to UTF-8. Unpaired surrogates, including a high surrogate
+        //   at the end of the string, are replaced with U+FFFD.
+        // Arguments:
+        // - in - UTF-16 string to be converted
+        // - size - the length of the string
+        // - out - the output buffer, which needs to have room for at least 3 * size code units
+        // Return Value:
+        // - The number of UTF-8 code units written
+        inline size_t u16u8_convert(const char16_t* const in, const size_t size, char* const out) noexcept
+        {
+            size_t i = 0;
+            size_t o = 0;
+
+            while (i < size)
+            {
+                const auto ascii = u16u8_ascii(in + i, size - i, out + o);
+                i += ascii;
+                o += ascii;
+
+                // See u8u16_convert.
+                const auto blockEnd = i + 32;
+                while (i < size && (i < blockEnd || in[i] >= 0x80))
+                {
+                    char32_t codepoint = in[i++];
+                    if (codepoint >= 0xD800 && codepoint <= 0xDFFF)
+                    {
+                        if (codepoint <= 0xDBFF && i < size && in[i] >= 0xDC00 && in[i] <= 0xDFFF)
+                        {
+                            codepoint = 0x10000 + ((codepoint - 0xD800) << 10) + (in[i++] - 0xDC00);
+                        }
+                        else
+                        {
+                            codepoint = 0xFFFD;
+                        }
+                    }
+
+                    if (codepoint < 0x80)
+                    {
+                        out[o++] = static_cast<char>(codepoint);
+                    }
+                    else if (codepoint < 0x800)
+                    {
+                        out[o++] = static_cast<char>(0xC0 | (codepoint >> 6));
+                        out[o++] = static_cast<char>(0x80 | (codepoint & 0x3F));
+                    }
+                    else if (codepoint < 0x10000)
+                    {
+                        out[o++] = static_cast<char>(0xE0 | (codepoint >> 12));
+                        out[o++] = static_cast<char>(0x80 | ((codepoint >> 6) & 0x3F));
+                        out[o++] = static_cast<char>(0x80 | (codepoint & 0x3F));
+                    }
+                    else
+                    {
+                        out[o++] = static_cast<char>(0xF0 | (codepoint >> 18));
+                        out[o++] = static_cast<char>(0x80 | ((codepoint >> 12) & 0x3F));
+                        out[o++] = static_cast<char>(0x80 | ((codepoint >> 6) & 0x3F));
+                        out[o++] = static_cast<char>(0x80 | (codepoint & 0x3F));
+                    }
+                }
+            }
+
+            return o;
+        }
+
+        template<typename T>
+        char16_t* as_char16(T* ptr) noexcept
+        {
+            static_assert(sizeof(T) == sizeof(char16_t), "UTF-16 strings need 16-bit code units");
+            return reinterpret_cast<char16_t*>(ptr);
+        }
+
+        template<typename T>
+        const char16_t* as_char16(const T* ptr) noexcept
+        {
+            static_assert(sizeof(T) == sizeof(char16_t), "UTF-16 strings need 16-bit code units");
+            return reinterpret_cast<const char16_t*>(ptr);
+        }
+
+#pragma warning(pop)
+    }
+
     // Routine Description:
     // - Takes a UTF-8 string and performs the conversion to UTF-16. NOTE: The function relies on getting complete UTF-8 characters at the string boundaries.
     // Arguments:
@@ -55,8 +372,6 @@ namespace til // Terminal Implementation Library. Also: "Today I Learned"
     // Return Value:
     // - S_OK          - the conversion succeeded
     // - E_OUTOFMEMORY - the function failed to allocate memory for the resulting string
-    // - E_ABORT       - the resulting string length would exceed the upper boundary of an int and thus, the conversion was aborted before the conversion has been completed
-    // - E_UNEXPECTED  - the underlying conversion function failed
     // - HRESULT value converted from a caught exception
     template<class outT>
     [[nodiscard]] HRESULT u8u16(const std::string_view& in, outT& out) noexcept
@@ -66,14 +381,12 @@ namespace til // Terminal Implementation Library. Also: "Today I Learned"
             out.clear();
             RETURN_HR_IF(S_OK, in.empty());
 
-            int lengthRequired{};
             // The worst ratio of UTF-8 code units to UTF-16 code units is 1 to 1 if UTF-8 consists of ASCII only.
-            RETURN_HR_IF(E_ABORT, !base::MakeCheckedNum(in.length()).AssignIfValid(&lengthRequired));
-            out.resize(in.length()); // avoid to call MultiByteToWideChar twice only to get the required size
-            const int lengthOut = MultiByteToWideChar(CP_UTF8, 0ul, in.data(), lengthRequired, out.data(), lengthRequired);
-            out.resize(gsl::narrow_cast<size_t>(lengthOut));
+            out.resize(in.length());
+            const auto lengthOut = details::u8u16_convert(in.data(), in.length(), details::as_char16(out.data()));
+            out.resize(lengthOut);
 
-            return lengthOut == 0 ? E_UNEXPECTED : S_OK;
+            return S_OK;
         }
         CATCH_RETURN();
     }
@@ -89,8 +402,6 @@ namespace til // Terminal Implementation Library. Also: "Today I Learned"
     // Return Value:
     // - S_OK          - the conversion succeeded
     // - E_OUTOFMEMORY - the function failed to allocate memory for the resulting string
-    // - E_ABORT       - the resulting string length would exceed the upper boundary of an int and thus, the conversion was aborted before the conversion has been completed
-    // - E_UNEXPECTED  - the underlying conversion function failed
     // - HRESULT value converted from a caught exception
     template<class outT>
     [[nodiscard]] HRESULT u8u16(const std::string_view& in, outT& out, u8state& state) noexcept
@@ -100,17 +411,15 @@ namespace til // Terminal Implementation Library. Also: "Today I Learned"
             out.clear();
             RETURN_HR_IF(S_OK, in.empty());
 
-            int capa16{};
             // The worst ratio of UTF-8 code units to UTF-16 code units is 1 to 1 if UTF-8 consists of ASCII only.
-            RETURN_HR_IF(E_ABORT, !base::CheckAdd(in.length(), state.have).AssignIfValid(&capa16));
-
-            out.resize(gsl::narrow_cast<size_t>(capa16));
-            auto len8{ gsl::narrow_cast<int>(in.length()) };
-            int len16{};
+            out.resize(in.length() + state.have);
+            const auto out16{ details::as_char16(out.data()) };
+            auto len8{ in.length() };
+            size_t len16{};
             auto cursor8{ in.data() };
             if (state.have)
             {
-                const auto copyable{ std::min<int>(state.want, len8) };
+                const auto copyable{ std::min<size_t>(state.want, len8) };
                 std::move(cursor8, cursor8 + copyable, &state.partials[state.have]);
                 state.have += gsl::narrow_cast<uint8_t>(copyable);
                 state.want -= gsl::narrow_cast<uint8_t>(copyable);
@@ -120,10 +429,8 @@ namespace til // Terminal Implementation Library. Also: "Today I Learned"
                     return S_OK;
                 }
 
-                len16 = MultiByteToWideChar(CP_UTF8, 0UL, &state.partials[0], gsl::narrow_cast<int>(state.have), out.data(), capa16);
-                RETURN_HR_IF(E_UNEXPECTED, !len16);
+                len16 = details::u8u16_convert(&state.partials[0], state.have, out16);
 
-                capa16 -= len16;
                 len8 -= copyable;
                 cursor8 += copyable;
                 // state.want is already zero at this point
@@ -133,7 +440,7 @@ namespace til // Terminal Implementation Library. Also: "Today I Learned"
             if (len8)
             {
                 auto backIter{ cursor8 + len8 - 1 };
-                int sequenceLen{ 1 };
+                size_t sequenceLen{ 1 };
 
                 // skip UTF8 continuation bytes
                 while (backIter != cursor8 && (*backIter & 0b11'000000) == 0b10'000000)
@@ -158,13 +465,10 @@ namespace til // Terminal Implementation Library. Also: "Today I Learned"
 
             if (len8)
             {
-                const auto convLen{ MultiByteToWideChar(CP_UTF8, 0UL, cursor8, len8, out.data() + len16, capa16) };
-                RETURN_HR_IF(E_UNEXPECTED, !convLen);
-
-                len16 += convLen;
+                len16 += details::u8u16_convert(cursor8, len8, out16 + len16);
             }
 
-            out.resize(gsl::narrow_cast<size_t>(len16));
+            out.resize(len16);
             return S_OK;
         }
         CATCH_RETURN();
@@ -179,8 +483,7 @@ namespace til // Terminal Implementation Library. Also: "Today I Learned"
     // Return Value:
     // - S_OK          - the conversion succeeded
     // - E_OUTOFMEMORY - the function failed to allocate memory for the resulting string
-    // - E_ABORT       - the resulting string length would exceed the upper boundary of an int and thus, the conversion was aborted before the conversion has been completed
-    // - E_UNEXPECTED  - the underlying conversion function failed
+    // - E_ABORT       - the resulting string length would overflow size_t
     // - HRESULT value converted from a caught exception
     template<class outT>
     [[nodiscard]] HRESULT u16u8(const std::wstring_view& in, outT& out) noexcept
@@ -190,17 +493,15 @@ namespace til // Terminal Implementation Library. Also: "Today I Learned"
             out.clear();
             RETURN_HR_IF(S_OK, in.empty());
 
-            int lengthIn{};
-            int lengthRequired{};
             // Code Point U+0000..U+FFFF: 1 UTF-16 code unit --> 1..3 UTF-8 code units.
             // Code Points >U+FFFF: 2 UTF-16 code units --> 4 UTF-8 code units.
             // Thus, the worst ratio of UTF-16 code units to UTF-8 code units is 1 to 3.
-            RETURN_HR_IF(E_ABORT, !base::MakeCheckedNum(in.length()).AssignIfValid(&lengthIn) || !base::CheckMul(lengthIn, 3).AssignIfValid(&lengthRequired));
-            out.resize(gsl::narrow_cast<size_t>(lengthRequired)); // avoid to call WideCharToMultiByte twice only to get the required size
-            const int lengthOut = WideCharToMultiByte(CP_UTF8, 0ul, in.data(), lengthIn, out.data(), lengthRequired, nullptr, nullptr);
-            out.resize(gsl::narrow_cast<size_t>(lengthOut));
+            RETURN_HR_IF(E_ABORT, in.length() > SIZE_MAX / 3);
+            out.resize(in.length() * 3);
+            const auto lengthOut = details::u16u8_convert(details::as_char16(in.data()), in.length(), out.data());
+            out.resize(lengthOut);
 
-            return lengthOut == 0 ? E_UNEXPECTED : S_OK;
+            return S_OK;
         }
         CATCH_RETURN();
     }
@@ -216,8 +517,7 @@ namespace til // Terminal Implementation Library. Also: "Today I Learned"
     // Return Value:
     // - S_OK          - the conversion succeeded without any change of the represented code points
     // - E_OUTOFMEMORY - the function failed to allocate memory for the resulting string
-    // - E_ABORT       - the resulting string length would exceed the upper boundary of an int and thus, the conversion was aborted before the conversion has been completed
-    // - E_UNEXPECTED  - the underlying conversion function failed
+    // - E_ABORT       - the resulting string length would overflow size_t
     // - HRESULT value converted from a caught exception
     template<class outT>
     [[nodiscard]] HRESULT u16u8(const std::wstring_view& in, outT& out, u16state& state) noexcept
@@ -227,22 +527,19 @@ namespace til // Terminal Implementation Library. Also: "Today I Learned"
             out.clear();
             RETURN_HR_IF(S_OK, in.empty());
 
-            int len16{};
-            int capa8{};
+            auto len16{ in.length() };
             // The worst ratio of UTF-16 code units to UTF-8 code units is 1 to 3.
-            RETURN_HR_IF(E_ABORT, !base::MakeCheckedNum(in.length()).AssignIfValid(&len16) || !base::CheckAdd(len16, gsl::narrow_cast<int>(state.partials[0]) != 0).AssignIfValid(&capa8) || !base::CheckMul(capa8, 3).AssignIfValid(&capa8));
+            RETURN_HR_IF(E_ABORT, len16 >= SIZE_MAX / 3);
 
-            out.resize(gsl::narrow_cast<size_t>(capa8));
-            int len8{};
+            out.resize((len16 + (state.partials[0] != 0)) * 3);
+            size_t len8{};
             auto cursor16{ in.data() };
             if (state.partials[0])
             {
                 state.partials[1] = *cursor16;
-                len8 = WideCharToMultiByte(CP_UTF8, 0UL, &state.partials[0], 2, out.data(), capa8, nullptr, nullptr);
-                RETURN_HR_IF(E_UNEXPECTED, !len8);
+                len8 = details::u16u8_convert(details::as_char16(&state.partials[0]), 2, out.data());
 
                 state.reset();
-                capa8 -= len8;
                 --len16;
                 ++cursor16;
             }
@@ -259,13 +556,10 @@ namespace til // Terminal Implementation Library. Also: "Today I Learned"
 
             if (len16)
             {
-                const auto convLen{ WideCharToMultiByte(CP_UTF8, 0UL, cursor16, len16, out.data() + len8, capa8, nullptr, nullptr) };
-                RETURN_HR_IF(E_UNEXPECTED, !convLen);
-
-                len8 += convLen;
+                len8 += details::u16u8_convert(details::as_char16(cursor16), len16, out.data() + len8);
             }
 
-            out.resize(gsl::narrow_cast<size_t>(len8));
+            out.resize(len8);
             return S_OK;
         }
         CATCH_RETURN();
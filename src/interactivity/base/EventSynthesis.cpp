@@ -44,8 +44,60 @@ static CodepointWidth GetQuickCharWidthLegacyForNumpadEventSynthesis(const wchar
     return CodepointWidth::Invalid;
 }
 
+// Routine Description:
+// - appends a KEY_EVENT record to records
+static void _AppendKeyRecord(std::vector<INPUT_RECORD>& records,
+                             const bool keyDown,
+                             const WORD virtualKeyCode,
+                             const WORD virtualScanCode,
+                             const wchar_t charData,
+                             const DWORD activeModifierKeys)
+{
+    auto& record = records.emplace_back();
+    record.EventType = KEY_EVENT;
+    record.Event.KeyEvent.bKeyDown = keyDown;
+    record.Event.KeyEvent.wRepeatCount = 1;
+    record.Event.KeyEvent.wVirtualKeyCode = virtualKeyCode;
+    record.Event.KeyEvent.wVirtualScanCode = virtualScanCode;
+    record.Event.KeyEvent.uChar.UnicodeChar = charData;
+    record.Event.KeyEvent.dwControlKeyState = activeModifierKeys;
+}
+
+// Routine Description:
+// - wraps each of the given KEY_EVENT records in a KeyEvent
+static std::deque<std::unique_ptr<KeyEvent>> _ToKeyEvents(const std::vector<INPUT_RECORD>& records)
+{
+    std::deque<std::unique_ptr<KeyEvent>> keyEvents;
+    for (const auto& record : records)
+    {
+        keyEvents.push_back(std::make_unique<KeyEvent>(record.Event.KeyEvent));
+    }
+    return keyEvents;
+}
+
 std::deque<std::unique_ptr<KeyEvent>> Microsoft::Console::Interactivity::CharToKeyEvents(const wchar_t wch,
                                                                                          const unsigned int codepage)
+{
+    std::vector<INPUT_RECORD> records;
+    CharToKeyRecords(wch, codepage, records);
+    return _ToKeyEvents(records);
+}
+
+// Routine Description:
+// - converts a wchar_t into the KEY_EVENT records that type it, appending
+// them to records. This is what CharToKeyEvents does, without allocating
+// a KeyEvent for each record, so that whole strings can be converted at once.
+// Arguments:
+// - wch - the wchar_t to convert
+// - codepage - the codepage to use if the char has to be typed using alt + numpad
+// - records - where to append the records
+// Return Value:
+// - <none>
+// Note:
+// - will throw exception on error
+void Microsoft::Console::Interactivity::CharToKeyRecords(const wchar_t wch,
+                                                         const unsigned int codepage,
+                                                         std::vector<INPUT_RECORD>& records)
 {
     const short invalidKey = -1;
     short keyState = VkKeyScanW(wch);
@@ -65,13 +117,14 @@ std::deque<std::unique_ptr<KeyEvent>> Microsoft::Console::Interactivity::CharToK
                 // It wasn't alphanumeric or determined to be wide by the old algorithm
                 // if VkKeyScanW fails (char is not in kbd layout), we must
                 // emulate the key being input through the numpad
-                return SynthesizeNumpadEvents(wch, codepage);
+                SynthesizeNumpadRecords(wch, codepage, records);
+                return;
             }
         }
-        keyState = 0; // SynthesizeKeyboardEvents would rather get 0 than -1
+        keyState = 0; // SynthesizeKeyboardRecords would rather get 0 than -1
     }
 
-    return SynthesizeKeyboardEvents(wch, keyState);
+    SynthesizeKeyboardRecords(wch, keyState, records);
 }
 
 // Routine Description:
@@ -84,79 +137,95 @@ std::deque<std::unique_ptr<KeyEvent>> Microsoft::Console::Interactivity::CharToK
 // Note:
 // - will throw exception on error
 std::deque<std::unique_ptr<KeyEvent>> Microsoft::Console::Interactivity::SynthesizeKeyboardEvents(const wchar_t wch, const short keyState)
+{
+    std::vector<INPUT_RECORD> records;
+    SynthesizeKeyboardRecords(wch, keyState, records);
+    return _ToKeyEvents(records);
+}
+
+// Routine Description:
+// - converts a wchar_t into a series of KEY_EVENT records as if it was typed
+// using the keyboard
+// Arguments:
+// - wch - the wchar_t to convert
+// - keyState - the result of VkKeyScanW for wch
+// - records - where to append the records
+// Return Value:
+// - <none>
+// Note:
+// - will throw exception on error
+void Microsoft::Console::Interactivity::SynthesizeKeyboardRecords(const wchar_t wch,
+                                                                  const short keyState,
+                                                                  std::vector<INPUT_RECORD>& records)
 {
     const byte modifierState = HIBYTE(keyState);
 
     bool altGrSet = false;
     bool shiftSet = false;
-    std::deque<std::unique_ptr<KeyEvent>> keyEvents;
 
     // add modifier key event if necessary
     if (WI_AreAllFlagsSet(modifierState, VkKeyScanModState::CtrlAndAltPressed))
     {
         altGrSet = true;
-        keyEvents.push_back(std::make_unique<KeyEvent>(true,
-                                                       1ui16,
-                                                       static_cast<WORD>(VK_MENU),
-                                                       altScanCode,
-                                                       UNICODE_NULL,
-                                                       (ENHANCED_KEY | LEFT_CTRL_PRESSED | RIGHT_ALT_PRESSED)));
+        _AppendKeyRecord(records,
+                         true,
+                         static_cast<WORD>(VK_MENU),
+                         altScanCode,
+                         UNICODE_NULL,
+                         (ENHANCED_KEY | LEFT_CTRL_PRESSED | RIGHT_ALT_PRESSED));
     }
     else if (WI_IsFlagSet(modifierState, VkKeyScanModState::ShiftPressed))
     {
         shiftSet = true;
-        keyEvents.push_back(std::make_unique<KeyEvent>(true,
-                                                       1ui16,
-                                                       static_cast<WORD>(VK_SHIFT),
-                                                       leftShiftScanCode,
-                                                       UNICODE_NULL,
-                                                       SHIFT_PRESSED));
+        _AppendKeyRecord(records,
+                         true,
+                         static_cast<WORD>(VK_SHIFT),
+                         leftShiftScanCode,
+                         UNICODE_NULL,
+                         SHIFT_PRESSED);
     }
 
     const auto vk = LOBYTE(keyState);
     const WORD virtualScanCode = gsl::narrow<WORD>(MapVirtualKeyW(vk, MAPVK_VK_TO_VSC));
-    KeyEvent keyEvent{ true, 1, LOBYTE(keyState), virtualScanCode, wch, 0 };
+    DWORD activeModifierKeys = 0;
 
     // add modifier flags if necessary
     if (WI_IsFlagSet(modifierState, VkKeyScanModState::ShiftPressed))
     {
-        keyEvent.ActivateModifierKey(ModifierKeyState::Shift);
+        WI_SetFlag(activeModifierKeys, SHIFT_PRESSED);
     }
     if (WI_IsFlagSet(modifierState, VkKeyScanModState::CtrlPressed))
     {
-        keyEvent.ActivateModifierKey(ModifierKeyState::LeftCtrl);
+        WI_SetFlag(activeModifierKeys, LEFT_CTRL_PRESSED);
     }
     if (WI_AreAllFlagsSet(modifierState, VkKeyScanModState::CtrlAndAltPressed))
     {
-        keyEvent.ActivateModifierKey(ModifierKeyState::RightAlt);
+        WI_SetFlag(activeModifierKeys, RIGHT_ALT_PRESSED);
     }
 
     // add key event down and up
-    keyEvents.push_back(std::make_unique<KeyEvent>(keyEvent));
-    keyEvent.SetKeyDown(false);
-    keyEvents.push_back(std::make_unique<KeyEvent>(keyEvent));
+    _AppendKeyRecord(records, true, vk, virtualScanCode, wch, activeModifierKeys);
+    _AppendKeyRecord(records, false, vk, virtualScanCode, wch, activeModifierKeys);
 
     // add modifier key up event
     if (altGrSet)
     {
-        keyEvents.push_back(std::make_unique<KeyEvent>(false,
-                                                       1ui16,
-                                                       static_cast<WORD>(VK_MENU),
-                                                       altScanCode,
-                                                       UNICODE_NULL,
-                                                       ENHANCED_KEY));
+        _AppendKeyRecord(records,
+                         false,
+                         static_cast<WORD>(VK_MENU),
+                         altScanCode,
+                         UNICODE_NULL,
+                         ENHANCED_KEY);
     }
     else if (shiftSet)
     {
-        keyEvents.push_back(std::make_unique<KeyEvent>(false,
-                                                       1ui16,
-                                                       static_cast<WORD>(VK_SHIFT),
-                                                       leftShiftScanCode,
-                                                       UNICODE_NULL,
-                                                       0));
+        _AppendKeyRecord(records,
+                         false,
+                         static_cast<WORD>(VK_SHIFT),
+                         leftShiftScanCode,
+                         UNICODE_NULL,
+                         0);
     }
-
-    return keyEvents;
 }
 
 // Routine Description:
@@ -171,15 +240,33 @@ std::deque<std::unique_ptr<KeyEvent>> Microsoft::Console::Interactivity::Synthes
 // - will throw exception on error
 std::deque<std::unique_ptr<KeyEvent>> Microsoft::Console::Interactivity::SynthesizeNumpadEvents(const wchar_t wch, const unsigned int codepage)
 {
-    std::deque<std::unique_ptr<KeyEvent>> keyEvents;
+    std::vector<INPUT_RECORD> records;
+    SynthesizeNumpadRecords(wch, codepage, records);
+    return _ToKeyEvents(records);
+}
 
+// Routine Description:
+// - converts a wchar_t into a series of KEY_EVENT records as if it was typed
+// using Alt + numpad
+// Arguments:
+// - wch - the wchar_t to convert
+// - codepage - the codepage to convert wch to before typing its code
+// - records - where to append the records
+// Return Value:
+// - <none>
+// Note:
+// - will throw exception on error
+void Microsoft::Console::Interactivity::SynthesizeNumpadRecords(const wchar_t wch,
+                                                                const unsigned int codepage,
+                                                                std::vector<INPUT_RECORD>& records)
+{
     //alt keydown
-    keyEvents.push_back(std::make_unique<KeyEvent>(true,
-                                                   1ui16,
-                                                   static_cast<WORD>(VK_MENU),
-                                                   altScanCode,
-                                                   UNICODE_NULL,
-                                                   LEFT_ALT_PRESSED));
+    _AppendKeyRecord(records,
+                     true,
+                     static_cast<WORD>(VK_MENU),
+                     altScanCode,
+                     UNICODE_NULL,
+                     LEFT_ALT_PRESSED);
 
     std::wstring wstr{ wch };
     const auto convertedChars = ConvertToA(codepage, wstr);
@@ -206,27 +293,26 @@ std::deque<std::unique_ptr<KeyEvent>> Microsoft::Console::Interactivity::Synthes
             const WORD virtualKey = ch - '0' + VK_NUMPAD0;
             const WORD virtualScanCode = gsl::narrow<WORD>(MapVirtualKeyW(virtualKey, MAPVK_VK_TO_VSC));
 
-            keyEvents.push_back(std::make_unique<KeyEvent>(true,
-                                                           1ui16,
-                                                           virtualKey,
-                                                           virtualScanCode,
-                                                           UNICODE_NULL,
-                                                           LEFT_ALT_PRESSED));
-            keyEvents.push_back(std::make_unique<KeyEvent>(false,
-                                                           1ui16,
-                                                           virtualKey,
-                                                           virtualScanCode,
-                                                           UNICODE_NULL,
-                                                           LEFT_ALT_PRESSED));
+            _AppendKeyRecord(records,
+                             true,
+                             virtualKey,
+                             virtualScanCode,
+                             UNICODE_NULL,
+                             LEFT_ALT_PRESSED);
+            _AppendKeyRecord(records,
+                             false,
+                             virtualKey,
+                             virtualScanCode,
+                             UNICODE_NULL,
+                             LEFT_ALT_PRESSED);
         }
     }
 
     // alt keyup
-    keyEvents.push_back(std::make_unique<KeyEvent>(false,
-                                                   1ui16,
-                                                   static_cast<WORD>(VK_MENU),
-                                                   altScanCode,
-                                                   wch,
-                                                   0));
-    return keyEvents;
+    _AppendKeyRecord(records,
+                     false,
+                     static_cast<WORD>(VK_MENU),
+                     altScanCode,
+                     wch,
+                     0);
 }
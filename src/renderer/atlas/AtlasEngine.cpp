@@ -409,6 +409,13 @@ CATCH_RETURN()
     return continuousRedraw;
 }
 
+[[nodiscard]] bool AtlasEngine::CanPaintWithoutLock() noexcept
+{
+    // The terminal control only resizes us and changes our font and settings
+    // through Renderer::UpdateEngines, which waits for the frame to finish.
+    return true;
+}
+
 void AtlasEngine::WaitUntilCanRender() noexcept
 {
     if constexpr (!debugGeneralPerformance)
@@ -70,6 +70,17 @@ HRESULT RenderEngineBase::PrepareLineTransform(const LineRendition /*lineRenditi
     return false;
 }
 
+// Method Description:
+// - By default, engines are painted with the console lock held. Engines
+//   whose state is only ever touched through the Renderer, including
+//   Renderer::UpdateEngines, can return true, which allows the console to
+//   process output while they paint. They must not ask for a repaint in
+//   InvalidateCircling. See Renderer::_PaintFrameForEngine.
+[[nodiscard]] bool RenderEngineBase::CanPaintWithoutLock() noexcept
+{
+    return false;
+}
+
 // Method Description:
 // - Blocks until the engine is able to render without blocking.
 void RenderEngineBase::WaitUntilCanRender() noexcept
@@ -0,0 +1,233 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+
+#include "precomp.h"
+
+#include "RenderFrame.hpp"
+
+#pragma hdrstop
+
+using namespace Microsoft::Console::Render;
+using namespace Microsoft::Console::Types;
+
+// Routine Description:
+// - Empties the frame for the next capture. The vectors keep their capacity,
+//   so that a steady stream of frames doesn't allocate.
+// Arguments:
+// - <none>
+// Return Value:
+// - <none>
+void RenderFrame::Clear() noexcept
+{
+    cursor.reset();
+    selection.clear();
+    title.clear();
+    rows.clear();
+    overlayRows.clear();
+    runs.clear();
+    gridLines.clear();
+    clusters.clear();
+    _text.clear();
+    _clusterText.clear();
+}
+
+// Routine Description:
+// - Copies the text of a cluster into the frame.
+// Arguments:
+// - text - The UTF-16 text of the cluster.
+// - columns - The number of columns the cluster occupies.
+// Return Value:
+// - <none>
+void RenderFrame::AppendCluster(const std::wstring_view text, const size_t columns)
+{
+    _clusterText.emplace_back(ClusterText{ _text.size(), text.size(), columns });
+    _text.append(text);
+}
+
+// Routine Description:
+// - Returns the number of clusters appended so far.
+// Arguments:
+// - <none>
+// Return Value:
+// - The index the next appended cluster will have.
+size_t RenderFrame::ClusterCount() const noexcept
+{
+    return _clusterText.size();
+}
+
+// Routine Description:
+// - Builds the clusters once all the text has been appended.
+//   Our copy of the text may reallocate while the frame is captured,
+//   which is why the clusters can't be created right away.
+// Arguments:
+// - <none>
+// Return Value:
+// - <none>
+void RenderFrame::Seal()
+{
+    const std::wstring_view text{ _text };
+
+    clusters.clear();
+    clusters.reserve(_clusterText.size());
+    for (const auto& c : _clusterText)
+    {
+        clusters.emplace_back(text.substr(c.offset, c.length), c.columns);
+    }
+}
+
+RenderFrameData::RenderFrameData(IRenderData* const pData) noexcept :
+    _pData{ pData },
+    _colors{}
+{
+}
+
+// Routine Description:
+// - Sets the attributes of the run that is about to be painted.
+//   GetAttributeColors() answers for these from the frame.
+// Arguments:
+// - attributes - The attributes passed to UpdateDrawingBrushes.
+// - colors - The colors of these attributes at the time the frame was captured.
+// Return Value:
+// - <none>
+void RenderFrameData::SetAttributes(const TextAttribute& attributes, const std::pair<COLORREF, COLORREF> colors) noexcept
+{
+    _attributes = attributes;
+    _colors = colors;
+}
+
+#pragma region IBaseData
+
+Viewport RenderFrameData::GetViewport() noexcept
+{
+    return _pData->GetViewport();
+}
+
+COORD RenderFrameData::GetTextBufferEndPosition() const noexcept
+{
+    return _pData->GetTextBufferEndPosition();
+}
+
+const TextBuffer& RenderFrameData::GetTextBuffer() noexcept
+{
+    return _pData->GetTextBuffer();
+}
+
+const FontInfo& RenderFrameData::GetFontInfo() noexcept
+{
+    return _pData->GetFontInfo();
+}
+
+std::pair<COLORREF, COLORREF> RenderFrameData::GetAttributeColors(const TextAttribute& attr) const noexcept
+{
+    if (attr == _attributes)
+    {
+        return _colors;
+    }
+    return _pData->GetAttributeColors(attr);
+}
+
+std::vector<Viewport> RenderFrameData::GetSelectionRects() noexcept
+{
+    return _pData->GetSelectionRects();
+}
+
+void RenderFrameData::LockConsole() noexcept
+{
+    _pData->LockConsole();
+}
+
+void RenderFrameData::UnlockConsole() noexcept
+{
+    _pData->UnlockConsole();
+}
+
+#pragma endregion
+
+#pragma region IRenderData
+
+const TextAttribute RenderFrameData::GetDefaultBrushColors() noexcept
+{
+    return _pData->GetDefaultBrushColors();
+}
+
+COORD RenderFrameData::GetCursorPosition() const noexcept
+{
+    return _pData->GetCursorPosition();
+}
+
+bool RenderFrameData::IsCursorVisible() const noexcept
+{
+    return _pData->IsCursorVisible();
+}
+
+bool RenderFrameData::IsCursorOn() const noexcept
+{
+    return _pData->IsCursorOn();
+}
+
+ULONG RenderFrameData::GetCursorHeight() const noexcept
+{
+    return _pData->GetCursorHeight();
+}
+
+CursorType RenderFrameData::GetCursorStyle() const noexcept
+{
+    return _pData->GetCursorStyle();
+}
+
+ULONG RenderFrameData::GetCursorPixelWidth() const noexcept
+{
+    return _pData->GetCursorPixelWidth();
+}
+
+COLORREF RenderFrameData::GetCursorColor() const noexcept
+{
+    return _pData->GetCursorColor();
+}
+
+bool RenderFrameData::IsCursorDoubleWidth() const
+{
+    return _pData->IsCursorDoubleWidth();
+}
+
+bool RenderFrameData::IsScreenReversed() const noexcept
+{
+    return _pData->IsScreenReversed();
+}
+
+const std::vector<RenderOverlay> RenderFrameData::GetOverlays() const noexcept
+{
+    return _pData->GetOverlays();
+}
+
+const bool RenderFrameData::IsGridLineDrawingAllowed() noexcept
+{
+    return _pData->IsGridLineDrawingAllowed();
+}
+
+const std::wstring_view RenderFrameData::GetConsoleTitle() const noexcept
+{
+    return _pData->GetConsoleTitle();
+}
+
+const std::wstring RenderFrameData::GetHyperlinkUri(uint16_t id) const noexcept
+{
+    return _pData->GetHyperlinkUri(id);
+}
+
+const std::wstring RenderFrameData::GetHyperlinkCustomId(uint16_t id) const noexcept
+{
+    return _pData->GetHyperlinkCustomId(id);
+}
+
+const std::vector<size_t> RenderFrameData::GetPatternId(const COORD location) const noexcept
+{
+    return _pData->GetPatternId(location);
+}
+
+void RenderFrameData::TakeDirtyRegions(std::vector<SMALL_RECT>& regions)
+{
+    _pData->TakeDirtyRegions(regions);
+}
+
+#pragma endregion
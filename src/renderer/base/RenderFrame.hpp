@@ -0,0 +1,144 @@
+/*++
+Copyright (c) Microsoft Corporation
+Licensed under the MIT license.
+
+Module Name:
+- RenderFrame.hpp
+
+Abstract:
+- A RenderFrame holds a copy of everything the renderer needs to paint one frame:
+  the clusters and attribute runs of the dirty rows, the cursor, the selection
+  and the title. It is filled while the console is locked and painted after
+  the lock has been released, so the engine never reads the live buffer.
+- RenderFrameData is the IRenderData handed to engines while painting a frame.
+  It answers the color queries engines make in UpdateDrawingBrushes from the
+  frame and forwards everything else to the console's render data.
+--*/
+
+#pragma once
+
+#include "../inc/IRenderData.hpp"
+#include "../inc/IRenderEngine.hpp"
+#include "../inc/Cluster.hpp"
+
+namespace Microsoft::Console::Render
+{
+    struct RenderFrame
+    {
+        // A sequence of clusters that share their attributes and
+        // get painted with a single PaintBufferLine call.
+        struct Run
+        {
+            TextAttribute attributes;
+            std::pair<COLORREF, COLORREF> colors;
+            COORD target;
+            bool usingSoftFont;
+            bool trimLeft;
+            bool lineWrapped;
+            size_t clustersBegin;
+            size_t clustersEnd;
+            size_t gridLinesBegin;
+            size_t gridLinesEnd;
+        };
+
+        struct GridLine
+        {
+            IRenderEngine::GridLineSet lines;
+            COLORREF color;
+            size_t cchLine;
+            COORD target;
+        };
+
+        // A single screen row of runs.
+        struct Row
+        {
+            LineRendition lineRendition;
+            SHORT targetRow;
+            size_t runsBegin;
+            size_t runsEnd;
+        };
+
+        void Clear() noexcept;
+        void AppendCluster(const std::wstring_view text, const size_t columns);
+        size_t ClusterCount() const noexcept;
+        void Seal();
+
+        Microsoft::Console::Types::Viewport viewport;
+        std::optional<CursorOptions> cursor;
+        std::vector<SMALL_RECT> selection;
+        std::wstring title;
+
+        // Rows of the text buffer, painted with their line transform, followed by overlay rows.
+        std::vector<Row> rows;
+        std::vector<Row> overlayRows;
+        std::vector<Run> runs;
+        std::vector<GridLine> gridLines;
+
+        // Only valid after Seal(), as the clusters point into our copy of the text.
+        std::vector<Cluster> clusters;
+
+    private:
+        struct ClusterText
+        {
+            size_t offset;
+            size_t length;
+            size_t columns;
+        };
+
+        std::wstring _text;
+        std::vector<ClusterText> _clusterText;
+    };
+
+    class RenderFrameData final : public IRenderData
+    {
+    public:
+        RenderFrameData(IRenderData* const pData) noexcept;
+
+        void SetAttributes(const TextAttribute& attributes, const std::pair<COLORREF, COLORREF> colors) noexcept;
+
+#pragma region IBaseData
+        Microsoft::Console::Types::Viewport GetViewport() noexcept override;
+        COORD GetTextBufferEndPosition() const noexcept override;
+        const TextBuffer& GetTextBuffer() noexcept override;
+        const FontInfo& GetFontInfo() noexcept override;
+        std::pair<COLORREF, COLORREF> GetAttributeColors(const TextAttribute& attr) const noexcept override;
+
+        std::vector<Microsoft::Console::Types::Viewport> GetSelectionRects() noexcept override;
+
+        void LockConsole() noexcept override;
+        void UnlockConsole() noexcept override;
+#pragma endregion
+
+#pragma region IRenderData
+        const TextAttribute GetDefaultBrushColors() noexcept override;
+
+        COORD GetCursorPosition() const noexcept override;
+        bool IsCursorVisible() const noexcept override;
+        bool IsCursorOn() const noexcept override;
+        ULONG GetCursorHeight() const noexcept override;
+        CursorType GetCursorStyle() const noexcept override;
+        ULONG GetCursorPixelWidth() const noexcept override;
+        COLORREF GetCursorColor() const noexcept override;
+        bool IsCursorDoubleWidth() const override;
+
+        bool IsScreenReversed() const noexcept override;
+
+        const std::vector<RenderOverlay> GetOverlays() const noexcept override;
+
+        const bool IsGridLineDrawingAllowed() noexcept override;
+        const std::wstring_view GetConsoleTitle() const noexcept override;
+
+        const std::wstring GetHyperlinkUri(uint16_t id) const noexcept override;
+        const std::wstring GetHyperlinkCustomId(uint16_t id) const noexcept override;
+
+        const std::vector<size_t> GetPatternId(const COORD location) const noexcept override;
+
+        void TakeDirtyRegions(std::vector<SMALL_RECT>& regions) override;
+#pragma endregion
+
+    private:
+        IRenderData* _pData; // Non-ownership pointer
+        TextAttribute _attributes;
+        std::pair<COLORREF, COLORREF> _colors;
+    };
+}
@@ -114,9 +114,35 @@ try
         _pData->UnlockConsole();
     });
 
+    // If we let go of the console lock while painting, we need to take it back
+    // afterwards to hand the engine the invalidations that came in meanwhile,
+    // unless _WaitForUnlockedPaint already did so.
+    bool paintingUnlocked = false;
+    auto relock = wil::scope_exit([&]() {
+        if (paintingUnlocked)
+        {
+            _pData->LockConsole();
+            if (_unlockedEngine)
+            {
+                _FlushDeferredInvalidations();
+            }
+            _pData->UnlockConsole();
+        }
+    });
+
+    // This is held instead of the console lock while painting without it.
+    std::unique_lock paintLock{ _unlockedPaintMutex, std::defer_lock };
+
+    // If another engine is still painting its frame without the lock, we use the other one.
+    // Painting under the lock is serialized by the lock itself, so two frames are enough.
+    auto& frame = til::at(_frames, _unlockedEngine ? 1 : 0);
+
     // Last chance check if anything scrolled without an explicit invalidate notification since the last frame.
     _CheckViewportAndScroll();
 
+    // Then pick up what was written to the buffer since the last frame.
+    _CollectBufferInvalidations();
+
     // Try to start painting a frame
     HRESULT const hr = pEngine->StartPaint();
     RETURN_IF_FAILED(hr);
@@ -142,35 +168,58 @@ try
     });
 
     // A. Prep Colors
-    RETURN_IF_FAILED(_UpdateDrawingBrushes(pEngine, _pData->GetDefaultBrushColors(), false, true));
+    const auto defaultAttributes = _pData->GetDefaultBrushColors();
+    RETURN_IF_FAILED(_UpdateDrawingBrushes(pEngine, defaultAttributes, _pData->GetAttributeColors(defaultAttributes), false, true));
 
     // B. Perform Scroll Operations
     RETURN_IF_FAILED(_PerformScrolling(pEngine));
 
-    // C. Prepare the engine with additional information before we start drawing.
-    RETURN_IF_FAILED(_PrepareRenderInfo(pEngine));
+    // C. Copy everything we're going to paint out of the console.
+    _CaptureFrame(pEngine, frame);
+
+    // Engines that don't need the console lock paint the frame while the console
+    // goes on processing output. Until we're done, invalidations for this engine
+    // are queued up and anything else that needs it waits in _WaitForUnlockedPaint.
+    // If another engine is still doing so, this one paints under the lock instead.
+    if (pEngine->CanPaintWithoutLock() && !_unlockedEngine)
+    {
+        paintLock.lock();
+        _unlockedEngine = pEngine;
+        paintingUnlocked = true;
+        unlock.reset();
+    }
+
+    // D. Prepare the engine with additional information before we start drawing.
+    RETURN_IF_FAILED(_PrepareRenderInfo(pEngine, frame));
 
     // 1. Paint Background
     RETURN_IF_FAILED(_PaintBackground(pEngine));
 
     // 2. Paint Rows of Text
-    _PaintBufferOutput(pEngine);
+    _PaintBufferOutput(pEngine, frame);
 
     // 3. Paint overlays that reside above the text buffer
-    _PaintOverlays(pEngine);
+    _PaintOverlays(pEngine, frame);
 
     // 4. Paint Selection
-    _PaintSelection(pEngine);
+    _PaintSelection(pEngine, frame);
 
     // 5. Paint Cursor
-    _PaintCursor(pEngine);
+    _PaintCursor(pEngine, frame);
 
     // 6. Paint window title
-    RETURN_IF_FAILED(_PaintTitle(pEngine));
+    RETURN_IF_FAILED(_PaintTitle(pEngine, frame));
 
     // Force scope exit end paint to finish up collecting information and possibly painting
     endPaint.reset();
 
+    // Let anyone waiting for the engine proceed and catch up on what we missed.
+    if (paintLock.owns_lock())
+    {
+        paintLock.unlock();
+    }
+    relock.reset();
+
     // Force scope exit unlock to let go of global lock so other threads can run
     unlock.reset();
 
@@ -193,18 +242,157 @@ void Renderer::_NotifyPaintFrame()
 }
 
 // Routine Description:
-// - Called when the system has requested we redraw a portion of the console.
+// - Hands an invalidation to all engines. See _InvalidateEngine.
 // Arguments:
-// - <none>
+// - invalidation - The invalidation to apply.
 // Return Value:
 // - <none>
-void Renderer::TriggerSystemRedraw(const RECT* const prcDirtyClient)
+void Renderer::_Invalidate(DeferredInvalidation&& invalidation)
 {
     FOREACH_ENGINE(pEngine)
     {
-        LOG_IF_FAILED(pEngine->InvalidateSystem(prcDirtyClient));
+        _InvalidateEngine(*pEngine, invalidation);
+    }
+}
+
+// Routine Description:
+// - Hands an invalidation to an engine. If the engine is currently painting
+//   without the console lock, the invalidation is queued up instead and
+//   handed over once it's done. See _PaintFrameForEngine.
+// Arguments:
+// - engine - The engine to invalidate.
+// - invalidation - The invalidation to apply.
+// Return Value:
+// - <none>
+void Renderer::_InvalidateEngine(IRenderEngine& engine, const DeferredInvalidation& invalidation)
+{
+    if (&engine != _unlockedEngine)
+    {
+        s_ApplyInvalidation(engine, invalidation);
+        return;
     }
 
+    // Output usually invalidates one cell or row after the other. Invalidating a
+    // bit more than necessary is always fine, so merge these to keep the queue short.
+    if (invalidation.kind == DeferredInvalidation::Kind::Region && !_deferredInvalidations.empty())
+    {
+        auto& last = _deferredInvalidations.back();
+        if (last.kind == DeferredInvalidation::Kind::Region)
+        {
+            last.region.Left = std::min(last.region.Left, invalidation.region.Left);
+            last.region.Top = std::min(last.region.Top, invalidation.region.Top);
+            last.region.Right = std::max(last.region.Right, invalidation.region.Right);
+            last.region.Bottom = std::max(last.region.Bottom, invalidation.region.Bottom);
+            return;
+        }
+    }
+
+    _deferredInvalidations.emplace_back(invalidation);
+}
+
+// Routine Description:
+// - Calls the engine method corresponding to the given invalidation.
+// Arguments:
+// - engine - The engine to invalidate.
+// - invalidation - The invalidation to apply.
+// Return Value:
+// - <none>
+void Renderer::s_ApplyInvalidation(IRenderEngine& engine, const DeferredInvalidation& invalidation)
+{
+    switch (invalidation.kind)
+    {
+    case DeferredInvalidation::Kind::Region:
+        LOG_IF_FAILED(engine.Invalidate(&invalidation.region));
+        break;
+    case DeferredInvalidation::Kind::Cursor:
+        LOG_IF_FAILED(engine.InvalidateCursor(&invalidation.region));
+        break;
+    case DeferredInvalidation::Kind::System:
+        LOG_IF_FAILED(engine.InvalidateSystem(&invalidation.client));
+        break;
+    case DeferredInvalidation::Kind::Selection:
+        LOG_IF_FAILED(engine.InvalidateSelection(invalidation.rectangles));
+        break;
+    case DeferredInvalidation::Kind::Scroll:
+        LOG_IF_FAILED(engine.InvalidateScroll(&invalidation.delta));
+        break;
+    case DeferredInvalidation::Kind::Viewport:
+        LOG_IF_FAILED(engine.UpdateViewport(invalidation.region));
+        break;
+    case DeferredInvalidation::Kind::All:
+        LOG_IF_FAILED(engine.InvalidateAll());
+        break;
+    case DeferredInvalidation::Kind::Title:
+        LOG_IF_FAILED(engine.InvalidateTitle(invalidation.title));
+        break;
+    case DeferredInvalidation::Kind::Circling:
+    {
+        // Only engines that paint without the lock get this late, and those only paint
+        // what's visible. They never need the repaint before the buffer circles that
+        // other engines can ask for here, and it would be too late for it anyway.
+        bool fEngineRequestsRepaint = false;
+        LOG_IF_FAILED(engine.InvalidateCircling(&fEngineRequestsRepaint));
+        break;
+    }
+    }
+}
+
+// Routine Description:
+// - Marks the end of painting without the console lock and hands the
+//   engine that did so all invalidations that were queued up in the meantime.
+// - The console lock must be held.
+// Arguments:
+// - <none>
+// Return Value:
+// - <none>
+void Renderer::_FlushDeferredInvalidations()
+{
+    const auto pEngine = std::exchange(_unlockedEngine, nullptr);
+
+    for (const auto& invalidation : _deferredInvalidations)
+    {
+        s_ApplyInvalidation(*pEngine, invalidation);
+    }
+
+    // clear() keeps the capacity around for the next frame.
+    _deferredInvalidations.clear();
+}
+
+// Routine Description:
+// - Called by anything that needs to talk to the engines directly while
+//   holding the console lock. If an engine is painting without the lock
+//   right now, this blocks until it's done. An engine that paints without
+//   the lock must not call back into anything that takes the console lock,
+//   so the paint always finishes and this can't deadlock.
+//   See RendererTests::WaitingForUnlockedPaintDoesNotDeadlock.
+// - Output doesn't end up here: invalidations and circling are queued
+//   for the engine instead. Only font and setting changes and glyph width
+//   queries wait, and the latter are cached by the CodepointWidthDetector.
+// Arguments:
+// - <none>
+// Return Value:
+// - <none>
+void Renderer::_WaitForUnlockedPaint()
+{
+    if (_unlockedEngine)
+    {
+        const std::lock_guard guard{ _unlockedPaintMutex };
+        _FlushDeferredInvalidations();
+    }
+}
+
+// Routine Description:
+// - Called when the system has requested we redraw a portion of the console.
+// Arguments:
+// - <none>
+// Return Value:
+// - <none>
+void Renderer::TriggerSystemRedraw(const RECT* const prcDirtyClient)
+{
+    DeferredInvalidation invalidation{ DeferredInvalidation::Kind::System };
+    invalidation.client = *prcDirtyClient;
+    _Invalidate(std::move(invalidation));
+
     _NotifyPaintFrame();
 }
 
@@ -215,6 +403,20 @@ void Renderer::TriggerSystemRedraw(const RECT* const prcDirtyClient)
 // Return Value:
 // - <none>
 void Renderer::TriggerRedraw(const Viewport& region)
+{
+    if (_InvalidateBufferRegion(region))
+    {
+        _NotifyPaintFrame();
+    }
+}
+
+// Routine Description:
+// - Hands the engines the part of the given buffer region that's in the viewport.
+// Arguments:
+// - region - The region of the buffer that changed.
+// Return Value:
+// - true if any part of the region was in the viewport and got invalidated.
+bool Renderer::_InvalidateBufferRegion(const Viewport& region)
 {
     Viewport view = _viewport;
     SMALL_RECT srUpdateRegion = region.ToExclusive();
@@ -234,12 +436,31 @@ void Renderer::TriggerRedraw(const Viewport& region)
     if (view.TrimToViewport(&srUpdateRegion))
     {
         view.ConvertToOrigin(&srUpdateRegion);
-        FOREACH_ENGINE(pEngine)
-        {
-            LOG_IF_FAILED(pEngine->Invalidate(&srUpdateRegion));
-        }
 
-        _NotifyPaintFrame();
+        DeferredInvalidation invalidation{ DeferredInvalidation::Kind::Region };
+        invalidation.region = srUpdateRegion;
+        _Invalidate(std::move(invalidation));
+        return true;
+    }
+    return false;
+}
+
+// Routine Description:
+// - Invalidates everything written to the text buffer since the last call.
+// - The text buffer only tells us about the first write since then, and keeps
+//   track of the rest itself. It moves the rows along when it circles, so the
+//   regions line up with the buffer as it is now. This is called once per frame,
+//   after the viewport and any scrolling have caught up with the buffer too.
+// Arguments:
+// - <none>
+// Return Value:
+// - <none>
+void Renderer::_CollectBufferInvalidations()
+{
+    _pData->TakeDirtyRegions(_bufferDirtyRegions);
+    for (const auto& region : _bufferDirtyRegions)
+    {
+        _InvalidateBufferRegion(Viewport::FromExclusive(region));
     }
 }
 
@@ -285,11 +506,9 @@ void Renderer::TriggerRedrawCursor(const COORD* const pcoord)
 
         if (cursorView.IsValid())
         {
-            const SMALL_RECT updateRect = view.ConvertToOrigin(cursorView).ToExclusive();
-            FOREACH_ENGINE(pEngine)
-            {
-                LOG_IF_FAILED(pEngine->InvalidateCursor(&updateRect));
-            }
+            DeferredInvalidation invalidation{ DeferredInvalidation::Kind::Cursor };
+            invalidation.region = view.ConvertToOrigin(cursorView).ToExclusive();
+            _Invalidate(std::move(invalidation));
 
             _NotifyPaintFrame();
         }
@@ -305,10 +524,7 @@ void Renderer::TriggerRedrawCursor(const COORD* const pcoord)
 // - <none>
 void Renderer::TriggerRedrawAll()
 {
-    FOREACH_ENGINE(pEngine)
-    {
-        LOG_IF_FAILED(pEngine->InvalidateAll());
-    }
+    _Invalidate({ DeferredInvalidation::Kind::All });
 
     _NotifyPaintFrame();
 }
@@ -368,11 +584,13 @@ void Renderer::TriggerSelection()
             sr = Viewport::FromInclusive(rc).ToExclusive();
         }
 
-        FOREACH_ENGINE(pEngine)
-        {
-            LOG_IF_FAILED(pEngine->InvalidateSelection(_previousSelection));
-            LOG_IF_FAILED(pEngine->InvalidateSelection(rects));
-        }
+        DeferredInvalidation previous{ DeferredInvalidation::Kind::Selection };
+        previous.rectangles = std::move(_previousSelection);
+        _Invalidate(std::move(previous));
+
+        DeferredInvalidation current{ DeferredInvalidation::Kind::Selection };
+        current.rectangles = rects;
+        _Invalidate(std::move(current));
 
         _previousSelection = std::move(rects);
 
@@ -403,11 +621,13 @@ bool Renderer::_CheckViewportAndScroll()
     coordDelta.X = srOldViewport.Left - srNewViewport.Left;
     coordDelta.Y = srOldViewport.Top - srNewViewport.Top;
 
-    FOREACH_ENGINE(engine)
-    {
-        LOG_IF_FAILED(engine->UpdateViewport(srNewViewport));
-        LOG_IF_FAILED(engine->InvalidateScroll(&coordDelta));
-    }
+    DeferredInvalidation viewport{ DeferredInvalidation::Kind::Viewport };
+    viewport.region = srNewViewport;
+    _Invalidate(std::move(viewport));
+
+    DeferredInvalidation scroll{ DeferredInvalidation::Kind::Scroll };
+    scroll.delta = coordDelta;
+    _Invalidate(std::move(scroll));
 
     _ScrollPreviousSelection(coordDelta);
     return true;
@@ -439,10 +659,9 @@ void Renderer::TriggerScroll()
 // - <none>
 void Renderer::TriggerScroll(const COORD* const pcoordDelta)
 {
-    FOREACH_ENGINE(pEngine)
-    {
-        LOG_IF_FAILED(pEngine->InvalidateScroll(pcoordDelta));
-    }
+    DeferredInvalidation invalidation{ DeferredInvalidation::Kind::Scroll };
+    invalidation.delta = *pcoordDelta;
+    _Invalidate(std::move(invalidation));
 
     _ScrollPreviousSelection(*pcoordDelta);
 
@@ -462,6 +681,20 @@ void Renderer::TriggerCircling()
 
     FOREACH_ENGINE(pEngine)
     {
+        // We don't wait for an engine that's painting without the lock. It gets the circling
+        // once it's done, followed by the scroll the console triggers after circling, so its
+        // next frame is captured with the buffer contents moved up. Meanwhile, other engines
+        // get painted with the second frame if they need to be, see _PaintFrameForEngine.
+        if (pEngine == _unlockedEngine)
+        {
+            _InvalidateEngine(*pEngine, { DeferredInvalidation::Kind::Circling });
+
+            DeferredInvalidation selection{ DeferredInvalidation::Kind::Selection };
+            selection.rectangles = rects;
+            _InvalidateEngine(*pEngine, selection);
+            continue;
+        }
+
         bool fEngineRequestsRepaint = false;
         HRESULT hr = pEngine->InvalidateCircling(&fEngineRequestsRepaint);
         LOG_IF_FAILED(hr);
@@ -484,11 +717,10 @@ void Renderer::TriggerCircling()
 // - <none>
 void Renderer::TriggerTitleChange()
 {
-    const auto newTitle = _pData->GetConsoleTitle();
-    FOREACH_ENGINE(pEngine)
-    {
-        LOG_IF_FAILED(pEngine->InvalidateTitle(newTitle));
-    }
+    DeferredInvalidation invalidation{ DeferredInvalidation::Kind::Title };
+    invalidation.title = _pData->GetConsoleTitle();
+    _Invalidate(std::move(invalidation));
+
     _NotifyPaintFrame();
 }
 
@@ -496,12 +728,12 @@ void Renderer::TriggerTitleChange()
 // - Update the title for a particular engine.
 // Arguments:
 // - pEngine: the engine to update the title for.
+// - frame: the frame with the title to paint.
 // Return Value:
 // - the HRESULT of the underlying engine's UpdateTitle call.
-HRESULT Renderer::_PaintTitle(IRenderEngine* const pEngine)
+HRESULT Renderer::_PaintTitle(IRenderEngine* const pEngine, const RenderFrame& frame)
 {
-    const auto newTitle = _pData->GetConsoleTitle();
-    return pEngine->UpdateTitle(newTitle);
+    return pEngine->UpdateTitle(frame.title);
 }
 
 // Routine Description:
@@ -514,6 +746,8 @@ HRESULT Renderer::_PaintTitle(IRenderEngine* const pEngine)
 // - <none>
 void Renderer::TriggerFontChange(const int iDpi, const FontInfoDesired& FontInfoDesired, _Out_ FontInfo& FontInfo)
 {
+    _WaitForUnlockedPaint();
+
     FOREACH_ENGINE(pEngine)
     {
         LOG_IF_FAILED(pEngine->UpdateDpi(iDpi));
@@ -540,6 +774,8 @@ void Renderer::UpdateSoftFont(const gsl::span<const uint16_t> bitPattern, const
     const auto softFontCharCount = cellSize.cy ? bitPattern.size() / cellSize.cy : 0;
     _lastSoftFontChar = _firstSoftFontChar + softFontCharCount - 1;
 
+    _WaitForUnlockedPaint();
+
     FOREACH_ENGINE(pEngine)
     {
         LOG_IF_FAILED(pEngine->UpdateSoftFont(bitPattern, cellSize, centeringHint));
@@ -570,6 +806,8 @@ bool Renderer::s_IsSoftFontChar(const std::wstring_view& v, const size_t firstSo
     //      renderer. We won't know which is which, so iterate over them.
     //      Only return the result of the successful one if it's not S_FALSE (which is the VT renderer)
     // TODO: 14560740 - The Window might be able to get at this info in a more sane manner
+    _WaitForUnlockedPaint();
+
     FOREACH_ENGINE(pEngine)
     {
         const HRESULT hr = LOG_IF_FAILED(pEngine->GetProposedFont(FontInfoDesired, FontInfo, iDpi));
@@ -601,6 +839,8 @@ bool Renderer::IsGlyphWideByFont(const std::wstring_view glyph)
     //      renderer. We won't know which is which, so iterate over them.
     //      Only return the result of the successful one if it's not S_FALSE (which is the VT renderer)
     // TODO: 14560740 - The Window might be able to get at this info in a more sane manner
+    _WaitForUnlockedPaint();
+
     FOREACH_ENGINE(pEngine)
     {
         const HRESULT hr = LOG_IF_FAILED(pEngine->IsGlyphWideByFont(glyph, &fIsFullWidth));
@@ -638,6 +878,34 @@ void Renderer::WaitForPaintCompletionAndDisable(const DWORD dwTimeoutMs)
     _pThread->WaitForPaintCompletionAndDisable(dwTimeoutMs);
 }
 
+// Routine Description:
+// - Copies everything the engine is going to paint this frame out of the console,
+//   so that the frame can be painted without reading the console's state.
+// - The console lock must be held.
+// Arguments:
+// - pEngine - The engine we're about to paint. Its dirty area determines which rows we copy.
+// - frame - The frame to copy into.
+// Return Value:
+// - <none>
+void Renderer::_CaptureFrame(_In_ IRenderEngine* const pEngine, RenderFrame& frame)
+{
+    frame.Clear();
+    frame.viewport = _pData->GetViewport();
+    frame.cursor = _GetCursorInfo();
+    frame.title = _pData->GetConsoleTitle();
+
+    // This is effectively the number of cells on the visible screen that need to be redrawn.
+    // The origin is always 0, 0 because it represents the screen itself, not the underlying buffer.
+    gsl::span<const til::rectangle> dirtyAreas;
+    LOG_IF_FAILED(pEngine->GetDirtyArea(dirtyAreas));
+
+    _CaptureBufferOutput(frame, dirtyAreas);
+    _CaptureOverlays(frame, dirtyAreas);
+    _CaptureSelection(frame, dirtyAreas);
+
+    frame.Seal();
+}
+
 // Routine Description:
 // - Paint helper to fill in the background color of the invalid area within the frame.
 // Arguments:
@@ -650,29 +918,23 @@ void Renderer::WaitForPaintCompletionAndDisable(const DWORD dwTimeoutMs)
 }
 
 // Routine Description:
-// - Paint helper to copy the primary console buffer text onto the screen.
+// - Capture helper to copy the primary console buffer text into the frame.
 // - This portion primarily handles figuring the current viewport, comparing it/trimming it versus the invalid portion of the frame, and queuing up, row by row, which pieces of text need to be further processed.
 // - See also: Helper functions that separate out each complexity of text rendering.
 // Arguments:
-// - <none>
+// - frame - The frame to copy into.
+// - dirtyAreas - The areas of the screen that need to be redrawn.
 // Return Value:
 // - <none>
-void Renderer::_PaintBufferOutput(_In_ IRenderEngine* const pEngine)
+void Renderer::_CaptureBufferOutput(RenderFrame& frame, const gsl::span<const til::rectangle> dirtyAreas)
 {
     // This is the subsection of the entire screen buffer that is currently being presented.
     // It can move left/right or top/bottom depending on how the viewport is scrolled
     // relative to the entire buffer.
-    const auto view = _pData->GetViewport();
-
-    // This is effectively the number of cells on the visible screen that need to be redrawn.
-    // The origin is always 0, 0 because it represents the screen itself, not the underlying buffer.
-    gsl::span<const til::rectangle> dirtyAreas;
-    LOG_IF_FAILED(pEngine->GetDirtyArea(dirtyAreas));
+    const auto view = frame.viewport;
 
-    // This is to make sure any transforms are reset when this paint is finished.
-    auto resetLineTransform = wil::scope_exit([&]() {
-        LOG_IF_FAILED(pEngine->ResetLineTransform());
-    });
+    // Retrieve the text buffer so we can read information out of it.
+    const auto& buffer = _pData->GetTextBuffer();
 
     for (const auto& dirtyRect : dirtyAreas)
     {
@@ -693,9 +955,6 @@ void Renderer::_PaintBufferOutput(_In_ IRenderEngine* const pEngine)
         // we need to walk through line-by-line and repaint onto the screen.
         const auto redraw = Viewport::Intersect(dirty, view);
 
-        // Retrieve the text buffer so we can read information out of it.
-        const auto& buffer = _pData->GetTextBuffer();
-
         // Now walk through each row of text that we need to redraw.
         for (auto row = redraw.Top(); row < redraw.BottomExclusive(); row++)
         {
@@ -721,29 +980,79 @@ void Renderer::_PaintBufferOutput(_In_ IRenderEngine* const pEngine)
             // Calculate if two things are true:
             // 1. this row wrapped
             // 2. We're painting the last col of the row.
-            // In that case, set lineWrapped=true for the _PaintBufferOutputHelper call.
+            // In that case, set lineWrapped=true for the _CaptureBufferOutputHelper call.
             const auto lineWrapped = (buffer.GetRowByOffset(bufferLine.Origin().Y).WasWrapForced()) &&
                                      (bufferLine.RightExclusive() == buffer.GetSize().Width());
 
-            // Prepare the appropriate line transform for the current row and viewport offset.
-            LOG_IF_FAILED(pEngine->PrepareLineTransform(lineRendition, screenPosition.Y, view.Left()));
+            // The row remembers the line transform for the current row,
+            // followed by the runs the helper copies out of this specific line.
+            frame.rows.emplace_back(RenderFrame::Row{ lineRendition, screenPosition.Y, frame.runs.size(), frame.runs.size() });
+            _CaptureBufferOutputHelper(frame, it, screenPosition, lineWrapped);
+            frame.rows.back().runsEnd = frame.runs.size();
+        }
+    }
+}
+
+// Routine Description:
+// - Paint helper to draw the rows of text that were copied into the frame.
+// Arguments:
+// - pEngine - The render engine that we're targeting.
+// - frame - The frame to paint.
+// Return Value:
+// - <none>
+void Renderer::_PaintBufferOutput(_In_ IRenderEngine* const pEngine, const RenderFrame& frame)
+{
+    // This is to make sure any transforms are reset when this paint is finished.
+    auto resetLineTransform = wil::scope_exit([&]() {
+        LOG_IF_FAILED(pEngine->ResetLineTransform());
+    });
 
-            // Ask the helper to paint through this specific line.
-            _PaintBufferOutputHelper(pEngine, it, screenPosition, lineWrapped);
+    for (const auto& row : frame.rows)
+    {
+        // Prepare the appropriate line transform for the current row and viewport offset.
+        LOG_IF_FAILED(pEngine->PrepareLineTransform(row.lineRendition, row.targetRow, frame.viewport.Left()));
+
+        for (auto i = row.runsBegin; i < row.runsEnd; ++i)
+        {
+            _PaintRun(pEngine, frame, til::at(frame.runs, i));
         }
     }
 }
 
+// Routine Description:
+// - Paints a single run of the frame along with its grid lines.
+// Arguments:
+// - pEngine - The render engine that we're targeting.
+// - frame - The frame the run belongs to.
+// - run - The run to paint.
+// Return Value:
+// - <none>
+void Renderer::_PaintRun(_In_ IRenderEngine* const pEngine, const RenderFrame& frame, const RenderFrame::Run& run)
+{
+    // Update the drawing brushes with our color and font usage.
+    THROW_IF_FAILED(_UpdateDrawingBrushes(pEngine, run.attributes, run.colors, run.usingSoftFont, false));
+
+    // Do the painting.
+    const auto clusters = gsl::span<const Cluster>{ frame.clusters }.subspan(run.clustersBegin, run.clustersEnd - run.clustersBegin);
+    THROW_IF_FAILED(pEngine->PaintBufferLine(clusters, run.target, run.trimLeft, run.lineWrapped));
+
+    for (auto i = run.gridLinesBegin; i < run.gridLinesEnd; ++i)
+    {
+        const auto& gridLine = til::at(frame.gridLines, i);
+        LOG_IF_FAILED(pEngine->PaintBufferGridLines(gridLine.lines, gridLine.color, gridLine.cchLine, gridLine.target));
+    }
+}
+
 static bool _IsAllSpaces(const std::wstring_view v)
 {
     // first non-space char is not found (is npos)
     return v.find_first_not_of(L' ') == decltype(v)::npos;
 }
 
-void Renderer::_PaintBufferOutputHelper(_In_ IRenderEngine* const pEngine,
-                                        TextBufferCellIterator it,
-                                        const COORD target,
-                                        const bool lineWrapped)
+void Renderer::_CaptureBufferOutputHelper(RenderFrame& frame,
+                                          TextBufferCellIterator it,
+                                          const COORD target,
+                                          const bool lineWrapped)
 {
     auto globalInvert{ _pData->IsScreenReversed() };
 
@@ -778,8 +1087,12 @@ void Renderer::_PaintBufferOutputHelper(_In_ IRenderEngine* const pEngine,
             // Hold onto the current pattern id as well
             const auto currentPatternId = patternIds;
 
-            // Update the drawing brushes with our color and font usage.
-            THROW_IF_FAILED(_UpdateDrawingBrushes(pEngine, currentRunColor, usingSoftFont, false));
+            // Remember our color and font usage for this run.
+            RenderFrame::Run run{};
+            run.attributes = currentRunColor;
+            run.colors = _pData->GetAttributeColors(currentRunColor);
+            run.usingSoftFont = usingSoftFont;
+            run.lineWrapped = lineWrapped;
 
             // Advance the point by however many columns we've just outputted and reset the accumulator.
             screenPoint.X += gsl::narrow<SHORT>(cols);
@@ -790,8 +1103,8 @@ void Renderer::_PaintBufferOutputHelper(_In_ IRenderEngine* const pEngine,
             const auto currentRunItStart = it;
             const auto currentRunTargetStart = screenPoint;
 
-            // Ensure that our cluster vector is clear.
-            _clusterBuffer.clear();
+            // The clusters of this run start after those of the previous one.
+            run.clustersBegin = frame.ClusterCount();
 
             // Reset our flag to know when we're in the special circumstance
             // of attempting to draw only the right-half of a two-column character
@@ -830,7 +1143,7 @@ void Renderer::_PaintBufferOutputHelper(_In_ IRenderEngine* const pEngine,
 
                 // If we're on the first cluster to be added and it's marked as "trailing"
                 // (a.k.a. the right half of a two column character), then we need some special handling.
-                if (_clusterBuffer.empty() && it->DbcsAttr().IsTrailing())
+                if (frame.ClusterCount() == run.clustersBegin && it->DbcsAttr().IsTrailing())
                 {
                     // Move left to the one so the whole character can be struck correctly.
                     --screenPoint.X;
@@ -846,14 +1159,17 @@ void Renderer::_PaintBufferOutputHelper(_In_ IRenderEngine* const pEngine,
                 }
 
                 // Advance the cluster and column counts.
-                _clusterBuffer.emplace_back(it->Chars(), columnCount);
+                frame.AppendCluster(it->Chars(), columnCount);
                 it += std::max<size_t>(it->Columns(), 1); // prevent infinite loop for no visible columns
                 cols += columnCount;
 
             } while (it);
 
-            // Do the painting.
-            THROW_IF_FAILED(pEngine->PaintBufferLine({ _clusterBuffer.data(), _clusterBuffer.size() }, screenPoint, trimLeft, lineWrapped));
+            // This is what we'll ask the engine to paint.
+            run.clustersEnd = frame.ClusterCount();
+            run.target = screenPoint;
+            run.trimLeft = trimLeft;
+            run.gridLinesBegin = frame.gridLines.size();
 
             // If we're allowed to do grid drawing, draw that now too (since it will be coupled with the color data)
             // We're only allowed to draw the grid lines under certain circumstances.
@@ -879,15 +1195,18 @@ void Renderer::_PaintBufferOutputHelper(_In_ IRenderEngine* const pEngine,
                     for (auto colsPainted = 0u; colsPainted < cols; ++colsPainted, ++lineIt, ++lineTarget.X)
                     {
                         auto lines = lineIt->TextAttr();
-                        _PaintBufferOutputGridLineHelper(pEngine, lines, 1, lineTarget);
+                        _CaptureBufferOutputGridLineHelper(frame, lines, 1, lineTarget);
                     }
                 }
                 else
                 {
                     // If nothing exciting is going on, draw the lines in bulk.
-                    _PaintBufferOutputGridLineHelper(pEngine, currentRunColor, cols, screenPoint);
+                    _CaptureBufferOutputGridLineHelper(frame, currentRunColor, cols, screenPoint);
                 }
             }
+
+            run.gridLinesEnd = frame.gridLines.size();
+            frame.runs.emplace_back(run);
         }
     }
 }
@@ -947,19 +1266,20 @@ IRenderEngine::GridLineSet Renderer::s_GetGridlines(const TextAttribute& textAtt
 }
 
 // Routine Description:
-// - Paint helper for primary buffer output function.
+// - Capture helper for primary buffer output function.
 // - This particular helper sets up the various box drawing lines that can be inscribed around any character in the buffer (left, right, top, underline).
 // - See also: All related helpers and buffer output functions.
 // Arguments:
+// - frame - The frame to copy into.
 // - textAttribute - The line/box drawing attributes to use for this particular run.
 // - cchLine - The length of both pwsLine and pbKAttrsLine.
 // - coordTarget - The X/Y coordinate position in the buffer which we're attempting to start rendering from.
 // Return Value:
 // - <none>
-void Renderer::_PaintBufferOutputGridLineHelper(_In_ IRenderEngine* const pEngine,
-                                                const TextAttribute textAttribute,
-                                                const size_t cchLine,
-                                                const COORD coordTarget)
+void Renderer::_CaptureBufferOutputGridLineHelper(RenderFrame& frame,
+                                                  const TextAttribute textAttribute,
+                                                  const size_t cchLine,
+                                                  const COORD coordTarget)
 {
     // Convert console grid line representations into rendering engine enum representations.
     auto lines = Renderer::s_GetGridlines(textAttribute);
@@ -980,13 +1300,13 @@ void Renderer::_PaintBufferOutputGridLineHelper(_In_ IRenderEngine* const pEngin
         }
     }
 
-    // Return early if there are no lines to paint.
+    // Skip this if there are no lines to paint.
     if (lines.any())
     {
         // Get the current foreground color to render the lines.
         const COLORREF rgb = _pData->GetAttributeColors(textAttribute).first;
-        // Draw the lines
-        LOG_IF_FAILED(pEngine->PaintBufferGridLines(lines, rgb, cchLine, coordTarget));
+        // Remember the lines for the paint.
+        frame.gridLines.emplace_back(RenderFrame::GridLine{ lines, rgb, cchLine, coordTarget });
     }
 }
 
@@ -1058,53 +1378,50 @@ void Renderer::_PaintBufferOutputGridLineHelper(_In_ IRenderEngine* const pEngin
 // - Paint helper to draw the cursor within the buffer.
 // Arguments:
 // - engine - The render engine that we're targeting.
+// - frame - The frame with the cursor to paint.
 // Return Value:
 // - <none>
-void Renderer::_PaintCursor(_In_ IRenderEngine* const pEngine)
+void Renderer::_PaintCursor(_In_ IRenderEngine* const pEngine, const RenderFrame& frame)
 {
-    const auto cursorInfo = _GetCursorInfo();
-    if (cursorInfo.has_value())
+    if (frame.cursor.has_value())
     {
-        LOG_IF_FAILED(pEngine->PaintCursor(cursorInfo.value()));
+        LOG_IF_FAILED(pEngine->PaintCursor(frame.cursor.value()));
     }
 }
 
 // Routine Description:
-// - Retrieves info from the render data to prepare the engine with, before the
-//   frame is drawn. Some renderers might want to use this information to affect
+// - Hands info from the frame to the engine, before the frame is drawn.
+//   Some renderers might want to use this information to affect
 //   later drawing decisions.
 //   * Namely, the DX renderer uses this to know the cursor position and state
 //     before PaintCursor is called, so it can draw the cursor underneath the
 //     text.
 // Arguments:
 // - engine - The render engine that we're targeting.
+// - frame - The frame we're about to paint.
 // Return Value:
 // - S_OK if the engine prepared successfully, or a relevant error via HRESULT.
-[[nodiscard]] HRESULT Renderer::_PrepareRenderInfo(_In_ IRenderEngine* const pEngine)
+[[nodiscard]] HRESULT Renderer::_PrepareRenderInfo(_In_ IRenderEngine* const pEngine, const RenderFrame& frame)
 {
     RenderFrameInfo info;
-    info.cursorInfo = _GetCursorInfo();
+    info.cursorInfo = frame.cursor;
     return pEngine->PrepareRenderInfo(info);
 }
 
 // Routine Description:
-// - Paint helper to draw text that overlays the main buffer to provide user interactivity regions
+// - Capture helper to copy text that overlays the main buffer to provide user interactivity regions
 // - This supports IME composition.
 // Arguments:
-// - engine - The render engine that we're targeting.
-// - overlay - The overlay to draw.
+// - frame - The frame to copy into.
+// - overlay - The overlay to copy.
+// - dirtyAreas - The areas of the screen that need to be redrawn.
 // Return Value:
 // - <none>
-void Renderer::_PaintOverlay(IRenderEngine& engine,
-                             const RenderOverlay& overlay)
+void Renderer::_CaptureOverlay(RenderFrame& frame, const RenderOverlay& overlay, const gsl::span<const til::rectangle> dirtyAreas)
 {
     try
     {
-        // First get the screen buffer's viewport.
-        Viewport view = _pData->GetViewport();
-
-        // Now get the overlay's viewport and adjust it to where it is supposed to be relative to the window.
-
+        // Get the overlay's viewport and adjust it to where it is supposed to be relative to the window.
         SMALL_RECT srCaView = overlay.region.ToInclusive();
         srCaView.Top += overlay.origin.Y;
         srCaView.Bottom += overlay.origin.Y;
@@ -1114,9 +1431,6 @@ void Renderer::_PaintOverlay(IRenderEngine& engine,
         // Set it up in a Viewport helper structure and trim it the IME viewport to be within the full console viewport.
         Viewport viewConv = Viewport::FromInclusive(srCaView);
 
-        gsl::span<const til::rectangle> dirtyAreas;
-        LOG_IF_FAILED(engine.GetDirtyArea(dirtyAreas));
-
         for (SMALL_RECT srDirty : dirtyAreas)
         {
             // Dirty is an inclusive rectangle, but oddly enough the IME was an exclusive one, so correct it.
@@ -1134,7 +1448,10 @@ void Renderer::_PaintOverlay(IRenderEngine& engine,
 
                     auto it = overlay.buffer.GetCellLineDataAt(source);
 
-                    _PaintBufferOutputHelper(&engine, it, target, false);
+                    // Overlay rows are painted without a line transform.
+                    frame.overlayRows.emplace_back(RenderFrame::Row{ LineRendition::SingleWidth, iRow, frame.runs.size(), frame.runs.size() });
+                    _CaptureBufferOutputHelper(frame, it, target, false);
+                    frame.overlayRows.back().runsEnd = frame.runs.size();
                 }
             }
         }
@@ -1143,14 +1460,15 @@ void Renderer::_PaintOverlay(IRenderEngine& engine,
 }
 
 // Routine Description:
-// - Paint helper to draw the composition string portion of the IME.
+// - Capture helper to copy the composition string portion of the IME.
 // - This specifically is the string that appears at the cursor on the input line showing what the user is currently typing.
-// - See also: Generic Paint IME helper method.
+// - See also: Generic capture IME helper method.
 // Arguments:
-// - <none>
+// - frame - The frame to copy into.
+// - dirtyAreas - The areas of the screen that need to be redrawn.
 // Return Value:
 // - <none>
-void Renderer::_PaintOverlays(_In_ IRenderEngine* const pEngine)
+void Renderer::_CaptureOverlays(RenderFrame& frame, const gsl::span<const til::rectangle> dirtyAreas)
 {
     try
     {
@@ -1158,25 +1476,45 @@ void Renderer::_PaintOverlays(_In_ IRenderEngine* const pEngine)
 
         for (const auto& overlay : overlays)
         {
-            _PaintOverlay(*pEngine, overlay);
+            _CaptureOverlay(frame, overlay, dirtyAreas);
         }
     }
     CATCH_LOG();
 }
 
 // Routine Description:
-// - Paint helper to draw the selected area of the window.
+// - Paint helper to draw the overlay rows that were copied into the frame.
 // Arguments:
-// - <none>
+// - pEngine - The render engine that we're targeting.
+// - frame - The frame to paint.
 // Return Value:
 // - <none>
-void Renderer::_PaintSelection(_In_ IRenderEngine* const pEngine)
+void Renderer::_PaintOverlays(_In_ IRenderEngine* const pEngine, const RenderFrame& frame)
 {
     try
     {
-        gsl::span<const til::rectangle> dirtyAreas;
-        LOG_IF_FAILED(pEngine->GetDirtyArea(dirtyAreas));
+        for (const auto& row : frame.overlayRows)
+        {
+            for (auto i = row.runsBegin; i < row.runsEnd; ++i)
+            {
+                _PaintRun(pEngine, frame, til::at(frame.runs, i));
+            }
+        }
+    }
+    CATCH_LOG();
+}
 
+// Routine Description:
+// - Capture helper to determine the parts of the selection that need to be redrawn.
+// Arguments:
+// - frame - The frame to copy into.
+// - dirtyAreas - The areas of the screen that need to be redrawn.
+// Return Value:
+// - <none>
+void Renderer::_CaptureSelection(RenderFrame& frame, const gsl::span<const til::rectangle> dirtyAreas)
+{
+    try
+    {
         // Get selection rectangles
         const auto rectangles = _GetSelectionRects();
         for (auto rect : rectangles)
@@ -1189,7 +1527,7 @@ void Renderer::_PaintSelection(_In_ IRenderEngine* const pEngine)
                 Viewport dirtyView = Viewport::FromInclusive(dirtyRect);
                 if (dirtyView.TrimToViewport(&rectCopy))
                 {
-                    LOG_IF_FAILED(pEngine->PaintSelection(rectCopy));
+                    frame.selection.emplace_back(rectCopy);
                 }
             }
         }
@@ -1197,11 +1535,27 @@ void Renderer::_PaintSelection(_In_ IRenderEngine* const pEngine)
     CATCH_LOG();
 }
 
+// Routine Description:
+// - Paint helper to draw the selected area of the window.
+// Arguments:
+// - pEngine - The render engine that we're targeting.
+// - frame - The frame with the selection to paint.
+// Return Value:
+// - <none>
+void Renderer::_PaintSelection(_In_ IRenderEngine* const pEngine, const RenderFrame& frame)
+{
+    for (const auto& rect : frame.selection)
+    {
+        LOG_IF_FAILED(pEngine->PaintSelection(rect));
+    }
+}
+
 // Routine Description:
 // - Helper to convert the text attributes to actual RGB colors and update the rendering pen/brush within the rendering engine before the next draw operation.
 // Arguments:
 // - pEngine - Which engine is being updated
 // - textAttributes - The 16 color foreground/background combination to set
+// - colors - The RGB colors of textAttributes, as captured with the frame
 // - usingSoftFont - Whether we're rendering characters from a soft font
 // - isSettingDefaultBrushes - Alerts that the default brushes are being set which will
 //                             impact whether or not to include the hung window/erase window brushes in this operation
@@ -1211,12 +1565,18 @@ void Renderer::_PaintSelection(_In_ IRenderEngine* const pEngine)
 // - <none>
 [[nodiscard]] HRESULT Renderer::_UpdateDrawingBrushes(_In_ IRenderEngine* const pEngine,
                                                       const TextAttribute textAttributes,
+                                                      const std::pair<COLORREF, COLORREF> colors,
                                                       const bool usingSoftFont,
                                                       const bool isSettingDefaultBrushes)
 {
+    // The engine asks for the colors of textAttributes, which we answer from the
+    // frame, so it doesn't need to look at the console while we're painting.
+    RenderFrameData frameData{ _pData };
+    frameData.SetAttributes(textAttributes, colors);
+
     // The last color needs to be each engine's responsibility. If it's local to this function,
     //      then on the next engine we might not update the color.
-    return pEngine->UpdateDrawingBrushes(textAttributes, _pData, usingSoftFont, isSettingDefaultBrushes);
+    return pEngine->UpdateDrawingBrushes(textAttributes, &frameData, usingSoftFont, isSettingDefaultBrushes);
 }
 
 // Routine Description:
@@ -1317,6 +1677,21 @@ void Renderer::AddRenderEngine(_In_ IRenderEngine* const pEngine)
     THROW_HR_MSG(E_UNEXPECTED, "engines array is full");
 }
 
+// Method Description:
+// - Lets the caller talk to its engines directly, for instance to resize them or to
+//   change their font or settings. Engines that paint without the console lock rely
+//   on this: it waits for them to finish their frame before calling update.
+// - The console lock must be held.
+// Arguments:
+// - update: the callback that updates the engines
+// Return Value:
+// - <none>
+void Renderer::UpdateEngines(const std::function<void()>& update)
+{
+    _WaitForUnlockedPaint();
+    update();
+}
+
 // Method Description:
 // - Registers a callback that will be called when this renderer gives up.
 //   An application consuming a renderer can use this to display auxiliary Retry UI
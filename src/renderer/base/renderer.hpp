@@ -21,6 +21,7 @@ Author(s):
 #include "../inc/IRenderData.hpp"
 
 #include "thread.hpp"
+#include "RenderFrame.hpp"
 
 #include "../../buffer/out/textBuffer.hpp"
 #include "../../buffer/out/CharRow.hpp"
@@ -72,6 +73,7 @@ namespace Microsoft::Console::Render
         void WaitUntilCanRender() override;
 
         void AddRenderEngine(_In_ IRenderEngine* const pEngine) override;
+        void UpdateEngines(const std::function<void()>& update);
 
         void SetRendererEnteredErrorStateCallback(std::function<void()> pfn);
         void ResetErrorStateAndResume();
@@ -79,27 +81,63 @@ namespace Microsoft::Console::Render
         void UpdateLastHoveredInterval(const std::optional<interval_tree::IntervalTree<til::point, size_t>::interval>& newInterval);
 
     private:
+        // An invalidation that arrived while an engine was painting without the console lock.
+        struct DeferredInvalidation
+        {
+            enum class Kind
+            {
+                Region,
+                Cursor,
+                System,
+                Selection,
+                Scroll,
+                Viewport,
+                All,
+                Title,
+                Circling
+            };
+
+            Kind kind;
+            SMALL_RECT region{};
+            RECT client{};
+            COORD delta{};
+            std::vector<SMALL_RECT> rectangles;
+            std::wstring title;
+        };
+
         static IRenderEngine::GridLineSet s_GetGridlines(const TextAttribute& textAttribute) noexcept;
         static bool s_IsSoftFontChar(const std::wstring_view& v, const size_t firstSoftFontChar, const size_t lastSoftFontChar);
 
         void _NotifyPaintFrame();
         [[nodiscard]] HRESULT _PaintFrameForEngine(_In_ IRenderEngine* const pEngine) noexcept;
         bool _CheckViewportAndScroll();
+        bool _InvalidateBufferRegion(const Microsoft::Console::Types::Viewport& region);
+        void _CollectBufferInvalidations();
+        void _Invalidate(DeferredInvalidation&& invalidation);
+        void _InvalidateEngine(IRenderEngine& engine, const DeferredInvalidation& invalidation);
+        static void s_ApplyInvalidation(IRenderEngine& engine, const DeferredInvalidation& invalidation);
+        void _FlushDeferredInvalidations();
+        void _WaitForUnlockedPaint();
+        void _CaptureFrame(_In_ IRenderEngine* const pEngine, RenderFrame& frame);
+        void _CaptureBufferOutput(RenderFrame& frame, const gsl::span<const til::rectangle> dirtyAreas);
+        void _CaptureBufferOutputHelper(RenderFrame& frame, TextBufferCellIterator it, const COORD target, const bool lineWrapped);
+        void _CaptureBufferOutputGridLineHelper(RenderFrame& frame, const TextAttribute textAttribute, const size_t cchLine, const COORD coordTarget);
+        void _CaptureOverlays(RenderFrame& frame, const gsl::span<const til::rectangle> dirtyAreas);
+        void _CaptureOverlay(RenderFrame& frame, const RenderOverlay& overlay, const gsl::span<const til::rectangle> dirtyAreas);
+        void _CaptureSelection(RenderFrame& frame, const gsl::span<const til::rectangle> dirtyAreas);
         [[nodiscard]] HRESULT _PaintBackground(_In_ IRenderEngine* const pEngine);
-        void _PaintBufferOutput(_In_ IRenderEngine* const pEngine);
-        void _PaintBufferOutputHelper(_In_ IRenderEngine* const pEngine, TextBufferCellIterator it, const COORD target, const bool lineWrapped);
-        void _PaintBufferOutputGridLineHelper(_In_ IRenderEngine* const pEngine, const TextAttribute textAttribute, const size_t cchLine, const COORD coordTarget);
-        void _PaintSelection(_In_ IRenderEngine* const pEngine);
-        void _PaintCursor(_In_ IRenderEngine* const pEngine);
-        void _PaintOverlays(_In_ IRenderEngine* const pEngine);
-        void _PaintOverlay(IRenderEngine& engine, const RenderOverlay& overlay);
-        [[nodiscard]] HRESULT _UpdateDrawingBrushes(_In_ IRenderEngine* const pEngine, const TextAttribute attr, const bool usingSoftFont, const bool isSettingDefaultBrushes);
+        void _PaintBufferOutput(_In_ IRenderEngine* const pEngine, const RenderFrame& frame);
+        void _PaintRun(_In_ IRenderEngine* const pEngine, const RenderFrame& frame, const RenderFrame::Run& run);
+        void _PaintSelection(_In_ IRenderEngine* const pEngine, const RenderFrame& frame);
+        void _PaintCursor(_In_ IRenderEngine* const pEngine, const RenderFrame& frame);
+        void _PaintOverlays(_In_ IRenderEngine* const pEngine, const RenderFrame& frame);
+        [[nodiscard]] HRESULT _UpdateDrawingBrushes(_In_ IRenderEngine* const pEngine, const TextAttribute attr, const std::pair<COLORREF, COLORREF> colors, const bool usingSoftFont, const bool isSettingDefaultBrushes);
         [[nodiscard]] HRESULT _PerformScrolling(_In_ IRenderEngine* const pEngine);
         std::vector<SMALL_RECT> _GetSelectionRects() const;
         void _ScrollPreviousSelection(const til::point delta);
-        [[nodiscard]] HRESULT _PaintTitle(IRenderEngine* const pEngine);
+        [[nodiscard]] HRESULT _PaintTitle(IRenderEngine* const pEngine, const RenderFrame& frame);
         [[nodiscard]] std::optional<CursorOptions> _GetCursorInfo();
-        [[nodiscard]] HRESULT _PrepareRenderInfo(_In_ IRenderEngine* const pEngine);
+        [[nodiscard]] HRESULT _PrepareRenderInfo(_In_ IRenderEngine* const pEngine, const RenderFrame& frame);
 
         std::array<IRenderEngine*, 2> _engines{};
         IRenderData* _pData = nullptr; // Non-ownership pointer
@@ -108,8 +146,14 @@ namespace Microsoft::Console::Render
         size_t _lastSoftFontChar = 0;
         std::optional<interval_tree::IntervalTree<til::point, size_t>::interval> _hoveredInterval;
         Microsoft::Console::Types::Viewport _viewport;
-        std::vector<Cluster> _clusterBuffer;
         std::vector<SMALL_RECT> _previousSelection;
+        // While one engine paints a frame without the console lock,
+        // another one can be captured and painted under the lock.
+        std::array<RenderFrame, 2> _frames;
+        std::vector<DeferredInvalidation> _deferredInvalidations;
+        std::vector<SMALL_RECT> _bufferDirtyRegions;
+        std::mutex _unlockedPaintMutex;
+        IRenderEngine* _unlockedEngine = nullptr; // Non-ownership pointer
         std::function<void()> _pfnRendererEnteredErrorState;
         bool _destructing = false;
 
@@ -39,6 +39,7 @@ namespace Microsoft::Console::Render
         [[nodiscard]] HRESULT StartPaint() noexcept override;
         [[nodiscard]] HRESULT EndPaint() noexcept override;
         [[nodiscard]] HRESULT Present() noexcept override;
+        [[nodiscard]] bool CanPaintWithoutLock() noexcept override;
 
         [[nodiscard]] HRESULT ScrollFrame() noexcept override;
 
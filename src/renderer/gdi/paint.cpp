@@ -250,6 +250,19 @@ using namespace Microsoft::Console::Render;
     return S_FALSE;
 }
 
+// Routine Description:
+// - The GDI engine is only ever driven by the Renderer, which hands it the
+//   frame's data and queues up invalidations while it paints. It can
+//   therefore paint without holding the console lock.
+// Arguments:
+// - <none>
+// Return Value:
+// - true
+[[nodiscard]] bool GdiEngine::CanPaintWithoutLock() noexcept
+{
+    return true;
+}
+
 // Routine Description:
 // - Fills the given rectangle with the background color on the drawing context.
 // Arguments:
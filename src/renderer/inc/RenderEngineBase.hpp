@@ -50,6 +50,7 @@ namespace Microsoft::Console::Render
                                                    const size_t viewportLeft) noexcept override;
 
         [[nodiscard]] virtual bool RequiresContinuousRedraw() noexcept override;
+        [[nodiscard]] virtual bool CanPaintWithoutLock() noexcept override;
 
         void WaitUntilCanRender() noexcept override;
 
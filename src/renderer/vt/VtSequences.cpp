@@ -8,6 +8,95 @@
 #pragma hdrstop
 using namespace Microsoft::Console::Render;
 
+namespace
+{
+    // The SGR sequences for the 16 colors of the color table, indexed by the
+    // color index. Foreground sequences are in [30,37] U [90,97], background
+    // sequences in [40,47] U [100,107]. See _SetGraphicsRendition16Color.
+    constexpr std::array<std::string_view, 16> foreground16ColorSequences{
+        "\x1b[30m", "\x1b[31m", "\x1b[32m", "\x1b[33m", "\x1b[34m", "\x1b[35m", "\x1b[36m", "\x1b[37m",
+        "\x1b[90m", "\x1b[91m", "\x1b[92m", "\x1b[93m", "\x1b[94m", "\x1b[95m", "\x1b[96m", "\x1b[97m"
+    };
+    constexpr std::array<std::string_view, 16> background16ColorSequences{
+        "\x1b[40m", "\x1b[41m", "\x1b[42m", "\x1b[43m", "\x1b[44m", "\x1b[45m", "\x1b[46m", "\x1b[47m",
+        "\x1b[100m", "\x1b[101m", "\x1b[102m", "\x1b[103m", "\x1b[104m", "\x1b[105m", "\x1b[106m", "\x1b[107m"
+    };
+
+    // The decimal representations of the numbers that sequences commonly have
+    // as parameters: color components, color indices, and coordinates.
+    constexpr size_t decimalTableSize = 1000;
+
+    struct DecimalTable
+    {
+        std::array<std::array<char, 3>, decimalTableSize> digits{};
+        std::array<uint8_t, decimalTableSize> lengths{};
+    };
+
+    constexpr DecimalTable makeDecimalTable() noexcept
+    {
+        DecimalTable table;
+        for (size_t i = 0; i < decimalTableSize; ++i)
+        {
+            auto& digits = table.digits[i];
+            if (i >= 100)
+            {
+                digits[0] = static_cast<char>('0' + i / 100);
+                digits[1] = static_cast<char>('0' + i / 10 % 10);
+                digits[2] = static_cast<char>('0' + i % 10);
+                table.lengths[i] = 3;
+            }
+            else if (i >= 10)
+            {
+                digits[0] = static_cast<char>('0' + i / 10);
+                digits[1] = static_cast<char>('0' + i % 10);
+                table.lengths[i] = 2;
+            }
+            else
+            {
+                digits[0] = static_cast<char>('0' + i);
+                table.lengths[i] = 1;
+            }
+        }
+        return table;
+    }
+
+    constexpr auto decimalTable = makeDecimalTable();
+
+    constexpr bool isInDecimalTable(const int value) noexcept
+    {
+        return value >= 0 && static_cast<size_t>(value) < decimalTableSize;
+    }
+
+    // Puts a short sequence together on the stack, out of literals and the
+    // decimal table, so that it can be written without formatting it.
+    class SequenceBuilder
+    {
+    public:
+        void Append(const std::string_view str) noexcept
+        {
+            std::copy(str.begin(), str.end(), _data.begin() + _size);
+            _size += str.size();
+        }
+
+        // The value must be in the decimal table. See isInDecimalTable.
+        void AppendDecimal(const int value) noexcept
+        {
+            const auto index = gsl::narrow_cast<size_t>(value);
+            Append({ til::at(decimalTable.digits, index).data(), til::at(decimalTable.lengths, index) });
+        }
+
+        std::string_view View() const noexcept
+        {
+            return { _data.data(), _size };
+        }
+
+    private:
+        // Long enough for the longest sequence built here, "\x1b[38;2;255;255;255m".
+        std::array<char, 24> _data{};
+        size_t _size{ 0 };
+    };
+}
+
 // Method Description:
 // - Formats and writes a sequence to stop the cursor from blinking.
 // Arguments:
@@ -81,6 +170,15 @@ using namespace Microsoft::Console::Render;
 // - S_OK if we succeeded, else an appropriate HRESULT for failing to allocate or write.
 [[nodiscard]] HRESULT VtEngine::_EraseCharacter(const short chars) noexcept
 {
+    if (isInDecimalTable(chars))
+    {
+        SequenceBuilder sequence;
+        sequence.Append("\x1b[");
+        sequence.AppendDecimal(chars);
+        sequence.Append("X");
+        return _Write(sequence.View());
+    }
+
     return _WriteFormatted(FMT_COMPILE("\x1b[{}X"), chars);
 }
 
@@ -92,6 +190,15 @@ using namespace Microsoft::Console::Render;
 // - S_OK if we succeeded, else an appropriate HRESULT for failing to allocate or write.
 [[nodiscard]] HRESULT VtEngine::_CursorForward(const short chars) noexcept
 {
+    if (isInDecimalTable(chars))
+    {
+        SequenceBuilder sequence;
+        sequence.Append("\x1b[");
+        sequence.AppendDecimal(chars);
+        sequence.Append("C");
+        return _Write(sequence.View());
+    }
+
     return _WriteFormatted(FMT_COMPILE("\x1b[{}C"), chars);
 }
 
@@ -104,6 +211,7 @@ using namespace Microsoft::Console::Render;
 // - S_OK if we succeeded, else an appropriate HRESULT for failing to allocate or write.
 [[nodiscard]] HRESULT VtEngine::_ClearScreen() noexcept
 {
+    _ForgetShadowScreen();
     return _Write("\x1b[2J");
 }
 
@@ -130,6 +238,14 @@ using namespace Microsoft::Console::Render;
     {
         return _Write(fInsertLine ? "\x1b[L" : "\x1b[M");
     }
+    if (isInDecimalTable(sLines))
+    {
+        SequenceBuilder sequence;
+        sequence.Append("\x1b[");
+        sequence.AppendDecimal(sLines);
+        sequence.Append(fInsertLine ? "L" : "M");
+        return _Write(sequence.View());
+    }
 
     return _WriteFormatted(FMT_COMPILE("\x1b[{}{}"), sLines, fInsertLine ? 'L' : 'M');
 }
@@ -173,6 +289,17 @@ using namespace Microsoft::Console::Render;
     coordVt.X++;
     coordVt.Y++;
 
+    if (isInDecimalTable(coordVt.Y) && isInDecimalTable(coordVt.X))
+    {
+        SequenceBuilder sequence;
+        sequence.Append("\x1b[");
+        sequence.AppendDecimal(coordVt.Y);
+        sequence.Append(";");
+        sequence.AppendDecimal(coordVt.X);
+        sequence.Append("H");
+        return _Write(sequence.View());
+    }
+
     return _WriteFormatted(FMT_COMPILE("\x1b[{};{}H"), coordVt.Y, coordVt.X);
 }
 
@@ -221,8 +348,10 @@ using namespace Microsoft::Console::Render;
     //      terminals display the bright color when displaying bolded text.
     // By specifying the boldness and brightness separately, we'll make sure the
     //      terminal has an accurate representation of our buffer.
-    const auto prefix = WI_IsFlagSet(index, FOREGROUND_INTENSITY) ? (fIsForeground ? 90 : 100) : (fIsForeground ? 30 : 40);
-    return _WriteFormatted(FMT_COMPILE("\x1b[{}m"), prefix + (index & 7));
+    // The tables are indexed by the dark colors first, then the bright ones,
+    //      which is just what the intensity flag and the lower 3 bits make up.
+    const auto& sequences = fIsForeground ? foreground16ColorSequences : background16ColorSequences;
+    return _Write(til::at(sequences, index & (FOREGROUND_INTENSITY | 7)));
 }
 
 // Method Description:
@@ -236,7 +365,11 @@ using namespace Microsoft::Console::Render;
 [[nodiscard]] HRESULT VtEngine::_SetGraphicsRendition256Color(const BYTE index,
                                                               const bool fIsForeground) noexcept
 {
-    return _WriteFormatted(FMT_COMPILE("\x1b[{}8;5;{}m"), fIsForeground ? '3' : '4', index);
+    SequenceBuilder sequence;
+    sequence.Append(fIsForeground ? "\x1b[38;5;" : "\x1b[48;5;");
+    sequence.AppendDecimal(index);
+    sequence.Append("m");
+    return _Write(sequence.View());
 }
 
 // Method Description:
@@ -253,7 +386,15 @@ using namespace Microsoft::Console::Render;
     const uint8_t r = GetRValue(color);
     const uint8_t g = GetGValue(color);
     const uint8_t b = GetBValue(color);
-    return _WriteFormatted(FMT_COMPILE("\x1b[{}8;2;{};{};{}m"), fIsForeground ? '3' : '4', r, g, b);
+    SequenceBuilder sequence;
+    sequence.Append(fIsForeground ? "\x1b[38;2;" : "\x1b[48;2;");
+    sequence.AppendDecimal(r);
+    sequence.Append(";");
+    sequence.AppendDecimal(g);
+    sequence.Append(";");
+    sequence.AppendDecimal(b);
+    sequence.Append("m");
+    return _Write(sequence.View());
 }
 
 // Method Description:
@@ -399,6 +399,9 @@ try
     _wrappedRow = oldWrappedRow;
     _delayedEolWrap = oldDelayedEolWrap;
 
+    // The terminal scrolled its contents along with us.
+    _ScrollShadowScreen(dy);
+
     // Shift our internal tracker of the last text position according to how
     // much we've scrolled. If we manually scroll the buffer right now, by
     // moving the cursor to the bottom row of the viewport and emitting a
@@ -523,6 +526,8 @@ CATCH_RETURN();
     RETURN_IF_FAILED(_fUseAsciiOnly ?
                          VtEngine::_WriteTerminalAscii(wstr) :
                          VtEngine::_WriteTerminalUtf8(wstr));
+    // We don't know what the string does to the terminal's screen.
+    _ForgetShadowScreen();
     // GH#4106, GH#2011 - WriteTerminalW is only ever called by the
     // StateMachine, when we've encountered a string we don't understand. When
     // this happens, we usually don't actually trigger another frame, but we
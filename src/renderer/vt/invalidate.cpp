@@ -130,12 +130,15 @@ CATCH_RETURN();
 // - Notifies us that we're about to be torn down. This gives us a last chance
 //      to force a repaint before the buffer contents are lost. The VT renderer
 //      needs to be able to render all text before it's lost, so we return true.
+//   The process may exit right after that final frame, so from now on frames
+//      are written before _Flush returns, instead of on the thread pool.
 // Arguments:
 // - Receives a bool indicating if we should force the repaint.
 // Return Value:
-// - S_OK
+// - S_OK, or a suitable HRESULT error if the previous frame failed to write.
 [[nodiscard]] HRESULT VtEngine::PrepareForTeardown(_Out_ bool* const pForcePaint) noexcept
 {
     *pForcePaint = true;
-    return S_OK;
+    _flushSynchronously = true;
+    return _WaitForPendingWrite();
 }
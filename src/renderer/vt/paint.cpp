@@ -356,6 +356,7 @@ using namespace Microsoft::Console::Types;
         }
 
         RETURN_IF_FAILED(VtEngine::_WriteTerminalAscii(_bufferLine));
+        _ForgetShadowCells(coord.Y, coord.X, gsl::narrow_cast<short>(coord.X + totalWidth));
 
         // Update our internal tracker of the cursor's position
         _lastText.X += totalWidth;
@@ -368,9 +369,14 @@ using namespace Microsoft::Console::Types;
 // Routine Description:
 // - Draws one line of the buffer to the screen. Writes the characters to the
 //      pipe, encoded in UTF-8.
+//   Only the parts of the line that changed since we last emitted them are
+//      written. Unchanged spans are skipped by moving the cursor past them,
+//      if that's shorter than printing them again. See _shadowScreen.
 // Arguments:
 // - clusters - text and column widths to be written
 // - coord - character coordinate target to render within viewport
+// - lineWrapped: true if this run we're painting is the end of a line that
+//   wrapped.
 // Return Value:
 // - S_OK or suitable HRESULT error from writing pipe.
 [[nodiscard]] HRESULT VtEngine::_PaintUtf8BufferLine(gsl::span<const Cluster> const clusters,
@@ -382,6 +388,82 @@ using namespace Microsoft::Console::Types;
         return S_OK;
     }
 
+    // The terminal only wraps the previous row once we print the first cell of
+    //      this one, and only marks this row as wrapped once we print its last
+    //      cell. Those need to be printed, whether they changed or not.
+    const bool continuesWrappedRow = coord.X == 0 &&
+                                     _wrappedRow.has_value() &&
+                                     coord.Y == _wrappedRow.value() + 1;
+
+    // Skipping an unchanged span means moving the cursor past it, which takes
+    //      a CUF sequence of up to 6 chars (ESC [ %d %d %d C). Spans that are
+    //      at most that long are printed again instead. An unchanged span at
+    //      the end of the line is simply left alone.
+    std::optional<size_t> spanBegin;
+    size_t spanEnd = 0;
+    short spanColumn = coord.X;
+    size_t unchangedChars = 0;
+
+    short column = coord.X;
+    for (size_t i = 0; i < clusters.size(); ++i)
+    {
+        const auto& cluster = til::at(clusters, i);
+        const bool mustPrint = (i == 0 && continuesWrappedRow) ||
+                               (i == clusters.size() - 1 && lineWrapped);
+
+        if (mustPrint || !_MatchesShadowCell(cluster, column, coord.Y))
+        {
+            if (!spanBegin.has_value())
+            {
+                const bool skipUnchanged = unchangedChars > CURSOR_FORWARD_STRING_LENGTH;
+                spanBegin = skipUnchanged ? i : 0;
+                spanColumn = skipUnchanged ? column : coord.X;
+            }
+            else if (unchangedChars > CURSOR_FORWARD_STRING_LENGTH)
+            {
+                RETURN_IF_FAILED(_PaintUtf8BufferRun(clusters.subspan(spanBegin.value(), spanEnd - spanBegin.value()),
+                                                     { spanColumn, coord.Y },
+                                                     false));
+                spanBegin = i;
+                spanColumn = column;
+            }
+
+            spanEnd = i + 1;
+            unchangedChars = 0;
+        }
+        else
+        {
+            unchangedChars += cluster.GetText().size();
+        }
+
+        column += gsl::narrow_cast<short>(cluster.GetColumns());
+    }
+
+    if (spanBegin.has_value())
+    {
+        RETURN_IF_FAILED(_PaintUtf8BufferRun(clusters.subspan(spanBegin.value(), spanEnd - spanBegin.value()),
+                                             { spanColumn, coord.Y },
+                                             lineWrapped && spanEnd == clusters.size()));
+    }
+
+    return S_OK;
+}
+
+// Routine Description:
+// - Draws a span of one line of the buffer to the screen. Writes the
+//      characters to the pipe, encoded in UTF-8, and records them in the
+//      shadow screen.
+// Arguments:
+// - clusters - text and column widths to be written
+// - coord - character coordinate target to render within viewport
+// - lineWrapped: true if this run we're painting is the end of a line that
+//   wrapped.
+// Return Value:
+// - S_OK or suitable HRESULT error from writing pipe.
+[[nodiscard]] HRESULT VtEngine::_PaintUtf8BufferRun(gsl::span<const Cluster> const clusters,
+                                                    const COORD coord,
+                                                    const bool lineWrapped) noexcept
+{
     _bufferLine.clear();
     _bufferLine.reserve(clusters.size());
     short totalWidth = 0;
@@ -492,6 +574,13 @@ using namespace Microsoft::Console::Types;
     // Write the actual text string
     RETURN_IF_FAILED(VtEngine::_WriteTerminalUtf8({ _bufferLine.data(), cchActual }));
 
+    // The spaces we removed are trailing clusters of a single space each. What
+    //      they end up looking like depends on how we get rid of them below
+    //      (if at all), so we don't record them.
+    const size_t clustersActual = removeSpaces ? clusters.size() - std::min(numSpaces, clusters.size()) : clusters.size();
+    _RecordShadowCells(clusters.first(clustersActual), coord);
+    _ForgetShadowCells(coord.Y, gsl::narrow_cast<short>(coord.X + columnsActual), gsl::narrow_cast<short>(coord.X + totalWidth));
+
     // GH#4415, GH#5181
     // If the renderer told us that this was a wrapped line, then mark
     // that we've wrapped this line. The next time we attempt to move the
@@ -590,6 +679,161 @@ using namespace Microsoft::Console::Types;
     return S_OK;
 }
 
+// Method Description:
+// - Resizes the shadow screen to the given size. Its contents are forgotten,
+//      since the terminal may have reflowed them.
+// Arguments:
+// - size - The new size of the viewport.
+// Return Value:
+// - <none>
+void VtEngine::_ResizeShadowScreen(const til::size size)
+{
+    _shadowScreen.assign(size.area<size_t>(), ShadowCell{});
+    _shadowSize = size;
+}
+
+// Method Description:
+// - Forgets the contents of the whole shadow screen, for when something was
+//      written to the terminal that we can't keep track of.
+// Arguments:
+// - <none>
+// Return Value:
+// - <none>
+void VtEngine::_ForgetShadowScreen() noexcept
+{
+    std::fill(_shadowScreen.begin(), _shadowScreen.end(), ShadowCell{});
+}
+
+// Method Description:
+// - Forgets the contents of the given cells of the shadow screen. If the first
+//      one is the second half of a wide glyph, the terminal will have erased
+//      the first half too, so it's forgotten as well.
+// Arguments:
+// - row - The row of the cells.
+// - begin - The first column to forget.
+// - end - The column after the last one to forget.
+// Return Value:
+// - <none>
+void VtEngine::_ForgetShadowCells(const short row, const short begin, const short end) noexcept
+{
+    if (row < 0 || row >= _shadowSize.height())
+    {
+        return;
+    }
+
+    const auto width = _shadowSize.width();
+    const auto first = std::clamp<ptrdiff_t>(begin, 0, width);
+    const auto last = std::clamp<ptrdiff_t>(end, 0, width);
+    if (first >= last)
+    {
+        return;
+    }
+
+    const auto rowBegin = _shadowScreen.begin() + row * width;
+    std::fill(rowBegin + first, rowBegin + last, ShadowCell{});
+    if (first > 0 && rowBegin[first - 1].columns > 1)
+    {
+        rowBegin[first - 1] = {};
+    }
+}
+
+// Method Description:
+// - Scrolls the shadow screen along with the terminal. The rows that are
+//      scrolled in are forgotten.
+// Arguments:
+// - delta - The number of rows to scroll down by, or up by if negative.
+// Return Value:
+// - <none>
+void VtEngine::_ScrollShadowScreen(const short delta) noexcept
+{
+    const auto width = _shadowSize.width();
+    const auto height = _shadowSize.height();
+    if (delta == 0 || width == 0)
+    {
+        return;
+    }
+    if (std::abs(delta) >= height)
+    {
+        _ForgetShadowScreen();
+        return;
+    }
+
+    const auto shift = std::abs(delta) * width;
+    if (delta < 0)
+    {
+        std::move(_shadowScreen.begin() + shift, _shadowScreen.end(), _shadowScreen.begin());
+        std::fill(_shadowScreen.end() - shift, _shadowScreen.end(), ShadowCell{});
+    }
+    else
+    {
+        std::move_backward(_shadowScreen.begin(), _shadowScreen.end() - shift, _shadowScreen.end());
+        std::fill(_shadowScreen.begin(), _shadowScreen.begin() + shift, ShadowCell{});
+    }
+}
+
+// Method Description:
+// - Records the given clusters in the shadow screen, with the attributes we
+//      last emitted.
+// Arguments:
+// - clusters - The clusters that were written.
+// - coord - The position that they were written to.
+// Return Value:
+// - <none>
+void VtEngine::_RecordShadowCells(gsl::span<const Cluster> const clusters, const COORD coord) noexcept
+{
+    short column = coord.X;
+    for (const auto& cluster : clusters)
+    {
+        const auto columns = gsl::narrow_cast<short>(cluster.GetColumns());
+
+        // Forget the cells first, which also takes care of the wide glyph we
+        //      might be overwriting the second half of, and of the cells the
+        //      second half of this one goes into.
+        _ForgetShadowCells(coord.Y, column, gsl::narrow_cast<short>(column + columns));
+
+        const auto text = cluster.GetText();
+        if (coord.Y >= 0 && coord.Y < _shadowSize.height() &&
+            column >= 0 && column + columns <= _shadowSize.width() &&
+            !text.empty() && text.size() <= std::tuple_size_v<decltype(ShadowCell::text)>)
+        {
+            auto& cell = til::at(_shadowScreen, coord.Y * _shadowSize.width() + column);
+            cell.attributes = _lastTextAttributes;
+            std::copy(text.begin(), text.end(), cell.text.begin());
+            cell.length = gsl::narrow_cast<uint8_t>(text.size());
+            cell.columns = gsl::narrow_cast<uint8_t>(columns);
+        }
+
+        column += columns;
+    }
+}
+
+// Method Description:
+// - Checks whether we last emitted the same cluster with the same attributes
+//      to the given position, in which case it doesn't need to be written again.
+// Arguments:
+// - cluster - The cluster we're about to write.
+// - column - The column that it would be written to.
+// - row - The row that it would be written to.
+// Return Value:
+// - true if the terminal already shows the cluster there.
+bool VtEngine::_MatchesShadowCell(const Cluster& cluster, const short column, const short row) const noexcept
+{
+    const auto columns = cluster.GetColumns();
+    if (row < 0 || row >= _shadowSize.height() ||
+        column < 0 || column + gsl::narrow_cast<ptrdiff_t>(columns) > _shadowSize.width())
+    {
+        return false;
+    }
+
+    const auto& cell = til::at(_shadowScreen, row * _shadowSize.width() + column);
+    const auto text = cluster.GetText();
+    return cell.length != 0 &&
+           cell.length == text.size() &&
+           cell.columns == columns &&
+           std::equal(text.begin(), text.end(), cell.text.begin()) &&
+           cell.attributes == _lastTextAttributes;
+}
+
 // Method Description:
 // - Updates the window's title string. Emits the VT sequence to SetWindowTitle.
 //      Because wintelnet does not understand these sequences by default, we
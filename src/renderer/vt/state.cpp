@@ -63,6 +63,11 @@ VtEngine::VtEngine(_In_ wil::unique_hfile pipe,
     // member is only defined when UNIT_TESTING is.
     _usingTestCallback = false;
 #endif
+
+    _writeWork.reset(CreateThreadpoolWork(&s_WritePendingBuffer, this, nullptr));
+    THROW_LAST_ERROR_IF_NULL(_writeWork.get());
+
+    _ResizeShadowScreen(initialViewport.Dimensions());
 }
 
 // Method Description:
@@ -103,6 +108,17 @@ VtEngine::VtEngine(_In_ wil::unique_hfile pipe,
     CATCH_RETURN();
 }
 
+// Method Description:
+// - Hands the frame that was composed in _buffer to the pipe. The write happens
+//      on the thread pool, so that the next frame can be composed while this one
+//      drains. Only one write is in flight at a time, which keeps the output in
+//      order: if the previous one hasn't finished yet, this waits for it first.
+// - A failed write is only noticed by the next flush (or teardown), which then
+//      closes the output just like a synchronous failure would have.
+// Arguments:
+// - <none>
+// Return Value:
+// - S_OK or suitable HRESULT error from writing the pipe.
 [[nodiscard]] HRESULT VtEngine::_Flush() noexcept
 {
 #ifdef UNIT_TESTING
@@ -113,29 +129,105 @@ VtEngine::VtEngine(_In_ wil::unique_hfile pipe,
     }
 #endif
 
-    if (!_pipeBroken)
+    if (_pipeBroken)
     {
-        bool fSuccess = !!WriteFile(_hFile.get(), _buffer.data(), gsl::narrow_cast<DWORD>(_buffer.size()), nullptr, nullptr);
         _buffer.clear();
-        if (!fSuccess)
+        return S_OK;
+    }
+
+    RETURN_IF_FAILED(_WaitForPendingWrite());
+
+    if (_buffer.empty())
+    {
+        return S_OK;
+    }
+
+    // The buffer that was just written becomes the one the next frame is composed
+    // into. It's made as large as this frame, so that the next one most likely
+    // doesn't need to grow it while it's being composed.
+    _pendingBuffer.swap(_buffer);
+    _buffer.clear();
+    try
+    {
+        _buffer.reserve(_pendingBuffer.size());
+    }
+    CATCH_LOG();
+
+    _writePending = true;
+    if (_flushSynchronously)
+    {
+        _WritePendingBuffer();
+        return _WaitForPendingWrite();
+    }
+
+    SubmitThreadpoolWork(_writeWork.get());
+    return S_OK;
+}
+
+// Method Description:
+// - Waits for the write that _Flush started to finish and records it in the
+//      trace. If the write failed, the pipe is considered broken from now on.
+// Arguments:
+// - <none>
+// Return Value:
+// - S_OK or suitable HRESULT error from writing the pipe.
+[[nodiscard]] HRESULT VtEngine::_WaitForPendingWrite() noexcept
+{
+    if (!_writePending)
+    {
+        return S_OK;
+    }
+
+    const auto waitStart = std::chrono::steady_clock::now();
+    WaitForThreadpoolWorkCallbacks(_writeWork.get(), FALSE);
+    const auto waitTime = std::chrono::steady_clock::now() - waitStart;
+    _writePending = false;
+
+    _trace.TraceWrite(_pendingBuffer.size(),
+                      std::chrono::duration_cast<std::chrono::microseconds>(_pendingWriteTime),
+                      std::chrono::duration_cast<std::chrono::microseconds>(waitTime));
+
+    if (_pendingWriteError != ERROR_SUCCESS)
+    {
+        _exitResult = HRESULT_FROM_WIN32(_pendingWriteError);
+        _pipeBroken = true;
+        if (_terminalOwner)
         {
-            _exitResult = HRESULT_FROM_WIN32(GetLastError());
-            _pipeBroken = true;
-            if (_terminalOwner)
-            {
-                _terminalOwner->CloseOutput();
-            }
-            return _exitResult;
+            _terminalOwner->CloseOutput();
         }
+        return _exitResult;
     }
 
     return S_OK;
 }
 
+// Method Description:
+// - Writes _pendingBuffer to the pipe. Runs on the thread pool, unless we're
+//      flushing synchronously. _Flush doesn't touch _pendingBuffer or the
+//      results until it has waited for this to finish.
+// Arguments:
+// - <none>
+// Return Value:
+// - <none>
+void VtEngine::_WritePendingBuffer() noexcept
+{
+    const auto writeStart = std::chrono::steady_clock::now();
+    const bool fSuccess = !!WriteFile(_hFile.get(), _pendingBuffer.data(), gsl::narrow_cast<DWORD>(_pendingBuffer.size()), nullptr, nullptr);
+    _pendingWriteError = fSuccess ? ERROR_SUCCESS : GetLastError();
+    _pendingWriteTime = std::chrono::steady_clock::now() - writeStart;
+}
+
+void CALLBACK VtEngine::s_WritePendingBuffer(PTP_CALLBACK_INSTANCE /*instance*/, void* context, PTP_WORK /*work*/) noexcept
+{
+    static_cast<VtEngine*>(context)->_WritePendingBuffer();
+}
+
 // Method Description:
 // - Wrapper for ITerminalOutputConnection. See _Write.
 [[nodiscard]] HRESULT VtEngine::WriteTerminalUtf8(const std::string_view str) noexcept
 {
+    // We don't know what the string does to the terminal's screen.
+    _ForgetShadowScreen();
     return _Write(str);
 }
 
@@ -163,17 +255,21 @@ VtEngine::VtEngine(_In_ wil::unique_hfile pipe,
 // - S_OK or suitable HRESULT error from writing pipe.
 [[nodiscard]] HRESULT VtEngine::_WriteTerminalAscii(const std::wstring_view wstr) noexcept
 {
-    std::string needed;
-    needed.reserve(wstr.size());
-
-    for (const auto& wch : wstr)
+    try
     {
-        // We're explicitly replacing characters outside ASCII with a ? because
-        //      that's what telnet wants.
-        needed.push_back((wch > L'\x7f') ? '?' : static_cast<char>(wch));
+        _conversionBuffer.clear();
+        _conversionBuffer.reserve(wstr.size());
+
+        for (const auto& wch : wstr)
+        {
+            // We're explicitly replacing characters outside ASCII with a ? because
+            //      that's what telnet wants.
+            _conversionBuffer.push_back((wch > L'\x7f') ? '?' : static_cast<char>(wch));
+        }
     }
+    CATCH_RETURN();
 
-    return _Write(needed);
+    return _Write(_conversionBuffer);
 }
 
 // Method Description:
@@ -227,6 +323,12 @@ VtEngine::VtEngine(_In_ wil::unique_hfile pipe,
             hr = _ResizeWindow(newView.Width(), newView.Height());
         }
         _resized = true;
+
+        try
+        {
+            _ResizeShadowScreen(newView.Dimensions());
+        }
+        CATCH_RETURN();
     }
 
     // See MSFT:19408543
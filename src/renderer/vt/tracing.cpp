@@ -212,6 +212,29 @@ void RenderTracing::TraceEndPaint() const
 #endif UNIT_TESTING
 }
 
+// Function Description:
+// - Records a frame that was written to the pipe: how many bytes it had, how
+//      long the write took, and how long the render thread had to wait for it
+//      before it could hand over the next frame.
+void RenderTracing::TraceWrite(const size_t bytes,
+                               const std::chrono::microseconds writeTime,
+                               const std::chrono::microseconds waitTime) const
+{
+#ifndef UNIT_TESTING
+    TraceLoggingWrite(g_hConsoleVtRendererTraceProvider,
+                      "VtEngine_TraceWrite",
+                      TraceLoggingUInt64(gsl::narrow_cast<uint64_t>(bytes), "bytes"),
+                      TraceLoggingInt64(writeTime.count(), "writeTimeMicroseconds"),
+                      TraceLoggingInt64(waitTime.count(), "waitTimeMicroseconds"),
+                      TraceLoggingLevel(WINEVENT_LEVEL_VERBOSE),
+                      TraceLoggingKeyword(TIL_KEYWORD_TRACE));
+#else
+    UNREFERENCED_PARAMETER(bytes);
+    UNREFERENCED_PARAMETER(writeTime);
+    UNREFERENCED_PARAMETER(waitTime);
+#endif UNIT_TESTING
+}
+
 void RenderTracing::TraceLastText(const til::point lastTextPos) const
 {
 #ifndef UNIT_TESTING
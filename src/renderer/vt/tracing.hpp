@@ -11,6 +11,7 @@ Abstract:
 
 #pragma once
 #include <string>
+#include <chrono>
 #include <windows.h>
 #include <winmeta.h>
 #include <TraceLoggingProvider.h>
@@ -45,5 +46,8 @@ namespace Microsoft::Console::VirtualTerminal
                              const bool cursorMoved,
                              const std::optional<short>& wrappedRow) const;
         void TraceEndPaint() const;
+        void TraceWrite(const size_t bytes,
+                        const std::chrono::microseconds writeTime,
+                        const std::chrono::microseconds waitTime) const;
     };
 }
@@ -20,8 +20,10 @@ Author(s):
 #include "../../inc/ITerminalOwner.hpp"
 #include "../../types/inc/Viewport.hpp"
 #include "tracing.hpp"
+#include <array>
 #include <string>
 #include <functional>
+#include <chrono>
 
 // fwdecl unittest classes
 #ifdef UNIT_TESTING
@@ -38,6 +40,8 @@ namespace Microsoft::Console::Render
     public:
         // See _PaintUtf8BufferLine for explanation of this value.
         static const size_t ERASE_CHARACTER_STRING_LENGTH = 8;
+        // See _PaintUtf8BufferLine for explanation of this value.
+        static const size_t CURSOR_FORWARD_STRING_LENGTH = 6;
         static const COORD INVALID_COORDS;
 
         VtEngine(_In_ wil::unique_hfile hPipe,
@@ -82,7 +86,17 @@ namespace Microsoft::Console::Render
 
     protected:
         wil::unique_hfile _hFile;
+        // The frame that's being composed. _Flush hands it to _writeWork, which
+        // writes it to the pipe while the next frame is composed into _buffer.
         std::string _buffer;
+        std::string _pendingBuffer;
+        DWORD _pendingWriteError{ ERROR_SUCCESS };
+        std::chrono::steady_clock::duration _pendingWriteTime{};
+        bool _writePending{ false };
+        bool _flushSynchronously{ false };
+        // Declared after the buffers and the pipe, so that it's destroyed (and
+        // waits for a write that's still running) before they are.
+        wil::unique_threadpool_work_nocancel _writeWork;
 
         std::string _formatBuffer;
         std::string _conversionBuffer;
@@ -94,6 +108,21 @@ namespace Microsoft::Console::Render
         std::pmr::unsynchronized_pool_resource _pool;
         til::pmr::bitmap _invalidMap;
 
+        // What we last emitted to each cell of the viewport, so that cells which
+        // get repainted without having changed don't need to be sent again.
+        // A length of 0 means that we don't know what's in the cell, for
+        // instance because it's the second half of a wide glyph, or because
+        // something we can't keep track of was written to the terminal.
+        struct ShadowCell
+        {
+            TextAttribute attributes;
+            std::array<wchar_t, 2> text{};
+            uint8_t length{ 0 };
+            uint8_t columns{ 0 };
+        };
+        std::vector<ShadowCell> _shadowScreen;
+        til::size _shadowSize;
+
         COORD _lastText;
         til::point _scrollDelta;
 
@@ -127,14 +156,28 @@ namespace Microsoft::Console::Render
 
         [[nodiscard]] HRESULT _Write(std::string_view const str) noexcept;
         [[nodiscard]] HRESULT _Flush() noexcept;
+        [[nodiscard]] HRESULT _WaitForPendingWrite() noexcept;
+        void _WritePendingBuffer() noexcept;
+        static void CALLBACK s_WritePendingBuffer(PTP_CALLBACK_INSTANCE instance, void* context, PTP_WORK work) noexcept;
 
         template<typename S, typename... Args>
         [[nodiscard]] HRESULT _WriteFormatted(S&& format, Args&&... args)
         try
         {
-            fmt::basic_memory_buffer<char, 64> buf;
-            fmt::format_to(std::back_inserter(buf), std::forward<S>(format), std::forward<Args>(args)...);
-            return _Write({ buf.data(), buf.size() });
+#ifdef UNIT_TESTING
+            if (_usingTestCallback)
+            {
+                fmt::basic_memory_buffer<char, 64> buf;
+                fmt::format_to(std::back_inserter(buf), std::forward<S>(format), std::forward<Args>(args)...);
+                return _Write({ buf.data(), buf.size() });
+            }
+#endif
+
+            // Format straight into the frame, instead of going through a temporary.
+            const auto offset = _buffer.size();
+            fmt::format_to(std::back_inserter(_buffer), std::forward<S>(format), std::forward<Args>(args)...);
+            _trace.TraceString(std::string_view{ _buffer }.substr(offset));
+            return S_OK;
         }
         CATCH_RETURN()
 
@@ -198,6 +241,9 @@ namespace Microsoft::Console::Render
         [[nodiscard]] HRESULT _PaintUtf8BufferLine(gsl::span<const Cluster> const clusters,
                                                    const COORD coord,
                                                    const bool lineWrapped) noexcept;
+        [[nodiscard]] HRESULT _PaintUtf8BufferRun(gsl::span<const Cluster> const clusters,
+                                                  const COORD coord,
+                                                  const bool lineWrapped) noexcept;
 
         [[nodiscard]] HRESULT _PaintAsciiBufferLine(gsl::span<const Cluster> const clusters,
                                                     const COORD coord) noexcept;
@@ -205,6 +251,13 @@ namespace Microsoft::Console::Render
         [[nodiscard]] HRESULT _WriteTerminalUtf8(const std::wstring_view str) noexcept;
         [[nodiscard]] HRESULT _WriteTerminalAscii(const std::wstring_view str) noexcept;
 
+        void _ResizeShadowScreen(const til::size size);
+        void _ForgetShadowScreen() noexcept;
+        void _ForgetShadowCells(const short row, const short begin, const short end) noexcept;
+        void _ScrollShadowScreen(const short delta) noexcept;
+        void _RecordShadowCells(gsl::span<const Cluster> const clusters, const COORD coord) noexcept;
+        bool _MatchesShadowCell(const Cluster& cluster, const short column, const short row) const noexcept;
+
         [[nodiscard]] virtual HRESULT _DoUpdateTitle(const std::wstring_view newTitle) noexcept override;
 
         /////////////////////////// Unit Testing Helpers ///////////////////////////
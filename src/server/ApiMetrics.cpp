@@ -0,0 +1,236 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+
+#include "precomp.h"
+
+#include "ApiMetrics.h"
+
+#include "../host/globals.h"
+
+using namespace std::chrono;
+
+std::mutex ApiMetrics::s_tablesLock;
+std::vector<std::unique_ptr<ApiMetrics::Table>> ApiMetrics::s_tables;
+
+// Time the current thread spent waiting for the console lock. See CONSOLE_INFORMATION::LockConsole.
+static thread_local steady_clock::duration t_lockWait{};
+
+// Routine Description:
+// - Only the thread owning a table ever writes to it, so its counters can be bumped
+//   without an interlocked instruction. The atomics merely make it safe for s_Collect
+//   to read them from another thread.
+static void _Add(std::atomic<uint64_t>& counter, const uint64_t value) noexcept
+{
+    counter.store(counter.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+}
+
+static microseconds _ToMicroseconds(const uint64_t value) noexcept
+{
+    return microseconds{ gsl::narrow_cast<microseconds::rep>(value) };
+}
+
+// Routine Description:
+// - Records a call to a console API in the current thread's table.
+// Arguments:
+// - apiNumber - The number of the API that was called, as sent by the client.
+// - name - The name of the API. Must be a string with static storage duration.
+// - elapsed - How long the API routine took.
+// - lockWait - How much of that time was spent waiting for the console lock.
+// - bytesIn - The size of the message the client sent.
+// - bytesOut - The amount of data returned to the client.
+void ApiMetrics::s_Record(const ULONG apiNumber,
+                          PCSTR name,
+                          const steady_clock::duration elapsed,
+                          const steady_clock::duration lockWait,
+                          const ULONG bytesIn,
+                          const ULONG_PTR bytesOut) noexcept
+try
+{
+    const size_t layer = (apiNumber >> 24) - 1;
+    const size_t index = apiNumber & 0xffffff;
+    if (layer >= LayerCount || index >= ApisPerLayer)
+    {
+        return;
+    }
+
+    auto& slot = til::at(_GetThreadTable().slots, layer * ApisPerLayer + index);
+    const auto time = gsl::narrow_cast<uint64_t>(duration_cast<nanoseconds>(elapsed).count());
+    const auto micros = time / 1000;
+
+    slot.name.store(name, std::memory_order_relaxed);
+    _Add(slot.calls, 1);
+    _Add(slot.bytesIn, bytesIn);
+    _Add(slot.bytesOut, bytesOut);
+    _Add(slot.totalTime, time);
+    _Add(slot.lockWaitTime, gsl::narrow_cast<uint64_t>(duration_cast<nanoseconds>(lockWait).count()));
+    if (micros > slot.maxTime.load(std::memory_order_relaxed))
+    {
+        slot.maxTime.store(micros, std::memory_order_relaxed);
+    }
+    _Add(til::at(slot.buckets, _BucketFromMicroseconds(micros)), 1);
+}
+CATCH_LOG()
+
+// Routine Description:
+// - Accounts time the current thread spent waiting for the console lock.
+void ApiMetrics::s_AddLockWait(const steady_clock::duration wait) noexcept
+{
+    t_lockWait += wait;
+}
+
+// Routine Description:
+// - Returns the total time the current thread has spent waiting for the console lock so far.
+steady_clock::duration ApiMetrics::s_GetLockWait() noexcept
+{
+    return t_lockWait;
+}
+
+// Routine Description:
+// - Sums up the tables of all threads.
+// Return Value:
+// - A summary for each API that has been called at least once, ordered by API number.
+std::vector<ApiMetrics::Summary> ApiMetrics::s_Collect()
+{
+    std::vector<Summary> summaries;
+
+    const std::lock_guard guard{ s_tablesLock };
+    for (size_t i = 0; i < LayerCount * ApisPerLayer; ++i)
+    {
+        Summary summary{};
+        uint64_t totalTime = 0;
+        uint64_t lockWaitTime = 0;
+        uint64_t maxTime = 0;
+        std::array<uint64_t, BucketCount> buckets{};
+
+        for (const auto& table : s_tables)
+        {
+            const auto& slot = til::at(table->slots, i);
+            const auto calls = slot.calls.load(std::memory_order_relaxed);
+            if (calls == 0)
+            {
+                continue;
+            }
+
+            summary.name = slot.name.load(std::memory_order_relaxed);
+            summary.calls += calls;
+            summary.bytesIn += slot.bytesIn.load(std::memory_order_relaxed);
+            summary.bytesOut += slot.bytesOut.load(std::memory_order_relaxed);
+            totalTime += slot.totalTime.load(std::memory_order_relaxed);
+            lockWaitTime += slot.lockWaitTime.load(std::memory_order_relaxed);
+            maxTime = std::max(maxTime, slot.maxTime.load(std::memory_order_relaxed));
+            for (size_t bucket = 0; bucket < BucketCount; ++bucket)
+            {
+                til::at(buckets, bucket) += til::at(slot.buckets, bucket).load(std::memory_order_relaxed);
+            }
+        }
+
+        if (summary.calls == 0)
+        {
+            continue;
+        }
+
+        // Returns the upper bound of the first bucket at which the given share of all calls have completed.
+        const auto percentile = [&](const uint64_t permille) {
+            const auto target = (summary.calls * permille + 999) / 1000;
+            uint64_t seen = 0;
+            for (size_t bucket = 0; bucket < BucketCount; ++bucket)
+            {
+                seen += til::at(buckets, bucket);
+                if (seen >= target)
+                {
+                    return _ToMicroseconds(std::min(_BucketUpperBound(bucket), maxTime));
+                }
+            }
+            return _ToMicroseconds(maxTime);
+        };
+
+        summary.apiNumber = gsl::narrow_cast<ULONG>(((i / ApisPerLayer + 1) << 24) | (i % ApisPerLayer));
+        summary.totalTime = duration_cast<microseconds>(nanoseconds{ gsl::narrow_cast<nanoseconds::rep>(totalTime) });
+        summary.lockWaitTime = duration_cast<microseconds>(nanoseconds{ gsl::narrow_cast<nanoseconds::rep>(lockWaitTime) });
+        summary.p50 = percentile(500);
+        summary.p90 = percentile(900);
+        summary.p99 = percentile(990);
+        summary.max = _ToMicroseconds(maxTime);
+        summaries.push_back(summary);
+    }
+
+    return summaries;
+}
+
+// Routine Description:
+// - Writes an event with the summary of each API that has been called so far.
+// - This is how the statistics are dumped on demand, for instance through the PTY signal pipe.
+void ApiMetrics::s_TraceSnapshot() noexcept
+try
+{
+    for (const auto& summary : s_Collect())
+    {
+#pragma warning(suppress : 26477 26485 26494 26482 26446) // We don't control TraceLoggingWrite
+        TraceLoggingWrite(g_hConhostV2EventTraceProvider,
+                          "ApiMetrics",
+                          TraceLoggingDescription("An event summarizing the calls to a console API since the server started"),
+                          TraceLoggingString(summary.name, "ApiName"),
+                          TraceLoggingHexUInt32(summary.apiNumber, "ApiNumber"),
+                          TraceLoggingUInt64(summary.calls, "Calls"),
+                          TraceLoggingInt64(summary.totalTime.count(), "TotalMicroseconds"),
+                          TraceLoggingInt64(summary.p50.count(), "P50Microseconds"),
+                          TraceLoggingInt64(summary.p90.count(), "P90Microseconds"),
+                          TraceLoggingInt64(summary.p99.count(), "P99Microseconds"),
+                          TraceLoggingInt64(summary.max.count(), "MaxMicroseconds"),
+                          TraceLoggingUInt64(summary.bytesIn, "BytesIn"),
+                          TraceLoggingUInt64(summary.bytesOut, "BytesOut"),
+                          TraceLoggingInt64(summary.lockWaitTime.count(), "LockWaitMicroseconds"),
+                          TraceLoggingLevel(WINEVENT_LEVEL_VERBOSE),
+                          TraceLoggingKeyword(TIL_KEYWORD_TRACE));
+    }
+}
+CATCH_LOG()
+
+// Routine Description:
+// - Returns the table of the current thread, creating it on first use.
+// - Tables are never freed, so that the calls of threads that have exited still show up in snapshots.
+ApiMetrics::Table& ApiMetrics::_GetThreadTable()
+{
+    static thread_local Table* table{ nullptr };
+    if (!table)
+    {
+        auto newTable = std::make_unique<Table>();
+        const std::lock_guard guard{ s_tablesLock };
+        s_tables.emplace_back(std::move(newTable));
+        table = s_tables.back().get();
+    }
+    return *table;
+}
+
+// Routine Description:
+// - Maps a duration to its histogram bucket. See BucketCount.
+size_t ApiMetrics::_BucketFromMicroseconds(const uint64_t value) noexcept
+{
+    if (value < 8)
+    {
+        return gsl::narrow_cast<size_t>(value);
+    }
+
+    size_t power = 3;
+    while (power < 63 && (value >> (power + 1)) != 0)
+    {
+        ++power;
+    }
+
+    const auto bucket = 8 + (power - 3) * 4 + gsl::narrow_cast<size_t>((value >> (power - 2)) & 3);
+    return std::min(bucket, BucketCount - 1);
+}
+
+// Routine Description:
+// - Returns the largest duration that maps to the given histogram bucket.
+uint64_t ApiMetrics::_BucketUpperBound(const size_t bucket) noexcept
+{
+    if (bucket < 8)
+    {
+        return bucket;
+    }
+
+    const auto power = (bucket - 8) / 4 + 3;
+    const auto step = uint64_t{ 1 } << (power - 2);
+    return (uint64_t{ 1 } << power) + ((bucket - 8) % 4 + 1) * step - 1;
+}
@@ -0,0 +1,85 @@
+/*++
+Copyright (c) Microsoft Corporation
+Licensed under the MIT license.
+
+Module Name:
+- ApiMetrics.h
+
+Abstract:
+- This file collects always-on statistics about the console APIs serviced by this server:
+  call counts, latency histograms, bytes in and out and the time spent waiting for the console lock.
+- Every thread records into a table of its own, so that recording never contends with other threads.
+  The tables are only summed up when a snapshot is requested.
+--*/
+
+#pragma once
+
+class ApiMetrics
+{
+public:
+    // API numbers carry a 1-based layer in their top byte and the index within that layer below it.
+    static constexpr size_t LayerCount{ 3 };
+    static constexpr size_t ApisPerLayer{ 64 };
+
+    // Latencies are bucketed like in an HDR histogram with 2 significant bits:
+    // durations below 8us get a bucket each, every power of two above that is split into 4.
+    // The last bucket collects everything above ~33s.
+    static constexpr size_t BucketCount{ 96 };
+
+    struct Summary
+    {
+        ULONG apiNumber;
+        PCSTR name;
+        uint64_t calls;
+        uint64_t bytesIn;
+        uint64_t bytesOut;
+        std::chrono::microseconds totalTime;
+        std::chrono::microseconds lockWaitTime;
+        std::chrono::microseconds p50;
+        std::chrono::microseconds p90;
+        std::chrono::microseconds p99;
+        std::chrono::microseconds max;
+    };
+
+    static void s_Record(const ULONG apiNumber,
+                         PCSTR name,
+                         const std::chrono::steady_clock::duration elapsed,
+                         const std::chrono::steady_clock::duration lockWait,
+                         const ULONG bytesIn,
+                         const ULONG_PTR bytesOut) noexcept;
+
+    static void s_AddLockWait(const std::chrono::steady_clock::duration wait) noexcept;
+    static std::chrono::steady_clock::duration s_GetLockWait() noexcept;
+
+    static std::vector<Summary> s_Collect();
+    static void s_TraceSnapshot() noexcept;
+
+private:
+    struct Slot
+    {
+        std::atomic<PCSTR> name{};
+        std::atomic<uint64_t> calls{};
+        std::atomic<uint64_t> bytesIn{};
+        std::atomic<uint64_t> bytesOut{};
+        std::atomic<uint64_t> totalTime{};
+        std::atomic<uint64_t> lockWaitTime{};
+        std::atomic<uint64_t> maxTime{};
+        std::array<std::atomic<uint64_t>, BucketCount> buckets{};
+    };
+
+    struct Table
+    {
+        std::array<Slot, LayerCount * ApisPerLayer> slots;
+    };
+
+    static Table& _GetThreadTable();
+    static size_t _BucketFromMicroseconds(const uint64_t value) noexcept;
+    static uint64_t _BucketUpperBound(const size_t bucket) noexcept;
+
+    static std::mutex s_tablesLock;
+    static std::vector<std::unique_ptr<Table>> s_tables;
+
+#ifdef UNIT_TESTING
+    friend class ApiMetricsTests;
+#endif
+};
@@ -6,6 +6,7 @@
 #include "ApiSorter.h"
 
 #include "ApiDispatchers.h"
+#include "ApiMetrics.h"
 
 #include "../host/tracing.hpp"
 
@@ -132,6 +133,11 @@ const CONSOLE_API_LAYER_DESCRIPTOR ConsoleApiLayerTable[] = {
     { ConsoleApiLayer3, RTL_NUMBER_OF(ConsoleApiLayer3) },
 };
 
+static_assert(std::size(ConsoleApiLayerTable) <= ApiMetrics::LayerCount);
+static_assert(std::size(ConsoleApiLayer1) <= ApiMetrics::ApisPerLayer);
+static_assert(std::size(ConsoleApiLayer2) <= ApiMetrics::ApisPerLayer);
+static_assert(std::size(ConsoleApiLayer3) <= ApiMetrics::ApisPerLayer);
+
 // Routine Description:
 // - This routine validates a user IO and dispatches it to the appropriate worker routine.
 // Arguments:
@@ -175,7 +181,15 @@ PCONSOLE_API_MSG ApiSorter::ConsoleDispatchRequest(_Inout_ PCONSOLE_API_MSG Mess
     NTSTATUS Status = S_OK;
     {
         const auto trace = Tracing::s_TraceApiCall(Status, Descriptor->TraceName);
+        const auto lockWait = ApiMetrics::s_GetLockWait();
+        const auto start = std::chrono::steady_clock::now();
         Status = (*Descriptor->Routine)(Message, &ReplyPending);
+        ApiMetrics::s_Record(Message->msgHeader.ApiNumber,
+                             Descriptor->TraceName,
+                             std::chrono::steady_clock::now() - start,
+                             ApiMetrics::s_GetLockWait() - lockWait,
+                             Message->Descriptor.InputSize,
+                             ReplyPending ? 0 : Message->Complete.IoStatus.Information);
     }
     if (Status != STATUS_BUFFER_TOO_SMALL)
     {
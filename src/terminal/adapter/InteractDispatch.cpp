@@ -32,8 +32,13 @@ InteractDispatch::InteractDispatch(std::unique_ptr<ConGetSet> pConApi) :
 // True if handled successfully. False otherwise.
 bool InteractDispatch::WriteInput(std::deque<std::unique_ptr<IInputEvent>>& inputEvents)
 {
-    size_t written = 0;
-    return _pConApi->PrivateWriteConsoleInputW(inputEvents, written);
+    for (const auto& event : inputEvents)
+    {
+        _pendingRecords.push_back(event->ToInputRecord());
+    }
+    inputEvents.clear();
+
+    return _batching || _WritePendingInput();
 }
 
 // Method Description:
@@ -47,12 +52,17 @@ bool InteractDispatch::WriteInput(std::deque<std::unique_ptr<IInputEvent>>& inpu
 // True if handled successfully. False otherwise.
 bool InteractDispatch::WriteCtrlKey(const KeyEvent& event)
 {
-    return _pConApi->PrivateWriteConsoleControlInput(event);
+    // Ctrl+C might flush the input buffer, so the input that came before it has to be in there first.
+    const auto written = _WritePendingInput();
+    ++_writtenEvents;
+    return _pConApi->PrivateWriteConsoleControlInput(event) && written;
 }
 
 // Method Description:
 // - Writes a string of input to the host. The string is converted to keystrokes
-//      that will faithfully represent the input by CharToKeyEvents.
+//      that will faithfully represent the input by CharToKeyRecords, and
+//      the whole string is handed to the input buffer in one write
+//      (or along with the rest of the batch, see BeginInputBatch).
 // Arguments:
 // - string : a string to write to the console.
 // Return Value:
@@ -68,18 +78,15 @@ bool InteractDispatch::WriteString(const std::wstring_view string)
     bool success = _pConApi->GetConsoleOutputCP(codepage);
     if (success)
     {
-        std::deque<std::unique_ptr<IInputEvent>> keyEvents;
+        // Most characters turn into a key down and a key up.
+        _pendingRecords.reserve(_pendingRecords.size() + string.size() * 2);
 
         for (const auto& wch : string)
         {
-            std::deque<std::unique_ptr<KeyEvent>> convertedEvents = Microsoft::Console::Interactivity::CharToKeyEvents(wch, codepage);
-
-            std::move(convertedEvents.begin(),
-                      convertedEvents.end(),
-                      std::back_inserter(keyEvents));
+            Microsoft::Console::Interactivity::CharToKeyRecords(wch, codepage, _pendingRecords);
         }
 
-        success = WriteInput(keyEvents);
+        success = _batching || _WritePendingInput();
     }
     return success;
 }
@@ -101,6 +108,8 @@ bool InteractDispatch::WindowManipulation(const DispatchTypes::WindowManipulatio
                                           const VTParameter parameter2)
 {
     bool success = false;
+    // Resizing the window writes a WINDOW_BUFFER_SIZE_EVENT, which belongs after the input that came before it.
+    _WritePendingInput();
     // Other Window Manipulation functions:
     //  MSFT:13271098 - QueryViewport
     //  MSFT:13271146 - QueryScreenSize
@@ -210,3 +219,51 @@ bool InteractDispatch::IsVtInputEnabled() const
 {
     return _pConApi->PrivateIsVtInputEnabled();
 }
+
+// Method Description:
+// - Starts collecting the input written through this dispatch, so that
+//   EndInputBatch can hand all of it to the input buffer in a single write.
+// - Control keys and window manipulations still take effect immediately,
+//   after writing whatever input was collected before them.
+// Arguments:
+// - <none>
+// Return value:
+// - <none>
+void InteractDispatch::BeginInputBatch() noexcept
+{
+    _batching = true;
+    _writtenEvents = 0;
+}
+
+// Method Description:
+// - Writes the input collected since BeginInputBatch to the input buffer.
+// Arguments:
+// - <none>
+// Return value:
+// - The number of events that were handed to the input buffer during the batch.
+size_t InteractDispatch::EndInputBatch()
+{
+    _batching = false;
+    LOG_HR_IF(E_FAIL, !_WritePendingInput());
+    return std::exchange(_writtenEvents, 0);
+}
+
+// Method Description:
+// - Hands the pending input to the input buffer, if there is any.
+// Arguments:
+// - <none>
+// Return value:
+// - True if handled successfully. False otherwise.
+bool InteractDispatch::_WritePendingInput()
+{
+    if (_pendingRecords.empty())
+    {
+        return true;
+    }
+
+    size_t written = 0;
+    const auto success = _pConApi->PrivateWriteConsoleInputW(_pendingRecords, written);
+    _writtenEvents += _pendingRecords.size();
+    _pendingRecords.clear();
+    return success;
+}
@@ -35,7 +35,18 @@ namespace Microsoft::Console::VirtualTerminal
 
         bool IsVtInputEnabled() const override;
 
+        void BeginInputBatch() noexcept;
+        size_t EndInputBatch();
+
     private:
         std::unique_ptr<ConGetSet> _pConApi;
+
+        // The input that hasn't been handed to the input buffer yet. Outside of a
+        // batch (see BeginInputBatch), it's written right after it's been added.
+        std::vector<INPUT_RECORD> _pendingRecords;
+        bool _batching{ false };
+        size_t _writtenEvents{ 0 };
+
+        bool _WritePendingInput();
     };
 }
@@ -6,6 +6,7 @@
 #include "../../inc/consoletaeftemplates.hpp"
 
 #include "adaptDispatch.hpp"
+#include "InteractDispatch.hpp"
 
 using namespace WEX::Common;
 using namespace WEX::Logging;
@@ -259,6 +260,13 @@ public:
         return _privateWriteConsoleInputWResult;
     }
 
+    bool PrivateWriteConsoleInputW(const gsl::span<const INPUT_RECORD> records,
+                                   size_t& eventsWritten) override
+    {
+        auto events = IInputEvent::Create(records);
+        return PrivateWriteConsoleInputW(events, eventsWritten);
+    }
+
     bool PrivateWriteConsoleControlInput(_In_ KeyEvent key) override
     {
         Log::Comment(L"PrivateWriteConsoleControlInput MOCK called...");
@@ -2632,6 +2640,43 @@ public:
         VERIFY_IS_TRUE(_pDispatch.get()->DesignateCodingSystem(DispatchTypes::CodingSystem::UTF8));
     }
 
+    TEST_METHOD(InteractDispatchBatchesInput)
+    {
+        auto api = std::make_unique<TestGetSet>();
+        auto& testGetSet = *api;
+        testGetSet.PrepData();
+        testGetSet._getConsoleOutputCPResult = true;
+        testGetSet._expectedOutputCP = CP_UTF8;
+        InteractDispatch dispatch{ std::move(api) };
+
+        Log::Comment(L"1. Input is written right away outside of a batch");
+        VERIFY_IS_TRUE(dispatch.WriteString(L"a"));
+        VERIFY_ARE_EQUAL(2u, testGetSet._events.size());
+
+        Log::Comment(L"2. Input written during a batch is held back until it ends");
+        testGetSet._events.clear();
+        dispatch.BeginInputBatch();
+        VERIFY_IS_TRUE(dispatch.WriteString(L"bc"));
+        std::deque<std::unique_ptr<IInputEvent>> inputEvents;
+        inputEvents.push_back(std::make_unique<FocusEvent>(true));
+        VERIFY_IS_TRUE(dispatch.WriteInput(inputEvents));
+        VERIFY_IS_TRUE(inputEvents.empty());
+        VERIFY_IS_TRUE(testGetSet._events.empty());
+
+        // The mock only keeps the events of the last write, so they all have to arrive in one.
+        VERIFY_ARE_EQUAL(5u, dispatch.EndInputBatch());
+        VERIFY_ARE_EQUAL(5u, testGetSet._events.size());
+        VERIFY_ARE_EQUAL(InputEventType::FocusEvent, testGetSet._events.back()->EventType());
+
+        Log::Comment(L"3. A control key writes the input that came before it first");
+        testGetSet._events.clear();
+        dispatch.BeginInputBatch();
+        VERIFY_IS_TRUE(dispatch.WriteString(L"d"));
+        VERIFY_IS_TRUE(dispatch.WriteCtrlKey(KeyEvent{ true, 1, 'C', 0, 0x3, LEFT_CTRL_PRESSED }));
+        VERIFY_ARE_EQUAL(2u, testGetSet._events.size());
+        VERIFY_ARE_EQUAL(3u, dispatch.EndInputBatch());
+    }
+
 private:
     TestGetSet* _testGetSet; // non-ownership pointer
     std::unique_ptr<AdaptDispatch> _pDispatch;
@@ -114,6 +114,15 @@ InputStateMachineEngine::InputStateMachineEngine(std::unique_ptr<IInteractDispat
 // - true iff we successfully dispatched the sequence.
 bool InputStateMachineEngine::ActionExecute(const wchar_t wch)
 {
+    // Inside a bracketed paste, carriage returns and tabs are kept with the
+    // text around them. WriteString types them just like _DoControlCharacter.
+    if (_inBracketedPaste && (wch == UNICODE_CARRIAGERETURN || wch == UNICODE_TAB))
+    {
+        _pastedText.push_back(wch);
+        return true;
+    }
+
+    FlushPastedText();
     return _DoControlCharacter(wch, false);
 }
 
@@ -218,6 +227,8 @@ bool InputStateMachineEngine::_DoControlCharacter(const wchar_t wch, const bool
 // - true iff we successfully dispatched the sequence.
 bool InputStateMachineEngine::ActionExecuteFromEscape(const wchar_t wch)
 {
+    FlushPastedText();
+
     if (_pDispatch->IsVtInputEnabled() && _pfnFlushToInputQueue)
     {
         return _pfnFlushToInputQueue();
@@ -235,6 +246,12 @@ bool InputStateMachineEngine::ActionExecuteFromEscape(const wchar_t wch)
 // - true iff we successfully dispatched the sequence.
 bool InputStateMachineEngine::ActionPrint(const wchar_t wch)
 {
+    if (_inBracketedPaste)
+    {
+        _pastedText.push_back(wch);
+        return true;
+    }
+
     short vkey = 0;
     DWORD modifierState = 0;
     bool success = _GenerateKeyFromChar(wch, vkey, modifierState);
@@ -258,6 +275,11 @@ bool InputStateMachineEngine::ActionPrintString(const std::wstring_view string)
     {
         return true;
     }
+    if (_inBracketedPaste)
+    {
+        _pastedText.append(string);
+        return true;
+    }
     return _pDispatch->WriteString(string);
 }
 
@@ -270,6 +292,8 @@ bool InputStateMachineEngine::ActionPrintString(const std::wstring_view string)
 // - true iff we successfully dispatched the sequence.
 bool InputStateMachineEngine::ActionPassThroughString(const std::wstring_view string)
 {
+    FlushPastedText();
+
     if (_pDispatch->IsVtInputEnabled())
     {
         // Synthesize string into key events that we'll write to the buffer
@@ -304,6 +328,8 @@ bool InputStateMachineEngine::ActionPassThroughString(const std::wstring_view st
 // - true iff we successfully dispatched the sequence.
 bool InputStateMachineEngine::ActionEscDispatch(const VTID id)
 {
+    FlushPastedText();
+
     if (_pDispatch->IsVtInputEnabled() && _pfnFlushToInputQueue)
     {
         return _pfnFlushToInputQueue();
@@ -362,6 +388,8 @@ bool InputStateMachineEngine::ActionVt52EscDispatch(const VTID /*id*/, const VTP
 // - true iff we successfully dispatched the sequence.
 bool InputStateMachineEngine::ActionCsiDispatch(const VTID id, const VTParameters parameters)
 {
+    FlushPastedText();
+
     // GH#4999 - If the client was in VT input mode, but we received a
     // win32-input-mode sequence, then _don't_ passthrough the sequence to the
     // client. It's impossibly unlikely that the client actually wanted
@@ -422,10 +450,27 @@ bool InputStateMachineEngine::ActionCsiDispatch(const VTID id, const VTParameter
         success = success && _WriteSingleKey(vkey, modifierState);
         break;
     case CsiActionCodes::Generic:
-        success = _GetGenericVkey(parameters.at(0), vkey);
+    {
+        const GenericKeyIdentifiers identifier = parameters.at(0);
+        // The bracketed paste markers aren't keys. They tell us that the
+        // text between them can be written to the input buffer as a whole.
+        if (identifier == GenericKeyIdentifiers::BracketedPasteStart)
+        {
+            _inBracketedPaste = true;
+            success = true;
+            break;
+        }
+        else if (identifier == GenericKeyIdentifiers::BracketedPasteEnd)
+        {
+            _inBracketedPaste = false;
+            success = true;
+            break;
+        }
+        success = _GetGenericVkey(identifier, vkey);
         modifierState = _GetGenericKeysModifierState(parameters);
         success = success && _WriteSingleKey(vkey, modifierState);
         break;
+    }
     case CsiActionCodes::CursorBackTab:
         success = _WriteSingleKey(VK_TAB, SHIFT_PRESSED);
         break;
@@ -475,6 +520,8 @@ IStateMachineEngine::StringHandler InputStateMachineEngine::ActionDcsDispatch(co
 // - true iff we successfully dispatched the sequence.
 bool InputStateMachineEngine::ActionSs3Dispatch(const wchar_t wch, const VTParameters /*parameters*/)
 {
+    FlushPastedText();
+
     if (_pDispatch->IsVtInputEnabled() && _pfnFlushToInputQueue)
     {
         return _pfnFlushToInputQueue();
@@ -1130,6 +1177,29 @@ void InputStateMachineEngine::SetFlushToInputQueueCallback(std::function<bool()>
     _pfnFlushToInputQueue = pfnFlushToInputQueue;
 }
 
+// Method Description:
+// - Writes the text collected so far from a bracketed paste to the input as
+//      a single string. The paste itself continues until its end marker, so
+//      any further text is collected again.
+// - This is called before any other input is dispatched, and should be
+//      called by the owner once it has processed all the input it has on
+//      hand, so that a paste that never ends can't hold onto typed keys.
+// Arguments:
+// - <none>
+// Return Value:
+// - true iff there was nothing to write or the text was written successfully.
+bool InputStateMachineEngine::FlushPastedText()
+{
+    if (_pastedText.empty())
+    {
+        return true;
+    }
+
+    const auto success = _pDispatch->WriteString(_pastedText);
+    _pastedText.clear();
+    return success;
+}
+
 // Method Description:
 // - Retrieves the type of window manipulation operation from the parameter pool
 //      stored during Param actions.
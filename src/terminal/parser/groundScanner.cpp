@@ -0,0 +1,155 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+
+#include "precomp.h"
+#include "groundScanner.hpp"
+#include "ascii.hpp"
+
+#if defined(_M_IX86) || defined(_M_AMD64)
+#include <immintrin.h>
+#endif
+
+using namespace Microsoft::Console::VirtualTerminal;
+
+// Routine Description:
+// - Determines if a character indicates an action that should be taken in the ground state.
+//   This is the scalar equivalent of the vectorized checks below:
+//   C0 characters (0x00 - 0x1F), DEL (0x7F) and the C1 range (0x80 - 0x9F).
+// Arguments:
+// - wch - Character to check.
+// Return Value:
+// - True if it is. False if it isn't.
+static constexpr bool _isActionable(const wchar_t wch) noexcept
+{
+    return wch <= AsciiChars::US || (wch >= AsciiChars::DEL && wch <= L'\x9F');
+}
+
+using FindActionableFn = size_t (*)(const std::wstring_view) noexcept;
+
+// Routine Description:
+// - Picks the fastest implementation of FindActionable() the CPU supports.
+// Return Value:
+// - The function to use for all further calls to FindActionable().
+static FindActionableFn _selectImplementation() noexcept
+{
+#if defined(_M_IX86) || defined(_M_AMD64)
+    if (til::is_avx2_supported())
+    {
+        return &GroundScanner::FindActionableAvx2;
+    }
+    // SSE2 is part of the baseline for all CPUs capable of running Windows 8 and later.
+    return &GroundScanner::FindActionableSse2;
+#else
+    return &GroundScanner::FindActionableScalar;
+#endif
+}
+
+static const FindActionableFn s_findActionable = _selectImplementation();
+
+// Routine Description:
+// - Finds the first character in the given string that can't be printed
+//   as-is while the state machine is in the ground state.
+// Arguments:
+// - string - The string to scan.
+// Return Value:
+// - The index of the first actionable character, or string.size() if there is none.
+size_t GroundScanner::FindActionable(const std::wstring_view string) noexcept
+{
+    return s_findActionable(string);
+}
+
+// Routine Description:
+// - Reference implementation of FindActionable(), testing one character at a time.
+// Arguments:
+// - string - The string to scan.
+// Return Value:
+// - The index of the first actionable character, or string.size() if there is none.
+size_t GroundScanner::FindActionableScalar(const std::wstring_view string) noexcept
+{
+    const auto it = std::find_if(string.cbegin(), string.cend(), _isActionable);
+    return gsl::narrow_cast<size_t>(it - string.cbegin());
+}
+
+#if defined(_M_IX86) || defined(_M_AMD64)
+
+#pragma warning(push)
+#pragma warning(disable : 26481 26490) // pointer arithmetic, reinterpret_cast
+
+// Routine Description:
+// - SSE2 implementation of FindActionable(). Tests 8 characters at a time.
+// - SSE2 lacks unsigned 16-bit comparisons, so "x <= limit" is computed as
+//   "saturating_sub(x, limit) == 0" instead:
+//   * C0: wch <= 0x1F
+//   * DEL and C1: (wch - 0x7F) <= 0x20 (with wraparound, so everything below DEL becomes huge)
+// Arguments:
+// - string - The string to scan.
+// Return Value:
+// - The index of the first actionable character, or string.size() if there is none.
+size_t GroundScanner::FindActionableSse2(const std::wstring_view string) noexcept
+{
+    const auto data = string.data();
+    const auto size = string.size();
+    size_t i = 0;
+
+    const auto zero = _mm_setzero_si128();
+    const auto c0Limit = _mm_set1_epi16(AsciiChars::US);
+    const auto c1Bias = _mm_set1_epi16(-AsciiChars::DEL);
+    const auto c1Limit = _mm_set1_epi16(0x9F - AsciiChars::DEL);
+
+    for (; i + 8 <= size; i += 8)
+    {
+        const auto chars = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i));
+        const auto isC0 = _mm_cmpeq_epi16(_mm_subs_epu16(chars, c0Limit), zero);
+        const auto isC1 = _mm_cmpeq_epi16(_mm_subs_epu16(_mm_add_epi16(chars, c1Bias), c1Limit), zero);
+        // There's no 16-bit movemask, so we get 2 bits per character.
+        const auto mask = gsl::narrow_cast<unsigned long>(_mm_movemask_epi8(_mm_or_si128(isC0, isC1)));
+
+        unsigned long index;
+        if (_BitScanForward(&index, mask))
+        {
+            return i + index / 2;
+        }
+    }
+
+    return i + FindActionableScalar(string.substr(i));
+}
+
+// Routine Description:
+// - AVX2 implementation of FindActionable(). Tests 16 characters at a time.
+//   See FindActionableSse2 for how the comparisons work.
+// Arguments:
+// - string - The string to scan.
+// Return Value:
+// - The index of the first actionable character, or string.size() if there is none.
+size_t GroundScanner::FindActionableAvx2(const std::wstring_view string) noexcept
+{
+    const auto data = string.data();
+    const auto size = string.size();
+    size_t i = 0;
+
+    const auto zero = _mm256_setzero_si256();
+    const auto c0Limit = _mm256_set1_epi16(AsciiChars::US);
+    const auto c1Bias = _mm256_set1_epi16(-AsciiChars::DEL);
+    const auto c1Limit = _mm256_set1_epi16(0x9F - AsciiChars::DEL);
+
+    for (; i + 16 <= size; i += 16)
+    {
+        const auto chars = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i));
+        const auto isC0 = _mm256_cmpeq_epi16(_mm256_subs_epu16(chars, c0Limit), zero);
+        const auto isC1 = _mm256_cmpeq_epi16(_mm256_subs_epu16(_mm256_add_epi16(chars, c1Bias), c1Limit), zero);
+        const auto mask = gsl::narrow_cast<unsigned long>(_mm256_movemask_epi8(_mm256_or_si256(isC0, isC1)));
+
+        unsigned long index;
+        if (_BitScanForward(&index, mask))
+        {
+            return i + index / 2;
+        }
+    }
+
+    // The remaining 0-15 characters are handled by the SSE2 loop and its scalar tail.
+    return i + FindActionableSse2(string.substr(i));
+}
+
+#pragma warning(pop)
+
+#endif
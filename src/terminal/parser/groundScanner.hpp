@@ -0,0 +1,32 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+
+/*
+Module Name:
+- groundScanner.hpp
+
+Abstract:
+- This declares the scanner used by the StateMachine while it's in the ground
+  state. It finds the next character that can't simply be printed (C0 and C1
+  control characters, ESC and DEL), so that everything before it can be handed
+  to the engine as a single run of printable text.
+- The scanner is vectorized with SSE2 and AVX2. The implementation is picked
+  once at runtime depending on the features the CPU supports.
+*/
+
+#pragma once
+
+namespace Microsoft::Console::VirtualTerminal
+{
+    class GroundScanner
+    {
+    public:
+        static size_t FindActionable(const std::wstring_view string) noexcept;
+
+        static size_t FindActionableScalar(const std::wstring_view string) noexcept;
+#if defined(_M_IX86) || defined(_M_AMD64)
+        static size_t FindActionableSse2(const std::wstring_view string) noexcept;
+        static size_t FindActionableAvx2(const std::wstring_view string) noexcept;
+#endif
+    };
+}
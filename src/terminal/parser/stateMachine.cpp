@@ -4,6 +4,7 @@
 #include "precomp.h"
 
 #include "stateMachine.hpp"
+#include "groundScanner.hpp"
 
 #include "ascii.hpp"
 
@@ -364,19 +365,44 @@ static constexpr bool _isApcIndicator(const wchar_t wch) noexcept
     return wch == L'_'; // 0x5F
 }
 
-// Routine Description:
-// - Determines if a character indicates an action that should be taken in the ground state -
-//     These are C0 characters and the C1 [single-character] CSI.
-// Arguments:
-// - wch - Character to check.
-// Return Value:
-// - True if it is. False if it isn't.
-static constexpr bool _isActionableFromGround(const wchar_t wch) noexcept
+#pragma warning(pop)
+
+// The fast path dispatches the handful of sequences that dominate typical
+// output (SGR, CUP, HVP, EL, ED and the OSC title and hyperlink strings)
+// straight from the input string, without going through the state machine.
+// Each character of a fast path CSI sequence is classified with this table;
+// anything outside of it sends the sequence down the regular path.
+enum class FastPathCsiClass : uint8_t
 {
-    return (wch <= AsciiChars::US) || _isC1ControlCharacter(wch) || _isDelete(wch);
-}
+    Invalid,
+    Digit,
+    Delimiter,
+    Final
+};
 
-#pragma warning(pop)
+static constexpr auto s_fastPathCsiClasses = []() {
+    std::array<FastPathCsiClass, 0x80> classes{};
+    for (auto wch = L'0'; wch <= L'9'; ++wch)
+    {
+        classes.at(wch) = FastPathCsiClass::Digit;
+    }
+    classes.at(L';') = FastPathCsiClass::Delimiter;
+    classes.at(L'm') = FastPathCsiClass::Final; // SGR
+    classes.at(L'H') = FastPathCsiClass::Final; // CUP
+    classes.at(L'f') = FastPathCsiClass::Final; // HVP
+    classes.at(L'K') = FastPathCsiClass::Final; // EL
+    classes.at(L'J') = FastPathCsiClass::Final; // ED
+    return classes;
+}();
+
+// DEC STD 070 requires at least 16 parameters to be supported, which covers
+// all but the most contrived SGR sequences. Longer ones take the regular path.
+static constexpr size_t MAX_FAST_PATH_PARAMETER_COUNT = 16;
+
+static constexpr bool _isFastPathOscParameter(const size_t parameter) noexcept
+{
+    return parameter == 0 || parameter == 8; // Set icon and window title, hyperlink
+}
 
 // Routine Description:
 // - Triggers the Execute action to indicate that the listener should immediately respond to a C0 control character.
@@ -1875,27 +1901,32 @@ void StateMachine::ProcessString(const std::wstring_view string)
         }
         else
         {
-            if (_isActionableFromGround(til::at(string, current))) // If the current char is the start of an escape sequence, or should be executed in ground state...
+            // Skip ahead to the next char that is the start of an escape sequence, or should be executed in ground state.
+            // Everything up to it can be printed as part of the current run.
+            current += GroundScanner::FindActionable(string.substr(current));
+
+            if (current < string.size())
             {
+                _runSize = current - start;
                 if (_runSize > 0)
                 {
-                    // Because the run above is composed INCLUDING current, we must
-                    // trim it off here since we just determined it's actionable
-                    // and only pass through everything before it.
-                    _runSize -= 1;
                     const auto allLeadingUpTo = _CurrentRun();
 
                     _engine->ActionPrintString(allLeadingUpTo); // ... print all the chars leading up to it as part of the run...
                     _trace.DispatchPrintRunTrace(allLeadingUpTo);
                 }
 
-                _processingIndividually = true; // begin processing future characters individually...
+                // Common sequences that are complete within this string can be dispatched
+                // directly, which leaves us in the ground state ready for the next run.
+                if (const auto consumed = _isEscape(til::at(string, current)) ? _DispatchFastPathSequence(current) : 0)
+                {
+                    current += consumed;
+                }
+                else
+                {
+                    _processingIndividually = true; // begin processing future characters individually...
+                }
                 start = current;
-                continue;
-            }
-            else
-            {
-                ++current; // Otherwise, add this char to the current run to be printed.
             }
         }
     }
@@ -2035,3 +2066,188 @@ void StateMachine::_AccumulateTo(const wchar_t wch, size_t& value) noexcept
         value = MAX_PARAMETER_VALUE;
     }
 }
+
+// Routine Description:
+// - Attempts to dispatch the escape sequence starting at the given offset of
+//   the current string without going through the state machine. Only complete
+//   sequences that are supported by the fast path are handled here, anything
+//   else (including sequences split across calls to ProcessString) is left for
+//   the state machine to process one character at a time.
+// - Must only be called in the Ground state.
+// Arguments:
+// - offset - Offset of the ESC character in the current string.
+// Return Value:
+// - The number of characters consumed, or 0 if the sequence wasn't handled.
+size_t StateMachine::_DispatchFastPathSequence(const size_t offset)
+{
+    if (!_parserMode.test(Mode::Ansi) || offset + 1 >= _currentString.size())
+    {
+        return 0;
+    }
+
+    const auto introducer = til::at(_currentString, offset + 1);
+    if (_isCsiIndicator(introducer))
+    {
+        return _DispatchFastPathCsi(offset);
+    }
+    if (_isOscIndicator(introducer))
+    {
+        return _DispatchFastPathOsc(offset);
+    }
+    return 0;
+}
+
+// Routine Description:
+// - Parses a CSI sequence with only numeric parameters and one of the final
+//   characters in s_fastPathCsiClasses into an inline parameter array, and
+//   dispatches it exactly as _ActionCsiDispatch would have.
+// Arguments:
+// - offset - Offset of the ESC character in the current string.
+// Return Value:
+// - The number of characters consumed, or 0 if the sequence wasn't handled.
+size_t StateMachine::_DispatchFastPathCsi(const size_t offset)
+{
+    std::array<VTParameter, MAX_FAST_PATH_PARAMETER_COUNT> parameters;
+    size_t parameterCount = 0;
+    size_t value = 0;
+    bool hasValue = false;
+
+    for (auto pos = offset + 2; pos < _currentString.size(); ++pos)
+    {
+        const auto wch = til::at(_currentString, pos);
+        const auto charClass = wch < s_fastPathCsiClasses.size() ? til::at(s_fastPathCsiClasses, wch) : FastPathCsiClass::Invalid;
+
+        switch (charClass)
+        {
+        case FastPathCsiClass::Digit:
+            // Like _ActionParam, the first parameter character starts the first parameter.
+            parameterCount = std::max<size_t>(parameterCount, 1);
+            _AccumulateTo(wch, value);
+            hasValue = true;
+            break;
+        case FastPathCsiClass::Delimiter:
+            // "Empty" params still count as a param - eg "\x1b[0;;m" has three.
+            parameterCount = std::max<size_t>(parameterCount, 1);
+            if (parameterCount >= MAX_FAST_PATH_PARAMETER_COUNT)
+            {
+                return 0;
+            }
+            if (hasValue)
+            {
+                til::at(parameters, parameterCount - 1) = value;
+            }
+            ++parameterCount;
+            value = 0;
+            hasValue = false;
+            break;
+        case FastPathCsiClass::Final:
+        {
+            if (hasValue)
+            {
+                til::at(parameters, parameterCount - 1) = value;
+            }
+
+            const auto length = pos - offset + 1;
+            _runOffset = offset;
+            _runSize = length;
+
+            _trace.ClearSequenceTrace();
+            _trace.TraceOnAction(L"CsiDispatch");
+
+            _engine->ActionClear();
+            const bool success = _engine->ActionCsiDispatch(VTID{ wch }, { parameters.data(), parameterCount });
+
+            // Trace the result.
+            _trace.DispatchSequenceTrace(success);
+
+            if (!success)
+            {
+                // Suppress it and log telemetry on failed cases
+                TermTelemetry::Instance().LogFailed(wch);
+            }
+            return length;
+        }
+        default:
+            return 0;
+        }
+    }
+
+    return 0;
+}
+
+// Routine Description:
+// - Parses an OSC sequence for one of the parameters accepted by
+//   _isFastPathOscParameter, terminated by either BEL or ST, and dispatches
+//   its string as a view into the current string rather than a copy.
+// Arguments:
+// - offset - Offset of the ESC character in the current string.
+// Return Value:
+// - The number of characters consumed, or 0 if the sequence wasn't handled.
+size_t StateMachine::_DispatchFastPathOsc(const size_t offset)
+{
+    const auto size = _currentString.size();
+    size_t parameter = 0;
+
+    auto pos = offset + 2;
+    while (pos < size && _isNumericParamValue(til::at(_currentString, pos)))
+    {
+        _AccumulateTo(til::at(_currentString, pos), parameter);
+        ++pos;
+    }
+
+    if (pos >= size || !_isOscDelimiter(til::at(_currentString, pos)) || !_isFastPathOscParameter(parameter))
+    {
+        return 0;
+    }
+
+    const auto stringOffset = ++pos;
+    while (pos < size)
+    {
+        const auto wch = til::at(_currentString, pos);
+        if (wch < AsciiChars::SPC || (_isC1ControlCharacter(wch) && _parserMode.test(Mode::AcceptC1)))
+        {
+            break;
+        }
+        ++pos;
+    }
+
+    // The state machine ignores some C0 controls inside OSC strings and
+    // aborts the sequence on others, so only a string that runs cleanly up
+    // to a BEL or an ESC \ terminator can be dispatched from here.
+    wchar_t terminator;
+    size_t terminatorLength;
+    if (pos < size && _isOscTerminator(til::at(_currentString, pos)))
+    {
+        terminator = AsciiChars::BEL;
+        terminatorLength = 1;
+    }
+    else if (pos + 1 < size && _isEscape(til::at(_currentString, pos)) && _isStringTerminatorIndicator(til::at(_currentString, pos + 1)))
+    {
+        terminator = til::at(_currentString, pos + 1);
+        terminatorLength = 2;
+    }
+    else
+    {
+        return 0;
+    }
+
+    const auto length = pos + terminatorLength - offset;
+    _runOffset = offset;
+    _runSize = length;
+
+    _trace.ClearSequenceTrace();
+    _trace.TraceOnAction(L"OscDispatch");
+
+    _engine->ActionClear();
+    const bool success = _engine->ActionOscDispatch(terminator, parameter, _currentString.substr(stringOffset, pos - stringOffset));
+
+    // Trace the result.
+    _trace.DispatchSequenceTrace(success);
+
+    if (!success)
+    {
+        // Suppress it and log telemetry on failed cases
+        TermTelemetry::Instance().LogFailed(terminator);
+    }
+    return length;
+}
@@ -122,6 +122,10 @@ namespace Microsoft::Console::VirtualTerminal
 
         void _AccumulateTo(const wchar_t wch, size_t& value) noexcept;
 
+        size_t _DispatchFastPathSequence(const size_t offset);
+        size_t _DispatchFastPathCsi(const size_t offset);
+        size_t _DispatchFastPathOsc(const size_t offset);
+
         enum class VTStates
         {
             Ground,
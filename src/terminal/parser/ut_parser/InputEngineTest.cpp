@@ -17,6 +17,7 @@
 #include <sstream>
 #include <string>
 #include <algorithm>
+#include <chrono>
 
 #ifdef BUILD_ONECORE_INTERACTIVITY
 #include "../../../interactivity/inc/VtApiRedirection.hpp"
@@ -282,6 +283,10 @@ class Microsoft::Console::VirtualTerminal::InputEngineTest
     TEST_METHOD(TestWin32InputParsing);
     TEST_METHOD(TestWin32InputOptionals);
 
+    TEST_METHOD(BracketedPasteTest);
+    TEST_METHOD(UnterminatedPasteIsFlushed);
+    TEST_METHOD(PasteThroughput);
+
     friend class TestInteractDispatch;
 };
 
@@ -1611,3 +1616,104 @@ void InputEngineTest::TestWin32InputOptionals()
         }
     }
 }
+
+// Collects the characters of the key down events it's given, and counts how
+// many separate writes they arrived in.
+class PasteCollector
+{
+public:
+    void WriteInputCallback(std::deque<std::unique_ptr<IInputEvent>>& inEvents)
+    {
+        ++writes;
+        for (const auto& record : IInputEvent::ToInputRecords(inEvents))
+        {
+            if (record.EventType == KEY_EVENT &&
+                record.Event.KeyEvent.bKeyDown &&
+                record.Event.KeyEvent.uChar.UnicodeChar != UNICODE_NULL)
+            {
+                text.push_back(record.Event.KeyEvent.uChar.UnicodeChar);
+            }
+        }
+    }
+
+    std::wstring text;
+    size_t writes{ 0 };
+};
+
+void InputEngineTest::BracketedPasteTest()
+{
+    PasteCollector collector;
+    auto pfn = std::bind(&PasteCollector::WriteInputCallback, &collector, std::placeholders::_1);
+    auto dispatch = std::make_unique<TestInteractDispatch>(pfn, &testState);
+    auto inputEngine = std::make_unique<InputStateMachineEngine>(std::move(dispatch));
+    StateMachine stateMachine(std::move(inputEngine));
+
+    Log::Comment(L"A paste with a carriage return and a tab in it should be written in one go.");
+    const std::wstring pasted{ L"echo hi\rls\tX" };
+    stateMachine.ProcessString(L"\x1b[200~" + pasted + L"\x1b[201~");
+    VERIFY_ARE_EQUAL(pasted, collector.text);
+    VERIFY_ARE_EQUAL(1u, collector.writes);
+
+    Log::Comment(L"Outside of a paste, the carriage return is a key press of its own.");
+    collector.text.clear();
+    collector.writes = 0;
+    stateMachine.ProcessString(L"ab\rcd");
+    VERIFY_ARE_EQUAL(L"ab\rcd", collector.text);
+    VERIFY_ARE_EQUAL(3u, collector.writes);
+}
+
+void InputEngineTest::UnterminatedPasteIsFlushed()
+{
+    PasteCollector collector;
+    auto pfn = std::bind(&PasteCollector::WriteInputCallback, &collector, std::placeholders::_1);
+    auto dispatch = std::make_unique<TestInteractDispatch>(pfn, &testState);
+    auto inputEngine = std::make_unique<InputStateMachineEngine>(std::move(dispatch));
+    auto engine = inputEngine.get();
+    StateMachine stateMachine(std::move(inputEngine));
+
+    stateMachine.ProcessString(L"\x1b[200~abc");
+    VERIFY_ARE_EQUAL(0u, collector.writes);
+
+    Log::Comment(L"The end of a read hands over whatever has been pasted so far.");
+    VERIFY_IS_TRUE(engine->FlushPastedText());
+    VERIFY_ARE_EQUAL(L"abc", collector.text);
+    VERIFY_ARE_EQUAL(1u, collector.writes);
+
+    stateMachine.ProcessString(L"def\x1b[201~g");
+    VERIFY_ARE_EQUAL(L"abcdefg", collector.text);
+    VERIFY_ARE_EQUAL(3u, collector.writes);
+}
+
+void InputEngineTest::PasteThroughput()
+{
+    BEGIN_TEST_METHOD_PROPERTIES()
+        TEST_METHOD_PROPERTY(L"IsPerfTest", L"true")
+    END_TEST_METHOD_PROPERTIES()
+
+    PasteCollector collector;
+    auto pfn = std::bind(&PasteCollector::WriteInputCallback, &collector, std::placeholders::_1);
+    auto dispatch = std::make_unique<TestInteractDispatch>(pfn, &testState);
+    auto inputEngine = std::make_unique<InputStateMachineEngine>(std::move(dispatch));
+    StateMachine stateMachine(std::move(inputEngine));
+
+    // A 64 KiB paste of short lines, the way a terminal sends it with bracketed paste on.
+    std::wstring pasted;
+    for (unsigned int i = 0; i < 65536; ++i)
+    {
+        pasted.push_back(i % 80 == 79 ? L'\r' : static_cast<wchar_t>(L'a' + i % 26));
+    }
+    const std::wstring sequence{ L"\x1b[200~" + pasted + L"\x1b[201~" };
+
+    constexpr size_t iterations = 20;
+    const auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < iterations; ++i)
+    {
+        collector.text.clear();
+        stateMachine.ProcessString(sequence);
+    }
+    const auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    VERIFY_ARE_EQUAL(pasted, collector.text);
+    VERIFY_ARE_EQUAL(iterations, collector.writes);
+    Log::Comment(NoThrowString().Format(L"%zu pasted characters parsed: %.1f M chars/s", iterations * pasted.size(), iterations * pasted.size() / elapsed / 1e6));
+}
@@ -6,6 +6,7 @@
 #include "../../inc/consoletaeftemplates.hpp"
 
 #include "stateMachine.hpp"
+#include "groundScanner.hpp"
 
 using namespace WEX::Common;
 using namespace WEX::Logging;
@@ -35,6 +36,8 @@ public:
         executed.clear();
         csiId = 0;
         csiParams.clear();
+        oscParameter = 0;
+        oscString.clear();
         dcsId = 0;
         dcsParams.clear();
         dcsDataString.clear();
@@ -69,14 +72,16 @@ public:
     bool ActionIgnore() override { return true; };
 
     bool ActionOscDispatch(const wchar_t /* wch */,
-                           const size_t /* parameter */,
-                           const std::wstring_view /* string */) override
+                           const size_t parameter,
+                           const std::wstring_view string) override
     {
         if (pfnFlushToTerminal)
         {
             pfnFlushToTerminal();
             return true;
         }
+        oscParameter = parameter;
+        oscString = string;
         return true;
     };
 
@@ -122,6 +127,10 @@ public:
     uint64_t csiId = 0;
     std::vector<size_t> csiParams;
 
+    // These will only be populated if ActionOscDispatch is called.
+    size_t oscParameter = 0;
+    std::wstring oscString;
+
     // Flush function for pass-through test.
     std::function<bool()> pfnFlushToTerminal;
 
@@ -162,6 +171,13 @@ class Microsoft::Console::VirtualTerminal::StateMachineTest
     TEST_METHOD(PassThroughUnhandledSplitAcrossWrites);
 
     TEST_METHOD(DcsDataStringsReceivedByHandler);
+
+    TEST_METHOD(FastPathMatchesStateMachine);
+    TEST_METHOD(FastPathPassesThroughWholeSequence);
+
+    TEST_METHOD(GroundScannerFindsEveryActionableCharacter);
+    TEST_METHOD(GroundScannerThroughput);
+    TEST_METHOD(SgrHeavyThroughput);
 };
 
 void StateMachineTest::TwoStateMachinesDoNotInterfereWithEachother()
@@ -342,3 +358,208 @@ void StateMachineTest::DcsDataStringsReceivedByHandler()
     // Verify the control characters were executed (if expected).
     VERIFY_ARE_EQUAL(expectedExecuted, engine.executed);
 }
+
+void StateMachineTest::FastPathMatchesStateMachine()
+{
+    // Each of these is processed once as a whole string, which allows the fast path to
+    // dispatch it, and once a character at a time, which forces it through the state
+    // machine. Both engines must end up seeing exactly the same thing.
+    const std::wstring_view sequences[] = {
+        L"\x1b[m",
+        L"\x1b[0m",
+        L"\x1b[1;31m",
+        L"\x1b[38;5;208m",
+        L"\x1b[38;2;255;128;0;48;2;0;0;255m",
+        L"\x1b[0;;m",
+        L"\x1b[;m",
+        L"\x1b[99999m",
+        L"\x1b[1;2;3;4;5;6;7;8;9;10;11;12;13;14;15;16m",
+        L"\x1b[1;2;3;4;5;6;7;8;9;10;11;12;13;14;15;16;17m",
+        L"\x1b[H",
+        L"\x1b[12;34H",
+        L"\x1b[5;6f",
+        L"\x1b[K",
+        L"\x1b[2J",
+        L"\x1b[?25h",
+        L"\x1b[3C",
+        L"\x1b[1\x0a" L"2m",
+        L"\x1b[1\x18m",
+        L"\x1b]0;title\x07",
+        L"\x1b];title\x1b\\",
+        L"\x1b]8;id=1;https://example.com\x1b\\",
+        L"\x1b]8;;\x07",
+        L"\x1b]2;other title\x07",
+        L"\x1b]0;tab\x09" L"bed\x07",
+        L"\x1b]0;unterminated\x1bX",
+    };
+
+    for (const auto sequence : sequences)
+    {
+        const auto text = L"before" + std::wstring{ sequence } + L"after";
+        Log::Comment(NoThrowString().Format(L"Sequence: %s", text.c_str()));
+
+        auto fastEnginePtr{ std::make_unique<TestStateMachineEngine>() };
+        const auto& fastEngine{ *fastEnginePtr.get() };
+        StateMachine fastMachine{ std::move(fastEnginePtr) };
+        fastMachine.ProcessString(text);
+
+        auto slowEnginePtr{ std::make_unique<TestStateMachineEngine>() };
+        const auto& slowEngine{ *slowEnginePtr.get() };
+        StateMachine slowMachine{ std::move(slowEnginePtr) };
+        for (const auto wch : text)
+        {
+            slowMachine.ProcessString({ &wch, 1 });
+        }
+
+        VERIFY_ARE_EQUAL(slowEngine.printed, fastEngine.printed);
+        VERIFY_ARE_EQUAL(slowEngine.executed, fastEngine.executed);
+        VERIFY_ARE_EQUAL(slowEngine.csiId, fastEngine.csiId);
+        VERIFY_ARE_EQUAL(slowEngine.csiParams, fastEngine.csiParams);
+        VERIFY_ARE_EQUAL(slowEngine.oscParameter, fastEngine.oscParameter);
+        VERIFY_ARE_EQUAL(slowEngine.oscString, fastEngine.oscString);
+    }
+}
+
+void StateMachineTest::FastPathPassesThroughWholeSequence()
+{
+    auto enginePtr{ std::make_unique<TestStateMachineEngine>() };
+    // this dance is required because StateMachine presumes to take ownership of its engine.
+    auto& engine{ *enginePtr.get() };
+    StateMachine machine{ std::move(enginePtr) };
+
+    // Hook up the passthrough function.
+    engine.pfnFlushToTerminal = std::bind(&StateMachine::FlushToTerminal, &machine);
+
+    machine.ProcessString(L"\x1b[1;31mRed\x1b[m \x1b]0;title\x07Plain");
+
+    VERIFY_ARE_EQUAL(L"\x1b[1;31m\x1b[m\x1b]0;title\x07", engine.passedThrough);
+    VERIFY_ARE_EQUAL(L"Red Plain", engine.printed);
+}
+
+void StateMachineTest::GroundScannerFindsEveryActionableCharacter()
+{
+    Log::Comment(L"Place every possible code unit at every offset of a 40 character long string "
+                 L"and verify that the vectorized scanners agree with the scalar one. "
+                 L"40 characters cover a full AVX2 block, a full SSE2 block and the scalar tail.");
+
+    std::wstring text(40, L'a');
+    for (size_t offset = 0; offset < text.size(); ++offset)
+    {
+        for (unsigned int wch = 0; wch <= 0xFFFF; ++wch)
+        {
+            text[offset] = gsl::narrow_cast<wchar_t>(wch);
+
+            const auto expected = GroundScanner::FindActionableScalar(text);
+            const auto expectedIndex = (wch <= 0x1F || (wch >= 0x7F && wch <= 0x9F)) ? offset : text.size();
+            if (expected != expectedIndex)
+            {
+                VERIFY_ARE_EQUAL(expectedIndex, expected, NoThrowString().Format(L"scalar: U+%04X at %zu", wch, offset));
+            }
+
+            const auto actual = GroundScanner::FindActionable(text);
+            if (actual != expected)
+            {
+                VERIFY_ARE_EQUAL(expected, actual, NoThrowString().Format(L"U+%04X at %zu", wch, offset));
+            }
+
+#if defined(_M_IX86) || defined(_M_AMD64)
+            const auto actualSse2 = GroundScanner::FindActionableSse2(text);
+            if (actualSse2 != expected)
+            {
+                VERIFY_ARE_EQUAL(expected, actualSse2, NoThrowString().Format(L"SSE2: U+%04X at %zu", wch, offset));
+            }
+
+            if (til::is_avx2_supported())
+            {
+                const auto actualAvx2 = GroundScanner::FindActionableAvx2(text);
+                if (actualAvx2 != expected)
+                {
+                    VERIFY_ARE_EQUAL(expected, actualAvx2, NoThrowString().Format(L"AVX2: U+%04X at %zu", wch, offset));
+                }
+            }
+#endif
+        }
+
+        text[offset] = L'a';
+    }
+}
+
+void StateMachineTest::GroundScannerThroughput()
+{
+    BEGIN_TEST_METHOD_PROPERTIES()
+        TEST_METHOD_PROPERTY(L"IsPerfTest", L"true")
+    END_TEST_METHOD_PROPERTIES()
+
+    // Long runs of printable text, broken up by the occasional SGR sequence and newline.
+    std::wstring text;
+    while (text.size() < 1024 * 1024)
+    {
+        text.append(L"src/terminal/parser/stateMachine.cpp(1848): \x1b[33mwarning\x1b[m C4100: unreferenced formal parameter\r\n");
+    }
+
+    const auto measure = [&](const wchar_t* name, auto&& scan) {
+        constexpr auto iterations = 64;
+        size_t actionable = 0;
+
+        const auto start = std::chrono::steady_clock::now();
+        for (auto i = 0; i < iterations; ++i)
+        {
+            for (size_t offset = 0; offset < text.size(); ++offset)
+            {
+                offset += scan(std::wstring_view{ text }.substr(offset));
+                ++actionable;
+            }
+        }
+        const auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        const auto megabytes = static_cast<double>(iterations * text.size() * sizeof(wchar_t)) / (1024 * 1024);
+        Log::Comment(NoThrowString().Format(L"%s: %.1f MB/s (%zu actionable characters)", name, megabytes / elapsed, actionable));
+    };
+
+    measure(L"Scalar", GroundScanner::FindActionableScalar);
+#if defined(_M_IX86) || defined(_M_AMD64)
+    measure(L"SSE2", GroundScanner::FindActionableSse2);
+    if (til::is_avx2_supported())
+    {
+        measure(L"AVX2", GroundScanner::FindActionableAvx2);
+    }
+#endif
+
+    auto enginePtr{ std::make_unique<TestStateMachineEngine>() };
+    StateMachine machine{ std::move(enginePtr) };
+
+    const auto start = std::chrono::steady_clock::now();
+    machine.ProcessString(text);
+    const auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    const auto megabytes = static_cast<double>(text.size() * sizeof(wchar_t)) / (1024 * 1024);
+    Log::Comment(NoThrowString().Format(L"StateMachine::ProcessString: %.1f MB/s", megabytes / elapsed));
+}
+
+void StateMachineTest::SgrHeavyThroughput()
+{
+    BEGIN_TEST_METHOD_PROPERTIES()
+        TEST_METHOD_PROPERTY(L"IsPerfTest", L"true")
+    END_TEST_METHOD_PROPERTIES()
+
+    // Short runs of text, each one wrapped in its own SGR sequences, like `ls --color`.
+    std::wstring text;
+    while (text.size() < 1024 * 1024)
+    {
+        text.append(L"\x1b[0m\x1b[01;34mbuild\x1b[0m  \x1b[01;32mconfigure\x1b[0m  \x1b[38;5;208mREADME.md\x1b[0m  src\r\n");
+    }
+
+    auto enginePtr{ std::make_unique<TestStateMachineEngine>() };
+    StateMachine machine{ std::move(enginePtr) };
+
+    constexpr auto iterations = 16;
+    const auto start = std::chrono::steady_clock::now();
+    for (auto i = 0; i < iterations; ++i)
+    {
+        machine.ProcessString(text);
+    }
+    const auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    const auto megabytes = static_cast<double>(iterations * text.size() * sizeof(wchar_t)) / (1024 * 1024);
+    Log::Comment(NoThrowString().Format(L"StateMachine::ProcessString: %.1f MB/s", megabytes / elapsed));
+}
@@ -235,6 +235,31 @@ class RunLengthEncodingTests
         VERIFY_ARE_EQUAL(expected_full, rle1);
     }
 
+    TEST_METHOD(ConstructWithPmr)
+    {
+        using pmr_rle_vector = til::pmr::small_rle<uint16_t, uint16_t, 1>;
+        std::pmr::unsynchronized_pool_resource pool{ til::pmr::get_default_resource() };
+
+        pmr_rle_vector rle1(5, 1, &pool);
+        VERIFY_ARE_EQUAL("1 1 1 1 1"sv, rle1);
+        VERIFY_ARE_EQUAL(&pool, rle1.get_allocator().resource());
+
+        // The runs that don't fit inline anymore come from the pool.
+        rle1.replace(1, 3, 2);
+        VERIFY_ARE_EQUAL("1|2 2|1 1"sv, rle1);
+        VERIFY_ARE_EQUAL(&pool, rle1.get_allocator().resource());
+
+        // copy with an allocator
+        const pmr_rle_vector rle2{ rle1, &pool };
+        VERIFY_ARE_EQUAL("1|2 2|1 1"sv, rle2);
+        VERIFY_ARE_EQUAL(&pool, rle2.get_allocator().resource());
+
+        // copy
+        const pmr_rle_vector rle3{ rle1 };
+        VERIFY_ARE_EQUAL("1|2 2|1 1"sv, rle3);
+        VERIFY_ARE_NOT_EQUAL(&pool, rle3.get_allocator().resource());
+    }
+
     TEST_METHOD(At)
     {
         rle_vector rle{
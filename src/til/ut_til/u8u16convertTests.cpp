@@ -17,6 +17,9 @@ class Utf8Utf16ConvertTests
     TEST_METHOD(TestU8ToU16Partials);
     TEST_METHOD(TestU16ToU8Partials);
     TEST_METHOD(TestU8ToU16OneByOne);
+    TEST_METHOD(TestU8ToU16Invalid);
+    TEST_METHOD(TestU16ToU8LoneSurrogates);
+    TEST_METHOD(TestLongMixedStrings);
 };
 
 void Utf8Utf16ConvertTests::TestU8ToU16()
@@ -191,3 +194,90 @@ void Utf8Utf16ConvertTests::TestU8ToU16OneByOne()
     VERIFY_SUCCEEDED(til::u8u16(u8String1_4, u16Out1, state));
     VERIFY_ARE_EQUAL(u16StringComp1, u16Out1);
 }
+
+void Utf8Utf16ConvertTests::TestU8ToU16Invalid()
+{
+    // Every maximal subpart of an ill-formed sequence is replaced with a single U+FFFD.
+    const std::string u8String{
+        '\x80', // lone continuation byte
+        'a',
+        '\xC0', // overlong lead byte
+        '\xAF',
+        'b',
+        '\xE0', // overlong 3 byte sequence
+        '\x80',
+        '\xAF',
+        'c',
+        '\xED', // surrogate U+D800
+        '\xA0',
+        '\x80',
+        'd',
+        '\xF4', // above U+10FFFF
+        '\x90',
+        '\x80',
+        '\x80',
+        'e',
+        '\xE2', // truncated EURO SIGN
+        '\x82',
+        'f',
+        '\xF0', // truncated CAMERA at the end of the string
+        '\x9F',
+        '\x93'
+    };
+
+    const std::wstring u16StringComp{ L"\xFFFD"
+                                      L"a\xFFFD\xFFFD"
+                                      L"b\xFFFD\xFFFD\xFFFD"
+                                      L"c\xFFFD\xFFFD\xFFFD"
+                                      L"d\xFFFD\xFFFD\xFFFD\xFFFD"
+                                      L"e\xFFFD"
+                                      L"f\xFFFD" };
+
+    std::wstring u16Out{};
+    VERIFY_SUCCEEDED(til::u8u16(u8String, u16Out));
+    VERIFY_ARE_EQUAL(u16StringComp, u16Out);
+}
+
+void Utf8Utf16ConvertTests::TestU16ToU8LoneSurrogates()
+{
+    const std::wstring u16String{
+        L'a',
+        gsl::narrow_cast<wchar_t>(0xDC00), // low surrogate without a high surrogate
+        L'b',
+        gsl::narrow_cast<wchar_t>(0xD800), // high surrogate without a low surrogate
+        L'c',
+        gsl::narrow_cast<wchar_t>(0xD83D), // high surrogate at the end of the string
+    };
+
+    const std::string u8StringComp{ "a\xEF\xBF\xBD"
+                                    "b\xEF\xBF\xBD"
+                                    "c\xEF\xBF\xBD" };
+
+    std::string u8Out{};
+    VERIFY_SUCCEEDED(til::u16u8(u16String, u8Out));
+    VERIFY_ARE_EQUAL(u8StringComp, u8Out);
+}
+
+void Utf8Utf16ConvertTests::TestLongMixedStrings()
+{
+    // ASCII is converted in blocks of up to 32 code units. Put non-ASCII at
+    // every offset of such a block to make sure we fall back correctly.
+    for (size_t offset = 0; offset < 80; ++offset)
+    {
+        std::string u8String(offset, 'x');
+        u8String.append("\xC3\xB6\xE2\x82\xAC\xF0\x9F\x93\xB7");
+        u8String.append(100, 'y');
+
+        std::wstring u16StringComp(offset, L'x');
+        u16StringComp.append(L"\x00F6\x20AC\xD83D\xDCF7");
+        u16StringComp.append(100, L'y');
+
+        std::wstring u16Out{};
+        VERIFY_SUCCEEDED(til::u8u16(u8String, u16Out));
+        VERIFY_ARE_EQUAL(u16StringComp, u16Out);
+
+        std::string u8Out{};
+        VERIFY_SUCCEEDED(til::u16u8(u16StringComp, u8Out));
+        VERIFY_ARE_EQUAL(u8String, u8Out);
+    }
+}
@@ -1,8 +1,8 @@
 // TEST TOOL U8U16Test
 // Performance tests for UTF-8 <--> UTF-16 conversions, related to PR #4093
-// NOTE The functions u8u16 and u16u8 contain own algorithms. Tests have shown that they perform
-// worse than the platform API functions.
-// Thus, these functions are *unrelated* to the til::u8u16 and til::u16u8 implementation.
+// NOTE The functions u8u16 and u16u8 contain the own algorithms of PR #4093. Tests have shown that they perform
+// worse than the platform API functions. They are *unrelated* to the til::u8u16 and til::u16u8 implementation,
+// which is compared with the platform API functions in the natural language tests.
 
 #pragma once
 
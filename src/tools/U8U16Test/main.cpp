@@ -1,8 +1,8 @@
 // TEST TOOL U8U16Test
 // Performance tests for UTF-8 <--> UTF-16 conversions, related to PR #4093
-// NOTE The functions u8u16 and u16u8 contain own algorithms. Tests have shown that they perform
-// worse than the platform API functions.
-// Thus, these functions are *unrelated* to the til::u8u16 and til::u16u8 implementation.
+// NOTE The functions u8u16 and u16u8 contain the own algorithms of PR #4093. Tests have shown that they perform
+// worse than the platform API functions. They are *unrelated* to the til::u8u16 and til::u16u8 implementation,
+// which is compared with the platform API functions in the natural language tests.
 
 #include <iostream>
 #include <memory>
@@ -13,6 +13,10 @@
 
 #include "U8U16Test.hpp"
 
+#include <wil/result_macros.h>
+#include <gsl/gsl_util>
+#include <til/u8u16convert.h>
+
 typedef NTSTATUS(WINAPI* t_RtlUTF8ToUnicodeN)(PWSTR, ULONG, PULONG, PCCH, ULONG);
 typedef NTSTATUS(WINAPI* t_RtlUnicodeToUTF8N)(PCHAR, ULONG, PULONG, PCWSTR, ULONG);
 NTSTATUS(WINAPI* p_RtlUTF8ToUnicodeN)
@@ -32,6 +36,7 @@ NTSTATUS(WINAPI* p_RtlUnicodeToUTF8N)
 
 // helper functions
 double GetDuration();
+double Throughput(size_t bytes, double duration);
 ptrdiff_t RandomIndex(ptrdiff_t length);
 void PrintHeader(const char* const funcName);
 
@@ -346,26 +351,38 @@ void CompNaturalLang_WholeString(const std::string& fileName)
     int length = MultiByteToWideChar(65001, 0, u8Str.data(), static_cast<int>(u8Str.length()), u16Buffer.get(), static_cast<int>(u8Str.length()));
     double duration = GetDuration();
     u16Buffer.reset();
-    std::cout << " MultiByteToWideChar length " << length << " elapsed " << duration << std::endl;
+    std::cout << " MultiByteToWideChar length " << length << " elapsed " << duration << " MB/s " << Throughput(u8Str.length(), duration) << std::endl;
 
     GetDuration();
     std::wstring u16Str{};
     HRESULT hRes = u8u16_ptr(u8Str, u16Str);
     duration = GetDuration();
-    std::cout << " u8u16_ptr           length " << u16Str.length() << " elapsed " << duration << std::endl;
+    std::cout << " u8u16_ptr           length " << u16Str.length() << " elapsed " << duration << " MB/s " << Throughput(u8Str.length(), duration) << std::endl;
+
+    GetDuration();
+    std::wstring u16StrTil{};
+    hRes = til::u8u16(u8Str, u16StrTil);
+    duration = GetDuration();
+    std::cout << " til::u8u16          length " << u16StrTil.length() << " elapsed " << duration << " MB/s " << Throughput(u8Str.length(), duration) << std::endl;
 
     GetDuration();
     std::unique_ptr<char[]> u8Buffer{ std::make_unique<char[]>(u16Str.length() * 3) };
     length = WideCharToMultiByte(65001, 0, u16Str.data(), static_cast<int>(u16Str.length()), u8Buffer.get(), static_cast<int>(u16Str.length()) * 3, nullptr, nullptr);
     duration = GetDuration();
     u8Buffer.reset();
-    std::cout << " WideCharToMultiByte length " << length << " elapsed " << duration << std::endl;
+    std::cout << " WideCharToMultiByte length " << length << " elapsed " << duration << " MB/s " << Throughput(u16Str.length() * sizeof(wchar_t), duration) << std::endl;
 
     GetDuration();
     std::string u8StrOut{};
     hRes = u16u8_ptr(u16Str, u8StrOut);
     duration = GetDuration();
-    std::cout << " u16u8_ptr           length " << u8StrOut.length() << " elapsed " << duration << std::endl;
+    std::cout << " u16u8_ptr           length " << u8StrOut.length() << " elapsed " << duration << " MB/s " << Throughput(u16Str.length() * sizeof(wchar_t), duration) << std::endl;
+
+    GetDuration();
+    std::string u8StrTil{};
+    hRes = til::u16u8(u16Str, u8StrTil);
+    duration = GetDuration();
+    std::cout << " til::u16u8          length " << u8StrTil.length() << " elapsed " << duration << " MB/s " << Throughput(u16Str.length() * sizeof(wchar_t), duration) << std::endl;
 }
 
 void CompNaturalLang_Chunks(const std::string& fileName)
@@ -391,10 +408,15 @@ void CompNaturalLang_Chunks(const std::string& fileName)
     int lenTotalWC2MB{};
     size_t lenTotalU8U16{};
     size_t lenTotalU16U8{};
+    size_t lenTotalTilU8U16{};
+    size_t lenTotalTilU16U8{};
+    size_t bytesTotalU8{};
     double durTotalMB2WC{};
     double durTotalWC2MB{};
     double durTotalU8U16{};
     double durTotalU16U8{};
+    double durTotalTilU8U16{};
+    double durTotalTilU16U8{};
 
     GetDuration();
     std::unique_ptr<wchar_t[]> u16Buffer{ std::make_unique<wchar_t[]>(chunkSize) };
@@ -416,6 +438,7 @@ void CompNaturalLang_Chunks(const std::string& fileName)
     {
         std::wstring u16Chunk{ u16Str.substr(idx, chunkSize) };
         std::string u8Chunk{ u16u8(u16Chunk) };
+        bytesTotalU8 += u8Chunk.length();
 
         GetDuration();
         lenTotalMB2WC += MultiByteToWideChar(65001, 0, u8Chunk.data(), static_cast<int>(u8Chunk.length()), u16Buffer.get(), static_cast<int>(u8Str.length()));
@@ -426,6 +449,11 @@ void CompNaturalLang_Chunks(const std::string& fileName)
         durTotalU8U16 += GetDuration();
         lenTotalU8U16 += u16StrOut.length();
 
+        GetDuration();
+        hRes = til::u8u16(u8Chunk, u16StrOut);
+        durTotalTilU8U16 += GetDuration();
+        lenTotalTilU8U16 += u16StrOut.length();
+
         GetDuration();
         lenTotalWC2MB += WideCharToMultiByte(65001, 0, u16Chunk.data(), static_cast<int>(u16Chunk.length()), u8Buffer.get(), static_cast<int>(u16Chunk.length()) * 3, nullptr, nullptr);
         durTotalWC2MB += GetDuration();
@@ -434,12 +462,20 @@ void CompNaturalLang_Chunks(const std::string& fileName)
         hRes = u16u8_ptr(u16Chunk, u8StrOut);
         durTotalU16U8 += GetDuration();
         lenTotalU16U8 += u8StrOut.length();
+
+        GetDuration();
+        hRes = til::u16u8(u16Chunk, u8StrOut);
+        durTotalTilU16U8 += GetDuration();
+        lenTotalTilU16U8 += u8StrOut.length();
     }
 
-    std::cout << " MultiByteToWideChar length " << lenTotalMB2WC << " elapsed " << durTotalMB2WC << std::endl;
-    std::cout << " u8u16_ptr           length " << lenTotalU8U16 << " elapsed " << durTotalU8U16 << std::endl;
-    std::cout << " WideCharToMultiByte length " << lenTotalWC2MB << " elapsed " << durTotalWC2MB << std::endl;
-    std::cout << " u16u8_ptr           length " << lenTotalU16U8 << " elapsed " << durTotalU16U8 << std::endl;
+    const size_t bytesTotalU16{ u16Str.length() * sizeof(wchar_t) };
+    std::cout << " MultiByteToWideChar length " << lenTotalMB2WC << " elapsed " << durTotalMB2WC << " MB/s " << Throughput(bytesTotalU8, durTotalMB2WC) << std::endl;
+    std::cout << " u8u16_ptr           length " << lenTotalU8U16 << " elapsed " << durTotalU8U16 << " MB/s " << Throughput(bytesTotalU8, durTotalU8U16) << std::endl;
+    std::cout << " til::u8u16          length " << lenTotalTilU8U16 << " elapsed " << durTotalTilU8U16 << " MB/s " << Throughput(bytesTotalU8, durTotalTilU8U16) << std::endl;
+    std::cout << " WideCharToMultiByte length " << lenTotalWC2MB << " elapsed " << durTotalWC2MB << " MB/s " << Throughput(bytesTotalU16, durTotalWC2MB) << std::endl;
+    std::cout << " u16u8_ptr           length " << lenTotalU16U8 << " elapsed " << durTotalU16U8 << " MB/s " << Throughput(bytesTotalU16, durTotalU16U8) << std::endl;
+    std::cout << " til::u16u8          length " << lenTotalTilU16U8 << " elapsed " << durTotalTilU16U8 << " MB/s " << Throughput(bytesTotalU16, durTotalTilU16U8) << std::endl;
 }
 
 int main()
@@ -533,6 +569,12 @@ double GetDuration()
     return elapsed.count();
 }
 
+// returns the number of megabytes of input converted per second
+double Throughput(size_t bytes, double duration)
+{
+    return duration > 0.0 ? static_cast<double>(bytes) / (1024.0 * 1024.0) / duration : 0.0;
+}
+
 // returns a value 0..(length - 1), or -1 if the function failed
 ptrdiff_t RandomIndex(ptrdiff_t length)
 {
@@ -14,11 +14,6 @@ namespace
         CodepointWidth width;
     };
 
-    static bool operator<(const UnicodeRange& range, const unsigned int searchTerm) noexcept
-    {
-        return range.upperBound < searchTerm;
-    }
-
     // Generated by Generate-CodepointWidthsFromUCD.ps1 -Pack:True -Full:False -NoOverrides:False
     // on 10/25/2020 7:32:04 AM (UTC) from Unicode 13.0.0.
     // 321205 (0x4E6B5) codepoints covered.
@@ -321,12 +316,154 @@ namespace
         UnicodeRange{ 0xf0000, 0xffffd, CodepointWidth::Ambiguous },
         UnicodeRange{ 0x100000, 0x10fffd, CodepointWidth::Ambiguous },
     };
+
+    // The widths of s_wideAndAmbiguousTable, flattened at compile time into a two-stage table.
+    // The first stage maps every page of 256 codepoints to a block in the second stage,
+    // which holds the widths of the page's codepoints with 2 bits each.
+    // Most pages are entirely narrow, wide or ambiguous, and share one of the first 3 blocks.
+    // Only the pages that a range starts or ends in within get a block of their own.
+    static constexpr unsigned int s_codepointCount = 0x110000;
+    static constexpr unsigned int s_pageShift = 8;
+    static constexpr unsigned int s_pageSize = 1 << s_pageShift;
+    static constexpr unsigned int s_pageCount = s_codepointCount >> s_pageShift;
+    static constexpr unsigned int s_widthBits = 2;
+    static constexpr unsigned int s_widthsPerWord = 32 / s_widthBits;
+    static constexpr size_t s_uniformBlockCount = 3;
+
+    static_assert(static_cast<unsigned int>(CodepointWidth::Narrow) == 0 &&
+                      static_cast<unsigned int>(CodepointWidth::Wide) == 1 &&
+                      static_cast<unsigned int>(CodepointWidth::Ambiguous) == 2,
+                  "s_widthTable stores CodepointWidth values in 2 bits");
+
+    static constexpr bool isPageCoveredBy(const UnicodeRange& range, const unsigned int page) noexcept
+    {
+        return range.lowerBound <= (page << s_pageShift) && range.upperBound >= ((page + 1) << s_pageShift) - 1;
+    }
+
+    static constexpr size_t countMixedPages() noexcept
+    {
+        size_t count = 0;
+        auto lastPage = s_pageCount;
+        for (const auto& range : s_wideAndAmbiguousTable)
+        {
+            // Only the first and last page of a range can be partially covered by it.
+            for (const auto page : { range.lowerBound >> s_pageShift, range.upperBound >> s_pageShift })
+            {
+                if (page != lastPage && !isPageCoveredBy(range, page))
+                {
+                    ++count;
+                    lastPage = page;
+                }
+            }
+        }
+        return count;
+    }
+
+    using WidthBlock = std::array<uint32_t, s_pageSize / s_widthsPerWord>;
+
+    // Returns a word of a WidthBlock, in which every codepoint has the given width.
+    static constexpr uint32_t uniformWidthWord(const CodepointWidth width) noexcept
+    {
+        uint32_t word = 0;
+        for (unsigned int i = 0; i < s_widthsPerWord; ++i)
+        {
+            word |= static_cast<uint32_t>(width) << (i * s_widthBits);
+        }
+        return word;
+    }
+
+    struct WidthTable final
+    {
+        std::array<uint8_t, s_pageCount> pages;
+        std::array<WidthBlock, s_uniformBlockCount + countMixedPages()> blocks;
+    };
+
+    static_assert(std::tuple_size_v<decltype(WidthTable::blocks)> <= UINT8_MAX + 1, "WidthTable::pages can't index all blocks");
+
+    static constexpr WidthTable buildWidthTable() noexcept
+    {
+        WidthTable table{};
+
+        // The first 3 blocks are filled with every codepoint being the width of the block index.
+        for (size_t i = 0; i < s_uniformBlockCount; ++i)
+        {
+            for (auto& word : table.blocks[i])
+            {
+                word = uniformWidthWord(static_cast<CodepointWidth>(i));
+            }
+        }
+
+        auto nextBlock = s_uniformBlockCount;
+        auto lastPage = s_pageCount;
+        for (const auto& range : s_wideAndAmbiguousTable)
+        {
+            for (auto page = range.lowerBound >> s_pageShift; page <= range.upperBound >> s_pageShift; ++page)
+            {
+                if (isPageCoveredBy(range, page))
+                {
+                    table.pages[page] = static_cast<uint8_t>(range.width);
+                    continue;
+                }
+
+                if (page != lastPage)
+                {
+                    table.pages[page] = static_cast<uint8_t>(nextBlock++);
+                    lastPage = page;
+                }
+
+                // Fill the part of the page that the range covers a word at a time.
+                auto& block = table.blocks[table.pages[page]];
+                const auto first = std::max(range.lowerBound, page << s_pageShift) & (s_pageSize - 1);
+                const auto last = std::min(range.upperBound, ((page + 1) << s_pageShift) - 1) & (s_pageSize - 1);
+                for (auto word = first / s_widthsPerWord; word <= last / s_widthsPerWord; ++word)
+                {
+                    const auto firstInWord = std::max(first, word * s_widthsPerWord) % s_widthsPerWord;
+                    const auto lastInWord = std::min(last, word * s_widthsPerWord + s_widthsPerWord - 1) % s_widthsPerWord;
+                    const auto lowMask = (uint32_t{ 1 } << (firstInWord * s_widthBits)) - 1;
+                    const auto highMask = lastInWord == s_widthsPerWord - 1 ? UINT32_MAX : (uint32_t{ 1 } << ((lastInWord + 1) * s_widthBits)) - 1;
+                    block[word] |= uniformWidthWord(range.width) & highMask & ~lowMask;
+                }
+            }
+        }
+
+        return table;
+    }
+
+    static constexpr WidthTable s_widthTable = buildWidthTable();
+
+    static constexpr CodepointWidth lookupCodepointWidth(const unsigned int codepoint) noexcept
+    {
+        if (codepoint >= s_codepointCount)
+        {
+            return CodepointWidth::Narrow;
+        }
+
+        const auto& block = s_widthTable.blocks[s_widthTable.pages[codepoint >> s_pageShift]];
+        const auto index = codepoint & (s_pageSize - 1);
+        const auto width = (block[index / s_widthsPerWord] >> (index % s_widthsPerWord * s_widthBits)) & ((1 << s_widthBits) - 1);
+        return static_cast<CodepointWidth>(width);
+    }
+
+    static_assert(lookupCodepointWidth(0x41) == CodepointWidth::Narrow);
+    static_assert(lookupCodepointWidth(0xa1) == CodepointWidth::Ambiguous);
+    static_assert(lookupCodepointWidth(0x4e00) == CodepointWidth::Wide);
+    static_assert(lookupCodepointWidth(0x1f6cc) == CodepointWidth::Wide);
+    static_assert(lookupCodepointWidth(0x1f6cd) == CodepointWidth::Narrow);
+    static_assert(lookupCodepointWidth(0x2fffd) == CodepointWidth::Wide);
+    static_assert(lookupCodepointWidth(0x2fffe) == CodepointWidth::Narrow);
+    static_assert(lookupCodepointWidth(0x10fffd) == CodepointWidth::Ambiguous);
+    static_assert(lookupCodepointWidth(0x10ffff) == CodepointWidth::Narrow);
+
+    // An empty slot in CodepointWidthDetector::_fallbackCache. Not a valid codepoint.
+    static constexpr unsigned int s_emptyFallbackCacheKey = UINT_MAX;
+    static constexpr size_t s_initialFallbackCacheCapacity = 64;
 }
 
 // Routine Description:
 // - Constructs an instance of the CodepointWidthDetector class
 CodepointWidthDetector::CodepointWidthDetector() noexcept :
     _fallbackCache{},
+    _fallbackCacheSize{ 0 },
     _pfnFallbackMethod{}
 {
 }
@@ -404,7 +541,7 @@ bool CodepointWidthDetector::IsWide(const std::wstring_view glyph) const
 }
 
 // Routine Description:
-// - returns the width type of codepoint by searching the map generated from the unicode spec
+// - returns the width type of codepoint by looking it up in the table generated from the unicode spec
 // Arguments:
 // - glyph - the utf16 encoded codepoint to search for
 // Return Value:
@@ -416,17 +553,7 @@ CodepointWidth CodepointWidthDetector::_lookupGlyphWidth(const std::wstring_view
         return CodepointWidth::Invalid;
     }
 
-    const auto codepoint = _extractCodepoint(glyph);
-    const auto it = std::lower_bound(s_wideAndAmbiguousTable.begin(), s_wideAndAmbiguousTable.end(), codepoint);
-
-    // For characters that are not _in_ the table, lower_bound will return the nearest item that is.
-    // We must check its bounds to make sure that our hit was a true hit.
-    if (it != s_wideAndAmbiguousTable.end() && codepoint >= it->lowerBound && codepoint <= it->upperBound)
-    {
-        return it->width;
-    }
-
-    return CodepointWidth::Narrow;
+    return lookupCodepointWidth(_extractCodepoint(glyph));
 }
 
 // Routine Description:
@@ -471,24 +598,89 @@ CodepointWidth CodepointWidthDetector::_lookupGlyphWidthWithCache(const std::wst
 // - Checks the fallback function but caches the results until the font changes
 //   because the lookup function is usually very expensive and will return the same results
 //   for the same inputs.
+// - The cache is keyed by codepoint, so only glyphs consisting of a single codepoint are cached.
+//   Longer clusters (for instance U+2640 U+FE0F) may render differently than their
+//   first codepoint alone and always go to the fallback function.
 // Arguments:
 // - glyph - the utf16 encoded codepoint to check width of
 // - true if codepoint is wide or false if it is narrow
 bool CodepointWidthDetector::_checkFallbackViaCache(const std::wstring_view glyph) const
 {
-    const std::wstring findMe{ glyph };
+    if (!_isSingleCodepoint(glyph))
+    {
+        return _pfnFallbackMethod(glyph);
+    }
+
+    const auto codepoint = _extractCodepoint(glyph);
 
-    // TODO: Cache needs to be emptied when font changes.
-    const auto it = _fallbackCache.find(findMe);
-    if (it == _fallbackCache.end())
+    if (const auto slot = _findFallbackCacheSlot(codepoint); slot && slot->codepoint == codepoint)
     {
-        auto result = _pfnFallbackMethod(glyph);
-        _fallbackCache.insert_or_assign(findMe, result);
-        return result;
+        return slot->isWide;
     }
-    else
+
+    const auto result = _pfnFallbackMethod(glyph);
+
+    // Keep the table at most half full, so that probing stays short and always ends at an empty slot.
+    if ((_fallbackCacheSize + 1) * 2 > _fallbackCache.size())
     {
-        return it->second;
+        std::vector<FallbackCacheEntry> entries(std::max(s_initialFallbackCacheCapacity, _fallbackCache.size() * 2), FallbackCacheEntry{ s_emptyFallbackCacheKey, false });
+        entries.swap(_fallbackCache);
+        for (const auto& entry : entries)
+        {
+            if (entry.codepoint != s_emptyFallbackCacheKey)
+            {
+                *_findFallbackCacheSlot(entry.codepoint) = entry;
+            }
+        }
+    }
+
+    *_findFallbackCacheSlot(codepoint) = FallbackCacheEntry{ codepoint, result };
+    ++_fallbackCacheSize;
+    return result;
+}
+
+// Routine Description:
+// - Finds the slot of a codepoint in the open addressed fallback cache,
+//   by probing linearly from the slot that the codepoint hashes to.
+// Arguments:
+// - codepoint - the codepoint to find
+// Return Value:
+// - the slot that holds the codepoint, or the empty slot that it would be inserted into.
+//   nullptr if the cache hasn't been allocated yet.
+CodepointWidthDetector::FallbackCacheEntry* CodepointWidthDetector::_findFallbackCacheSlot(const unsigned int codepoint) const noexcept
+{
+    if (_fallbackCache.empty())
+    {
+        return nullptr;
+    }
+
+    // Fibonacci hashing spreads the clustered codepoints of a script over the whole table.
+    const auto mask = _fallbackCache.size() - 1;
+    auto index = gsl::narrow_cast<size_t>((codepoint * 0x9E3779B97F4A7C15ull) >> 32) & mask;
+    while (til::at(_fallbackCache, index).codepoint != codepoint && til::at(_fallbackCache, index).codepoint != s_emptyFallbackCacheKey)
+    {
+        index = (index + 1) & mask;
+    }
+    return &til::at(_fallbackCache, index);
+}
+
+// Routine Description:
+// - checks whether the glyph is made up of exactly one codepoint,
+//   which is either a single code unit or a surrogate pair
+// Arguments:
+// - glyph - the utf16 encoded glyph to check
+// Return Value:
+// - true if glyph holds a single codepoint
+bool CodepointWidthDetector::_isSingleCodepoint(const std::wstring_view glyph) noexcept
+{
+    switch (glyph.size())
+    {
+    case 1:
+        return true;
+    case 2:
+        return IS_HIGH_SURROGATE(glyph.front()) && IS_LOW_SURROGATE(glyph.back());
+    default:
+        return false;
     }
 }
 
@@ -497,10 +689,10 @@ bool CodepointWidthDetector::_checkFallbackViaCache(const std::wstring_view glyp
 // Arguments:
 // - glyph - the utf16 encoded codepoint convert
 // Return Value:
-// - the codepoint being stored
+// - the codepoint being stored. For clusters of several codepoints, the first one.
 unsigned int CodepointWidthDetector::_extractCodepoint(const std::wstring_view glyph) noexcept
 {
-    if (glyph.size() == 1)
+    if (glyph.size() == 1 || !IS_HIGH_SURROGATE(glyph.front()))
     {
         return static_cast<unsigned int>(glyph.front());
     }
@@ -542,5 +734,6 @@ void CodepointWidthDetector::SetFallbackMethod(std::function<bool(const std::wst
 // - <none>
 void CodepointWidthDetector::NotifyFontChanged() const noexcept
 {
-    _fallbackCache.clear();
+    std::fill(_fallbackCache.begin(), _fallbackCache.end(), FallbackCacheEntry{ s_emptyFallbackCacheKey, false });
+    _fallbackCacheSize = 0;
 }
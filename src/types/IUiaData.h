@@ -41,6 +41,7 @@ namespace Microsoft::Console::Types
         virtual const COORD GetSelectionEnd() const noexcept = 0;
         virtual void ColorSelection(const COORD coordSelectionStart, const COORD coordSelectionEnd, const TextAttribute attr) = 0;
         virtual const bool IsUiaDataInitialized() const noexcept = 0;
+        virtual void ReflowScrollback() noexcept = 0;
     };
 
     // See docs/virtual-dtors.md for an explanation of why this is weird.
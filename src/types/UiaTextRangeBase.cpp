@@ -23,6 +23,10 @@ try
     RETURN_HR_IF_NULL(E_INVALIDARG, pProvider);
     RETURN_HR_IF_NULL(E_INVALIDARG, pData);
 
+    // A range may be moved anywhere in the buffer, so the scrollback
+    // can't be left for a resize to reflow later.
+    pData->ReflowScrollback();
+
     _pProvider = pProvider;
     _pData = pData;
     _start = pData->GetViewport().Origin();
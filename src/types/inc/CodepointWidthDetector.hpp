@@ -41,11 +41,22 @@ public:
 #endif
 
 private:
+    struct FallbackCacheEntry
+    {
+        unsigned int codepoint;
+        bool isWide;
+    };
+
     CodepointWidth _lookupGlyphWidth(const std::wstring_view glyph) const;
     CodepointWidth _lookupGlyphWidthWithCache(const std::wstring_view glyph) const noexcept;
     bool _checkFallbackViaCache(const std::wstring_view glyph) const;
+    FallbackCacheEntry* _findFallbackCacheSlot(const unsigned int codepoint) const noexcept;
+    static bool _isSingleCodepoint(const std::wstring_view glyph) noexcept;
     static unsigned int _extractCodepoint(const std::wstring_view glyph) noexcept;
 
-    mutable std::unordered_map<std::wstring, bool> _fallbackCache;
+    // An open addressed hash table of the fallback method's answers, keyed by codepoint.
+    // Its capacity is always a power of two, or 0 before the first fallback.
+    mutable std::vector<FallbackCacheEntry> _fallbackCache;
+    mutable size_t _fallbackCacheSize;
     std::function<bool(std::wstring_view)> _pfnFallbackMethod;
 };
@@ -19,6 +19,7 @@ typedef struct _PseudoConsole
 //      the signal pipe.
 #define PTY_SIGNAL_CLEAR_WINDOW (2u)
 #define PTY_SIGNAL_RESIZE_WINDOW (8u)
+#define PTY_SIGNAL_DUMP_API_METRICS (16u)
 
 // CreatePseudoConsole Flags
 // The other flag (PSEUDOCONSOLE_INHERIT_CURSOR) is actually defined in consoleapi.h in the OS repo